@@ -13,6 +13,57 @@ PIRC_O_FILES = \
     compilers/pirc/src/pirpcc$(O) \
     compilers/pirc/src/pirerr$(O) \
     compilers/pirc/src/pircapi$(O) \
+    compilers/pirc/src/pircache$(O) \
+    compilers/pirc/src/pirsnapshot$(O) \
+    compilers/pirc/src/pirstats$(O) \
+    compilers/pirc/src/pirjobs$(O) \
+    compilers/pirc/src/pirsplit$(O) \
+    compilers/pirc/src/pirproject$(O) \
+    compilers/pirc/src/pirserver$(O) \
     compilers/pirc/src/pirop$(O)
 
-PIRC_CLEANUPS = $(PIRC_O_FILES) "compilers/pirc/t/*.pir" ./pirc$(EXE)
+PIRC_MICROBENCH_O_FILES = \
+    compilers/pirc/src/pirbench$(O) \
+    compilers/pirc/src/pirparser$(O) \
+    compilers/pirc/src/pirlexer$(O) \
+    compilers/pirc/src/pircompunit$(O) \
+    compilers/pirc/src/pircompiler$(O) \
+    compilers/pirc/src/pirsymbol$(O) \
+    compilers/pirc/src/piremit$(O) \
+    compilers/pirc/src/hdocprep$(O) \
+    compilers/pirc/src/pirmacro$(O) \
+    compilers/pirc/src/pirregalloc$(O) \
+    compilers/pirc/src/bcgen$(O) \
+    compilers/pirc/src/pirpcc$(O) \
+    compilers/pirc/src/pirerr$(O) \
+    compilers/pirc/src/pircapi$(O) \
+    compilers/pirc/src/pircache$(O) \
+    compilers/pirc/src/pirsnapshot$(O) \
+    compilers/pirc/src/pirstats$(O) \
+    compilers/pirc/src/pirjobs$(O) \
+    compilers/pirc/src/pirop$(O)
+
+PIRC_STRESS_O_FILES = \
+    compilers/pirc/src/pirstress$(O) \
+    compilers/pirc/src/pirparser$(O) \
+    compilers/pirc/src/pirlexer$(O) \
+    compilers/pirc/src/pircompunit$(O) \
+    compilers/pirc/src/pircompiler$(O) \
+    compilers/pirc/src/pirsymbol$(O) \
+    compilers/pirc/src/piremit$(O) \
+    compilers/pirc/src/hdocprep$(O) \
+    compilers/pirc/src/pirmacro$(O) \
+    compilers/pirc/src/pirregalloc$(O) \
+    compilers/pirc/src/bcgen$(O) \
+    compilers/pirc/src/pirpcc$(O) \
+    compilers/pirc/src/pirerr$(O) \
+    compilers/pirc/src/pircapi$(O) \
+    compilers/pirc/src/pircache$(O) \
+    compilers/pirc/src/pirsnapshot$(O) \
+    compilers/pirc/src/pirstats$(O) \
+    compilers/pirc/src/pirjobs$(O) \
+    compilers/pirc/src/pirop$(O)
+
+PIRC_CLEANUPS = $(PIRC_O_FILES) "compilers/pirc/t/*.pir" ./pirc$(EXE) \
+    compilers/pirc/src/pirbench$(O) ./pirbench$(EXE) \
+    compilers/pirc/src/pirstress$(O) ./pirstress$(EXE) pirstress.pir
@@ -10,6 +10,7 @@ compilers/pirc/src/piremit$(O) : $(PARROT_H_HEADERS) \
         compilers/pirc/src/pirregalloc.h \
         compilers/pirc/src/pirsymbol.h \
         compilers/pirc/src/piryy.h \
+        compilers/pirc/src/pirstats.h \
         $(INC_DIR)/embed.h \
         $(INC_DIR)/oplib/ops.h
 
@@ -89,6 +90,7 @@ compilers/pirc/macro/macroparser$(O) : $(PARROT_H_HEADERS) \
 
 compilers/pirc/src/hdocprep$(O) : $(PARROT_H_HEADERS) \
         $(INC_DIR)/embed.h compilers/pirc/src/pirheredoc.h \
+        compilers/pirc/src/pirdefines.h \
         compilers/pirc/src/hdocprep.c
 
 compilers/pirc/src/main$(O) : \
@@ -107,7 +109,13 @@ compilers/pirc/src/main$(O) : \
         compilers/pirc/src/pirheredoc.h \
         compilers/pirc/src/pirsymbol.h \
         compilers/pirc/src/pirregalloc.h \
-        compilers/pirc/src/pircapi.h
+        compilers/pirc/src/pircapi.h \
+        compilers/pirc/src/pircache.h \
+        compilers/pirc/src/pirsnapshot.h \
+        compilers/pirc/src/pirstats.h \
+        compilers/pirc/src/pirsplit.h \
+        compilers/pirc/src/pirproject.h \
+        compilers/pirc/src/pirserver.h
 
 compilers/pirc/src/pircapi$(O) : \
         $(PARROT_H_HEADERS) \
@@ -124,8 +132,96 @@ compilers/pirc/src/pircapi$(O) : \
         compilers/pirc/src/piryy.h \
         compilers/pirc/src/pirlexer.h \
         compilers/pirc/src/pircapi.h \
+        compilers/pirc/src/pircache.h \
+        compilers/pirc/src/pirsnapshot.h \
+        compilers/pirc/src/pirstats.h \
+        $(INC_DIR)/embed.h
+
+compilers/pirc/src/pircache$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pircache.c \
+        compilers/pirc/src/pircache.h \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/pirmacro.h \
+        compilers/pirc/src/pirdefines.h \
+        compilers/pirc/src/bcgen.h \
         $(INC_DIR)/embed.h
 
+compilers/pirc/src/pirsnapshot$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirsnapshot.c \
+        compilers/pirc/src/pirsnapshot.h \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/pirmacro.h \
+        compilers/pirc/src/pirheredoc.h \
+        compilers/pirc/src/bcgen.h
+
+compilers/pirc/src/pirjobs$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirjobs.c \
+        compilers/pirc/src/pirjobs.h
+
+compilers/pirc/src/pirproject$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirproject.c \
+        compilers/pirc/src/pirproject.h \
+        compilers/pirc/src/pirjobs.h \
+        compilers/pirc/src/pircapi.h \
+        compilers/pirc/src/pircache.h \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/pirmacro.h \
+        compilers/pirc/src/pirsnapshot.h \
+        compilers/pirc/src/pirheredoc.h \
+        compilers/pirc/src/pirstats.h
+
+compilers/pirc/src/pirserver$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirserver.c \
+        compilers/pirc/src/pirserver.h \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/pirmacro.h
+
+compilers/pirc/src/pirsplit$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirsplit.c \
+        compilers/pirc/src/pirsplit.h \
+        compilers/pirc/src/pirjobs.h \
+        compilers/pirc/src/pircache.h \
+        compilers/pirc/src/pirparser.h \
+        compilers/pirc/src/pirlexer.h \
+        compilers/pirc/src/piryy.h \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/pirmacro.h \
+        compilers/pirc/src/pirsnapshot.h \
+        compilers/pirc/src/pirheredoc.h \
+        compilers/pirc/src/pirstats.h
+
+compilers/pirc/src/pirstats$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirstats.c \
+        compilers/pirc/src/pirstats.h \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/pirmacro.h \
+        compilers/pirc/src/bcgen.h
+
 compilers/pirc/src/pircompiler$(O) : \
         compilers/pirc/src/pircompiler.c \
         compilers/pirc/src/pircompiler.h \
@@ -134,6 +230,7 @@ compilers/pirc/src/pircompiler$(O) : \
         compilers/pirc/src/pirmacro.h \
         compilers/pirc/src/pirregalloc.h \
         compilers/pirc/src/pirerr.h \
+        compilers/pirc/src/pirstats.h \
         compilers/pirc/src/bcgen.h \
         compilers/pirc/src/pircompunit.h \
         compilers/pirc/src/pirsymbol.h \
@@ -153,6 +250,8 @@ compilers/pirc/src/pircompunit$(O) : $(PARROT_H_HEADERS) \
   compilers/pirc/src/pirmacro.h \
   compilers/pirc/src/pirop.h \
   compilers/pirc/src/bcgen.h \
+  compilers/pirc/src/pirstats.h \
+  compilers/pirc/src/pirjobs.h \
   $(INC_DIR)/oplib/ops.h \
   $(INC_DIR)/dynext.h \
   $(INC_DIR)/embed.h
@@ -162,6 +261,7 @@ compilers/pirc/src/pirlexer$(O) : $(PARROT_H_HEADERS) \
   compilers/pirc/src/pirparser.h \
   compilers/pirc/src/pirmacro.h \
   compilers/pirc/src/pirerr.h \
+  compilers/pirc/src/pirstats.h \
   compilers/pirc/src/pircompunit.h \
   compilers/pirc/src/pircompiler.h \
   compilers/pirc/src/pirsymbol.h \
@@ -215,6 +315,7 @@ compilers/pirc/src/pirsymbol$(O) : $(PARROT_H_HEADERS) \
   compilers/pirc/src/pirsymbol.c \
   compilers/pirc/src/pircompiler.h \
   compilers/pirc/src/pirsymbol.h \
+  compilers/pirc/src/pirstats.h \
   compilers/pirc/src/piryy.h \
   compilers/pirc/src/pirerr.h \
   compilers/pirc/src/pircompunit.h \
@@ -239,6 +340,51 @@ compilers/pirc/src/pir.l.flag compilers/pirc/src/pirlexer.c : compilers/pirc/src
 	$(LEX) -o compilers/pirc/src/pirlexer.c compilers/pirc/src/pir.l
 	$(TOUCH) compilers/pirc/src/pir.l.flag compilers/pirc/src/pirlexer.c
 
+compilers/pirc/src/pirbench$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirbench.c \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pircompunit.h \
+        compilers/pirc/src/pirsymbol.h \
+        compilers/pirc/src/pirmacro.h \
+        compilers/pirc/src/pirop.h \
+        compilers/pirc/src/pirregalloc.h \
+        compilers/pirc/src/bcgen.h \
+        $(INC_DIR)/embed.h
+
+pirbench$(EXE): $(PIRC_MICROBENCH_O_FILES) all
+	$(LINK) $(LD_OUT) $@ \
+	    $(PIRC_MICROBENCH_O_FILES) \
+	    $(RPATH_BLIB) $(ALL_PARROT_LIBS) $(C_LIBS) $(LINKFLAGS) $(LINK_DYNAMIC)
+
+compilers/pirc/src/pirstress$(O) : \
+        $(PARROT_H_HEADERS) \
+        compilers/pirc/src/pirstress.c \
+        compilers/pirc/src/pircompiler.h \
+        compilers/pirc/src/pirheredoc.h \
+        compilers/pirc/src/pircapi.h \
+        compilers/pirc/src/pircache.h \
+        $(INC_DIR)/embed.h
+
+pirstress$(EXE): $(PIRC_STRESS_O_FILES) all
+	$(LINK) $(LD_OUT) $@ \
+	    $(PIRC_STRESS_O_FILES) \
+	    $(RPATH_BLIB) $(ALL_PARROT_LIBS) $(C_LIBS) $(LINKFLAGS) $(LINK_DYNAMIC)
+
 # XXX This should eventually be combined with the standard parrot test suite.
 pirc-test: all
 	$(PERL) compilers/pirc/t/harness
+
+# Throughput of pirc on generated input of growing size; see compilers/pirc/bench/throughput.pl
+pirc-bench: pirc$(EXE)
+	$(PERL) compilers/pirc/bench/throughput.pl --pirc=./pirc$(EXE)
+
+# Microbenchmarks of the compiler's data structures; see compilers/pirc/src/pirbench.c
+pirc-microbench: pirbench$(EXE)
+	./pirbench$(EXE)
+
+# Many threads compiling the same file at once; see compilers/pirc/src/pirstress.c
+pirc-stress: pirstress$(EXE)
+	$(PERL) compilers/pirc/bench/workload.pl --kind=macro --subs=50 --output=pirstress.pir
+	./pirstress$(EXE) pirstress.pir
+	$(RM_F) pirstress.pir
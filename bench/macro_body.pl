@@ -0,0 +1,95 @@
+#! perl
+# Copyright (C) 2009, Parrot Foundation.
+
+=head1 NAME
+
+compilers/pirc/bench/macro_body.pl - time the definition and expansion of large macros
+
+=head1 SYNOPSIS
+
+    % perl compilers/pirc/bench/macro_body.pl [--pirc=./pirc] [--runs=5]
+
+=head1 DESCRIPTION
+
+Generates PIR files with macros whose bodies are 1KB to 256KB long, each
+with a C<.macro_local> per 64 lines of body, and expands every macro a
+number of times. Each file is compiled with C<pirc -n>, and the best time
+of a number of runs is reported, together with the number of body bytes
+stored per second.
+
+Run it from the Parrot root directory.
+
+=cut
+
+use strict;
+use warnings;
+
+use File::Temp qw(tempfile);
+use Getopt::Long;
+use Time::HiRes qw(time);
+
+my $pirc = './pirc';
+my $runs = 5;
+
+GetOptions(
+    'pirc=s' => \$pirc,
+    'runs=i' => \$runs,
+) or die "usage: $0 [--pirc=./pirc] [--runs=5]\n";
+
+printf "%10s %10s %12s %14s\n", 'body', 'macros', 'best (s)', 'body bytes/s';
+
+foreach my $kbytes ( 1, 4, 16, 64, 256 ) {
+    my $num_macros = 16;
+    my ( $source, $bodysize ) = generate( $kbytes * 1024, $num_macros );
+
+    my ( $fh, $filename ) = tempfile( SUFFIX => '.pir', UNLINK => 1 );
+    print {$fh} $source;
+    close $fh;
+
+    my $best;
+    foreach ( 1 .. $runs ) {
+        my $start = time;
+        system("$pirc -n $filename > /dev/null") == 0
+            or die "$pirc failed on a $kbytes KB macro body\n";
+        my $elapsed = time - $start;
+        $best = $elapsed if !defined $best || $elapsed < $best;
+    }
+
+    printf "%8dKB %10d %12.4f %14.0f\n", $kbytes, $num_macros, $best,
+        $bodysize * $num_macros / $best;
+}
+
+# generate($size, $count): return PIR code defining $count macros with a body
+# of about $size bytes each, and a sub that expands each of them twice; and
+# the actual size of each body.
+sub generate {
+    my ( $size, $count ) = @_;
+
+    my $body = '';
+    my $line = 0;
+    while ( length $body < $size ) {
+        $body .= "    .macro_local int tmp$line\n" if $line % 64 == 0;
+        $body .= "    .tmp" . ( $line - $line % 64 ) . " = $line\n";
+        $line++;
+    }
+
+    my $code = '';
+    foreach my $i ( 1 .. $count ) {
+        $code .= ".macro big_$i()\n$body.endm\n\n";
+    }
+
+    $code .= ".sub main\n";
+    foreach my $i ( 1 .. $count ) {
+        $code .= "    .big_$i()\n    .big_$i()\n";
+    }
+    $code .= ".end\n";
+
+    return ( $code, length $body );
+}
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
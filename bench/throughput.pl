@@ -0,0 +1,142 @@
+#! perl
+# Copyright (C) 2009, Parrot Foundation.
+
+=head1 NAME
+
+compilers/pirc/bench/throughput.pl - measure how pirc scales with its input
+
+=head1 SYNOPSIS
+
+    % perl compilers/pirc/bench/throughput.pl [--pirc=./pirc] [--runs=3]
+        [--kinds=plain,macro,heredoc,const,pcc] [--sizes=100,400,1600]
+        [--locals=16] [--labels=8]
+
+or
+
+    % make pirc-bench
+
+=head1 DESCRIPTION
+
+For each kind of input (see F<workload.pl>) and each number of subs in
+C<--sizes>, a PIR file is generated and compiled with C<pirc -n>,
+C<pirc -b> and C<pirc -b -r>. The best time of a number of runs is
+reported, as source lines per second and instructions per second, together
+with the peak resident set size of pirc. The number of instructions is
+taken from C<pirc --stats=json>; the peak RSS is measured with
+F</usr/bin/time>, if there is one.
+
+If the throughput drops as the input grows, some part of the compiler
+doesn't scale linearly.
+
+Run it from the Parrot root directory.
+
+=cut
+
+use strict;
+use warnings;
+
+use File::Spec;
+use File::Temp qw(tempdir);
+use FindBin;
+use Getopt::Long;
+use Time::HiRes qw(time);
+
+my $pirc   = './pirc';
+my $runs   = 3;
+my $kinds  = 'plain,macro,heredoc,const,pcc';
+my $sizes  = '100,400,1600';
+my $locals = 16;
+my $labels = 8;
+
+GetOptions(
+    'pirc=s'   => \$pirc,
+    'runs=i'   => \$runs,
+    'kinds=s'  => \$kinds,
+    'sizes=s'  => \$sizes,
+    'locals=i' => \$locals,
+    'labels=i' => \$labels,
+) or die "usage: $0 [--pirc=./pirc] [--runs=3] [--kinds=k1,k2] [--sizes=n1,n2] "
+    . "[--locals=M] [--labels=K]\n";
+
+my @modes = ( '-n', '-b', '-b -r' );
+
+my $generator = File::Spec->catfile( $FindBin::Bin, 'workload.pl' );
+my $timer     = -x '/usr/bin/time' ? '/usr/bin/time' : undef;
+my $dir       = tempdir( CLEANUP => 1 );
+
+printf "%-8s %6s %-6s %8s %8s %10s %12s %12s %10s\n",
+    'kind', 'subs', 'mode', 'lines', 'instrs', 'best (s)', 'lines/s', 'instrs/s', 'RSS (KB)';
+
+foreach my $kind ( split /,/, $kinds ) {
+    foreach my $subs ( split /,/, $sizes ) {
+        my $source = File::Spec->catfile( $dir, "$kind-$subs.pir" );
+
+        system( $^X, $generator, "--kind=$kind", "--subs=$subs", "--locals=$locals",
+            "--labels=$labels", "--output=$source" ) == 0
+            or die "failed to generate the $kind workload with $subs subs\n";
+
+        my $lines = count_lines($source);
+
+        foreach my $mode (@modes) {
+            my ( $best, $instrs, $rss ) = run_pirc( $mode, $source );
+
+            printf "%-8s %6d %-6s %8d %8s %10.4f %12.0f %12s %10s\n",
+                $kind, $subs, $mode, $lines, defined $instrs ? $instrs : '?',
+                $best, $lines / $best,
+                defined $instrs ? sprintf( '%.0f', $instrs / $best ) : '?',
+                defined $rss ? $rss : '?';
+        }
+    }
+}
+
+# run_pirc($mode, $source): compile $source $runs times with options $mode; return
+# the best time, the number of instructions and the largest peak RSS in KB.
+sub run_pirc {
+    my ( $mode, $source ) = @_;
+    my $pbc    = File::Spec->catfile( $dir, 'out.pbc' );
+    my $errors = File::Spec->catfile( $dir, 'stderr' );
+    my $usage  = File::Spec->catfile( $dir, 'usage' );
+    my ( $best, $instrs, $rss );
+
+    foreach ( 1 .. $runs ) {
+        my $command = "$pirc $mode --stats=json -o $pbc $source > /dev/null 2> $errors";
+        $command = "$timer -f %M -o $usage $command" if $timer;
+
+        my $start = time;
+        system($command) == 0 or die "'$pirc $mode' failed on $source\n";
+        my $elapsed = time - $start;
+        $best = $elapsed if !defined $best || $elapsed < $best;
+
+        $instrs = $1 if slurp($errors) =~ /"instructions":\s*(\d+)/;
+
+        if ( $timer && slurp($usage) =~ /(\d+)\s*$/ ) {
+            $rss = $1 if !defined $rss || $1 > $rss;
+        }
+    }
+
+    return ( $best, $instrs, $rss );
+}
+
+# count_lines($file): return the number of lines in $file
+sub count_lines {
+    my ($file) = @_;
+    my $count = () = slurp($file) =~ /\n/g;
+    return $count;
+}
+
+# slurp($file): return the contents of $file, or an empty string if it can't be read
+sub slurp {
+    my ($file) = @_;
+    open my $fh, '<', $file or return '';
+    local $/;
+    my $contents = <$fh>;
+    close $fh;
+    return $contents;
+}
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
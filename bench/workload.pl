@@ -0,0 +1,208 @@
+#! perl
+# Copyright (C) 2009, Parrot Foundation.
+
+=head1 NAME
+
+compilers/pirc/bench/workload.pl - generate synthetic PIR input for benchmarks
+
+=head1 SYNOPSIS
+
+    % perl compilers/pirc/bench/workload.pl [--kind=plain] [--subs=100]
+        [--locals=16] [--labels=8] [--output=workload.pir]
+
+=head1 DESCRIPTION
+
+Writes a PIR file to stdout (or to the file given with C<--output>), with a C<:main> sub and a number of generated
+subs. Each sub declares C<--locals> locals, computes them from each other,
+and has C<--labels> labels that are branched to. Depending on C<--kind>,
+the subs stress another part of the compiler as well:
+
+=over 4
+
+=item plain
+
+Only the locals and labels.
+
+=item macro
+
+Each local is computed by expanding a macro with two parameters and a
+C<.macro_local>, and a C<.macro_const>.
+
+=item heredoc
+
+For every four locals, a heredoc string of eight lines is assigned.
+
+=item const
+
+Each local is initialized from an integer or string C<.const> of its own.
+
+=item pcc
+
+Each sub calls the next one with four arguments and two results, making
+a chain of calls that is as deep as there are subs.
+
+=back
+
+The output only depends on the options, so the same input can be generated
+again to compare runs.
+
+=cut
+
+use strict;
+use warnings;
+
+use Getopt::Long;
+
+my %opt = (
+    kind   => 'plain',
+    subs   => 100,
+    locals => 16,
+    labels => 8,
+);
+
+GetOptions( \%opt, 'kind=s', 'subs=i', 'locals=i', 'labels=i', 'output=s' )
+    or die "usage: $0 [--kind=plain|macro|heredoc|const|pcc] [--subs=N] "
+    . "[--locals=M] [--labels=K] [--output=FILE]\n";
+
+my %body_of = (
+    plain   => \&plain_locals,
+    macro   => \&macro_locals,
+    heredoc => \&heredoc_locals,
+    const   => \&const_locals,
+    pcc     => \&plain_locals,
+);
+
+die "unknown kind '$opt{kind}'\n" unless exists $body_of{ $opt{kind} };
+die "--subs and --locals must be at least 1\n" if $opt{subs} < 1 || $opt{locals} < 1;
+
+# the pcc chain passes and returns two ints
+$opt{locals} = 2 if $opt{kind} eq 'pcc' && $opt{locals} < 2;
+
+my $out = \*STDOUT;
+if ( defined $opt{output} ) {
+    open $out, '>', $opt{output} or die "can't write '$opt{output}': $!\n";
+}
+
+print {$out} preamble( $opt{kind} );
+print {$out} main_sub( $opt{kind} );
+print {$out} generate_sub( $opt{kind}, $_ ) foreach 0 .. $opt{subs} - 1;
+
+close $out or die "can't write the output: $!\n";
+
+# preamble($kind): definitions that come before the subs
+sub preamble {
+    my ($kind) = @_;
+
+    return '' unless $kind eq 'macro';
+
+    return <<'PIR';
+.macro_const STEP 3
+
+.macro bump(target, source)
+    .macro_local int tmp
+    .tmp = .source * .STEP
+    .target = .tmp + 1
+.endm
+
+PIR
+}
+
+# main_sub($kind): the :main sub, which calls the first generated sub
+sub main_sub {
+    my ($kind) = @_;
+
+    my $call = $kind eq 'pcc'
+        ? '    ($I0, $I1) = sub_0(1, 2, "start", 1.5)'
+        : '    $I0 = sub_0(1)';
+
+    return ".sub main :main\n$call\n    say \$I0\n.end\n\n";
+}
+
+# generate_sub($kind, $index): the generated sub number $index
+sub generate_sub {
+    my ( $kind, $index ) = @_;
+    my $code = ".sub sub_$index\n";
+
+    if ( $kind eq 'pcc' ) {
+        $code .= "    .param int n\n    .param int m\n"
+            . "    .param string s\n    .param num f\n";
+    }
+    else {
+        $code .= "    .param int n\n";
+    }
+
+    $code .= "    .local int l$_\n" foreach 0 .. $opt{locals} - 1;
+    $code .= "    .local string s\n" if $kind eq 'heredoc' || $kind eq 'const';
+    $code .= "    l0 = n\n";
+    $code .= $body_of{$kind}->($index);
+
+    foreach my $label ( 0 .. $opt{labels} - 1 ) {
+        my $local = $label % $opt{locals};
+        $code .= "  L_$label:\n"
+            . "    l$local = l$local + 1\n"
+            . "    if l$local < 0 goto L_$label\n";
+    }
+
+    if ( $kind eq 'pcc' ) {
+        $code .= "    (l0, l1) = sub_" . ( $index + 1 ) . "(l0, m, s, f)\n"
+            if $index + 1 < $opt{subs};
+        $code .= "    .return (l0, l1)\n";
+    }
+    else {
+        $code .= "    .return (l0)\n";
+    }
+
+    return "$code.end\n\n";
+}
+
+# plain_locals($index): compute each local from the one before
+sub plain_locals {
+    return join '', map { '    l' . $_ . ' = l' . ( $_ - 1 ) . " + $_\n" } 1 .. $opt{locals} - 1;
+}
+
+# macro_locals($index): compute each local by expanding a macro
+sub macro_locals {
+    return join '', map { '    .bump(l' . $_ . ', l' . ( $_ - 1 ) . ")\n" } 1 .. $opt{locals} - 1;
+}
+
+# heredoc_locals($index): plain locals, and a heredoc string for every four
+sub heredoc_locals {
+    my $code = '';
+
+    foreach my $i ( 1 .. $opt{locals} - 1 ) {
+        $code .= "    l$i = l" . ( $i - 1 ) . " + $i\n";
+        next if $i % 4;
+
+        $code .= "    s = <<'EOS'\n";
+        $code .= "line $_ of a heredoc string in local $i\n" foreach 1 .. 8;
+        $code .= "EOS\n";
+    }
+
+    return $code;
+}
+
+# const_locals($index): initialize each local from a constant of its own
+sub const_locals {
+    my ($index) = @_;
+    my $code = '';
+
+    foreach my $i ( 1 .. $opt{locals} - 1 ) {
+        if ( $i % 2 ) {
+            $code .= "    .const int C_${index}_$i = $i\n"
+                . "    l$i = C_${index}_$i\n";
+        }
+        else {
+            $code .= "    .const string S_${index}_$i = \"constant $i of sub $index\"\n"
+                . "    s = S_${index}_$i\n";
+        }
+    }
+
+    return $code;
+}
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
@@ -4,6 +4,12 @@
 #ifndef PARROT_PIR_MACRO_H_GUARD
 #define PARROT_PIR_MACRO_H_GUARD
 
+/* number of hash buckets of the global table, and of the tables that
+ * hold the arguments of a macro expansion.
+ */
+#define CONSTANT_TABLE_SIZE     128
+#define CONSTANT_SCOPE_SIZE     8
+
 typedef struct list {
     char const  *item;
 
@@ -18,6 +24,9 @@ typedef struct macro_def {
     int               line_defined;
     list             *parameters;
 
+    unsigned long     hash;      /* hash value of name */
+    struct macro_def *hashnext;  /* next definition in the same bucket */
+
     struct macro_def *next;
 
 } macro_def;
@@ -34,6 +43,8 @@ typedef struct macro_def {
  */
 typedef struct constant_table {
     macro_def *definitions;
+    macro_def **buckets;    /* the definitions, hashed by name */
+    unsigned    size;       /* number of buckets */
     /* constant tables are linked through this pointer,
      * and organized as a stack. If a constant is not found
      * in this table, then the previous table is tried, and so on,
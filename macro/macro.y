@@ -79,6 +79,9 @@ static char *munge_id(char const * const label_id, int is_label_declaration,
 static constant_table *new_constant_table(constant_table * const current,
                                           lexer_state * const lexer);
 
+static unsigned long hash_name(char const * const name);
+static void store_definition(constant_table * const table, macro_def * const def);
+
 static constant_table *pop_constant_table(lexer_state * const lexer);
 
 static void delete_constant_table(constant_table *table);
@@ -538,8 +541,7 @@ define_constant(constant_table * const table, char const * const name, char cons
     macro_def *def     = (macro_def *)mem_sys_allocate_zeroed(sizeof (macro_def));
     def->name          = name;
     def->body          = value;
-    def->next          = table->definitions;
-    table->definitions = def;
+    store_definition(table, def);
 }
 
 /*
@@ -565,9 +567,54 @@ define_macro(constant_table * const table, char const * const name, list * const
     macro->parameters   = parameters;
     macro->line_defined = line_defined;
 
-    /* link the macro in the list */
-    macro->next         = table->definitions;
-    table->definitions  = macro;
+    store_definition(table, macro);
+}
+
+/*
+
+=item C<static unsigned long
+hash_name(char const * const name)>
+
+Calculate the hash value of C<name>.
+
+=cut
+
+*/
+PARROT_PURE_FUNCTION
+PARROT_WARN_UNUSED_RESULT
+static unsigned long
+hash_name(char const * const name) {
+    unsigned long  key = 0;
+    char const    *s;
+
+    for (s = name; *s; s++)
+        key = key * 65599 + *s;
+
+    return key;
+}
+
+/*
+
+=item C<static void
+store_definition(constant_table * const table, macro_def * const def)>
+
+Link the definition C<def> in C<table>'s list of definitions, and in its
+hash bucket; a redefinition is found before the original one.
+
+=cut
+
+*/
+static void
+store_definition(constant_table * const table, macro_def * const def) {
+    macro_def **bucket;
+
+    def->hash          = hash_name(def->name);
+    bucket             = table->buckets + def->hash % table->size;
+
+    def->next          = table->definitions;
+    table->definitions = def;
+    def->hashnext      = *bucket;
+    *bucket            = def;
 }
 
 
@@ -576,8 +623,9 @@ define_macro(constant_table * const table, char const * const name, list * const
 =item C<macro_def *
 find_macro(constant_table * const table, char * const name)>
 
-Find the specified macro. If the specified macro does not exist,
-NULL is returned.
+Find the specified macro in C<table>, or any of the tables below it.
+If the specified macro does not exist, NULL is returned. The hash
+value of C<name> is calculated only once for all tables.
 
 =cut
 
@@ -586,18 +634,23 @@ PARROT_WARN_UNUSED_RESULT
 PARROT_CAN_RETURN_NULL
 macro_def *
 find_macro(constant_table * const table, char * const name) {
-    macro_def *iter = table->definitions;
+    constant_table *scope = table;
+    unsigned long   hash;
+
     PARROT_ASSERT(name != NULL);
+    hash = hash_name(name);
 
-    /* iterate over the list and compare each node's name */
-    while (iter != NULL) {
-        if (strcmp(iter->name, name) == 0)
-            return iter;
-        iter = iter->next;
-    }
+    while (scope != NULL) {
+        macro_def *iter = scope->buckets[hash % scope->size];
+
+        while (iter != NULL) {
+            if (iter->hash == hash && (iter->name == name || strcmp(iter->name, name) == 0))
+                return iter;
+            iter = iter->hashnext;
+        }
 
-    if (table->prev)
-        return find_macro(table->prev, name);
+        scope = scope->prev;
+    }
 
     return NULL;
 }
@@ -797,8 +850,13 @@ PARROT_CANNOT_RETURN_NULL
 PARROT_WARN_UNUSED_RESULT
 static constant_table *
 new_constant_table(constant_table * const current, lexer_state * const lexer) {
-    constant_table *table    = (constant_table *)mem_sys_allocate(sizeof (constant_table));
+    /* the buckets are allocated together with the table */
+    unsigned        size     = current ? CONSTANT_SCOPE_SIZE : CONSTANT_TABLE_SIZE;
+    constant_table *table    = (constant_table *)mem_sys_allocate_zeroed(sizeof (constant_table)
+                                                          + size * sizeof (macro_def *));
     table->definitions       = NULL;
+    table->buckets           = (macro_def **)(table + 1);
+    table->size              = size;
     table->prev              = current;
     lexer->globaldefinitions = table;
     return table;
@@ -2,6 +2,7 @@
  * Copyright (C) 2008-2009, Parrot Foundation.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include "pirsymbol.h"
 
@@ -9,6 +10,7 @@
 
 #include "pmc/pmc_sub.h"
 #include "pmc/pmc_namespace.h"
+#include "parrot/oplib/ops.h"
 
 /* #include "parrot/embed.h" */
 
@@ -20,6 +22,13 @@
 /* HEADERIZER BEGIN: static */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
+static void add_sub_fixup(
+    ARGIN(bytecode * const bc),
+    ARGIN(char const * const subname),
+    int subconst_index)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
 PARROT_CANNOT_RETURN_NULL
 static STRING * add_string_const_from_cstring(
     ARGIN(bytecode * const bc),
@@ -70,14 +79,45 @@ static PMC * get_namespace_pmc(
     ARGIN_NULLOK(multi_type * const ns))
         __attribute__nonnull__(1);
 
+static int compare_constant_ranks(ARGIN(const void *a), ARGIN(const void *b))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
 static int new_pbc_const(ARGIN(bytecode * const bc))
         __attribute__nonnull__(1);
 
+static void renumber_constants(
+    ARGIN(bytecode * const bc),
+    ARGIN(opcode_t const * const newindex))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+static void visit_constant_ref(
+    ARGMOD(opcode_t *ref),
+    ARGMOD_NULLOK(unsigned * const refcounts),
+    ARGIN_NULLOK(opcode_t const * const newindex))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*ref)
+        FUNC_MODIFIES(* const refcounts);
+
+static void walk_constant_refs(
+    ARGIN(bytecode * const bc),
+    ARGMOD_NULLOK(unsigned * const refcounts),
+    ARGIN_NULLOK(opcode_t const * const newindex))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(* const refcounts);
+
+#define ASSERT_ARGS_add_sub_fixup __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc) \
+    , PARROT_ASSERT_ARG(subname))
 #define ASSERT_ARGS_add_string_const_from_cstring __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc) \
     , PARROT_ASSERT_ARG(str))
 #define ASSERT_ARGS_check_requested_constant __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc))
+#define ASSERT_ARGS_compare_constant_ranks __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(a) \
+    , PARROT_ASSERT_ARG(b))
 #define ASSERT_ARGS_create_lexinfo __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc) \
     , PARROT_ASSERT_ARG(sub))
@@ -92,6 +132,13 @@ static int new_pbc_const(ARGIN(bytecode * const bc))
        PARROT_ASSERT_ARG(bc))
 #define ASSERT_ARGS_new_pbc_const __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc))
+#define ASSERT_ARGS_renumber_constants __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc) \
+    , PARROT_ASSERT_ARG(newindex))
+#define ASSERT_ARGS_visit_constant_ref __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(ref))
+#define ASSERT_ARGS_walk_constant_refs __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 /* HEADERIZER END: static */
 
@@ -104,6 +151,13 @@ static int new_pbc_const(ARGIN(bytecode * const bc))
 /* turn this on when debugging */
 #define DEBUGBC     0
 
+/* true if an operand of type T (either an op's argument type or the flags
+ * of an argument in a calling convention signature) is an index into the
+ * constant table. Integer constants are stored inline, so they are not.
+ */
+#define IS_CONSTANT_REF(T)  (((T) & PARROT_ARG_CONSTANT) \
+                             && ((T) & PARROT_ARG_TYPE_MASK) != PARROT_ARG_INTVAL)
+
 
 
 
@@ -143,6 +197,9 @@ accessor functions.
       emit_int_arg(bc, mystring);
   }
 
+  // remove constants that are no longer used
+  compact_constants(bc);
+
   // write the pbc file
   write_pbc_file(bc, "foo.pbc");
 
@@ -155,13 +212,22 @@ accessor functions.
 
 
 struct bytecode {
-    PackFile        *packfile;       /* the actual packfile */
-    opcode_t        *opcursor;       /* for writing ops into the code segment */
-    Interp          *interp;         /* parrot interpreter */
-    PackFile_Debug  *debug_seg;      /* debug segment */
-    int              instr_counter;
+    PackFile          *packfile;       /* the actual packfile */
+    PackFile_ByteCode *code;           /* the code segment, which is private to this bytecode */
+    opcode_t          *opcursor;       /* for writing ops into the code segment */
+    Interp            *interp;         /* parrot interpreter */
+    PackFile_Debug    *debug_seg;      /* debug segment */
+    int                instr_counter;
 };
 
+/* sort key for a constant when reordering the constant table */
+typedef struct constant_rank {
+    opcode_t  index;     /* current index of the constant */
+    int       group;     /* see reorder_constants() */
+    unsigned  refcount;  /* number of references to the constant */
+
+} constant_rank;
+
 
 /*
 
@@ -196,22 +262,22 @@ new_pbc_const(ARGIN(bytecode * const bc))
     PackFile_Constant *new_pbc_constant;
 
     interp   = bc->interp;
-    oldcount = interp->code->const_table->const_count;
+    oldcount = bc->code->const_table->const_count;
     newcount = oldcount + 1;
 
     new_pbc_constant = PackFile_Constant_new(interp);
 
     /* Update the constant count and reallocate */
-    if (interp->code->const_table->constants)
-        interp->code->const_table->constants
-            = mem_realloc_n_typed(interp->code->const_table->constants,
+    if (bc->code->const_table->constants)
+        bc->code->const_table->constants
+            = mem_realloc_n_typed(bc->code->const_table->constants,
                 newcount, PackFile_Constant *);
     else
-        interp->code->const_table->constants
+        bc->code->const_table->constants
             = mem_allocate_n_typed(newcount, PackFile_Constant *);
 
-    interp->code->const_table->constants[oldcount] = new_pbc_constant;
-    interp->code->const_table->const_count         = newcount;
+    bc->code->const_table->constants[oldcount] = new_pbc_constant;
+    bc->code->const_table->const_count         = newcount;
 
     return oldcount;
 }
@@ -234,7 +300,7 @@ add_pmc_const(ARGIN(bytecode * const bc), ARGIN(PMC * pmc))
 {
     ASSERT_ARGS(add_pmc_const)
     int index                   = new_pbc_const(bc);
-    PackFile_Constant *constant = bc->interp->code->const_table->constants[index];
+    PackFile_Constant *constant = bc->code->const_table->constants[index];
     constant->type              = PFC_PMC;
     constant->u.key             = pmc;
     return index;
@@ -263,12 +329,12 @@ add_string_const(ARGIN(bytecode * const bc), ARGIN(char const * const str),
     ASSERT_ARGS(add_string_const)
     STRING *parrotstr = string_make(bc->interp, str, strlen(str), charset, PObj_constant_FLAG);
     int index         = 0;
-    int count         = bc->interp->code->const_table->const_count;
+    int count         = bc->code->const_table->const_count;
     PackFile_Constant *constant;
 
     /* check whether the string is already stored; if so, return that index */
     while (index < count) {
-        constant = bc->interp->code->const_table->constants[index];
+        constant = bc->code->const_table->constants[index];
         if (constant->type == PFC_STRING) {
             if (STRING_equal(bc->interp, constant->u.string, parrotstr)) {
 #if DEBUGBC
@@ -284,7 +350,7 @@ add_string_const(ARGIN(bytecode * const bc), ARGIN(char const * const str),
     */
     /* it wasn't stored yet, store it now, and return the index */
     index    = new_pbc_const(bc);
-    constant = bc->interp->code->const_table->constants[index];
+    constant = bc->code->const_table->constants[index];
 
     constant->type     = PFC_STRING;
     constant->u.string = parrotstr;
@@ -315,7 +381,7 @@ add_num_const(ARGIN(bytecode * const bc), double f)
 {
     ASSERT_ARGS(add_num_const)
     int index                   = new_pbc_const(bc);
-    PackFile_Constant *constant = bc->interp->code->const_table->constants[index];
+    PackFile_Constant *constant = bc->code->const_table->constants[index];
     constant->type              = PFC_NUMBER;
     constant->u.number          = f;
 #if DEBUGBC
@@ -340,13 +406,13 @@ add_key_const(ARGIN(bytecode * const bc), ARGIN(PMC *key))
 {
     ASSERT_ARGS(add_key_const)
     PackFile_Constant *constant;
-    int count  = bc->interp->code->const_table->const_count;
+    int count  = bc->code->const_table->const_count;
     int index  = 0;
     STRING *s1 = key_set_to_string(bc->interp, key);
 
     /* iterate over all constants; if a constant is a key, compare the string representations */
     while (index < count) {
-        constant = bc->interp->code->const_table->constants[index];
+        constant = bc->code->const_table->constants[index];
 
         if (constant->type == PFC_KEY) {
             STRING *s2 = key_set_to_string(bc->interp, constant->u.key);
@@ -362,7 +428,7 @@ add_key_const(ARGIN(bytecode * const bc), ARGIN(PMC *key))
 
     /* key wasn't found, so add it now */
     index            = new_pbc_const(bc);
-    constant         = bc->interp->code->const_table->constants[index];
+    constant         = bc->code->const_table->constants[index];
     constant->type   = PFC_KEY;
     constant->u.key  = key;
 #if DEBUGBC
@@ -390,9 +456,9 @@ check_requested_constant(ARGIN(bytecode * const bc), unsigned index, int expecte
 {
     ASSERT_ARGS(check_requested_constant)
     /* make sure the requested PMC exists. */
-    PARROT_ASSERT(index < bc->interp->code->const_table->const_count);
+    PARROT_ASSERT(index < bc->code->const_table->const_count);
     /* make sure the requested constant is a PMC */
-    PARROT_ASSERT(bc->interp->code->const_table->constants[index]->type == expectedtype);
+    PARROT_ASSERT(bc->code->const_table->constants[index]->type == expectedtype);
 }
 
 /*
@@ -410,7 +476,7 @@ get_pmc_const(ARGIN(bytecode * const bc), unsigned index)
 {
     ASSERT_ARGS(get_pmc_const)
     check_requested_constant(bc, index, PFC_PMC);
-    return bc->interp->code->const_table->constants[index]->u.key;
+    return bc->code->const_table->constants[index]->u.key;
 }
 
 /*
@@ -427,7 +493,7 @@ get_num_const(ARGIN(bytecode * const bc), unsigned index)
 {
     ASSERT_ARGS(get_num_const)
     check_requested_constant(bc, index, PFC_NUMBER);
-    return bc->interp->code->const_table->constants[index]->u.number;
+    return bc->code->const_table->constants[index]->u.number;
 }
 
 /*
@@ -445,7 +511,7 @@ get_string_const(ARGIN(bytecode * const bc), unsigned index)
 {
     ASSERT_ARGS(get_string_const)
     check_requested_constant(bc, index, PFC_STRING);
-    return bc->interp->code->const_table->constants[index]->u.string;
+    return bc->code->const_table->constants[index]->u.string;
 }
 
 /*
@@ -458,6 +524,11 @@ loaded into the Parrot interpreter C<interp>. Default bytecode segments
 are created, and the interpreter's C<iglobals> field is stored as a constant
 PMC in the bytecode's constant table.
 
+All code and constants are written to the bytecode's own code segment; the
+interpreter's current code segment is left alone, so that it doesn't matter
+what the interpreter runs while the code is generated. Use
+C<get_code_segment()> to get the segment when it's done.
+
 =cut
 
 */
@@ -480,7 +551,7 @@ new_bytecode(PARROT_INTERP, ARGIN(char const * const filename))
 
     /* create segments */
     PARROT_ASSERT(filename != NULL);
-    interp->code = PF_create_default_segs(interp, Parrot_str_new(interp, filename,
+    bc->code     = PF_create_default_segs(interp, Parrot_str_new(interp, filename,
                                                                  strlen(filename)), 1);
 
     /* add interpreter globals to bytecode. XXX Why is this? */
@@ -496,6 +567,25 @@ new_bytecode(PARROT_INTERP, ARGIN(char const * const filename))
 
 /*
 
+=item C<PackFile_ByteCode * get_code_segment(bytecode * const bc)>
+
+Return the code segment into which C<bc> is generated. To run the code,
+make it the interpreter's current code segment with C<Parrot_switch_to_cs()>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+PARROT_CANNOT_RETURN_NULL
+PackFile_ByteCode *
+get_code_segment(ARGIN(bytecode * const bc))
+{
+    ASSERT_ARGS(get_code_segment)
+    return bc->code;
+}
+
+/*
+
 =item C<void create_codesegment(bytecode * const bc, int codesize)>
 
 Create a code segment of size C<codesize>. C<bc>'s C<opcursor> attribute
@@ -510,13 +600,13 @@ create_codesegment(ARGIN(bytecode * const bc), int codesize)
 {
     ASSERT_ARGS(create_codesegment)
     /* allocate enough space. */
-    bc->interp->code->base.data = (opcode_t *)mem_sys_realloc(bc->interp->code->base.data,
+    bc->code->base.data = (opcode_t *)mem_sys_realloc(bc->code->base.data,
                                                               codesize * sizeof (opcode_t));
     /* store the size of the code-segment */
-    bc->interp->code->base.size = codesize;
+    bc->code->base.size = codesize;
 
     /* initialize the cursor to write opcodes into the code segment */
-    bc->opcursor = (opcode_t *)bc->interp->code->base.data;
+    bc->opcursor = (opcode_t *)bc->code->base.data;
 }
 
 /*
@@ -536,7 +626,7 @@ create_debugsegment(ARGIN(bytecode * const bc), size_t size, ARGIN(char const *
     /* create a new debug segment; Parrot_new_debug_seg() automatically stores
      * away any currently existing debug segment.
      */
-    bc->debug_seg = Parrot_new_debug_seg(bc->interp, bc->interp->code, size);
+    bc->debug_seg = Parrot_new_debug_seg(bc->interp, bc->code, size);
 
     Parrot_debug_add_mapping(bc->interp, bc->debug_seg, bc->instr_counter, file);
 }
@@ -575,20 +665,20 @@ create_annotations_segment(ARGIN(bytecode * const bc), ARGIN(char const * const
     char *segment_name = (char *)mem_sys_allocate((strlen(name) + 5) * sizeof (char));
     sprintf(segment_name, "%s_ANN", name);
 
-    bc->interp->code->annotations = (PackFile_Annotations*)
+    bc->code->annotations = (PackFile_Annotations*)
                                     PackFile_Segment_new_seg(bc->interp,
-                                        bc->interp->code->base.dir,
+                                        bc->code->base.dir,
                                         PF_ANNOTATIONS_SEG,
                                         Parrot_str_new(bc->interp, segment_name,
                                             strlen(segment_name)),
                                         1);
 
-    bc->interp->code->annotations->code = bc->interp->code;
+    bc->code->annotations->code = bc->code;
 
     /* Create initial group. */
     PackFile_Annotations_add_group(bc->interp,
-                                   bc->interp->code->annotations,
-                                   bc->opcursor - bc->interp->code->base.data);
+                                   bc->code->annotations,
+                                   bc->opcursor - bc->code->base.data);
 }
 
 /* Look up table for PackFile Annotation types */
@@ -628,7 +718,7 @@ add_annotation(ARGIN(bytecode * const bc), opcode_t offset, opcode_t key,
         return;
     }
 
-    PackFile_Annotations_add_entry(bc->interp, bc->interp->code->annotations,
+    PackFile_Annotations_add_entry(bc->interp, bc->code->annotations,
                                    offset, key, annotation_type, value);
 }
 
@@ -649,7 +739,7 @@ destroy_bytecode(ARGMOD(bytecode * bc))
 {
     ASSERT_ARGS(destroy_bytecode)
     /* XXX should we do this? Not Parrot? */
-    mem_sys_free(bc->interp->code->base.data);
+    mem_sys_free(bc->code->base.data);
     mem_sys_free(bc);
 }
 
@@ -673,7 +763,7 @@ emit_opcode(ARGIN(bytecode * const bc), opcode_t op)
 #if DEBUGBC
     fprintf(stderr, "\n[%d]", op);
 #endif
-    return (bc->opcursor++ - bc->interp->code->base.data);
+    return (bc->opcursor++ - bc->code->base.data);
 
 }
 
@@ -696,7 +786,7 @@ emit_int_arg(ARGIN(bytecode * const bc), int intval)
 #if DEBUGBC
     fprintf(stderr, "{%d}", intval);
 #endif
-    return (bc->opcursor++ - bc->interp->code->base.data);
+    return (bc->opcursor++ - bc->code->base.data);
 }
 
 
@@ -722,7 +812,7 @@ store_key_bytecode(ARGIN(bytecode * const bc), ARGIN(opcode_t * key))
     int                  index;
 
     pfc   = mem_allocate_typed(PackFile_Constant);
-    rc    = PackFile_Constant_unpack_key(bc->interp, bc->interp->code->const_table, pfc, key);
+    rc    = PackFile_Constant_unpack_key(bc->interp, bc->code->const_table, pfc, key);
 
     if (!rc) {
         mem_sys_free(pfc);
@@ -765,7 +855,7 @@ add_string_const_from_cstring(ARGIN(bytecode * const bc), ARGIN(char const * con
 {
     ASSERT_ARGS(add_string_const_from_cstring)
     int index = add_string_const(bc, str, "ascii");
-    return bc->interp->code->const_table->constants[index]->u.string;
+    return bc->code->const_table->constants[index]->u.string;
 }
 
 
@@ -827,7 +917,7 @@ generate_multi_signature(ARGIN(bytecode * const bc),
                    for emitting key bytecode. Need to see whether this works...
                  */
                 int index = emit_pbc_key(bc, types[i].entry.key);
-                sig_pmc   = bc->interp->code->const_table->constants[index]->u.key;
+                sig_pmc   = bc->code->const_table->constants[index]->u.key;
 
                 break;
             }
@@ -1052,13 +1142,13 @@ find_outer_sub(ARGIN(bytecode * const bc), ARGIN_NULLOK(char const * const outer
     outersub = find_global_label(lexer, outername);
 
     if (outersub) {
-        int const num_constants = interp->code->const_table->const_count;
+        int const num_constants = bc->code->const_table->const_count;
 
         /* sanity check for const_table_index */
         if (outersub->const_table_index >= 0 && outersub->const_table_index < num_constants)
         {
             PackFile_Constant *subconst
-                       = interp->code->const_table->constants[outersub->const_table_index];
+                       = bc->code->const_table->constants[outersub->const_table_index];
             /* set a flag on that outer sub that it's an outer sub */
             PObj_get_FLAGS(subconst->u.key) |= SUB_FLAG_IS_OUTER;
             return subconst->u.key;
@@ -1179,6 +1269,39 @@ create_sub_pmc(ARGIN(bytecode * const bc), int iscoroutine,
 
 /*
 
+=item C<static void add_sub_fixup(bytecode * const bc, char const * const subname,
+int subconst_index)>
+
+Add an entry for the sub C<subname>, stored at C<subconst_index> in the constant
+table, to the fixup table of C<bc>'s code segment. Parrot's
+C<PackFile_FixupTable_new_entry()> adds to the interpreter's current code
+segment instead, which need not be the one that is being generated.
+
+=cut
+
+*/
+static void
+add_sub_fixup(ARGIN(bytecode * const bc), ARGIN(char const * const subname), int subconst_index)
+{
+    ASSERT_ARGS(add_sub_fixup)
+    PackFile_FixupTable * const ft    = bc->code->fixups;
+    PackFile_FixupEntry * const entry = mem_allocate_typed(PackFile_FixupEntry);
+
+    entry->type   = enum_fixup_sub;
+    entry->name   = (char *)mem_sys_allocate((strlen(subname) + 1) * sizeof (char));
+    entry->offset = subconst_index;
+    strcpy(entry->name, subname);
+
+    if (ft->fixups)
+        ft->fixups = mem_realloc_n_typed(ft->fixups, ft->fixup_count + 1, PackFile_FixupEntry *);
+    else
+        ft->fixups = mem_allocate_n_typed(1, PackFile_FixupEntry *);
+
+    ft->fixups[ft->fixup_count++] = entry;
+}
+
+/*
+
 =item C<int add_sub_pmc(bytecode * const bc, sub_info * const info, int needlex,
 int subpragmas, struct lexer_state * const lexer)>
 
@@ -1209,7 +1332,7 @@ add_sub_pmc(ARGIN(bytecode * const bc), ARGIN(sub_info * const info), int needle
     interp                = bc->interp;
     sub_pmc               = create_sub_pmc(bc, info->iscoroutine, info->instanceof);
     subname_index         = add_string_const(bc, info->subname, "ascii");
-    subname_const         = bc->interp->code->const_table->constants[subname_index];
+    subname_const         = bc->code->const_table->constants[subname_index];
     PMC_get_sub(interp, sub_pmc, sub);
 
     /* set start and end offset of this sub in the bytecode.
@@ -1274,13 +1397,482 @@ add_sub_pmc(ARGIN(bytecode * const bc), ARGIN(sub_info * const info), int needle
     subconst_index = add_pmc_const(bc, sub_pmc);
 
     /* Add a new fixup entry in the fixup table for this sub. */
-    PackFile_FixupTable_new_entry(bc->interp, info->subname, enum_fixup_sub, subconst_index);
+    add_sub_fixup(bc, info->subname, subconst_index);
 
     /* return the index in the constant table where this sub PMC is stored */
     return subconst_index;
 }
 
+/*
+
+=item C<void relocate_sub_pmc(bytecode * const bc, int subconst_index, int
+startoffset, int endoffset)>
+
+Set the start and end offset of the sub PMC stored at index C<subconst_index>
+in the constant table. This is needed when code in front of the sub is
+removed after the sub PMC was created by C<add_sub_pmc>.
+
+=cut
+
+*/
+void
+relocate_sub_pmc(ARGIN(bytecode * const bc), int subconst_index, int startoffset,
+                 int endoffset)
+{
+    ASSERT_ARGS(relocate_sub_pmc)
+    Parrot_Sub_attributes *sub;
+    PMC                   *sub_pmc = get_pmc_const(bc, subconst_index);
+    /* need a Interp object called "interp", because of some macro expansions. */
+    Interp                *interp  = bc->interp;
+
+    PMC_get_sub(interp, sub_pmc, sub);
+
+    sub->start_offs = startoffset;
+    sub->end_offs   = endoffset;
+}
+
+/*
+
+=item C<void set_sub_pmc_registers(bytecode * const bc, int subconst_index,
+unsigned regs_used[4])>
+
+Set the number of registers of each type that are used by the sub PMC stored
+at index C<subconst_index> in the constant table. This is needed when the
+registers of the sub are allocated after the sub PMC was created by
+C<add_sub_pmc>.
+
+=cut
+
+*/
+void
+set_sub_pmc_registers(ARGIN(bytecode * const bc), int subconst_index, unsigned regs_used[4])
+{
+    ASSERT_ARGS(set_sub_pmc_registers)
+    Parrot_Sub_attributes *sub;
+    PMC                   *sub_pmc = get_pmc_const(bc, subconst_index);
+    /* need a Interp object called "interp", because of some macro expansions. */
+    Interp                *interp  = bc->interp;
+    int                    i;
+
+    PMC_get_sub(interp, sub_pmc, sub);
+
+    for (i = 0; i < 4; ++i)
+        sub->n_regs_used[i] = regs_used[i];
+}
+
+/*
+
+=item C<void remove_sub_pmc(bytecode * const bc, int subconst_index)>
+
+Remove the fixup entry for the sub PMC stored at index C<subconst_index>,
+so that the sub is not registered when the bytecode is loaded. The PMC
+itself stays in the constant table, so that the indices of other constants
+do not change.
+
+=cut
+
+*/
+void
+remove_sub_pmc(ARGIN(bytecode * const bc), int subconst_index)
+{
+    ASSERT_ARGS(remove_sub_pmc)
+    PackFile_FixupTable *ft = bc->code->fixups;
+    opcode_t             i;
+
+    for (i = 0; i < ft->fixup_count; ++i) {
+        PackFile_FixupEntry *entry = ft->fixups[i];
+
+        if (entry->type == enum_fixup_sub && entry->offset == subconst_index) {
+            mem_sys_free(entry->name);
+            mem_sys_free(entry);
+
+            /* close the gap */
+            --ft->fixup_count;
+            for (; i < ft->fixup_count; ++i)
+                ft->fixups[i] = ft->fixups[i + 1];
+
+            return;
+        }
+    }
+}
+
+
+
+/*
+
+=item C<static void visit_constant_ref(opcode_t *ref, unsigned * const
+refcounts, opcode_t const * const newindex)>
+
+Process a single reference to the constant table, stored at C<ref>. If
+C<refcounts> is not NULL, the reference is counted; if C<newindex> is not
+NULL, the reference is replaced by the new index of the constant.
+
+=cut
+
+*/
+static void
+visit_constant_ref(ARGMOD(opcode_t *ref), ARGMOD_NULLOK(unsigned * const refcounts),
+    ARGIN_NULLOK(opcode_t const * const newindex))
+{
+    ASSERT_ARGS(visit_constant_ref)
+    if (refcounts)
+        ++refcounts[*ref];
+
+    if (newindex)
+        *ref = newindex[*ref];
+}
+
+/*
+
+=item C<static void walk_constant_refs(bytecode * const bc, unsigned * const
+refcounts, opcode_t const * const newindex)>
+
+Visit all references to the constant table; see C<visit_constant_ref()>.
+Constants are referenced by operands in the code segment (including the
+variable arguments of the calling convention ops), by the fixup table,
+by annotations and by the debug segment. When counting, the strings
+in a referenced key constant are counted as well, as these are looked up
+in the constant table when the key is packed.
+
+The code segment must be completely emitted before calling this function.
+
+=cut
+
+*/
+static void
+walk_constant_refs(ARGIN(bytecode * const bc), ARGMOD_NULLOK(unsigned * const refcounts),
+    ARGIN_NULLOK(opcode_t const * const newindex))
+{
+    ASSERT_ARGS(walk_constant_refs)
+    Interp               *interp = bc->interp;
+    PackFile_ByteCode    *code   = bc->code;
+    PackFile_ConstTable  *ct     = code->const_table;
+    PackFile_FixupTable  *ft     = code->fixups;
+    PackFile_Annotations *ann    = code->annotations;
+    PackFile_Debug       *debug  = code->debugs;
+    opcode_t             *pc     = code->base.data;
+    opcode_t             *end    = pc + code->base.size;
+    opcode_t              i;
+
+    /* operands in the code segment */
+    while (pc < end) {
+        opcode_t           op   = *pc;
+        op_info_t  * const info = &interp->op_info_table[op];
+        opcode_t           sigindex;
+        int                arg;
+
+        ++pc;
+        /* get the signature index before it is renumbered, if this op has one */
+        sigindex = info->op_count > 1 ? *pc : 0;
+
+        /* note that op_count counts the op itself as well */
+        for (arg = 0; arg < info->op_count - 1; ++arg) {
+            if (IS_CONSTANT_REF(info->types[arg]))
+                visit_constant_ref(pc + arg, refcounts, newindex);
+        }
+
+        pc += info->op_count - 1;
+
+        /* these ops have a variable number of arguments, which are described
+         * by the signature PMC that is passed as the first argument.
+         */
+        if (op == PARROT_OP_set_args_pc
+        ||  op == PARROT_OP_get_results_pc
+        ||  op == PARROT_OP_get_params_pc
+        ||  op == PARROT_OP_set_returns_pc) {
+            PMC    *sig     = ct->constants[sigindex]->u.key;
+            INTVAL  numargs = VTABLE_elements(interp, sig);
+
+            for (arg = 0; arg < numargs; ++arg) {
+                INTVAL flags = VTABLE_get_integer_keyed_int(interp, sig, arg);
+
+                if (IS_CONSTANT_REF(flags))
+                    visit_constant_ref(pc + arg, refcounts, newindex);
+            }
+
+            pc += numargs;
+        }
+    }
+
+    /* sub PMCs */
+    for (i = 0; i < ft->fixup_count; ++i) {
+        if (ft->fixups[i]->type == enum_fixup_sub)
+            visit_constant_ref(&ft->fixups[i]->offset, refcounts, newindex);
+    }
+
+    /* annotation keys, and values that are stored as constants */
+    if (ann) {
+        for (i = 0; i < ann->num_entries; ++i) {
+            PackFile_Annotations_Entry *entry = ann->entries[i];
+            opcode_t                    type  = ann->keys[entry->key]->type;
+
+            if (type == PF_ANNOTATION_KEY_TYPE_STR || type == PF_ANNOTATION_KEY_TYPE_NUM)
+                visit_constant_ref(&entry->value, refcounts, newindex);
+        }
+
+        for (i = 0; i < ann->num_keys; ++i)
+            visit_constant_ref(&ann->keys[i]->name, refcounts, newindex);
+    }
+
+    /* file names in the debug segment */
+    if (debug) {
+        for (i = 0; i < debug->num_mappings; ++i)
+            visit_constant_ref(&debug->mappings[i]->filename, refcounts, newindex);
+    }
+
+    /* strings in keys; these are not referenced by index, so only count them.
+     * The string constants are hashed first, so that a string in a key is only
+     * compared to the strings in its bucket, not to all constants.
+     */
+    if (refcounts && ct->const_count > 0) {
+        opcode_t const  numbuckets = ct->const_count;
+        opcode_t       *first      = mem_allocate_n_typed(numbuckets, opcode_t);
+        opcode_t       *next       = mem_allocate_n_typed(ct->const_count, opcode_t);
+
+        for (i = 0; i < numbuckets; ++i)
+            first[i] = -1;
+
+        /* each bucket lists its strings by index, as the first equal one counts */
+        for (i = ct->const_count - 1; i >= 0; --i) {
+            if (ct->constants[i]->type == PFC_STRING) {
+                size_t const bucket = Parrot_str_to_hashval(interp, ct->constants[i]->u.string)
+                                    % numbuckets;
+
+                next[i]       = first[bucket];
+                first[bucket] = i;
+            }
+        }
+
+        for (i = 0; i < ct->const_count; ++i) {
+            PMC *k;
+
+            if (ct->constants[i]->type != PFC_KEY || refcounts[i] == 0)
+                continue;
+
+            for (k = ct->constants[i]->u.key; k != NULL; k = key_next(interp, k)) {
+                STRING   *str;
+                opcode_t  strindex;
+
+                if ((PObj_get_FLAGS(k) & KEY_type_FLAGS) != KEY_string_FLAG)
+                    continue;
+
+                str      = key_string(interp, k);
+                strindex = first[Parrot_str_to_hashval(interp, str) % numbuckets];
+
+                for (; strindex >= 0; strindex = next[strindex]) {
+                    if (STRING_equal(interp, ct->constants[strindex]->u.string, str)) {
+                        ++refcounts[strindex];
+                        break;
+                    }
+                }
+            }
+        }
+
+        mem_sys_free(first);
+        mem_sys_free(next);
+    }
+}
+
+/*
+
+=item C<static void renumber_constants(bytecode * const bc, opcode_t const *
+const newindex)>
+
+Move each constant to the index given by C<newindex>, and update all
+references. Constants with a new index of -1 are removed; all other
+new indices must be unique, and together form the range 0 up to the
+new number of constants.
+
+=cut
+
+*/
+static void
+renumber_constants(ARGIN(bytecode * const bc), ARGIN(opcode_t const * const newindex))
+{
+    ASSERT_ARGS(renumber_constants)
+    PackFile_ConstTable  *ct       = bc->code->const_table;
+    PackFile_Constant   **newtable;
+    opcode_t              newcount = 0;
+    opcode_t              i;
+
+    for (i = 0; i < ct->const_count; ++i) {
+        if (newindex[i] >= 0)
+            ++newcount;
+    }
+
+    /* update the references first; the old table is needed to find signatures */
+    walk_constant_refs(bc, NULL, newindex);
+
+    newtable = mem_allocate_n_typed(newcount, PackFile_Constant *);
+
+    for (i = 0; i < ct->const_count; ++i) {
+        if (newindex[i] >= 0)
+            newtable[newindex[i]] = ct->constants[i];
+        else
+            mem_sys_free(ct->constants[i]);
+    }
+
+    mem_sys_free(ct->constants);
+    ct->constants   = newtable;
+    ct->const_count = newcount;
+}
+
+/*
+
+=item C<int count_constants(bytecode * const bc)>
+
+Return the number of constants in the constant table of C<bc>.
 
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+int
+count_constants(ARGIN(bytecode * const bc))
+{
+    ASSERT_ARGS(count_constants)
+    return bc->code->const_table->const_count;
+}
+
+/*
+
+=item C<int compact_constants(bytecode * const bc)>
+
+Remove all constants that are no longer referenced, for instance because
+the instructions that used them were optimized, or because subs were
+removed. The remaining constants keep their order. The interpreter PMC
+that was stored by C<new_bytecode()> is always kept at index 0.
+The number of removed constants is returned.
+
+Call this after all code was emitted, before writing the PBC file.
+
+=cut
+
+*/
+int
+compact_constants(ARGIN(bytecode * const bc))
+{
+    ASSERT_ARGS(compact_constants)
+    PackFile_ConstTable *ct        = bc->code->const_table;
+    opcode_t             count     = ct->const_count;
+    opcode_t             live      = 0;
+    unsigned            *refcounts = mem_allocate_n_zeroed_typed(count, unsigned);
+    opcode_t            *newindex  = mem_allocate_n_typed(count, opcode_t);
+    opcode_t             i;
+
+    walk_constant_refs(bc, refcounts, NULL);
+
+    /* keep the interpreter PMC; see new_bytecode() */
+    ++refcounts[0];
+
+    for (i = 0; i < count; ++i)
+        newindex[i] = refcounts[i] > 0 ? live++ : -1;
+
+    if (live < count)
+        renumber_constants(bc, newindex);
+
+    mem_sys_free(refcounts);
+    mem_sys_free(newindex);
+
+    return count - live;
+}
+
+/*
+
+=item C<static int compare_constant_ranks(const void *a, const void *b)>
+
+Comparison function for C<qsort()>, to order C<constant_rank> structs by
+group, then by number of references (most used first), then by current
+index, so that the order is stable. The group is the kind of constant.
+
+=cut
+
+*/
+static int
+compare_constant_ranks(ARGIN(const void *a), ARGIN(const void *b))
+{
+    ASSERT_ARGS(compare_constant_ranks)
+    constant_rank const * const x = (constant_rank const *)a;
+    constant_rank const * const y = (constant_rank const *)b;
+
+    if (x->group != y->group)
+        return x->group - y->group;
+
+    if (x->refcount != y->refcount)
+        return x->refcount > y->refcount ? -1 : 1;
+
+    return x->index < y->index ? -1 : 1;
+}
+
+/*
+
+=item C<void reorder_constants(bytecode * const bc)>
+
+Reorder the constant table, so that constants of the same type are stored
+together, and within each type, constants that are used most come first.
+The order is: strings, numbers, keys, other PMCs and finally the sub PMCs.
+Keys refer to string and number constants by index, and these must be
+unpacked before the keys when the PBC file is loaded, so all strings and
+numbers come before any key. The interpreter PMC that was stored by
+C<new_bytecode()> stays at index 0. All references are updated.
+
+Call this after all code was emitted, before writing the PBC file.
+
+=cut
+
+*/
+void
+reorder_constants(ARGIN(bytecode * const bc))
+{
+    ASSERT_ARGS(reorder_constants)
+    PackFile_ConstTable *ct        = bc->code->const_table;
+    PackFile_FixupTable *ft        = bc->code->fixups;
+    opcode_t             count     = ct->const_count;
+    unsigned            *refcounts = mem_allocate_n_zeroed_typed(count, unsigned);
+    opcode_t            *newindex  = mem_allocate_n_typed(count, opcode_t);
+    constant_rank       *ranks     = mem_allocate_n_typed(count, constant_rank);
+    opcode_t             i;
+
+    walk_constant_refs(bc, refcounts, NULL);
+
+    for (i = 0; i < count; ++i) {
+        ranks[i].index    = i;
+        ranks[i].refcount = refcounts[i];
+
+        switch (ct->constants[i]->type) {
+            case PFC_STRING:
+                ranks[i].group = 0;
+                break;
+            case PFC_NUMBER:
+                ranks[i].group = 1;
+                break;
+            case PFC_KEY:
+                ranks[i].group = 2;
+                break;
+            default:
+                ranks[i].group = 3;
+                break;
+        }
+    }
+
+    /* sub PMCs go last */
+    for (i = 0; i < ft->fixup_count; ++i) {
+        if (ft->fixups[i]->type == enum_fixup_sub)
+            ranks[ft->fixups[i]->offset].group = 4;
+    }
+
+    /* the interpreter PMC stays first, so leave it out of the sort */
+    qsort(ranks + 1, count - 1, sizeof (constant_rank), compare_constant_ranks);
+
+    for (i = 0; i < count; ++i)
+        newindex[ranks[i].index] = i;
+
+    renumber_constants(bc, newindex);
+
+    mem_sys_free(refcounts);
+    mem_sys_free(newindex);
+    mem_sys_free(ranks);
+}
 
 /*
 
@@ -1302,9 +1894,9 @@ write_pbc_file(ARGIN(bytecode * const bc), ARGIN(char const * const filename))
     int       result;
 
     /* pack the packfile */
-    size   = PackFile_pack_size(bc->interp, bc->interp->code->base.pf) * sizeof (opcode_t);
+    size   = PackFile_pack_size(bc->interp, bc->code->base.pf) * sizeof (opcode_t);
     packed = (opcode_t*) mem_sys_allocate(size);
-    PackFile_pack(bc->interp, bc->interp->code->base.pf, packed);
+    PackFile_pack(bc->interp, bc->code->base.pf, packed);
 
     /* write to file */
     fp = fopen(filename, "wb");
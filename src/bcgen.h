@@ -128,6 +128,13 @@ int add_sub_pmc(
         __attribute__nonnull__(2)
         __attribute__nonnull__(5);
 
+int compact_constants(ARGIN(bytecode * const bc))
+        __attribute__nonnull__(1);
+
+PARROT_WARN_UNUSED_RESULT
+int count_constants(ARGIN(bytecode * const bc))
+        __attribute__nonnull__(1);
+
 void create_annotations_segment(
     ARGIN(bytecode * const bc),
     ARGIN(char const * const name))
@@ -165,6 +172,11 @@ int emit_pbc_key(ARGIN(bytecode * const bc), ARGIN(struct key * const k))
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
 
+PARROT_WARN_UNUSED_RESULT
+PARROT_CANNOT_RETURN_NULL
+PackFile_ByteCode * get_code_segment(ARGIN(bytecode * const bc))
+        __attribute__nonnull__(1);
+
 FLOATVAL get_num_const(ARGIN(bytecode * const bc), unsigned index)
         __attribute__nonnull__(1);
 
@@ -181,6 +193,25 @@ bytecode * new_bytecode(PARROT_INTERP, ARGIN(char const * const filename))
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
 
+void reorder_constants(ARGIN(bytecode * const bc))
+        __attribute__nonnull__(1);
+
+void relocate_sub_pmc(
+    ARGIN(bytecode * const bc),
+    int subconst_index,
+    int startoffset,
+    int endoffset)
+        __attribute__nonnull__(1);
+
+void remove_sub_pmc(ARGIN(bytecode * const bc), int subconst_index)
+        __attribute__nonnull__(1);
+
+void set_sub_pmc_registers(
+    ARGIN(bytecode * const bc),
+    int subconst_index,
+    unsigned regs_used[4])
+        __attribute__nonnull__(1);
+
 int store_key_bytecode(ARGIN(bytecode * const bc), ARGIN(opcode_t * key))
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
@@ -209,6 +240,10 @@ void write_pbc_file(
        PARROT_ASSERT_ARG(bc) \
     , PARROT_ASSERT_ARG(info) \
     , PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_compact_constants __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
+#define ASSERT_ARGS_count_constants __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
 #define ASSERT_ARGS_create_annotations_segment __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc) \
     , PARROT_ASSERT_ARG(name))
@@ -228,6 +263,8 @@ void write_pbc_file(
 #define ASSERT_ARGS_emit_pbc_key __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc) \
     , PARROT_ASSERT_ARG(k))
+#define ASSERT_ARGS_get_code_segment __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
 #define ASSERT_ARGS_get_num_const __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc))
 #define ASSERT_ARGS_get_pmc_const __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
@@ -237,6 +274,14 @@ void write_pbc_file(
 #define ASSERT_ARGS_new_bytecode __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(interp) \
     , PARROT_ASSERT_ARG(filename))
+#define ASSERT_ARGS_reorder_constants __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
+#define ASSERT_ARGS_relocate_sub_pmc __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
+#define ASSERT_ARGS_remove_sub_pmc __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
+#define ASSERT_ARGS_set_sub_pmc_registers __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(bc))
 #define ASSERT_ARGS_store_key_bytecode __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(bc) \
     , PARROT_ASSERT_ARG(key))
@@ -248,6 +293,9 @@ void write_pbc_file(
 
 bytecode *new_bytecode(Interp *interp, char const * const filename);
 
+/* the code segment that is generated; it's not made the current one */
+PackFile_ByteCode *get_code_segment(bytecode * const bc);
+
 void destroy_bytecode(bytecode * bc);
 
 void create_codesegment(bytecode * const bc, int codesize);
@@ -259,6 +307,15 @@ void create_annotations_segment(bytecode * const bc, char const * const name);
 void add_annotation(bytecode * const bc, opcode_t offset, opcode_t key,
                                          opcode_t type, opcode_t value);
 
+/* call this to remove unused constants before writing the PBC file */
+int compact_constants(bytecode * const bc);
+
+/* number of constants stored so far */
+int count_constants(bytecode * const bc);
+
+/* call this to store the most used constants first */
+void reorder_constants(bytecode * const bc);
+
 /* call this to write the PBC file */
 void write_pbc_file(bytecode * const bc, char const * const filename) ;
 
@@ -304,6 +361,12 @@ struct lexer_state;
 int add_sub_pmc(bytecode * const bc, sub_info * const info, int needlex, int subpragmas,
                 struct lexer_state * const lexer);
 
+void relocate_sub_pmc(bytecode * const bc, int subconst_index, int startoffset, int endoffset);
+
+void remove_sub_pmc(bytecode * const bc, int subconst_index);
+
+void set_sub_pmc_registers(bytecode * const bc, int subconst_index, unsigned regs_used[4]);
+
 
 #endif /* PARROT_BCGEN_H_GUARD */
 
@@ -683,9 +683,12 @@ static yyconst flex_int16_t yy_rule_linenum[21] =
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "parrot/parrot.h"
 #include "parrot/embed.h"
 #include "pirheredoc.h"
+#include "pirdefines.h"
 
 
 /* don't bother to generate and include the header file;
@@ -719,6 +722,8 @@ int   yyget_lineno(yyscan_t yyscanner);
 typedef struct global_state {
     int             errors;
     char           *heredoc;       /* heredoc string buffer */
+    size_t          heredoc_length; /* number of characters in heredoc */
+    size_t          heredoc_size;   /* allocated size of heredoc */
     char           *linebuffer;    /* buffer to save the 'rest of the line'
                                       before scanning a heredoc */
     char           *delimiter;     /* buffer to save the delimiter of the
@@ -729,10 +734,65 @@ typedef struct global_state {
 
     FILE           *outfile;        /* output file; or STDOUT if no file is specified */
 
+    struct include_entry *parent;   /* included file whose contents are being cached,
+                                       or NULL if writing to the real output */
+    struct include_list **includes; /* files included by the compilation unit */
+
     PARROT_INTERP;
 
 } global_state;
 
+/* list of included files; the typedef is in pirheredoc.h */
+struct include_list {
+    struct include_entry *entry;
+    struct include_list  *next;
+
+};
+
+/* where the contents of a nested .include file are in the contents of the file
+ * that includes it; see write_contents() */
+typedef struct include_piece {
+    size_t                start;     /* offset of the first character */
+    size_t                end;       /* offset just after the last character */
+    struct include_entry *entry;     /* the nested file */
+    struct include_piece *next;
+
+} include_piece;
+
+/* a preprocessed .include file; see include_file() */
+typedef struct include_entry {
+    char                 *path;      /* full path of the included file */
+    time_t                mtime;     /* modification time when it was scanned */
+    off_t                 size;      /* size in bytes when it was scanned */
+    char                 *contents;  /* flattened contents; not NULL-terminated */
+    size_t                length;    /* number of characters in contents */
+    int                   once;      /* true if it asks to be included only once */
+    int                   defs_only; /* true if it only defines macros and constants */
+    int                   scanning;  /* true while a thread scans it into the cache */
+    unsigned              mark;      /* used when walking the includes */
+    int                   preloaded; /* true if its definitions are loaded already */
+
+    struct include_list  *includes;  /* files included by this file */
+    struct include_piece *pieces;    /* their places in contents, in order */
+    struct include_piece *last_piece;
+
+    struct include_entry *next;
+
+} include_entry;
+
+/* The include cache is shared by all compilations in the process; the lock
+ * protects the cache, the counter below and all include entries. It is only
+ * held to look up, store or write cached contents, not while a file is
+ * scanned, so files can be preprocessed in several threads at once.
+ */
+PIRC_STATIC_MUTEX(include_cache_lock);
+
+/* all files that were .included by this process, with their flattened contents */
+static include_entry *include_cache = NULL;
+
+/* the last value used to mark entries when walking the includes */
+static unsigned dependency_mark = 0;
+
 /* accessor methods for setting and getting the lexer_state */
 #define YY_EXTRA_TYPE  struct global_state *
 
@@ -794,11 +854,15 @@ init_global_state(PARROT_INTERP, NOTNULL(char * const filename), NOTNULL(FILE *o
     global_state *state = (global_state *)mem_sys_allocate(sizeof (global_state));
     state->filename     = filename;
     state->heredoc      = NULL;
+    state->heredoc_length = 0;
+    state->heredoc_size   = 0;
     state->linebuffer   = NULL;
     state->delimiter    = NULL;
     state->file_buffer  = NULL;
     state->errors       = 0;
     state->outfile      = outfile;
+    state->parent       = NULL;
+    state->includes     = NULL;
     state->interp       = interp;
 
     return state;
@@ -825,33 +889,229 @@ destroy_global_state(NOTNULL(global_state *state)) {
     state = NULL;
 }
 
+/*
+
+=item C<static void
+append_heredoc(global_state * const state, char const * const str, size_t len)>
+
+Append C<len> characters of C<str> to the heredoc buffer. The buffer is
+doubled in size whenever it's full, so that accumulating a heredoc string
+takes time linear in its length. The buffer is not NULL-terminated; its
+length is kept in C<heredoc_length>.
+
+=cut
+
+*/
+static void
+append_heredoc(NOTNULL(global_state * const state), NOTNULL(char const * const str), size_t len) {
+    if (state->heredoc_length + len > state->heredoc_size) {
+        size_t newsize = state->heredoc_size ? state->heredoc_size : 128;
+
+        while (newsize < state->heredoc_length + len)
+            newsize *= 2;
+
+        state->heredoc      = (char *)mem_sys_realloc(state->heredoc, newsize * sizeof (char));
+        state->heredoc_size = newsize;
+    }
+
+    memcpy(state->heredoc + state->heredoc_length, str, len);
+    state->heredoc_length += len;
+}
 
 /*
 
-=item C<void
-process_heredocs(char * const filename, FILE *outputfile)>
+=item C<static void
+start_heredoc(global_state * const state)>
 
-Scan the file C<filename> for heredoc strings, and write the I<normalized> heredoc
-strings to the file C<outputfile>. The scan session uses a fresh C<yyscan_t>
-object, so any nested (recursive, in a way) calls of this function are handled
-fine, as each invocation has its own state. After the file C<filename> is processed,
-all resources are released.
+Start a new heredoc string; the buffer of the previous one is reused.
+An empty heredoc has at least a newline.
 
 =cut
 
 */
-void
-process_heredocs(PARROT_INTERP, NOTNULL(char * const filename), NOTNULL(FILE *outfile)) {
+static void
+start_heredoc(NOTNULL(global_state * const state)) {
+    state->heredoc_length = 0;
+    append_heredoc(state, "\\n", 2);
+}
+
+/*
+
+=item C<static void
+flush_heredoc(global_state * const state)>
+
+Write the flattened heredoc string, in quotes, to the output file.
+
+=cut
+
+*/
+static void
+flush_heredoc(NOTNULL(global_state * const state)) {
+    fputc('"', state->outfile);
+    fwrite(state->heredoc, sizeof (char), state->heredoc_length, state->outfile);
+    fputc('"', state->outfile);
+}
+
+/*
+
+=item C<static int
+has_once_marker(char const * const path)>
+
+Check whether the file C<path> asks to be included only once, by a line
+
+ #pragma once
+
+before its first line that isn't empty or a comment. As it's a comment, other
+PIR compilers just ignore it. Returns TRUE if the line is found, FALSE
+otherwise, or if the file can't be read.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+has_once_marker(NOTNULL(char const * const path)) {
+    FILE *file = fopen(path, "r");
+    char  line[256];
+    int   found = FALSE;
+
+    if (file == NULL)
+        return FALSE;
+
+    while (!found && fgets(line, sizeof (line), file) != NULL) {
+        char const *iter = line;
+
+        while (*iter == ' ' || *iter == '\t' || *iter == '\r')
+            ++iter;
+
+        if (*iter == '\n' || *iter == '\0')
+            continue;
+
+        if (*iter++ != '#')
+            break;
+
+        while (*iter == ' ' || *iter == '\t')
+            ++iter;
+
+        if (strncmp(iter, "pragma", 6) == 0 && (iter[6] == ' ' || iter[6] == '\t')) {
+            iter += 6;
+            while (*iter == ' ' || *iter == '\t')
+                ++iter;
+
+            if (strncmp(iter, "once", 4) == 0) {
+                iter += 4;
+                while (*iter == ' ' || *iter == '\t' || *iter == '\r')
+                    ++iter;
+
+                found = (*iter == '\n' || *iter == '\0');
+            }
+        }
+
+        /* skip the rest of a comment that didn't fit */
+        if (strchr(line, '\n') == NULL) {
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n')
+                ;
+        }
+    }
+
+    fclose(file);
+    return found;
+}
+
+/*
+
+=item C<static int
+is_definitions_only(char const * const contents, size_t length)>
+
+Check whether the flattened contents of an included file only define macros,
+macro constants and global constants. Only the definitions of such a file can
+be loaded from a snapshot instead; see C<visit_included_definitions()>.
+Returns TRUE if that is the case, FALSE otherwise.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+is_definitions_only(NOTNULL(char const * const contents), size_t length) {
+    char const *iter     = contents;
+    char const *end      = contents + length;
+    int         in_macro = 0;
+
+    while (iter < end) {
+        char const *eol = (char const *)memchr(iter, '\n', end - iter);
+        size_t      linelength;
+
+        if (eol == NULL)
+            eol = end;
+
+        while (iter < eol && (*iter == ' ' || *iter == '\t' || *iter == '\r'))
+            ++iter;
+
+        linelength = eol - iter;
+
+#define LINE_STARTS_WITH(s) (linelength >= sizeof (s) - 1 && strncmp(iter, s, sizeof (s) - 1) == 0)
+
+        if (in_macro) {
+            if (LINE_STARTS_WITH(".endm"))
+                in_macro = 0;
+        }
+        else if (linelength == 0
+             ||  LINE_STARTS_WITH(".macro_const")
+             ||  LINE_STARTS_WITH(".const")
+             ||  LINE_STARTS_WITH(".globalconst")
+             ||  LINE_STARTS_WITH(".line")
+             ||  LINE_STARTS_WITH(".file")) {
+            /* nothing to do; these lines are fine */
+        }
+        else if (LINE_STARTS_WITH(".macro"))
+            in_macro = 1;
+        else
+            return FALSE;
+
+#undef LINE_STARTS_WITH
+
+        iter = eol + 1;
+    }
+
+    return !in_macro;
+}
+
+/*
+
+=item C<static int
+scan_file(PARROT_INTERP, char * const filename, FILE *outfile,
+include_list **includes, include_entry *parent)>
+
+Scan the file C<filename> for heredoc strings, and write the I<normalized>
+heredoc strings to the file C<outfile>. The scan session uses a fresh
+C<yyscan_t> object, so any nested (recursive, in a way) calls of this function
+are handled fine, as each invocation has its own state. C<includes> is the
+list of files included by the compilation unit that the file is part of;
+C<parent> is the included file whose contents are being cached, or NULL if the
+output is not captured for the include cache. After the file C<filename> is
+processed, all resources are released. The number of errors is returned; a
+file that can't be opened is one error.
+
+=cut
+
+*/
+static int
+scan_file(PARROT_INTERP, NOTNULL(char * const filename), NOTNULL(FILE *outfile),
+          NOTNULL(include_list **includes), NULLOK(include_entry *parent))
+{
     yyscan_t      yyscanner;
     global_state *state = NULL;
     FILE         *fp;
+    int           errors;
 
     /* open the file */
     fp = fopen(filename, "r");
 
     if (fp == NULL) {
         fprintf(stderr, "heredoc preprocessor: error opening file '%s'\n", filename);
-        exit(EXIT_FAILURE);
+        return 1;
     }
 
     /* initialize a yyscan_t object */
@@ -859,17 +1119,643 @@ process_heredocs(PARROT_INTERP, NOTNULL(char * const filename), NOTNULL(FILE *ou
     /* set the scanner to a string buffer and go parse */
     yyset_in(fp,yyscanner);
 
-    state = init_global_state(interp, filename, outfile);
+    state           = init_global_state(interp, filename, outfile);
+    state->includes = includes;
+    state->parent   = parent;
 
     yyset_extra(state,yyscanner);
 
     /* the lexer never returns anything, only call it once. Don't give a YYSTYPE object. */
     yylex(yyscanner);
 
+    errors = state->errors;
+
     destroy_global_state(state);
 
     /* clean up after playing */
     yylex_destroy(yyscanner);
+    fclose(fp);
+
+    return errors;
+}
+
+/*
+
+=item C<static include_list *
+add_include(include_list **list, include_entry * const entry)>
+
+Add C<entry> to the end of C<list>, unless it's in there already. Returns the
+new node, or NULL if C<entry> was in the list.
+
+=cut
+
+*/
+PARROT_IGNORABLE_RESULT
+PARROT_CAN_RETURN_NULL
+static include_list *
+add_include(NOTNULL(include_list **list), NOTNULL(include_entry * const entry)) {
+    while (*list != NULL) {
+        if ((*list)->entry == entry)
+            return NULL;
+
+        list = &(*list)->next;
+    }
+
+    *list          = mem_allocate_zeroed_typed(include_list);
+    (*list)->entry = entry;
+
+    return *list;
+}
+
+/*
+
+=item C<void
+free_include_list(include_list *list)>
+
+Free the nodes of C<list>; the entries themselves are left alone. Use this to
+free the list returned by C<process_heredocs()>.
+
+=cut
+
+*/
+void
+free_include_list(NULLOK(include_list *list)) {
+    while (list != NULL) {
+        include_list * const next = list->next;
+        mem_sys_free(list);
+        list = next;
+    }
+}
+
+/*
+
+=item C<static include_piece *
+add_piece(include_entry * const parent, size_t start, size_t end,
+          include_entry * const entry)>
+
+Record that the contents of the nested file C<entry> are at C<start> up to
+C<end> in the contents of C<parent>. Returns the new piece, whose C<end> may be
+set later.
+
+=cut
+
+*/
+PARROT_IGNORABLE_RESULT
+PARROT_CANNOT_RETURN_NULL
+static include_piece *
+add_piece(NOTNULL(include_entry * const parent), size_t start, size_t end,
+          NOTNULL(include_entry * const entry))
+{
+    include_piece * const piece = mem_allocate_zeroed_typed(include_piece);
+
+    piece->start = start;
+    piece->end   = end;
+    piece->entry = entry;
+
+    if (parent->last_piece != NULL)
+        parent->last_piece->next = piece;
+    else
+        parent->pieces = piece;
+
+    parent->last_piece = piece;
+    return piece;
+}
+
+/*
+
+=item C<static void
+free_pieces(include_entry * const entry)>
+
+Forget where the nested files are in the contents of C<entry>.
+
+=cut
+
+*/
+static void
+free_pieces(NOTNULL(include_entry * const entry)) {
+    include_piece *piece = entry->pieces;
+
+    while (piece != NULL) {
+        include_piece * const next = piece->next;
+        mem_sys_free(piece);
+        piece = next;
+    }
+
+    entry->pieces     = NULL;
+    entry->last_piece = NULL;
+}
+
+/*
+
+=item C<static int
+is_included(include_list *list, include_list *stop, include_entry * const entry)>
+
+Check whether C<entry> is in C<list> before the node C<stop>, or is included by
+a file in there, directly or indirectly. Pass NULL for C<stop> to check the
+whole list. The caller must hold C<include_cache_lock>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+is_included(NULLOK(include_list *list), NULLOK(include_list *stop),
+            NOTNULL(include_entry * const entry))
+{
+    for (; list != stop; list = list->next) {
+        if (list->entry == entry || is_included(list->entry->includes, NULL, entry))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*
+
+=item C<static void
+write_contents(global_state * const state, char const * const contents,
+               size_t length, include_piece *pieces, include_list *listed)>
+
+Write the flattened contents of an included file to the output. The nested
+files in them are at C<pieces>.
+
+If the output is the contents of a file that is being cached, everything is
+written, and the nested files are recorded as pieces of that file; it may be
+used in another compilation unit. Otherwise a nested file is left out if its
+definitions were loaded from a snapshot, or if it is included only once and
+was written already: earlier in C<contents>, or by a file that was included
+before the node C<listed> of the compilation unit's includes (NULL means the
+whole list). The caller must hold C<include_cache_lock>.
+
+=cut
+
+*/
+static void
+write_contents(NOTNULL(global_state * const state), NOTNULL(char const * const contents),
+               size_t length, NULLOK(include_piece *pieces), NULLOK(include_list *listed))
+{
+    size_t   done = 0;
+    unsigned mark;
+
+    if (state->parent != NULL) {
+        long const offset = ftell(state->outfile);
+
+        for (; pieces != NULL; pieces = pieces->next)
+            (void)add_piece(state->parent, pieces->start + offset, pieces->end + offset,
+                            pieces->entry);
+
+        fwrite(contents, sizeof (char), length, state->outfile);
+        return;
+    }
+
+    mark = ++dependency_mark;
+
+    for (; pieces != NULL; pieces = pieces->next) {
+        include_entry * const entry = pieces->entry;
+
+        /* a piece that was skipped already, as part of an earlier one */
+        if (pieces->start < done)
+            continue;
+
+        if (entry->preloaded
+        || (entry->once
+           && (entry->mark == mark || is_included(*state->includes, listed, entry))))
+        {
+            fwrite(contents + done, sizeof (char), pieces->start - done, state->outfile);
+            done = pieces->end;
+        }
+
+        entry->mark = mark;
+    }
+
+    fwrite(contents + done, sizeof (char), length - done, state->outfile);
+}
+
+/*
+
+=item C<static void
+cache_file(global_state * const state, include_entry * const entry,
+           char * const fullpath, struct stat const * const info,
+           include_list *listed)>
+
+Scan the included file C<fullpath> into a temporary file, write it to the
+output, and store it in C<entry>, unless it has errors. C<info> is the file's
+status before scanning; C<listed> is as for C<write_contents()>. The caller
+has set C<< entry->scanning >>; it's cleared when done.
+
+=cut
+
+*/
+static void
+cache_file(NOTNULL(global_state * const state), NOTNULL(include_entry * const entry),
+           NOTNULL(char * const fullpath), NOTNULL(struct stat const * const info),
+           NULLOK(include_list *listed))
+{
+    FILE *temp = tmpfile();
+    char *contents;
+    long  length;
+    int   errors;
+
+    if (temp == NULL) { /* can't cache it; just scan it into the output */
+        LOCK(include_cache_lock);
+        entry->scanning = FALSE;
+        UNLOCK(include_cache_lock);
+
+        state->errors += scan_file(state->interp, fullpath, state->outfile,
+                                   state->includes, state->parent);
+        return;
+    }
+
+    errors = scan_file(state->interp, fullpath, temp, state->includes, entry);
+    length = ftell(temp);
+    rewind(temp);
+
+    contents = (char *)mem_sys_allocate((length + 1) * sizeof (char));
+    length   = fread(contents, sizeof (char), length, temp);
+    fclose(temp);
+
+    LOCK(include_cache_lock);
+
+    write_contents(state, contents, length, entry->pieces, listed);
+
+    /* don't cache a file with errors, it'll be reported again next time. */
+    if (errors) {
+        free_pieces(entry);
+        entry->scanning = FALSE;
+        UNLOCK(include_cache_lock);
+
+        mem_sys_free(contents);
+        state->errors += errors;
+        return;
+    }
+
+    entry->mtime     = info->st_mtime;
+    entry->size      = info->st_size;
+    entry->contents  = contents;
+    entry->length    = length;
+    entry->defs_only = is_definitions_only(contents, length);
+    entry->scanning  = FALSE;
+
+    UNLOCK(include_cache_lock);
+}
+
+/*
+
+=item C<static void
+include_file(global_state * const state, char * const fullpath)>
+
+Write the flattened contents of the included file C<fullpath> to the output.
+Each included file is scanned only once per process; its flattened contents
+are kept in the include cache, keyed by its path. If the file's modification
+time or size changed since, it is scanned again. A file that asks to be
+included only once (see C<has_once_marker()>) is skipped if it was written to
+the output of this compilation unit already, directly or as part of another
+file, however that file was written; any other file is written each time.
+Whether a file asks for that is decided before it's scanned, so it doesn't
+depend on the order in which threads scan it. PIR has no conditional
+directives, so there are no include guards to detect; only the pragma counts.
+
+The cache is only locked to look up, store and write contents. While a file is
+scanned into the cache, other threads that include it scan it on their own.
+
+=cut
+
+*/
+static void
+include_file(NOTNULL(global_state * const state), NOTNULL(char * const fullpath)) {
+    include_entry *entry;
+    include_list  *listed;
+    include_piece *piece = NULL;
+    struct stat    info;
+    int            once;
+
+    /* if the file can't be found, let scan_file() report the error */
+    if (stat(fullpath, &info) != 0) {
+        state->errors += scan_file(state->interp, fullpath, state->outfile,
+                                   state->includes, state->parent);
+        return;
+    }
+
+    LOCK(include_cache_lock);
+
+    for (entry = include_cache; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->path, fullpath) == 0)
+            break;
+    }
+
+    if (entry == NULL) {
+        entry       = mem_allocate_zeroed_typed(include_entry);
+        entry->path = (char *)mem_sys_allocate((strlen(fullpath) + 1) * sizeof (char));
+        strcpy(entry->path, fullpath);
+
+        entry->next   = include_cache;
+        include_cache = entry;
+    }
+
+    /* a new or changed file; its cached contents, if any, are out of date */
+    if (entry->mtime != info.st_mtime || entry->size != info.st_size) {
+        UNLOCK(include_cache_lock);
+        once = has_once_marker(fullpath);
+        LOCK(include_cache_lock);
+
+        if (!entry->scanning && entry->contents != NULL) {
+            mem_sys_free(entry->contents);
+            entry->contents = NULL;
+            free_pieces(entry);
+        }
+
+        entry->once  = once;
+        entry->mtime = info.st_mtime;
+        entry->size  = info.st_size;
+    }
+
+    /* the contents that are being cached must be complete, as they may be
+     * used in another compilation unit; so only skip the file if it's
+     * written to the real output. write_contents() skips it when the
+     * cached contents are written.
+     */
+    if (entry->once && state->parent == NULL && is_included(*state->includes, NULL, entry)) {
+        UNLOCK(include_cache_lock);
+        return;
+    }
+
+    /* remember the dependency, for write_dependencies() */
+    listed = add_include(state->parent ? &state->parent->includes : state->includes, entry);
+
+    /* the definitions of this file were loaded from a snapshot */
+    if (entry->preloaded && state->parent == NULL) {
+        UNLOCK(include_cache_lock);
+        return;
+    }
+
+    /* remember where it goes in the contents that are being cached */
+    if (state->parent != NULL)
+        piece = add_piece(state->parent, ftell(state->outfile), 0, entry);
+
+    /* write the cached contents */
+    if (entry->contents != NULL) {
+        write_contents(state, entry->contents, entry->length, entry->pieces, listed);
+        UNLOCK(include_cache_lock);
+    }
+    /* another thread is scanning it; just scan it into the output */
+    else if (entry->scanning) {
+        UNLOCK(include_cache_lock);
+        state->errors += scan_file(state->interp, fullpath, state->outfile,
+                                   state->includes, state->parent);
+    }
+    else {
+        entry->scanning = TRUE;
+
+        free_pieces(entry);
+        free_include_list(entry->includes);
+        entry->includes = NULL;
+
+        UNLOCK(include_cache_lock);
+
+        cache_file(state, entry, fullpath, &info, listed);
+    }
+
+    if (piece != NULL)
+        piece->end = ftell(state->outfile);
+}
+
+/*
+
+=item C<include_list *
+process_heredocs(char * const filename, FILE *outputfile, int *errors)>
+
+Scan the file C<filename> for heredoc strings, and write the I<normalized>
+heredoc strings to the file C<outputfile>. Each call starts a new compilation
+unit; the contents of C<.include>d files are cached across calls, and may be
+shared by calls in several threads at once. The number of errors, such as
+files that can't be opened, is stored in C<errors>; the output is incomplete
+if it's not 0. The list of files that were included is returned; pass it to
+C<write_dependencies()> and C<visit_included_definitions()>, and free it with
+C<free_include_list()>.
+
+=cut
+
+*/
+include_list *
+process_heredocs(PARROT_INTERP, NOTNULL(char * const filename), NOTNULL(FILE *outfile),
+                 NOTNULL(int *errors))
+{
+    include_list *includes = NULL;
+
+    PIRC_MUTEX_READY(include_cache_lock);
+
+    *errors = scan_file(interp, filename, outfile, &includes, NULL);
+
+    return includes;
+}
+
+/*
+
+=item C<static void
+write_make_name(FILE *depfile, char const *name)>
+
+Write the file name C<name> to C<depfile>, escaping the characters that
+have a special meaning to make.
+
+=cut
+
+*/
+static void
+write_make_name(NOTNULL(FILE *depfile), NOTNULL(char const *name)) {
+    for (; *name != '\0'; ++name) {
+        switch (*name) {
+            case ' ':
+            case '\t':
+            case '#':
+                fputc('\\', depfile);
+                fputc(*name, depfile);
+                break;
+            case '$':
+                fputs("$$", depfile);
+                break;
+            default:
+                fputc(*name, depfile);
+                break;
+        }
+    }
+}
+
+/*
+
+=item C<static void
+write_included_files(FILE *depfile, include_list *list, unsigned mark,
+int phony)>
+
+Write the names of all files in C<list>, and the files that they include
+in turn, to C<depfile>. Files that were written already are marked with
+C<mark>, so that each file is written only once. If C<phony> is true, each
+file is written as a target without prerequisites; otherwise as a
+prerequisite.
+
+=cut
+
+*/
+static void
+write_included_files(NOTNULL(FILE *depfile), NULLOK(include_list *list),
+                     unsigned mark, int phony)
+{
+    for (; list != NULL; list = list->next) {
+        include_entry * const entry = list->entry;
+
+        if (entry->mark == mark)
+            continue;
+
+        entry->mark = mark;
+
+        if (phony) {
+            fputc('\n', depfile);
+            write_make_name(depfile, entry->path);
+            fputs(":\n", depfile);
+        }
+        else {
+            fputs(" \\\n  ", depfile);
+            write_make_name(depfile, entry->path);
+        }
+
+        write_included_files(depfile, entry->includes, mark, phony);
+    }
+}
+
+/*
+
+=item C<static void
+visit_definitions(include_list *list, include_visitor visit, void *data, unsigned mark)>
+
+Call C<visit> for each file in C<list>, and for the files that they include
+in turn, that only contains definitions. Files that were visited already are
+marked with C<mark>.
+
+=cut
+
+*/
+static void
+visit_definitions(NULLOK(include_list *list), NOTNULL(include_visitor visit),
+                  NULLOK(void *data), unsigned mark)
+{
+    for (; list != NULL; list = list->next) {
+        include_entry * const entry = list->entry;
+
+        if (entry->mark == mark)
+            continue;
+
+        entry->mark = mark;
+
+        if (entry->once && entry->defs_only && entry->contents != NULL)
+            visit(entry->path, (long)entry->mtime, (long)entry->size, data);
+
+        visit_definitions(entry->includes, visit, data, mark);
+    }
+}
+
+/*
+
+=item C<void
+visit_included_definitions(include_list *includes, include_visitor visit, void *data)>
+
+Call C<visit> for each file in C<includes>, the files that were included by a
+call to C<process_heredocs()>, that asks to be included only once and only
+contains definitions of macros and constants (see C<has_once_marker()> and
+C<is_definitions_only()>). Skipping the C<.include> of such a file doesn't
+change the program once its definitions are loaded. Besides C<data>, C<visit>
+gets the file's path, and its modification time and size when it was scanned.
+
+=cut
+
+*/
+void
+visit_included_definitions(NULLOK(include_list *includes), NOTNULL(include_visitor visit),
+                           NULLOK(void *data))
+{
+    PIRC_MUTEX_READY(include_cache_lock);
+    LOCK(include_cache_lock);
+
+    visit_definitions(includes, visit, data, ++dependency_mark);
+
+    UNLOCK(include_cache_lock);
+}
+
+/*
+
+=item C<int
+preload_include(char const * const path, long mtime, long size)>
+
+Mark the file C<path> as preloaded: its definitions were loaded from a
+snapshot, so C<.include> directives for it are skipped, until the file is
+changed. If the file's modification time or size don't match C<mtime> and
+C<size>, the file was changed after the snapshot was taken, and it is not
+marked. Returns TRUE if the file was marked, FALSE otherwise.
+
+=cut
+
+*/
+int
+preload_include(NOTNULL(char const * const path), long mtime, long size) {
+    include_entry *entry;
+    struct stat    info;
+
+    if (stat(path, &info) != 0 || (long)info.st_mtime != mtime || (long)info.st_size != size)
+        return 0;
+
+    PIRC_MUTEX_READY(include_cache_lock);
+    LOCK(include_cache_lock);
+
+    for (entry = include_cache; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->path, path) == 0)
+            break;
+    }
+
+    if (entry == NULL) {
+        entry       = mem_allocate_zeroed_typed(include_entry);
+        entry->path = (char *)mem_sys_allocate((strlen(path) + 1) * sizeof (char));
+        strcpy(entry->path, path);
+
+        entry->next   = include_cache;
+        include_cache = entry;
+    }
+
+    entry->preloaded = 1;
+
+    UNLOCK(include_cache_lock);
+    return 1;
+}
+
+/*
+
+=item C<void
+write_dependencies(include_list *includes, char const * const target, char const
+* const source, FILE *depfile)>
+
+Write a make rule to C<depfile>, stating that C<target> depends on the file
+C<source> and on all files in C<includes>, which were included while it was
+preprocessed by C<process_heredocs()>. Each included file also gets a
+rule of its own without prerequisites, so that make doesn't fail if it is
+removed.
+
+=cut
+
+*/
+void
+write_dependencies(NULLOK(include_list *includes), NOTNULL(char const * const target),
+                   NOTNULL(char const * const source), NOTNULL(FILE *depfile))
+{
+    write_make_name(depfile, target);
+    fputs(": ", depfile);
+    write_make_name(depfile, source);
+
+    PIRC_MUTEX_READY(include_cache_lock);
+    LOCK(include_cache_lock);
+
+    write_included_files(depfile, includes, ++dependency_mark, 0);
+    fputc('\n', depfile);
+
+    write_included_files(depfile, includes, ++dependency_mark, 1);
+
+    UNLOCK(include_cache_lock);
 }
 
 
@@ -890,7 +1776,7 @@ process_heredocs(PARROT_INTERP, NOTNULL(char * const filename), NOTNULL(FILE *ou
 
 
 
-#line 896 "hdocprep.c"
+#line 1782 "hdocprep.c"
 
 #define INITIAL 0
 #define POD 1
@@ -1186,10 +2072,10 @@ YY_DECL
     struct yyguts_t * yyg = (struct yyguts_t*)yyscanner;
 
 /* %% [7.0] user's declarations go here */
-#line 283 "hdocprep.l"
+#line 1169 "hdocprep.l"
 
 
-#line 1195 "hdocprep.c"
+#line 2081 "hdocprep.c"
 
     if ( !yyg->yy_init )
         {
@@ -1315,25 +2201,25 @@ do_action:  /* This label is used only to access EOF actions. */
 case 1:
 /* rule 1 can match eol */
 YY_RULE_SETUP
-#line 285 "hdocprep.l"
+#line 1171 "hdocprep.l"
 { /* ignore line comments */ }
     YY_BREAK
 case 2:
 /* rule 2 can match eol */
 YY_RULE_SETUP
-#line 287 "hdocprep.l"
+#line 1173 "hdocprep.l"
 { /* ignore a "=cut" if it's not in a POD comment */ }
     YY_BREAK
 case 3:
 /* rule 3 can match eol */
 YY_RULE_SETUP
-#line 289 "hdocprep.l"
+#line 1175 "hdocprep.l"
 { yy_push_state(POD, yyscanner); }
     YY_BREAK
 case 4:
 /* rule 4 can match eol */
 YY_RULE_SETUP
-#line 292 "hdocprep.l"
+#line 1178 "hdocprep.l"
 { /* end of POD comment */
                           yy_pop_state(yyscanner);
                         }
@@ -1341,11 +2227,11 @@ YY_RULE_SETUP
 case 5:
 /* rule 5 can match eol */
 YY_RULE_SETUP
-#line 296 "hdocprep.l"
+#line 1182 "hdocprep.l"
 { /* ignore pod comments */ }
     YY_BREAK
 case YY_STATE_EOF(POD):
-#line 298 "hdocprep.l"
+#line 1184 "hdocprep.l"
 { /* we're scanning a POD comment, but encountered end-of-file. */
                           lex_error(yyscanner, "POD comment not closed!");
                           yyterminate();
@@ -1354,12 +2240,12 @@ case YY_STATE_EOF(POD):
 case 6:
 /* rule 6 can match eol */
 YY_RULE_SETUP
-#line 303 "hdocprep.l"
+#line 1189 "hdocprep.l"
 { fprintf(yyget_extra(yyscanner)->outfile, "\n"); }
     YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 306 "hdocprep.l"
+#line 1192 "hdocprep.l"
 {
                           global_state * const state = yyget_extra(yyscanner);
 
@@ -1368,9 +2254,7 @@ YY_RULE_SETUP
 
                           strncpy(state->delimiter, yytext + 3, yyleng - 4);
 
-                          state->heredoc = (char *)mem_sys_allocate_zeroed(3 * sizeof (char));
-
-                          strcpy(state->heredoc, "\\n");
+                          start_heredoc(state);
 
                           BEGIN(SAVE_REST_OF_LINE);
 
@@ -1379,7 +2263,7 @@ YY_RULE_SETUP
 case 8:
 /* rule 8 can match eol */
 YY_RULE_SETUP
-#line 323 "hdocprep.l"
+#line 1207 "hdocprep.l"
 { /* match the rest of the line */
                               global_state * const state = yyget_extra(yyscanner);
 
@@ -1395,7 +2279,7 @@ YY_RULE_SETUP
 case 9:
 /* rule 9 can match eol */
 YY_RULE_SETUP
-#line 335 "hdocprep.l"
+#line 1219 "hdocprep.l"
 { /* match the rest of the line */
                               global_state * const state = yyget_extra(yyscanner);
 
@@ -1420,39 +2304,32 @@ YY_RULE_SETUP
 case 10:
 /* rule 10 can match eol */
 YY_RULE_SETUP
-#line 357 "hdocprep.l"
+#line 1241 "hdocprep.l"
 {
                               global_state * const state = yyget_extra(yyscanner);
 
-                              int len = strlen(state->heredoc);
-
-                              /* allocate enough space for the current heredoc and an
-                               * escaped newline character, + the NULL character.
-                               */
-                              char *temp = (char *)mem_sys_allocate_zeroed((len + 1 + 2)
-                                                                           * sizeof (char));
-
-                              sprintf(temp, "%s\\n", state->heredoc);
-
-                              mem_sys_free(state->heredoc);
-
-                              state->heredoc = temp;
+                              /* add an escaped newline character */
+                              append_heredoc(state, "\\n", 2);
 
                             }
     YY_BREAK
 case 11:
 /* rule 11 can match eol */
 YY_RULE_SETUP
-#line 376 "hdocprep.l"
+#line 1249 "hdocprep.l"
 {
                              global_state * const state = yyget_extra(yyscanner);
 
+                             int linelength;
+
                              /* remove the newline character */
                              /* can this be done through #ifdef, to prevent checks? */
                              if (yytext[yyleng - 2] == '\r')
-                                 yytext[yyleng - 2] = '\0';
+                                 linelength = yyleng - 2;
                              else /* yytext[yyleng - 1] is '\n'. */
-                                 yytext[yyleng - 1] = '\0';
+                                 linelength = yyleng - 1;
+
+                             yytext[linelength] = '\0';
 
                              if (strcmp(state->delimiter, yytext) == 0) { /* delimiter found? */
 
@@ -1466,10 +2343,7 @@ YY_RULE_SETUP
                                  state->file_buffer = YY_CURRENT_BUFFER;
 
                                  /* print the flattened heredoc string */
-                                 fprintf(yyget_extra(yyscanner)->outfile, "\"%s\"", state->heredoc);
-
-                                 mem_sys_free(state->heredoc);
-                                 state->heredoc = NULL;
+                                 flush_heredoc(state);
 
                                  /* now continue with scanning the string that we saved */
                                  BEGIN(SCAN_STRING);
@@ -1477,22 +2351,13 @@ YY_RULE_SETUP
                                  yy_scan_string(state->linebuffer,yyscanner);
                              }
                              else { /* nope, this is part of the heredoc; save this line */
-
-                                 int len = strlen(state->heredoc);
-
-                                 char *temp = (char *)mem_sys_allocate((len + yyleng + 1 + 2)
-                                                                       * sizeof (char));
-
-                                 sprintf(temp, "%s%s\\n", state->heredoc, yytext);
-
-                                 mem_sys_free(state->heredoc);
-
-                                 state->heredoc = temp;
+                                 append_heredoc(state, yytext, linelength);
+                                 append_heredoc(state, "\\n", 2);
                              }
                            }
     YY_BREAK
 case YY_STATE_EOF(HEREDOC_STRING):
-#line 423 "hdocprep.l"
+#line 1288 "hdocprep.l"
 { /* end of file while reading heredoc */
                               lex_error(yyscanner, "runaway heredoc string");
                               yyterminate();
@@ -1500,7 +2365,7 @@ case YY_STATE_EOF(HEREDOC_STRING):
     YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 428 "hdocprep.l"
+#line 1293 "hdocprep.l"
 { /* a 'nested' heredoc string */
                               global_state *state = yyget_extra(yyscanner);
 
@@ -1512,10 +2377,7 @@ YY_RULE_SETUP
                               /* strncpy adds the NULL char., according to the spec. */
                               strncpy(state->delimiter, yytext + 3, yyleng - 4);
 
-                              state->heredoc = (char *)mem_sys_allocate_zeroed(3 * sizeof (char));
-
-                              /* an empty heredoc has at least a newline */
-                              strcpy(state->heredoc, "\\n");
+                              start_heredoc(state);
 
                               BEGIN(SAVE_REST_AGAIN);
                             }
@@ -1523,16 +2385,16 @@ YY_RULE_SETUP
 case 13:
 /* rule 13 can match eol */
 YY_RULE_SETUP
-#line 447 "hdocprep.l"
+#line 1309 "hdocprep.l"
 { /* do nothing */ }
     YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 449 "hdocprep.l"
+#line 1311 "hdocprep.l"
 { fprintf(yyget_extra(yyscanner)->outfile, "%s", yytext); }
     YY_BREAK
 case YY_STATE_EOF(SCAN_STRING):
-#line 451 "hdocprep.l"
+#line 1313 "hdocprep.l"
 {
                               global_state * const state = yyget_extra(yyscanner);
 
@@ -1556,26 +2418,26 @@ case YY_STATE_EOF(SCAN_STRING):
                             }
     YY_BREAK
 case YY_STATE_EOF(INITIAL):
-#line 475 "hdocprep.l"
+#line 1337 "hdocprep.l"
 { /* end of file */
                               yyterminate();
                             }
     YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 479 "hdocprep.l"
+#line 1341 "hdocprep.l"
 { /* .include directives must be handled here */
                               yy_push_state(INCLUDE, yyscanner);
                             }
     YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 483 "hdocprep.l"
+#line 1345 "hdocprep.l"
 { /* skip whitespace */ }
     YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 485 "hdocprep.l"
+#line 1347 "hdocprep.l"
 { /* include this file */
                               global_state * const state = yyget_extra(yyscanner);
 
@@ -1605,7 +2467,7 @@ YY_RULE_SETUP
                               fprintf(state->outfile, ".line 1\n");
                               fprintf(state->outfile, ".file %s\n", yytext); /* is quoted */
 
-                              process_heredocs(state->interp, fullpath, state->outfile);
+                              include_file(state, fullpath);
 
                               /* restore the location information; we didn't count the "\n"
                                * yet that will come after the .include dir.; hence the + 1 now.
@@ -1622,27 +2484,27 @@ YY_RULE_SETUP
 case 18:
 /* rule 18 can match eol */
 YY_RULE_SETUP
-#line 528 "hdocprep.l"
+#line 1390 "hdocprep.l"
 { /* after .include "foo.pir", go back to the state we were in */
                               yy_pop_state(yyscanner);
                             }
     YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 532 "hdocprep.l"
+#line 1394 "hdocprep.l"
 { lex_error(yyscanner, "wrong scanner state\n"); }
     YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 534 "hdocprep.l"
+#line 1396 "hdocprep.l"
 { fprintf(yyget_extra(yyscanner)->outfile, "%s", yytext); }
     YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 536 "hdocprep.l"
+#line 1398 "hdocprep.l"
 ECHO;
     YY_BREAK
-#line 1648 "hdocprep.c"
+#line 2510 "hdocprep.c"
 case YY_STATE_EOF(INCLUDE):
 case YY_STATE_EOF(SAVE_REST_OF_LINE):
 case YY_STATE_EOF(SAVE_REST_AGAIN):
@@ -2942,7 +3804,7 @@ void yyfree (void * ptr , yyscan_t yyscanner)
 
 /* %ok-for-header */
 
-#line 536 "hdocprep.l"
+#line 1398 "hdocprep.l"
 
 
 
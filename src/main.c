@@ -7,6 +7,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#ifndef _WIN32
+#  include <unistd.h>
+#else
+#  include <process.h>
+#  define getpid _getpid
+#endif
 #include "pirparser.h"
 #include "pircompiler.h"
 #include "piremit.h"
@@ -15,10 +21,16 @@
 #include "pirheredoc.h"
 #include "pirregalloc.h"
 #include "pircapi.h"
-
-/* global variable to set parser in debug mode.
- * It is not clear to me whether the global can be replaced
- * by a parser-specific flag.
+#include "pircache.h"
+#include "pirsnapshot.h"
+#include "pirstats.h"
+#include "pirsplit.h"
+#include "pirproject.h"
+#include "pirserver.h"
+
+/* global variable to set parser in debug mode. Bison's parser has no
+ * per-parser flag for it, so it's shared by all compilers in the process;
+ * only the driver sets it, before any compilation starts.
  */
 #ifdef YYDEBUG
 
@@ -28,38 +40,49 @@ extern int yypirdebug = 0;
 
 /* HEADERIZER HFILE: none */
 
-/* XXX use pthreads library to test thread safety.
-   does not work currently on windows.
-   The check for _MSC_VER is not correct but works for me.
-*/
-
-/*
-#ifndef _MSC_VER
-#  define TEST_THREAD_SAFETY
-#endif
-*/
-
-#ifdef TEST_THREAD_SAFETY
-#  include <pthread.h>
-#  define NUM_THREADS 1
-#endif
-
-void * process_file(void *a);
-
-/* HEADERIZER HFILE: none */
-
 /* HEADERIZER BEGIN: static */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
+static int compile_command(PARROT_INTERP, int argc, ARGIN(char *argv[]))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3);
+
+static void finish_stats(
+    ARGMOD(compiler_stats *stats),
+    int print,
+    stats_format format,
+    int printmemory,
+    stats_format memoryformat)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*stats);
+
 static void print_help(ARGIN(char const * const program_name))
         __attribute__nonnull__(1);
 
+static void print_dependencies(
+    ARGIN_NULLOK(include_list *includes),
+    ARGIN(char const * const depfile),
+    ARGIN(char const * const target),
+    ARGIN(char const * const source))
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        __attribute__nonnull__(4);
+
 static void runcode(PARROT_INTERP, int argc, ARGIN(char *argv[]))
         __attribute__nonnull__(1)
         __attribute__nonnull__(3);
 
+#define ASSERT_ARGS_compile_command __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(argv))
+#define ASSERT_ARGS_finish_stats __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats))
 #define ASSERT_ARGS_print_help __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(program_name))
+#define ASSERT_ARGS_print_dependencies __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(depfile) \
+    , PARROT_ASSERT_ARG(target) \
+    , PARROT_ASSERT_ARG(source))
 #define ASSERT_ARGS_runcode __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(interp) \
     , PARROT_ASSERT_ARG(argv))
@@ -86,74 +109,122 @@ print_help(ARGIN(char const * const program_name))
     fprintf(stderr, "Usage: %s [options] <file>\n", program_name);
     fprintf(stderr, "Options:\n\n"
     "  -b        generate bytecode\n"
+    "  -c        order the constant table by use (with -b)\n"
+    "  -C <dir>  reuse bytecode from, and store it in, cache directory <dir> (with -b)\n"
     "  -d        show debug messages of parser\n"
     "  -E        run heredoc and macro preprocessors only\n"
     "  -h        show this help message\n"
     "  -H        heredoc preprocessing only\n"
+    "  -j <n>    allocate registers of <n> subs at a time, on as many threads (with -r);\n"
+    "            with --project, compile <n> files at a time\n"
+    "  -L <file> start with the macros and constants of snapshot <file>\n"
     "  -m <size> specify initial macro buffer size; default is 4096 bytes\n"
+    "  -M <file> write a make rule listing the input and included files to <file>\n"
     "  -n        no output, only print 'ok' if successful\n"
     "  -o <file> write output to the specified file.\n"
     "  -p        pasm output\n"
+    "  -P <file> write a snapshot of all macros and constants to <file>\n"
     "  -r        activate the register allocator for improved register usage\n"
     "  -S        do not perform strength reduction\n"
+    "  -t        remove subs that can't be reached from an entry point (with -b);\n"
+    "            not safe for libraries, unless their subs are passed to --keep\n"
     "  -v        verbose mode\n"
     "  -W        show warning messages\n"
     "  -x        execute code after compilation\n"
 #ifdef YYDEBUG
     "  -y        debug bison-generated parser\n"
 #endif
+    "  -z        memory-map the input and scan it in place\n"
+    "  --stats   print the time spent in each phase, and some counts, to stderr\n"
+    "  --stats=json\n"
+    "            same as --stats, but print them as a JSON object\n"
+    "  --mem-stats\n"
+    "            print the memory allocated for each kind of node, the high-water\n"
+    "            mark and the memory live at each phase boundary, to stderr\n"
+    "  --mem-stats=json\n"
+    "            same as --mem-stats, but print them as a JSON object\n"
+    "  --server=<socket> [-j <n>]\n"
+    "            compile the requests of clients on Unix domain socket <socket>,\n"
+    "            with <n> workers at a time (4 by default); set PIRC_SERVER to\n"
+    "            <socket> to have pirc send its command line to the server\n"
+    "  --keep=<sub>[,<sub>...]\n"
+    "            keep these subs with -t, as they're called from outside the file\n"
+    "  --project=<file>\n"
+    "            compile all files listed in <file>, or in directory <file>, each\n"
+    "            to a .pbc file next to it, on -j <n> threads (with -b or -n)\n"
+    "  --split=<n>\n"
+    "            only check the file, parsing its subs in <n> chunks, on as many\n"
+    "            threads (with -n)\n"
+    "  --trace=<file>\n"
+    "            write the phases, files and subs as Chrome trace events to <file>\n"
     );
 }
 
 
 /*
-static void
-print_data_sizes(void) {
-    printf("size of symbol: %u\n", sizeof(symbol));
-    printf("size of target: %u\n", sizeof(target));
-    printf("size of sub:    %u\n", sizeof(subroutine));
-    printf("size of stat:   %u\n", sizeof(statement));
-}
-*/
 
-typedef struct parser_args {
-    int   flexdebug;
-    FILE *infile;
-    char *filename;
-    int   thr_id;
-    int   flags;
+=item C<static void print_dependencies(include_list *includes, char const *
+const depfile, char const * const target, char const * const source)>
 
-} parser_args;
+Write a make rule to the file C<depfile>, stating that C<target> depends on
+C<source> and all files in C<includes>, the list of files that the heredoc
+preprocessor found to be included by C<source>.
 
+=cut
 
+*/
+static void
+print_dependencies(ARGIN_NULLOK(include_list *includes), ARGIN(char const * const depfile),
+                   ARGIN(char const * const target), ARGIN(char const * const source))
+{
+    FILE *file = open_file(depfile, "w");
+
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file '%s'\n", depfile);
+        exit(EXIT_FAILURE);
+    }
+
+    write_dependencies(includes, target, source, file);
+    fclose(file);
+}
 
 
 /*
 
-temporary function for the thread-testing code.
-Unpack the arguments and invoke parse_file().
+=item C<static void finish_stats(compiler_stats *stats, int print,
+stats_format format, int printmemory, stats_format memoryformat)>
+
+Print the statistics in C<stats> to stderr in the format C<format>, if
+C<print> is true, and the memory accounting in the format C<memoryformat>,
+if C<printmemory> is true; close the trace file, if any, and free C<stats>.
+
+=cut
 
 */
-PARROT_CAN_RETURN_NULL
-void *
-process_file(ARGIN(void *a))
+static void
+finish_stats(ARGMOD(compiler_stats *stats), int print, stats_format format,
+             int printmemory, stats_format memoryformat)
 {
+    if (print)
+        print_stats(stats, stderr, format);
 
+    if (printmemory)
+        print_memory_stats(stats, stderr, memoryformat);
 
-    /* unpack the arguments from the structure parser_args */
-    parser_args *args      = (parser_args *)a;
-    int          flexdebug = args->flexdebug;
-    FILE        *infile    = args->infile;
-    char        *filename  = args->filename;
-    int          thr_id    = args->thr_id;
-    int          flags     = args->flags;
-    PARROT_INTERP          = Parrot_new(NULL);
+    close_trace(stats);
+    mem_sys_free(stats);
+}
 
-    parse_file(interp, flexdebug, infile, filename, flags, thr_id, INIT_MACRO_SIZE, NULL);
 
-    return NULL;
+/*
+static void
+print_data_sizes(void) {
+    printf("size of symbol: %u\n", sizeof(symbol));
+    printf("size of target: %u\n", sizeof(target));
+    printf("size of sub:    %u\n", sizeof(subroutine));
+    printf("size of stat:   %u\n", sizeof(statement));
 }
-
+*/
 
 /*
 
@@ -179,24 +250,51 @@ runcode(PARROT_INTERP, int argc, ARGIN(char *argv[]))
 
 /*
 
-=item C<int main(int argc, char *argv[])>
+=item C<static int compile_command(PARROT_INTERP, int argc, char *argv[])>
 
-Main compiler driver.
+Main compiler driver: compile with the command line C<argv>, of which there
+are C<argc> arguments, including the program name, using C<interp>. Returns
+the exit status. With C<--server=E<lt>socketE<gt>>, a compile server is
+started instead, whose workers run this function with the command lines of
+its clients; it only returns if the server fails.
 
 =cut
 
 */
-int
-main(int argc, char *argv[]) {
+static int
+compile_command(PARROT_INTERP, int argc, ARGIN(char *argv[])) {
     char const * const program_name = argv[0];
     int                flexdebug    = 0;
     int                flags        = 0;
     int                execute      = 0;
     char              *filename     = NULL;
     char              *outputfile   = NULL;
+    char              *depfile      = NULL;
+    char              *cachedir     = NULL;
+    char              *cachefile    = NULL;
+    char              *loadfile     = NULL;
+    char              *savefile     = NULL;
+    snapshot          *snap         = NULL;
+    compiler_stats    *stats        = NULL;
+    int                printstats   = 0;
+    stats_format       statsformat  = STATS_FORMAT_TEXT;
+    int                printmemory  = 0;
+    stats_format       memoryformat = STATS_FORMAT_TEXT;
+    char              *tracefile    = NULL;
     const char        *hdocoutfile  = NULL;
+    char               hdocfile[32];
+    char               listfile[32];
+    include_list      *includes     = NULL;
+    FILE              *file         = NULL;
     unsigned           macrosize    = INIT_MACRO_SIZE;
-    PARROT_INTERP                   = Parrot_new(NULL);
+    unsigned           jobs         = 0;    /* 0 if -j isn't given */
+    unsigned           split        = 1;
+    char              *projectfile  = NULL;
+    char              *serverpath   = NULL;
+    char              *keepsubs     = NULL;
+    unsigned           numoptions   = 0;
+    compile_options    options;
+    int                errors;
 
     /* skip program name */
     argc--;
@@ -217,6 +315,20 @@ main(int argc, char *argv[]) {
             case 'b':
                 SET_FLAG(flags, LEXER_FLAG_OUTPUTPBC);
                 break;
+            case 'c':
+                SET_FLAG(flags, LEXER_FLAG_REORDERCONSTS);
+                break;
+            case 'C':
+                if (argc > 1) {
+                    argc--;
+                    argv++;
+                    cachedir = argv[0];
+                }
+                else {
+                    fprintf(stderr, "Missing argument for option '-C'\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'E':
                 SET_FLAG(flags, LEXER_FLAG_PREPROCESS);
                 break;
@@ -230,6 +342,33 @@ main(int argc, char *argv[]) {
             case 'H':
                 SET_FLAG(flags, LEXER_FLAG_HEREDOCONLY);
                 break;
+            case 'j':
+                if (argc > 1) {
+                    argc--;
+                    argv++;
+                    jobs = atoi(argv[0]);
+                }
+                else {
+                    fprintf(stderr, "Missing argument for option '-j'\n");
+                    exit(EXIT_FAILURE);
+                }
+
+                if (jobs < 1) {
+                    fprintf(stderr, "Option '-j' requires a number of at least 1\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'L':
+                if (argc > 1) {
+                    argc--;
+                    argv++;
+                    loadfile = argv[0];
+                }
+                else {
+                    fprintf(stderr, "Missing argument for option '-L'\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'm':
                 if (argc > 1) {
                     argc--;
@@ -241,6 +380,17 @@ main(int argc, char *argv[]) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'M':
+                if (argc > 1) {
+                    argc--;
+                    argv++;
+                    depfile = argv[0];
+                }
+                else {
+                    fprintf(stderr, "Missing argument for option '-M'\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'n':
                 SET_FLAG(flags, LEXER_FLAG_NOOUTPUT);
                 break;
@@ -259,12 +409,26 @@ main(int argc, char *argv[]) {
             case 'p':
                 SET_FLAG(flags, LEXER_FLAG_EMIT_PASM);
                 break;
+            case 'P':
+                if (argc > 1) {
+                    argc--;
+                    argv++;
+                    savefile = argv[0];
+                }
+                else {
+                    fprintf(stderr, "Missing argument for option '-P'\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'r':
                 SET_FLAG(flags, LEXER_FLAG_REGALLOC);
                 break;
             case 'S':
                 SET_FLAG(flags, LEXER_FLAG_NOSTRENGTHREDUCTION);
                 break;
+            case 't':
+                SET_FLAG(flags, LEXER_FLAG_TREESHAKE);
+                break;
             case 'v':
                 SET_FLAG(flags, LEXER_FLAG_VERBOSE);
                 break;
@@ -280,6 +444,41 @@ main(int argc, char *argv[]) {
                 yypirdebug = 1;
                 break;
 #endif
+            case 'z':
+                SET_FLAG(flags, LEXER_FLAG_MAPINPUT);
+                break;
+            case '-':
+                if (STREQ(argv[0], "--stats")) {
+                    printstats  = 1;
+                    statsformat = STATS_FORMAT_TEXT;
+                }
+                else if (STREQ(argv[0], "--stats=json")) {
+                    printstats  = 1;
+                    statsformat = STATS_FORMAT_JSON;
+                }
+                else if (STREQ(argv[0], "--mem-stats")) {
+                    printmemory  = 1;
+                    memoryformat = STATS_FORMAT_TEXT;
+                }
+                else if (STREQ(argv[0], "--mem-stats=json")) {
+                    printmemory  = 1;
+                    memoryformat = STATS_FORMAT_JSON;
+                }
+                else if (strncmp(argv[0], "--trace=", 8) == 0 && argv[0][8] != '\0')
+                    tracefile = argv[0] + 8;
+                else if (strncmp(argv[0], "--project=", 10) == 0 && argv[0][10] != '\0')
+                    projectfile = argv[0] + 10;
+                else if (strncmp(argv[0], "--split=", 8) == 0 && atoi(argv[0] + 8) > 0)
+                    split = atoi(argv[0] + 8);
+                else if (strncmp(argv[0], "--server=", 9) == 0 && argv[0][9] != '\0')
+                    serverpath = argv[0] + 9;
+                else if (strncmp(argv[0], "--keep=", 7) == 0 && argv[0][7] != '\0')
+                    keepsubs = argv[0] + 7;
+                else {
+                    fprintf(stderr, "Unknown option: '%s'\n", argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             default:
                 fprintf(stderr, "Unknown option: '%c'\n", argv[0][1]);
                 exit(EXIT_FAILURE);
@@ -287,76 +486,166 @@ main(int argc, char *argv[]) {
         /* goto next command line argument */
         argv++;
         argc--;
+        numoptions++;
     }
 
-/* The following code is to test thread safety. If TEST_THREAD_SAFETY
- * is false, no threads are started; only the main thread will do
- * a parse.
- * For thread safety testing, the pthreads library is used.
- */
-#ifdef TEST_THREAD_SAFETY
-{
-    pthread_t threads[NUM_THREADS];
-    int i;
-    for (i = 0; i < NUM_THREADS; i++) {
-        FILE *infile = NULL;
-        parser_args args;
+    /* the server compiles the command lines of its clients, with their options */
+    if (serverpath != NULL) {
+        if (argc > 0 || numoptions > (jobs > 0 ? 2u : 1u)) {
+            fprintf(stderr, "Option '--server' can only be used with option '-j'\n");
+            exit(EXIT_FAILURE);
+        }
 
+        return run_server(interp, serverpath, program_name,
+                          jobs > 0 ? jobs : SERVER_WORKERS, compile_command);
+    }
 
-        if (argc < 1) { /* no file specified, read from stdin */
-            infile   = stdin;
-            filename = NULL;
-        }
-        else {
-            /* done handling arguments, open the file */
-            infile   = open_file(argv[0], "r");
-            filename = argv[0];
-        }
+    if (jobs < 1)
+        jobs = 1;
+
+    if (argc < 1 && projectfile == NULL) {
+        fprintf(stderr, "pirc: no input specified\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* the dependencies are those of the output file; bytecode is written to
+     * "a.pbc" by default, but there's no file to name for other output.
+     */
+    if (depfile != NULL && outputfile == NULL && !TEST_FLAG(flags, LEXER_FLAG_OUTPUTPBC)) {
+        fprintf(stderr, "Option '-M' requires an output file\n");
+        exit(EXIT_FAILURE);
+    }
 
-        if (infile == NULL) {
-            fprintf(stderr, "Failed to open file '%s'\n", argv[0]);
+    /* the chunks of a split parse are compiled separately, and can't be
+     * combined into a single output file or snapshot.
+     */
+    if (split > 1 && (!TEST_FLAG(flags, LEXER_FLAG_NOOUTPUT) || savefile != NULL)) {
+        fprintf(stderr, "Option '--split' requires option '-n', and can't be used with '-P'\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* the files included by the snapshot's prelude must be known before
+     * the heredoc preprocessor runs, so that it can skip them.
+     */
+    if (loadfile != NULL) {
+        snap = read_snapshot(loadfile);
+
+        if (snap == NULL)
+            exit(EXIT_FAILURE);
+
+        preload_snapshot_includes(snap);
+    }
+
+    /* build all files of a project; each file gets an output file of its own */
+    if (projectfile != NULL) {
+        int failed;
+
+        if (!TEST_FLAG(flags, LEXER_FLAG_OUTPUTPBC) && !TEST_FLAG(flags, LEXER_FLAG_NOOUTPUT)) {
+            fprintf(stderr, "Option '--project' requires option '-b' or '-n'\n");
             exit(EXIT_FAILURE);
         }
 
-        args.flexdebug = flexdebug;
-        args.infile    = infile;
-        args.filename  = filename;
-        args.thr_id    = i;
-        args.flags     = flags;
+        if (outputfile != NULL || depfile != NULL || savefile != NULL || cachedir != NULL
+        ||  split > 1 || execute
+        ||  TEST_FLAG(flags, LEXER_FLAG_HEREDOCONLY) || TEST_FLAG(flags, LEXER_FLAG_PREPROCESS))
+        {
+            fprintf(stderr, "Option '--project' can't be used with '-o', '-M', '-P', '-C', "
+                            "'--split', '-x', '-E' or '-H'\n");
+            exit(EXIT_FAILURE);
+        }
 
-        pthread_create(&threads[i], NULL, process_file, &args);
+        /* the statistics and the trace are kept for a single compilation */
+        if (printstats || printmemory || tracefile != NULL) {
+            fprintf(stderr, "Option '--project' can't be used with '--stats', '--mem-stats' "
+                            "or '--trace'\n");
+            exit(EXIT_FAILURE);
+        }
 
-    }
+        failed = build_project(interp, projectfile, flags, macrosize, jobs, snap,
+                               keepsubs);
 
-    /* wait for all threads to finish */
-    for (i = 0; i < NUM_THREADS; i++)
-        pthread_join(threads[i], NULL);
-}
-#else
-{
-    /* non-thread testing code; this is the normal case */
-    FILE *file = NULL;
+        if (snap != NULL)
+            free_snapshot(snap);
 
-    if (argc < 1) {
-        fprintf(stderr, "pirc: no input specified\n");
-        exit(EXIT_FAILURE);
+        return failed == 0 ? 0 : EXIT_FAILURE;
     }
 
     if (outputfile != NULL && TEST_FLAG(flags, LEXER_FLAG_HEREDOCONLY)) {
-        file = open_file(outputfile, "w");
-        process_heredocs(interp, argv[0], file);
+        file     = open_file(outputfile, "w");
+        includes = process_heredocs(interp, argv[0], file, &errors);
         fclose(file);
-        return 0;
+
+        if (depfile != NULL && errors == 0)
+            print_dependencies(includes, depfile, outputfile, argv[0]);
+
+        free_include_list(includes);
+        return errors > 0 ? EXIT_FAILURE : 0;
     }
     else if (TEST_FLAG(flags, LEXER_FLAG_HEREDOCONLY)) {
-        process_heredocs(interp, argv[0], stdout);
-        return 0;
+        free_include_list(process_heredocs(interp, argv[0], stdout, &errors));
+        return errors > 0 ? EXIT_FAILURE : 0;
     }
     else {
-        hdocoutfile = "hdoctemp";
+        if (printstats || printmemory || tracefile != NULL) {
+            stats = new_compiler_stats();
+
+            if (tracefile != NULL && !open_trace(stats, tracefile))
+                exit(EXIT_FAILURE);
+        }
+
+        /* the workers of a compile server may compile in the same directory
+         * at the same time, so the scratch files are named after the process.
+         */
+        sprintf(hdocfile, "hdoctemp_%lu", (unsigned long)getpid());
+        hdocoutfile = hdocfile;
         file = open_file(hdocoutfile, "w");
-        process_heredocs(interp, argv[0], file);
+        begin_phase(stats, PHASE_HEREDOC);
+        includes = process_heredocs(interp, argv[0], file, &errors);
+        end_phase(stats, PHASE_HEREDOC);
         fclose(file);
+
+        /* a file that can't be read, or a broken heredoc, leaves nothing to compile */
+        if (errors > 0) {
+            if (stats != NULL)
+                finish_stats(stats, printstats, statsformat, printmemory, memoryformat);
+
+            remove(hdocoutfile);
+            free_include_list(includes);
+            return EXIT_FAILURE;
+        }
+
+        if (depfile != NULL)
+            print_dependencies(includes, depfile, outputfile ? outputfile : "a.pbc", argv[0]);
+
+        /* if the bytecode for this input was generated before, copy it from
+         * the cache, and we're done; unless a snapshot must be written.
+         */
+        if (cachedir != NULL
+        &&  savefile == NULL
+        &&  TEST_FLAG(flags, LEXER_FLAG_OUTPUTPBC)
+        &&  !TEST_FLAG(flags, LEXER_FLAG_PREPROCESS)
+        &&  !TEST_FLAG(flags, LEXER_FLAG_NOOUTPUT)
+        &&  !execute)
+        {
+            cachefile = pbc_cache_path(interp, cachedir, argv[0], hdocoutfile, loadfile,
+                                       keepsubs, flags);
+
+            if (cachefile != NULL
+            &&  fetch_cached_pbc(cachefile, outputfile ? outputfile : "a.pbc"))
+            {
+                if (TEST_FLAG(flags, LEXER_FLAG_VERBOSE))
+                    fprintf(stderr, "Using cached bytecode %s\n", cachefile);
+
+                if (stats != NULL)
+                    finish_stats(stats, printstats, statsformat,
+                                 printmemory, memoryformat);
+
+                remove(hdocoutfile);
+                mem_sys_free(cachefile);
+                free_include_list(includes);
+                return 0;
+            }
+        }
     }
 
 
@@ -369,24 +658,87 @@ main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    parse_file(interp, flexdebug, file, filename, flags, 0, macrosize, outputfile);
+    sprintf(listfile, "output_thr_%lu", (unsigned long)getpid());
+
+    init_compile_options(&options, flags);
+    options.flexdebug    = flexdebug;
+    options.listfile     = listfile;
+    options.macro_size   = macrosize;
+    options.jobs         = jobs;
+    options.outputfile   = outputfile;
+    options.snap         = snap;
+    options.snapshotfile = savefile;
+    options.keep         = keepsubs;
+    options.includes     = includes;
+    options.stats        = stats;
+
+    if (split > 1)
+        errors = split_and_parse(interp, file, filename, flags, macrosize, split, snap, stats);
+    else
+        errors = parse_file(interp, file, filename, &options);
+
+    remove(hdocoutfile);
+    remove(listfile);
+
+    if (errors == 0 && cachefile != NULL)
+        store_cached_pbc(cachefile, outputfile ? outputfile : "a.pbc");
+
+    if (stats != NULL)
+        finish_stats(stats, printstats, statsformat, printmemory, memoryformat);
+
+    if (snap != NULL)
+        free_snapshot(snap);
+
+    free_include_list(includes);
+
+    if (cachefile != NULL)
+        mem_sys_free(cachefile);
 /*
     fprintf(stderr, "done\n");
 */
 
+    if (errors > 0)
+        return EXIT_FAILURE;
+
     if (execute)
         runcode(interp, argc, argv);
 
-}
-#endif
-
     return 0;
 }
 
 
+/*
+
+=item C<int main(int argc, char *argv[])>
+
+Start PIRC. If the environment variable C<PIRC_SERVER> names the socket of
+a compile server, the command line is handed to the server, unless it starts
+a server itself (see C<--server=E<lt>socketE<gt>>). Otherwise, or if there's
+no server, an interpreter is created, and the command line is run here.
+
+=cut
 
+*/
+int
+main(int argc, char *argv[]) {
+    char const * const server = getenv("PIRC_SERVER");
+    int                i;
 
+    if (server != NULL) {
+        for (i = 1; i < argc; ++i)
+            if (strncmp(argv[i], "--server=", 9) == 0)
+                break;
 
+        if (i == argc) {
+            int const status = forward_command(server, argc - 1, argv + 1);
+
+            if (status >= 0)
+                return status;
+        }
+    }
+
+    return compile_command(Parrot_new(NULL), argc, argv);
+}
 
 /*
 
@@ -616,7 +616,7 @@ macro_const       : ".macro_const" TK_IDENT TK_MACRO_CONST_VAL
 macro             : macro_header '(' macro_parameters ')' "\n"
                     macro_body
                     ".endm"
-                        { /* fprintf(stderr, "macro body: [%s]\n", CURRENT_MACRO(lexer)->body);*/ }
+                        { close_macro_body(CURRENT_MACRO(lexer)); }
                   ;
 
 macro_header      : ".macro" identifier
@@ -2882,7 +2882,8 @@ concat_strings(NOTNULL(lexer_state * const lexer), NOTNULL(char const * a),
 {
     int strlen_a = strlen(a);
     char *newstr = (char *)pir_mem_allocate_zeroed(lexer, (strlen_a + strlen(b) + 1)
-                                                          * sizeof (char));
+                                                          * sizeof (char),
+                                                   ALLOC_STRING);
     strcpy(newstr, a);
     strcpy(newstr + strlen_a, b);
     a = b = NULL;
@@ -3381,6 +3382,7 @@ check_op_args_for_symbols(lexer_state * const lexer) {
                 */
                 operand->expr.t = target_from_symbol(lexer, sym);
                 operand->type   = EXPR_TARGET; /* convert operand node into EXPR_TARGET */
+                operand->sigcode = get_operand_code(operand);
             }
             else { /* it may be a constant, otherwise it's a label */
 
@@ -0,0 +1,692 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 NAME
+
+pirbench.c - microbenchmarks for the data structures of pirc
+
+=head1 SYNOPSIS
+
+ $ ./pirbench [scale]
+
+=head1 DESCRIPTION
+
+Drives the hand-written data structures of the compiler directly, without
+parsing anything, and reports the time per operation for each, and the number of allocations per
+operation for those that allocate through the lexer:
+
+=over 4
+
+=item * C<get_hashcode()>
+
+=item * lookups in a C<hashtable> of chained C<bucket>s
+
+=item * interning strings with C<dupstr()>, which uses C<find_string()>
+
+=item * C<add_string_const()>, which searches the constant table
+
+=item * growing the constant table, through C<add_num_const()>
+
+=item * linear scan register allocation of a sub's worth of live intervals
+
+=item * C<find_macro()>
+
+=item * op lookups that hit the op cache, with C<find_cached_op()>
+
+=item * op lookups that miss the op cache, which look up the signatured name
+of the op in the op library, as C<get_opinfo()> does
+
+=back
+
+The keys are a fixed, skewed mix of the names that occur in real PIR: op
+names, C<$I>/C<$N>/C<$S>/C<$P> registers, local variables and labels.
+Allocations are those done through C<pir_mem_allocate()> and
+C<pir_mem_allocate_zeroed()>, which are counted through the lexer's list of
+allocated pointers. The register allocator, the macro tables, the
+constant table and the op library allocate memory with C<mem_sys_allocate()>,
+which can't be counted; their benchmarks show C<-> instead.
+
+The number of operations of each benchmark is multiplied by C<scale>, which
+is 1 by default.
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pircompiler.h"
+#include "pircompunit.h"
+#include "pirsymbol.h"
+#include "pirmacro.h"
+#include "pirop.h"
+#include "pirregalloc.h"
+#include "bcgen.h"
+
+/* HEADERIZER HFILE: none */
+
+/* number of keys that the benchmarks pick from */
+#define NUM_BENCH_KEYS      4096
+
+/* maximum length of a key, including the NUL character */
+#define BENCH_KEY_LENGTH    32
+
+/* number of live intervals per sub in the register allocation benchmark */
+#define BENCH_INTERVALS     200
+
+/* number of macros defined in the find_macro() benchmark */
+#define BENCH_MACROS        64
+
+/* number of ops looked up in the op lookup benchmarks */
+#define BENCH_OPS           ((unsigned)(sizeof signatured_ops / sizeof signatured_ops[0]))
+
+/* a benchmark; run() does count operations, and returns the number it did */
+typedef struct benchmark {
+    char const     *name;
+    unsigned long (*run)(lexer_state * const lexer, unsigned long count);
+    unsigned long   count;    /* number of operations, before scaling */
+    int             counted;  /* true if it only allocates through the lexer */
+
+} benchmark;
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+static unsigned long bench_add_num_const(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_add_string_const(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_dupstr(ARGIN(lexer_state * const lexer), unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_find_macro(ARGIN(lexer_state * const lexer), unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_get_hashcode(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_hashtable(ARGIN(lexer_state * const lexer), unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_op_cache_hit(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_op_cache_miss(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_regalloc(ARGIN(lexer_state * const lexer), unsigned long count)
+        __attribute__nonnull__(1);
+
+PARROT_WARN_UNUSED_RESULT
+static unsigned long count_allocations(ARGIN(lexer_state * const lexer))
+        __attribute__nonnull__(1);
+
+static void make_keys(void);
+
+PARROT_WARN_UNUSED_RESULT
+static unsigned next_random(void);
+
+PARROT_WARN_UNUSED_RESULT
+static unsigned pick(unsigned n);
+
+#define ASSERT_ARGS_bench_add_num_const __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_add_string_const __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_dupstr __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_find_macro __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_get_hashcode __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_hashtable __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_op_cache_hit __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_op_cache_miss __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_bench_regalloc __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_count_allocations __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_make_keys __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_next_random __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_pick __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+/* the keys, as generated by make_keys() */
+static char keys[NUM_BENCH_KEYS][BENCH_KEY_LENGTH];
+
+/* state of the random number generator; fixed, so that each run is the same */
+static unsigned long random_state = 42;
+
+/* results are added to this, so that the compiler can't optimize the work away */
+static volatile unsigned long sink;
+
+/* the most common ops in PIR code */
+static char const * const opnames[] = {
+    "set", "add", "sub", "mul", "div", "inc", "dec", "concat", "print", "say",
+    "new", "if", "unless", "goto", "eq", "ne", "lt", "le", "gt", "ge",
+    "find_lex", "store_lex", "get_global", "set_global", "get_hll_global",
+    "isnull", "defined", "exists", "delete", "push", "pop", "shift", "unshift",
+    "substr", "length", "index", "typeof", "clone", "find_method", "callmethodcc",
+    "get_params", "set_returns", "get_results", "set_args", "invokecc", "returncc",
+    "newclosure", "capture_lex", "box", "unbox", "iter", "isa", "does", "can"
+};
+
+/* short and signatured names of common ops, for the op lookup benchmarks */
+static char const * const signatured_ops[][2] = {
+    { "set", "set_i_ic" }, { "set", "set_p_pc" }, { "set", "set_s_sc" },
+    { "add", "add_i_i_ic" }, { "sub", "sub_i_i_i" }, { "inc", "inc_i" },
+    { "concat", "concat_s_s_s" }, { "say", "say_s" }, { "say", "say_sc" },
+    { "print", "print_i" }, { "new", "new_p_sc" }, { "if", "if_i_ic" },
+    { "unless", "unless_p_ic" }, { "eq", "eq_i_ic_ic" }, { "lt", "lt_i_i_ic" },
+    { "find_lex", "find_lex_p_sc" }, { "store_lex", "store_lex_sc_p" },
+    { "get_hll_global", "get_hll_global_p_sc" }, { "isnull", "isnull_i_p" },
+    { "push", "push_p_p" }, { "shift", "shift_p_p" }, { "length", "length_i_s" },
+    { "substr", "substr_s_s_i_i" }, { "typeof", "typeof_s_p" },
+    { "find_method", "find_method_p_p_sc" }, { "newclosure", "newclosure_p_p" },
+    { "capture_lex", "capture_lex_p" }, { "box", "box_p_s" }, { "iter", "iter_p_p" },
+    { "set_args", "set_args_pc" }, { "get_results", "get_results_pc" },
+    { "returncc", "returncc" }
+};
+
+/* names of .locals */
+static char const * const localnames[] = {
+    "i", "j", "k", "n", "count", "self", "result", "key", "value", "obj", "str",
+    "pos", "len", "args", "list", "hash", "node", "past", "code", "name", "item",
+    "iter", "match", "target", "ns", "sub", "block", "cur", "prev", "next"
+};
+
+/* register types, as in $I0 */
+static char const registertypes[] = { 'I', 'N', 'S', 'P' };
+
+/*
+
+=head1 FUNCTIONS
+
+=over 4
+
+=item C<static unsigned next_random(void)>
+
+Return the next number of a simple linear congruential generator.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static unsigned
+next_random(void)
+{
+    ASSERT_ARGS(next_random)
+    random_state = random_state * 1103515245UL + 12345UL;
+    return (unsigned)((random_state >> 16) & 0x7fff);
+}
+
+/*
+
+=item C<static unsigned pick(unsigned n)>
+
+Return a number from 0 up to C<n>; low numbers are picked more often than
+high numbers, like the few common ops and registers in real code.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static unsigned
+pick(unsigned n)
+{
+    ASSERT_ARGS(pick)
+    unsigned const a = next_random() % n;
+    unsigned const b = next_random() % n;
+    return a < b ? a : b;
+}
+
+/*
+
+=item C<static void make_keys(void)>
+
+Fill C<keys> with a mix of op names (40%), registers (30%), local names
+(15%) and labels (15%).
+
+=cut
+
+*/
+static void
+make_keys(void)
+{
+    ASSERT_ARGS(make_keys)
+    unsigned i;
+
+    for (i = 0; i < NUM_BENCH_KEYS; i++) {
+        unsigned const kind = next_random() % 100;
+
+        if (kind < 40)
+            sprintf(keys[i], "%s", opnames[pick(sizeof opnames / sizeof opnames[0])]);
+        else if (kind < 70)
+            sprintf(keys[i], "$%c%u", registertypes[next_random() % 4], pick(32));
+        else if (kind < 85)
+            sprintf(keys[i], "%s", localnames[pick(sizeof localnames / sizeof localnames[0])]);
+        else if (kind < 95)
+            sprintf(keys[i], "L%u", next_random() % 500);
+        else
+            sprintf(keys[i], "_loop_%s_%u", localnames[next_random() % 8], next_random() % 50);
+    }
+}
+
+/*
+
+=item C<static unsigned long count_allocations(lexer_state * const lexer)>
+
+Return the number of pointers that were allocated through C<lexer>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static unsigned long
+count_allocations(ARGIN(lexer_state * const lexer))
+{
+    ASSERT_ARGS(count_allocations)
+    allocated_mem_ptrs *iter  = lexer->mem_allocations;
+    unsigned long       count = 0;
+
+    for (; iter; iter = iter->next)
+        count += iter->allocs_in_this_block;
+
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_get_hashcode(lexer_state * const lexer,
+unsigned long count)>
+
+Hash C<count> keys.
+
+=cut
+
+*/
+static unsigned long
+bench_get_hashcode(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_get_hashcode)
+    unsigned long i, total = 0;
+
+    UNUSED(lexer);
+
+    for (i = 0; i < count; i++)
+        total += get_hashcode(keys[i % NUM_BENCH_KEYS], HASHTABLE_SIZE_INIT);
+
+    sink += total;
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_op_cache_hit(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_op_cache_miss(
+    ARGIN(lexer_state * const lexer),
+    unsigned long count)
+        __attribute__nonnull__(1);
+
+static unsigned long bench_hashtable(lexer_state * const lexer, unsigned
+long count)>
+
+Store all different keys in a hashtable, as the symbol tables do, and then
+look up C<count> keys.
+
+=cut
+
+*/
+static unsigned long
+bench_hashtable(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_hashtable)
+    hashtable     table;
+    unsigned long i, found = 0;
+
+    init_hashtable(lexer, &table, HASHTABLE_SIZE_INIT);
+
+    for (i = 0; i < NUM_BENCH_KEYS; i++) {
+        unsigned long const hash = get_hashcode(keys[i], table.size);
+        bucket *b = get_bucket(&table, hash);
+
+        while (b && !STREQ(bucket_string(b), keys[i]))
+            b = b->next;
+
+        if (b == NULL) {
+            b = new_bucket(lexer);
+            bucket_string(b) = keys[i];
+            store_bucket(&table, b, hash);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        char const * const  key = keys[(i * 7) % NUM_BENCH_KEYS];
+        bucket             *b   = get_bucket(&table, get_hashcode(key, table.size));
+
+        while (b && !STREQ(bucket_string(b), key))
+            b = b->next;
+
+        found += (b != NULL);
+    }
+
+    sink += found;
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_dupstr(lexer_state * const lexer, unsigned
+long count)>
+
+Intern C<count> keys with C<dupstr()>; only the first occurrence of each key
+allocates memory.
+
+=cut
+
+*/
+static unsigned long
+bench_dupstr(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_dupstr)
+    unsigned long i;
+
+    for (i = 0; i < count; i++)
+        sink += (unsigned long)dupstr(lexer, keys[i % NUM_BENCH_KEYS]);
+
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_add_string_const(lexer_state * const lexer,
+unsigned long count)>
+
+Add C<count> keys to the constant table as string constants; most of them
+are stored already.
+
+=cut
+
+*/
+static unsigned long
+bench_add_string_const(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_add_string_const)
+    unsigned long i;
+
+    for (i = 0; i < count; i++)
+        sink += add_string_const(lexer->bc, keys[i % NUM_BENCH_KEYS], "ascii");
+
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_add_num_const(lexer_state * const lexer,
+unsigned long count)>
+
+Add C<count> different number constants, which grows the constant table
+by one each time.
+
+=cut
+
+*/
+static unsigned long
+bench_add_num_const(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_add_num_const)
+    unsigned long i;
+
+    for (i = 0; i < count; i++)
+        sink += add_num_const(lexer->bc, (double)i + 0.5);
+
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_regalloc(lexer_state * const lexer, unsigned
+long count)>
+
+Allocate registers for subs of C<BENCH_INTERVALS> variables each, until
+C<count> variables are done. Most variables live for a few instructions;
+some live for the rest of the sub. The register usage is stored in a sub,
+as the allocator does for the sub being compiled.
+
+=cut
+
+*/
+static unsigned long
+bench_regalloc(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_regalloc)
+    lsr_allocator * const lsr = new_linear_scan_register_allocator(lexer);
+    int                   colors[BENCH_INTERVALS];
+    unsigned long         done = 0;
+
+    new_subr(lexer, Parrot_str_new(lexer->interp, "bench", 5));
+
+    while (done < count) {
+        unsigned i;
+
+        for (i = 0; i < BENCH_INTERVALS; i++) {
+            live_interval * const interval =
+                new_live_interval(lsr, i, (pir_type)(next_random() % 4));
+
+            interval->endpoint = next_random() % 10
+                               ? i + 1 + next_random() % 8
+                               : BENCH_INTERVALS;
+            interval->color    = &colors[i];
+        }
+
+        linear_scan_register_allocation(lsr);
+        sink += colors[0];
+        done += BENCH_INTERVALS;
+    }
+
+    destroy_linear_scan_register_allocator(lsr);
+    return done;
+}
+
+/*
+
+=item C<static unsigned long bench_find_macro(lexer_state * const lexer,
+unsigned long count)>
+
+Define C<BENCH_MACROS> macros, named after the first keys, and look up
+C<count> keys; most of these aren't macros.
+
+=cut
+
+*/
+static unsigned long
+bench_find_macro(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_find_macro)
+    macro_table * const table = new_macro_table(NULL);
+    unsigned long       i, found = 0;
+
+    UNUSED(lexer);
+
+    for (i = 0; i < BENCH_MACROS; i++)
+        if (find_macro(table, keys[i]) == NULL)
+            new_macro(table, keys[i], 1, 0, 16);
+
+    for (i = 0; i < count; i++)
+        found += (find_macro(table, keys[(i * 7) % NUM_BENCH_KEYS]) != NULL);
+
+    delete_macro_table(table);
+
+    sink += found;
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_op_cache_hit(lexer_state * const lexer,
+unsigned long count)>
+
+Cache the lookups of C<BENCH_OPS> ops, each keyed by its interned short name
+and a signature code of its own, and look up C<count> of them; each lookup is
+a hit, as for an op that was seen before.
+
+=cut
+
+*/
+static unsigned long
+bench_op_cache_hit(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_op_cache_hit)
+    char const    *names[BENCH_OPS];
+    unsigned long  i, found = 0;
+
+    for (i = 0; i < BENCH_OPS; i++) {
+        names[i] = dupstr(lexer, signatured_ops[i][0]);
+        cache_op(lexer, names[i], i + 1,
+                 lexer->interp->op_lib->op_code(signatured_ops[i][1], 1));
+    }
+
+    for (i = 0; i < count; i++) {
+        unsigned const n = pick(BENCH_OPS);
+        found += (find_cached_op(lexer, names[n], n + 1) != NULL);
+    }
+
+    sink += found;
+    return count;
+}
+
+/*
+
+=item C<static unsigned long bench_op_cache_miss(lexer_state * const lexer,
+unsigned long count)>
+
+Look up C<count> ops that aren't in the op cache, in the op library by their
+signatured name, as C<get_opinfo()> does for an op that wasn't seen before.
+The results aren't cached, so that each lookup misses. Building the
+signatured name isn't included.
+
+=cut
+
+*/
+static unsigned long
+bench_op_cache_miss(ARGIN(lexer_state * const lexer), unsigned long count)
+{
+    ASSERT_ARGS(bench_op_cache_miss)
+    char const    *names[BENCH_OPS];
+    unsigned long  i, total = 0;
+
+    for (i = 0; i < BENCH_OPS; i++)
+        names[i] = dupstr(lexer, signatured_ops[i][0]);
+
+    for (i = 0; i < count; i++) {
+        unsigned const n = pick(BENCH_OPS);
+
+        if (find_cached_op(lexer, names[n], n + 1) == NULL)
+            total += lexer->interp->op_lib->op_code(signatured_ops[n][1], 1);
+    }
+
+    sink += total;
+    return count;
+}
+
+/* the benchmarks, and the number of operations for each */
+static const benchmark benchmarks[] = {
+    { "get_hashcode",              bench_get_hashcode,     2000000, TRUE  },
+    { "hashtable lookup",          bench_hashtable,        2000000, TRUE  },
+    { "find_string (dupstr)",      bench_dupstr,           1000000, TRUE  },
+    { "add_string_const",          bench_add_string_const,   20000, FALSE },
+    { "new_pbc_const growth",      bench_add_num_const,      20000, FALSE },
+    { "linear scan (per interval)", bench_regalloc,         1000000, FALSE },
+    { "find_macro",                bench_find_macro,       2000000, FALSE },
+    { "op lookup (cache hit)",     bench_op_cache_hit,     2000000, TRUE  },
+    { "op lookup (cache miss)",    bench_op_cache_miss,    1000000, FALSE }
+};
+
+/*
+
+=item C<int main(int argc, char *argv[])>
+
+Run all benchmarks, each with a lexer of its own, and print the results.
+
+=cut
+
+*/
+int
+main(int argc, char *argv[])
+{
+    PARROT_INTERP = Parrot_new(NULL);
+    unsigned long scale = 1;
+    unsigned      i;
+
+    if (argc > 1) {
+        scale = strtoul(argv[1], NULL, 10);
+
+        if (scale == 0) {
+            fprintf(stderr, "Usage: %s [scale]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    make_keys();
+
+    printf("%-28s %10s %10s %10s\n", "benchmark", "ops", "ns/op", "allocs/op");
+
+    for (i = 0; i < sizeof benchmarks / sizeof benchmarks[0]; i++) {
+        lexer_state * const lexer  = new_lexer(interp, (char *)"microbench", 0);
+        unsigned long const before = count_allocations(lexer);
+        FLOATVAL const      start  = Parrot_floatval_time();
+        unsigned long const ops    = benchmarks[i].run(lexer, benchmarks[i].count * scale);
+        FLOATVAL const      time   = Parrot_floatval_time() - start;
+        unsigned long const allocs = count_allocations(lexer) - before;
+
+        if (benchmarks[i].counted)
+            printf("%-28s %10lu %10.1f %10.3f\n", benchmarks[i].name, ops,
+                   time * 1e9 / ops, (double)allocs / ops);
+        else
+            printf("%-28s %10lu %10.1f %10s\n", benchmarks[i].name, ops,
+                   time * 1e9 / ops, "-");
+
+        release_resources(lexer);
+    }
+
+    return 0;
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,577 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements a cache of compiled bytecode files. The bytecode that
+pirc generates only depends on the flattened input, as written by the heredoc
+preprocessor, the name of the input file (which is stored in the bytecode),
+the compiler flags and the set of ops that Parrot provides. A hash of these
+is used as the name of a file in a cache directory, in which the bytecode is
+stored. If the file exists, it's copied to the output file, and no
+compilation is needed.
+
+It also implements a cache for C<parse_string()>, which keeps the bytecode
+segments of the most recently compiled strings, so that evaluating the same
+code again doesn't compile it again.
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+#include "pircompiler.h"
+#include "pircache.h"
+
+/* HEADERIZER HFILE: compilers/pirc/src/pircache.h */
+
+/* a compiled string; see find_cached_eval() */
+typedef struct eval_cache_entry {
+    Interp                  *interp;  /* interpreter that owns the bytecode */
+    char                    *source;  /* the code that was compiled */
+    UHUGEINTVAL              hash;    /* hash of source */
+    int                      flags;   /* flags it was compiled with */
+    PackFile_ByteCode       *code;    /* the generated bytecode */
+
+    struct eval_cache_entry *prev;    /* the entry that was used more recently */
+    struct eval_cache_entry *next;    /* the entry that was used less recently */
+
+} eval_cache_entry;
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+static int copy_file(
+    ARGIN(char const * const from),
+    ARGIN(char const * const to))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+PARROT_WARN_UNUSED_RESULT
+static UHUGEINTVAL hash_bytes(
+    UHUGEINTVAL hash,
+    ARGIN(void const * const data),
+    size_t size)
+        __attribute__nonnull__(2);
+
+PARROT_WARN_UNUSED_RESULT
+static int hash_file(
+    ARGMOD(UHUGEINTVAL *hash),
+    ARGIN(char const * const filename))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*hash);
+
+static void unlink_eval(ARGIN(eval_cache_entry * const entry))
+        __attribute__nonnull__(1);
+
+#define ASSERT_ARGS_copy_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(from) \
+    , PARROT_ASSERT_ARG(to))
+#define ASSERT_ARGS_hash_bytes __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(data))
+#define ASSERT_ARGS_hash_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(hash) \
+    , PARROT_ASSERT_ARG(filename))
+#define ASSERT_ARGS_unlink_eval __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(entry))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+/* flags that don't affect the generated bytecode */
+#define PBC_CACHE_IGNORED_FLAGS     (LEXER_FLAG_WARNINGS | LEXER_FLAG_VERBOSE | LEXER_FLAG_MAPINPUT)
+
+/* 64-bit FNV-1a parameters */
+#define FNV_OFFSET_BASIS            ((UHUGEINTVAL)0xcbf29ce4 << 32 | 0x84222325)
+#define FNV_PRIME                   ((UHUGEINTVAL)0x100 << 32 | 0x000001b3)
+
+/* size of the buffer used to read files */
+#define PBC_CACHE_BUFFER_SIZE       8192
+
+/* the eval cache is a list of entries, most recently used first */
+PIRC_STATIC_MUTEX(eval_cache_lock);
+static eval_cache_entry *eval_cache_first  = NULL;
+static eval_cache_entry *eval_cache_last   = NULL;
+static unsigned          eval_cache_count  = 0;
+static unsigned          eval_cache_hits   = 0;
+static unsigned          eval_cache_misses = 0;
+
+/*
+
+=head1 FUNCTIONS
+
+=over 4
+
+=item C<static UHUGEINTVAL hash_bytes(UHUGEINTVAL hash, void const * const data,
+size_t size)>
+
+Add C<size> bytes at C<data> to C<hash>, which is a 64-bit FNV-1a hash.
+Returns the new hash value.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static UHUGEINTVAL
+hash_bytes(UHUGEINTVAL hash, ARGIN(void const * const data), size_t size)
+{
+    ASSERT_ARGS(hash_bytes)
+    unsigned char const *iter = (unsigned char const *)data;
+
+    while (size-- > 0) {
+        hash ^= *iter++;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*
+
+=item C<static int hash_file(UHUGEINTVAL *hash, char const * const filename)>
+
+Add the contents of the file C<filename> to C<hash>. Returns FALSE if the file
+can't be read, TRUE otherwise.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+hash_file(ARGMOD(UHUGEINTVAL *hash), ARGIN(char const * const filename))
+{
+    ASSERT_ARGS(hash_file)
+    char    buffer[PBC_CACHE_BUFFER_SIZE];
+    FILE   *in = fopen(filename, "rb");
+    size_t  count;
+
+    if (in == NULL)
+        return FALSE;
+
+    while ((count = fread(buffer, sizeof (char), PBC_CACHE_BUFFER_SIZE, in)) > 0)
+        *hash = hash_bytes(*hash, buffer, count);
+
+    fclose(in);
+    return TRUE;
+}
+
+/*
+
+=item C<static int copy_file(char const * const from, char const * const to)>
+
+Copy the file C<from> to C<to>. The copy is written to a temporary file with a
+unique name in the directory of C<to> first, which is renamed to C<to> when
+it's complete, so that no other process sees a partially written file, and
+processes that copy to the same file don't get in each other's way. Returns
+TRUE if successful, FALSE otherwise.
+
+=cut
+
+*/
+static int
+copy_file(ARGIN(char const * const from), ARGIN(char const * const to))
+{
+    ASSERT_ARGS(copy_file)
+    char   buffer[PBC_CACHE_BUFFER_SIZE];
+    char  *tempname;
+    FILE  *in;
+    FILE  *out = NULL;
+    size_t count;
+    int    ok = TRUE;
+
+    in = fopen(from, "rb");
+    if (in == NULL)
+        return FALSE;
+
+    tempname = (char *)mem_sys_allocate((strlen(to) + 8) * sizeof (char));
+    sprintf(tempname, "%s.XXXXXX", to);
+
+#ifndef _WIN32
+    {
+        int const fd = mkstemp(tempname);
+
+        if (fd >= 0) {
+            /* mkstemp() creates the file for the owner only; give it the
+             * permissions that fopen() would.
+             */
+            mode_t const mask = umask(0);
+            umask(mask);
+            fchmod(fd, 0666 & ~mask);
+
+            out = fdopen(fd, "wb");
+            if (out == NULL) {
+                close(fd);
+                remove(tempname);
+            }
+        }
+    }
+#else
+    if (_mktemp(tempname) != NULL)
+        out = fopen(tempname, "wb");
+#endif
+
+    if (out == NULL) {
+        fclose(in);
+        mem_sys_free(tempname);
+        return FALSE;
+    }
+
+    while ((count = fread(buffer, sizeof (char), PBC_CACHE_BUFFER_SIZE, in)) > 0) {
+        if (fwrite(buffer, sizeof (char), count, out) != count) {
+            ok = FALSE;
+            break;
+        }
+    }
+
+    if (ferror(in))
+        ok = FALSE;
+
+    fclose(in);
+
+    if (fclose(out) != 0)
+        ok = FALSE;
+
+    if (ok) {
+#ifdef _WIN32
+        /* rename() fails on Windows if the target exists */
+        remove(to);
+#endif
+        ok = (rename(tempname, to) == 0);
+    }
+
+    if (!ok)
+        remove(tempname);
+
+    mem_sys_free(tempname);
+    return ok;
+}
+
+/*
+
+=item C<char * pbc_cache_path(PARROT_INTERP, char const * const cachedir, char
+const * const source, char const * const flattened, char const * const
+snapshotfile, char const * const keep, int flags)>
+
+Compute the name of the file in the cache directory C<cachedir> that holds
+the bytecode for the file C<source>, of which the heredoc-preprocessed
+version is stored in the file C<flattened>, when compiled with C<flags>,
+and with the definitions of the snapshot C<snapshotfile>, if not NULL, and
+keeping the subs C<keep>, if not NULL.
+The name is a hash of the contents of C<flattened> and C<snapshotfile>,
+C<source>, C<keep>, C<flags> and the full names of all ops of C<interp>. If a file
+can't be read, NULL is returned. The returned string must be freed with C<mem_sys_free()>.
+
+=cut
+
+*/
+PARROT_MALLOC
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+char *
+pbc_cache_path(PARROT_INTERP, ARGIN(char const * const cachedir),
+               ARGIN(char const * const source), ARGIN(char const * const flattened),
+               ARGIN_NULLOK(char const * const snapshotfile),
+               ARGIN_NULLOK(char const * const keep), int flags)
+{
+    ASSERT_ARGS(pbc_cache_path)
+    UHUGEINTVAL hash = FNV_OFFSET_BASIS;
+    char       *path;
+    size_t      i;
+
+    if (!hash_file(&hash, flattened))
+        return NULL;
+
+    if (snapshotfile != NULL && !hash_file(&hash, snapshotfile))
+        return NULL;
+
+    /* the file name is stored in the bytecode; include the NULL character,
+     * so that it's separated from what follows.
+     */
+    hash  = hash_bytes(hash, source, strlen(source) + 1);
+
+    if (keep != NULL)
+        hash = hash_bytes(hash, keep, strlen(keep) + 1);
+
+    CLEAR_FLAG(flags, PBC_CACHE_IGNORED_FLAGS);
+    hash  = hash_bytes(hash, &flags, sizeof (flags));
+
+    /* the op table determines the op numbers in the bytecode */
+    for (i = 0; i < interp->op_count; ++i) {
+        char const * const opname = interp->op_info_table[i].full_name;
+        hash = hash_bytes(hash, opname, strlen(opname) + 1);
+    }
+
+    /* "/" + 16 hex digits + ".pbc" + NULL character */
+    path = (char *)mem_sys_allocate((strlen(cachedir) + 1 + 16 + 4 + 1) * sizeof (char));
+    sprintf(path, "%s/%08lx%08lx.pbc", cachedir,
+            (unsigned long)(hash >> 32), (unsigned long)(hash & 0xffffffffUL));
+
+    return path;
+}
+
+/*
+
+=item C<int fetch_cached_pbc(char const * const cachefile, char const * const
+outfile)>
+
+Copy the cached bytecode file C<cachefile> to C<outfile>. Returns TRUE if
+successful; FALSE if there's no such file in the cache, or if it couldn't
+be copied.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+int
+fetch_cached_pbc(ARGIN(char const * const cachefile), ARGIN(char const * const outfile))
+{
+    ASSERT_ARGS(fetch_cached_pbc)
+    return copy_file(cachefile, outfile);
+}
+
+/*
+
+=item C<void store_cached_pbc(char const * const cachefile, char const * const
+outfile)>
+
+Store the bytecode file C<outfile> in the cache, as C<cachefile>. Failing to
+do so is not an error; the next compilation just won't find it.
+
+=cut
+
+*/
+void
+store_cached_pbc(ARGIN(char const * const cachefile), ARGIN(char const * const outfile))
+{
+    ASSERT_ARGS(store_cached_pbc)
+    (void)copy_file(outfile, cachefile);
+}
+
+/*
+
+=item C<static void unlink_eval(eval_cache_entry * const entry)>
+
+Remove C<entry> from the list of cached evals. The caller must hold
+C<eval_cache_lock>.
+
+=cut
+
+*/
+static void
+unlink_eval(ARGIN(eval_cache_entry * const entry))
+{
+    ASSERT_ARGS(unlink_eval)
+
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        eval_cache_first  = entry->next;
+
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        eval_cache_last   = entry->prev;
+
+    entry->prev = NULL;
+    entry->next = NULL;
+    --eval_cache_count;
+}
+
+/*
+
+=item C<PackFile_ByteCode * find_cached_eval(PARROT_INTERP, char const * const
+source, int flags)>
+
+Find the bytecode that was generated by C<interp> for the PIR code C<source>,
+when compiled with C<flags>. If it's found, it's marked as most recently used,
+and returned; otherwise NULL is returned. The number of hits and misses is
+counted; see C<get_eval_cache_stats()>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+PackFile_ByteCode *
+find_cached_eval(PARROT_INTERP, ARGIN(char const * const source), int flags)
+{
+    ASSERT_ARGS(find_cached_eval)
+    UHUGEINTVAL        hash = hash_bytes(FNV_OFFSET_BASIS, source, strlen(source));
+    eval_cache_entry  *iter;
+    PackFile_ByteCode *code = NULL;
+
+    PIRC_MUTEX_READY(eval_cache_lock);
+
+    CLEAR_FLAG(flags, PBC_CACHE_IGNORED_FLAGS);
+
+    LOCK(eval_cache_lock);
+
+    for (iter = eval_cache_first; iter != NULL; iter = iter->next) {
+        if (iter->hash      == hash
+        &&  iter->flags     == flags
+        &&  iter->interp    == interp
+        &&  STREQ(iter->source, source))
+            break;
+    }
+
+    if (iter != NULL) {
+        /* move it to the front of the list */
+        unlink_eval(iter);
+
+        iter->next = eval_cache_first;
+        if (eval_cache_first)
+            eval_cache_first->prev = iter;
+        else
+            eval_cache_last = iter;
+
+        eval_cache_first = iter;
+        ++eval_cache_count;
+        ++eval_cache_hits;
+
+        code = iter->code;
+    }
+    else
+        ++eval_cache_misses;
+
+    UNLOCK(eval_cache_lock);
+
+    return code;
+}
+
+/*
+
+=item C<void cache_eval(PARROT_INTERP, char const * const source, int flags,
+PackFile_ByteCode *code)>
+
+Store the bytecode C<code> that C<interp> generated for the PIR code C<source>,
+when compiled with C<flags>. At most C<EVAL_CACHE_SIZE> entries are kept; if
+the cache is full, the least recently used entry is removed. The bytecode
+segment itself remains owned by the interpreter's packfile.
+
+=cut
+
+*/
+void
+cache_eval(PARROT_INTERP, ARGIN(char const * const source), int flags,
+           ARGIN(PackFile_ByteCode *code))
+{
+    ASSERT_ARGS(cache_eval)
+    eval_cache_entry *entry = mem_allocate_zeroed_typed(eval_cache_entry);
+
+    entry->interp = interp;
+    entry->hash   = hash_bytes(FNV_OFFSET_BASIS, source, strlen(source));
+    entry->code   = code;
+    entry->source = (char *)mem_sys_allocate((strlen(source) + 1) * sizeof (char));
+    strcpy(entry->source, source);
+
+    CLEAR_FLAG(flags, PBC_CACHE_IGNORED_FLAGS);
+    entry->flags  = flags;
+
+    PIRC_MUTEX_READY(eval_cache_lock);
+
+    LOCK(eval_cache_lock);
+
+    if (eval_cache_count == EVAL_CACHE_SIZE) {
+        eval_cache_entry * const last = eval_cache_last;
+
+        unlink_eval(last);
+        mem_sys_free(last->source);
+        mem_sys_free(last);
+    }
+
+    entry->next = eval_cache_first;
+    if (eval_cache_first)
+        eval_cache_first->prev = entry;
+    else
+        eval_cache_last = entry;
+
+    eval_cache_first = entry;
+    ++eval_cache_count;
+
+    UNLOCK(eval_cache_lock);
+}
+
+/*
+
+=item C<void forget_cached_evals(PARROT_INTERP)>
+
+Remove all entries of C<interp> from the eval cache. As the cache is keyed by
+the interpreter's address, this must be called before C<interp> is destroyed;
+otherwise an interpreter that's created at the same address later would find
+bytecode that no longer exists.
+
+=cut
+
+*/
+void
+forget_cached_evals(PARROT_INTERP)
+{
+    ASSERT_ARGS(forget_cached_evals)
+    eval_cache_entry *iter;
+
+    PIRC_MUTEX_READY(eval_cache_lock);
+
+    LOCK(eval_cache_lock);
+
+    iter = eval_cache_first;
+    while (iter != NULL) {
+        eval_cache_entry * const next = iter->next;
+
+        if (iter->interp == interp) {
+            unlink_eval(iter);
+            mem_sys_free(iter->source);
+            mem_sys_free(iter);
+        }
+
+        iter = next;
+    }
+
+    UNLOCK(eval_cache_lock);
+}
+
+/*
+
+=item C<void get_eval_cache_stats(unsigned *hits, unsigned *misses)>
+
+Store the number of times that C<find_cached_eval()> found and didn't find the
+requested bytecode in C<hits> and C<misses>, respectively.
+
+=cut
+
+*/
+void
+get_eval_cache_stats(ARGOUT(unsigned *hits), ARGOUT(unsigned *misses))
+{
+    ASSERT_ARGS(get_eval_cache_stats)
+    PIRC_MUTEX_READY(eval_cache_lock);
+
+    LOCK(eval_cache_lock);
+    *hits   = eval_cache_hits;
+    *misses = eval_cache_misses;
+    UNLOCK(eval_cache_lock);
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRCACHE_H_GUARD
+#define PARROT_PIR_PIRCACHE_H_GUARD
+
+#include "parrot/parrot.h"
+
+/* the maximum number of compiled strings kept by the eval cache */
+#define EVAL_CACHE_SIZE     64
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pircache.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+void cache_eval(PARROT_INTERP,
+    ARGIN(char const * const source),
+    int flags,
+    ARGIN(PackFile_ByteCode *code))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(4);
+
+PARROT_WARN_UNUSED_RESULT
+int fetch_cached_pbc(
+    ARGIN(char const * const cachefile),
+    ARGIN(char const * const outfile))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+PackFile_ByteCode * find_cached_eval(PARROT_INTERP,
+    ARGIN(char const * const source),
+    int flags)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+void forget_cached_evals(PARROT_INTERP)
+        __attribute__nonnull__(1);
+
+void get_eval_cache_stats(ARGOUT(unsigned *hits), ARGOUT(unsigned *misses))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*hits)
+        FUNC_MODIFIES(*misses);
+
+PARROT_MALLOC
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+char * pbc_cache_path(PARROT_INTERP,
+    ARGIN(char const * const cachedir),
+    ARGIN(char const * const source),
+    ARGIN(char const * const flattened),
+    ARGIN_NULLOK(char const * const snapshotfile),
+    ARGIN_NULLOK(char const * const keep),
+    int flags)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        __attribute__nonnull__(4);
+
+void store_cached_pbc(
+    ARGIN(char const * const cachefile),
+    ARGIN(char const * const outfile))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+#define ASSERT_ARGS_cache_eval __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(source) \
+    , PARROT_ASSERT_ARG(code))
+#define ASSERT_ARGS_fetch_cached_pbc __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(cachefile) \
+    , PARROT_ASSERT_ARG(outfile))
+#define ASSERT_ARGS_find_cached_eval __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(source))
+#define ASSERT_ARGS_forget_cached_evals __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp))
+#define ASSERT_ARGS_get_eval_cache_stats __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(hits) \
+    , PARROT_ASSERT_ARG(misses))
+#define ASSERT_ARGS_pbc_cache_path __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(cachedir) \
+    , PARROT_ASSERT_ARG(source) \
+    , PARROT_ASSERT_ARG(flattened))
+#define ASSERT_ARGS_store_cached_pbc __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(cachefile) \
+    , PARROT_ASSERT_ARG(outfile))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pircache.c */
+
+#endif /* PARROT_PIR_PIRCACHE_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
@@ -3,6 +3,14 @@
  */
 
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "parrot/parrot.h"
+
+#ifdef PARROT_HAS_HEADER_SYSMMAN
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
 
 #include "pirparser.h"
 #include "pircompiler.h"
@@ -10,12 +18,36 @@
 #include "piryy.h"
 #include "pirlexer.h"
 #include "pircapi.h"
+#include "pircache.h"
+#include "pirstats.h"
+#include "bcgen.h"
 
 /* HEADERIZER HFILE: compilers/pirc/src/pircapi.h */
 
 /* HEADERIZER BEGIN: static */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+static char * load_input(
+    ARGIN(FILE *infile),
+    ARGOUT(size_t *size),
+    ARGOUT(int *mapped))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*size)
+        FUNC_MODIFIES(*mapped);
+
+static void unload_input(ARGIN(char *input), size_t size, int mapped)
+        __attribute__nonnull__(1);
+
+#define ASSERT_ARGS_load_input __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(infile) \
+    , PARROT_ASSERT_ARG(size) \
+    , PARROT_ASSERT_ARG(mapped))
+#define ASSERT_ARGS_unload_input __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(input))
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 /* HEADERIZER END: static */
 
@@ -37,10 +69,12 @@ PIRC's services should use only these functions.
 
 
 void init_scanner_state(yyscan_t yyscanner);
+struct yy_buffer_state *yypir_scan_buffer(char *base, size_t size, yyscan_t yyscanner);
 
 
-static Parrot_mutex eval_nr_lock;
-static INTVAL       eval_nr  = 0;
+/* evals are numbered by all compilers in the process, so that each gets a unique name */
+PIRC_STATIC_MUTEX(eval_nr_lock);
+static INTVAL eval_nr = 0;
 
 /*
 
@@ -71,37 +105,187 @@ open_file(ARGIN(char const * const filename), ARGIN(char const * const mode))
 
 /*
 
-=item C<void parse_file(PARROT_INTERP, int flexdebug, FILE *infile, char * const
-filename, int flags, int thr_id, unsigned macro_size, char * const outputfile)>
+=item C<static char * load_input(FILE *infile, size_t *size, int *mapped)>
+
+Make the contents of C<infile> available in memory, so that the lexer can scan
+it in place, and return a pointer to it; its size is stored in C<size>. The
+contents are followed by two NULL characters, as flex requires. If possible,
+the file is memory-mapped, and C<mapped> is set; otherwise it's read into a
+buffer. NULL is returned if C<infile> is empty or not a file, in which case
+the lexer should read it.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+static char *
+load_input(ARGIN(FILE *infile), ARGOUT(size_t *size), ARGOUT(int *mapped))
+{
+    ASSERT_ARGS(load_input)
+    struct stat  info;
+    char        *input;
+
+    *mapped = 0;
 
-This will be the proper declaration after testing for thread-safety:
+    if (fstat(fileno(infile), &info) != 0 || info.st_size <= 0)
+        return NULL;
 
-void parse_file(int flexdebug, FILE *infile, char * const filename, int flags,
-                char * const outputfile)
+    *size = (size_t)info.st_size;
+
+#ifdef PARROT_HAS_HEADER_SYSMMAN
+    {
+        /* the rest of the file's last page reads as zeroes; if there's room for
+         * the two NULL characters, map them as well.
+         */
+        long const   page   = sysconf(_SC_PAGESIZE);
+        size_t const inpage = page > 0 ? *size % (size_t)page : 0;
+
+        if (inpage != 0 && inpage <= (size_t)page - 2) {
+            input = (char *)mmap(NULL, *size + 2, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                                 fileno(infile), 0);
+
+            if (input != (char *)MAP_FAILED) {
+                *mapped = 1;
+                return input;
+            }
+        }
+    }
+#endif
+
+    input = (char *)mem_sys_allocate_zeroed((*size + 2) * sizeof (char));
+
+    if (fread(input, sizeof (char), *size, infile) != *size) {
+        mem_sys_free(input);
+        rewind(infile);
+        return NULL;
+    }
+
+    return input;
+}
+
+/*
+
+=item C<static void unload_input(char *input, size_t size, int mapped)>
+
+Release the input C<input> of C<size> characters, that was returned by
+C<load_input()>. This must be done after the lexer is destroyed.
 
 =cut
 
 */
+static void
+unload_input(ARGIN(char *input), size_t size, int mapped)
+{
+    ASSERT_ARGS(unload_input)
+#ifdef PARROT_HAS_HEADER_SYSMMAN
+    if (mapped) {
+        munmap(input, size + 2);
+        return;
+    }
+#else
+    UNUSED(size);
+    UNUSED(mapped);
+#endif
+    mem_sys_free(input);
+}
 
+/*
+
+=item C<void init_compile_options(compile_options *options, int flags)>
+
+Initialize C<options> to compile with C<flags>: no lexer debugging, thread id
+0 and the listing file named after it, the default macro buffer size,
+registers allocated for one sub at a time, the default output file, and no
+snapshot, included files or statistics.
+
+=cut
+
+*/
 void
-parse_file(PARROT_INTERP, int flexdebug, ARGIN(FILE *infile),
-           ARGIN(char * const filename), int flags,
-           int thr_id, unsigned macro_size,
-           ARGMOD_NULLOK(char * const outputfile))
+init_compile_options(ARGOUT(compile_options *options), int flags)
+{
+    ASSERT_ARGS(init_compile_options)
+    options->flags        = flags;
+    options->flexdebug    = 0;
+    options->thr_id       = 0;
+    options->listfile     = NULL;
+    options->macro_size   = INIT_MACRO_SIZE;
+    options->jobs         = 1;
+    options->outputfile   = NULL;
+    options->snap         = NULL;
+    options->snapshotfile = NULL;
+    options->keep         = NULL;
+    options->includes     = NULL;
+    options->stats        = NULL;
+}
+
+/*
+
+=item C<int parse_file(PARROT_INTERP, FILE *infile, char * const filename,
+compile_options const * const options)>
+
+Parse and compile the file C<infile>, with the C<options> that are set up by
+C<init_compile_options()>; the number of errors is returned.
+If C<LEXER_FLAG_MAPINPUT> is set in the flags, the file is memory-mapped and
+scanned in place, instead of being read in chunks by the lexer.
+If C<snap> is not NULL, the macros and constants in it are defined before
+parsing. If C<snapshotfile> is not NULL, a snapshot of the macros and
+constants is written to it after a successful parse, together with the
+files in C<includes>, the list returned by C<process_heredocs()> for C<infile>.
+If C<stats> is not NULL, the times of the compilation phases and the
+counters are added to it, and the file is traced as a span if C<stats>
+has a trace file.
+If unreachable subs are removed (C<LEXER_FLAG_TREESHAKE> is set in the flags),
+the subs named in C<keep>, if not NULL, are kept; see C<remove_unreachable_subs()>.
+If registers are allocated (C<LEXER_FLAG_REGALLOC> is set in the flags) and
+C<jobs> is more than 1, this is done for C<jobs> subs at a time, by as many
+threads, after parsing; see C<allocate_deferred_registers()>.
+Files may be compiled in several threads at the same time, if each thread
+has an interpreter of its own and a different C<thr_id>; the latter names
+the file C<output_thr_N> to which a listing is written, unless C<listfile>
+names another file. Processes that compile in the same directory at the same
+time must each pass a C<listfile> of their own.
+
+=cut
+
+*/
+
+PARROT_IGNORABLE_RESULT
+int
+parse_file(PARROT_INTERP, ARGIN(FILE *infile), ARGIN(char * const filename),
+           ARGIN(compile_options const * const options))
 {
     ASSERT_ARGS(parse_file)
+    compiler_stats * const stats = options->stats;
     yyscan_t     yyscanner;
     lexer_state *lexer     = NULL;
+    int          errors;
+    char        *input     = NULL;
+    size_t       inputsize = 0;
+    int          mapped    = 0;
 
     /* create a yyscan_t object */
     yypirlex_init(&yyscanner);
     /* set debug flag */
-    yypirset_debug(flexdebug, yyscanner);
+    yypirset_debug(options->flexdebug, yyscanner);
     /* set the input file */
     yypirset_in(infile, yyscanner);
     /* set the extra parameter in the yyscan_t structure */
-    lexer = new_lexer(interp, filename, flags);
-    lexer->macro_size = macro_size;
+    lexer = new_lexer(interp, filename, options->flags);
+    lexer->macro_size = options->macro_size;
+    lexer->jobs       = options->jobs;
+    lexer->keep_subs  = options->keep;
+    lexer->stats      = stats;
+
+    /* let the statistics measure this lexer's macro buffers */
+    if (stats != NULL)
+        stats->lexer = lexer;
+
+    begin_span(stats, "file", filename);
+
+    if (options->snap != NULL)
+        restore_snapshot(lexer, options->snap);
 
     /* initialize the scanner state */
     init_scanner_state(yyscanner);
@@ -113,13 +297,36 @@ parse_file(PARROT_INTERP, int flexdebug, ARGIN(FILE *infile),
     yypirset_extra(lexer, yyscanner);
     /* and store the yyscanner in the lexer, so they're close buddies */
     lexer->yyscanner = yyscanner;
+
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_MAPINPUT)) {
+        input = load_input(infile, &inputsize, &mapped);
+        if (input != NULL)
+            yypir_scan_buffer(input, inputsize + 2, yyscanner);
+    }
+
     /* go parse */
+    begin_phase(stats, PHASE_PARSE);
     yypirparse(yyscanner, lexer);
 
+    /* allocate the registers that weren't allocated while parsing */
+    if (lexer->parse_errors == 0)
+        allocate_deferred_registers(lexer);
+
+    end_phase(stats, PHASE_PARSE);
+
+    if (lexer->parse_errors == 0 && options->snapshotfile != NULL)
+        if (!save_snapshot(lexer, options->includes, options->snapshotfile))
+            ++lexer->parse_errors;
 
     if (lexer->parse_errors == 0) {
-        char outfile[20];
-        sprintf(outfile, "output_thr_%d", thr_id);
+        char        listing[24];
+        char const *outfile = options->listfile;
+
+        if (outfile == NULL) {
+            sprintf(listing, "output_thr_%d", options->thr_id);
+            outfile = listing;
+        }
+
         lexer->outfile = open_file(outfile, "w");
         if (lexer->outfile == NULL) {
             fprintf(stderr, "Failed to open file %s\n", outfile);
@@ -129,9 +336,9 @@ parse_file(PARROT_INTERP, int flexdebug, ARGIN(FILE *infile),
         if (TEST_FLAG(lexer->flags, LEXER_FLAG_NOOUTPUT)) /* handy for testing the compiler */
             fprintf(stdout, "ok\n");
         else if (TEST_FLAG(lexer->flags, LEXER_FLAG_PREPROCESS))
-            emit_pir_subs(lexer, outputfile);
+            emit_pir_subs(lexer, options->outputfile);
         else if (TEST_FLAG(lexer->flags, LEXER_FLAG_OUTPUTPBC))
-            emit_pbc(lexer, outputfile);
+            emit_pbc(lexer, options->outputfile ? options->outputfile : "a.pbc");
         else
             /*
             fprintf(stderr, "Parse successful!\n");
@@ -159,24 +366,41 @@ parse_file(PARROT_INTERP, int flexdebug, ARGIN(FILE *infile),
         fprintf(stderr, "pirc ok\n");
 */
 
+    errors = lexer->parse_errors;
+
+    collect_stats(lexer);
+
     /* clean up after playing */
     release_resources(lexer);
     yypirlex_destroy(yyscanner);
 
+    /* the lexer's buffer pointed into the input, so release it only now */
+    if (input != NULL)
+        unload_input(input, inputsize, mapped);
+
+    end_span(stats, "file");
+
+    return errors;
 }
 
 
 /*
 
-=item C<void parse_string(PARROT_INTERP, char *pirstring, int flags, int
-pasminput, unsigned macro_size)>
+=item C<PackFile_ByteCode * parse_string(PARROT_INTERP, char *pirstring, int
+flags, int pasminput, unsigned macro_size)>
 
-Parse a PIR string.
+Parse a PIR string. If bytecode is generated (C<flags> has
+C<LEXER_FLAG_OUTPUTPBC> set), the new bytecode segment is returned, and it
+is kept in the eval cache. When the same string is parsed again with the
+same flags, the cached segment is made the current one and returned, without
+compiling the string again. Otherwise, or in case of errors, NULL is returned.
 
 =cut
 
 */
-void
+PARROT_IGNORABLE_RESULT
+PARROT_CAN_RETURN_NULL
+PackFile_ByteCode *
 parse_string(PARROT_INTERP, ARGIN(char *pirstring), int flags, int pasminput,
     unsigned macro_size)
 {
@@ -184,12 +408,23 @@ parse_string(PARROT_INTERP, ARGIN(char *pirstring), int flags, int pasminput,
     yyscan_t            yyscanner;
     lexer_state        *lexer = NULL;
     char                name[64];
-    PackFile_ByteCode  *old_cs, *new_cs;
+    PackFile_ByteCode  *result = NULL;
     INTVAL              eval_number;
 
+    if (pasminput)
+        SET_FLAG(flags, LEXER_FLAG_PASMFILE);
+
+    /* only generated bytecode is cached; other output is printed */
+    if (TEST_FLAG(flags, LEXER_FLAG_OUTPUTPBC)) {
+        result = find_cached_eval(interp, pirstring, flags);
+
+        if (result != NULL) {
+            Parrot_switch_to_cs(interp, result, 0);
+            return result;
+        }
+    }
 
-    if (eval_nr == 0)
-        MUTEX_INIT(eval_nr_lock);
+    PIRC_MUTEX_READY(eval_nr_lock);
 
     LOCK(eval_nr_lock);
     eval_number = ++eval_nr;
@@ -197,9 +432,6 @@ parse_string(PARROT_INTERP, ARGIN(char *pirstring), int flags, int pasminput,
 
     snprintf(name, sizeof (name), "EVAL_" INTVAL_FMT, eval_number);
 
-    new_cs = PF_create_default_segs(interp, Parrot_str_new(interp, name, strlen(name)), 0);
-    old_cs = Parrot_switch_to_cs(interp, new_cs, 0);
-
     /* create a yyscan_t object */
     yypirlex_init(&yyscanner);
 
@@ -218,11 +450,6 @@ parse_string(PARROT_INTERP, ARGIN(char *pirstring), int flags, int pasminput,
     /* set the scanner to a string buffer and go parse */
     yypir_scan_string(pirstring, yyscanner);
 
-    if (pasminput) { /* PASM mode */
-        SET_FLAG(lexer->flags, LEXER_FLAG_PASMFILE);
-    }
-
-
     yypirparse(yyscanner, lexer);
 
     if (lexer->parse_errors == 0) {
@@ -240,6 +467,18 @@ parse_string(PARROT_INTERP, ARGIN(char *pirstring), int flags, int pasminput,
     /* XXX just want to make sure pirc doesn't segfault when doing bytecode stuff. */
     if (TEST_FLAG(lexer->flags, LEXER_FLAG_OUTPUTPBC)) {
         emit_pbc(lexer, NULL);
+
+        if (lexer->parse_errors == 0) {
+            result = get_code_segment(lexer->bc);
+            cache_eval(interp, pirstring, flags, result);
+            Parrot_switch_to_cs(interp, result, 0);
+        }
+    }
+
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE)) {
+        unsigned hits, misses;
+        get_eval_cache_stats(&hits, &misses);
+        fprintf(stderr, "Eval cache: %u hits, %u misses\n", hits, misses);
     }
 
 /*
@@ -252,7 +491,7 @@ parse_string(PARROT_INTERP, ARGIN(char *pirstring), int flags, int pasminput,
     /* clean up after playing */
     yypirlex_destroy(yyscanner);
 
-
+    return result;
 }
 
 /*
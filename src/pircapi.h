@@ -6,10 +6,33 @@
 #define PARROT_PIR_PIRCAPI_H_GUARD
 
 #include <stdio.h>
+#include "pirsnapshot.h"
+#include "pirstats.h"
+
+/* how parse_file() compiles a file; see init_compile_options() */
+typedef struct compile_options {
+    int              flags;         /* the LEXER_FLAG_* flags */
+    int              flexdebug;     /* true to show the lexer's debug messages */
+    int              thr_id;        /* names the listing file; see parse_file() */
+    char const      *listfile;      /* listing file, or NULL to name it after thr_id */
+    unsigned         macro_size;    /* initial size of macro buffers */
+    unsigned         jobs;          /* number of subs whose registers are allocated at once */
+    char            *outputfile;    /* output file, or NULL for the default */
+    snapshot        *snap;          /* definitions to start with, or NULL */
+    char const      *snapshotfile;  /* file to write a snapshot to, or NULL */
+    char const      *keep;          /* comma-separated subs that -t keeps, or NULL */
+    include_list    *includes;      /* files included by the input, or NULL */
+    compiler_stats  *stats;         /* statistics to add to, or NULL */
+
+} compile_options;
 
 /* HEADERIZER BEGIN: compilers/pirc/src/pircapi.c */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
+void init_compile_options(ARGOUT(compile_options *options), int flags)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*options);
+
 PARROT_CAN_RETURN_NULL
 FILE * open_file(
     ARGIN(char const * const filename),
@@ -17,20 +40,19 @@ FILE * open_file(
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
 
-void parse_file(PARROT_INTERP,
-    int flexdebug,
+PARROT_IGNORABLE_RESULT
+int parse_file(PARROT_INTERP,
     ARGIN(FILE *infile),
     ARGIN(char * const filename),
-    int flags,
-    int thr_id,
-    unsigned macro_size,
-    ARGMOD_NULLOK(char * const outputfile))
+    ARGIN(compile_options const * const options))
         __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
         __attribute__nonnull__(3)
-        __attribute__nonnull__(4)
-        FUNC_MODIFIES(* const outputfile);
+        __attribute__nonnull__(4);
 
-void parse_string(PARROT_INTERP,
+PARROT_IGNORABLE_RESULT
+PARROT_CAN_RETURN_NULL
+PackFile_ByteCode * parse_string(PARROT_INTERP,
     ARGIN(char *pirstring),
     int flags,
     int pasminput,
@@ -43,13 +65,16 @@ PackFile_ByteCode * pirc_compile_file(SHIM_INTERP,
     SHIM(const char *filename),
     SHIM(STRING **error_message));
 
+#define ASSERT_ARGS_init_compile_options __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(options))
 #define ASSERT_ARGS_open_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(filename) \
     , PARROT_ASSERT_ARG(mode))
 #define ASSERT_ARGS_parse_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(interp) \
     , PARROT_ASSERT_ARG(infile) \
-    , PARROT_ASSERT_ARG(filename))
+    , PARROT_ASSERT_ARG(filename) \
+    , PARROT_ASSERT_ARG(options))
 #define ASSERT_ARGS_parse_string __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(interp) \
     , PARROT_ASSERT_ARG(pirstring))
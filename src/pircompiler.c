@@ -13,6 +13,7 @@
 #include "pirmacro.h"
 #include "pirregalloc.h"
 #include "pirerr.h"
+#include "pirstats.h"
 
 /* HEADERIZER HFILE: compilers/pirc/src/pircompiler.h */
 
@@ -23,7 +24,8 @@ PARROT_WARN_UNUSED_RESULT
 PARROT_CAN_RETURN_NULL
 static char const * find_string(
     ARGIN(lexer_state * const lexer),
-    ARGIN(char const * const str))
+    ARGIN(char const * const str),
+    size_t length)
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
 
@@ -56,12 +58,6 @@ static void store_string(
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 /* HEADERIZER END: static */
 
-/* XXX count memory, so we can check out mem. savings of string reuse
- * Only temporarily used, so no need to "fix" this.
- */
-static int totalmem = 0;
-
-
 
 /*
 
@@ -118,12 +114,14 @@ register_ptr(ARGMOD(lexer_state *lexer), ARGIN(void *ptr))
 
 /*
 
-=item C<void * pir_mem_allocate_zeroed(lexer_state *lexer, size_t numbytes)>
+=item C<void * pir_mem_allocate_zeroed(lexer_state *lexer, size_t numbytes,
+alloc_tag tag)>
 
 Memory allocation function for all PIR internal functions. Memory is allocated
 through Parrot's allocation functions, but the pointer to the allocated memory
 is stored in a data structure; this way, freeing all memory can be done by just
-iterating over these pointers and freeing them.
+iterating over these pointers and freeing them. C<tag> says what the memory
+is used for; if statistics are collected, the allocation is counted under it.
 
 Memory allocated through this function is all set to zero.
 
@@ -134,11 +132,14 @@ PARROT_MALLOC
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 void *
-pir_mem_allocate_zeroed(ARGMOD(lexer_state *lexer), size_t numbytes)
+pir_mem_allocate_zeroed(ARGMOD(lexer_state *lexer), size_t numbytes, alloc_tag tag)
 {
     void * const ptr = mem_sys_allocate_zeroed(numbytes);
 
-    totalmem += numbytes;
+    lexer->totalmem += numbytes;
+
+    if (lexer->stats)
+        count_allocation(lexer->stats, tag, numbytes);
 
     register_ptr(lexer, ptr);
     return ptr;
@@ -146,7 +147,8 @@ pir_mem_allocate_zeroed(ARGMOD(lexer_state *lexer), size_t numbytes)
 
 /*
 
-=item C<void * pir_mem_allocate(lexer_state * const lexer, size_t numbytes)>
+=item C<void * pir_mem_allocate(lexer_state * const lexer, size_t numbytes,
+alloc_tag tag)>
 
 See C<pir_mem_allocate_zeroed()>. Memory is C<not> guaranteed to be zeroed.
 (It might, it might not, depending on what your system finds appropriate.
@@ -159,11 +161,14 @@ PARROT_MALLOC
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 void *
-pir_mem_allocate(ARGIN(lexer_state * const lexer), size_t numbytes)
+pir_mem_allocate(ARGIN(lexer_state * const lexer), size_t numbytes, alloc_tag tag)
 {
     void *ptr = mem_sys_allocate(numbytes);
 
-    totalmem += numbytes;
+    lexer->totalmem += numbytes;
+
+    if (lexer->stats)
+        count_allocation(lexer->stats, tag, numbytes);
 
     register_ptr(lexer, ptr);
     return ptr;
@@ -184,9 +189,11 @@ void
 init_hashtable(ARGIN(lexer_state * const lexer), ARGIN(hashtable * const table),
                unsigned size)
 {
-    table->contents  = (bucket **)pir_mem_allocate_zeroed(lexer, size * sizeof (bucket *));
+    table->contents  = (bucket **)pir_mem_allocate_zeroed(lexer, size * sizeof (bucket *),
+                                                          ALLOC_BUCKET);
     table->size      = size;
     table->obj_count = 0;
+    table->probes    = 0;
 }
 
 /*
@@ -232,6 +239,8 @@ new_lexer(PARROT_INTERP, ARGIN_NULLOK(char * const filename), int flags)
     init_hashtable(lexer, &lexer->globals, HASHTABLE_SIZE_INIT);
     /* create a hashtable for storing .const declarations */
     init_hashtable(lexer, &lexer->constants, HASHTABLE_SIZE_INIT);
+    /* create a hashtable for caching op lookups */
+    init_hashtable(lexer, &lexer->op_cache, OP_CACHE_SIZE);
 
     /* create a new symbol table for macros. */
     lexer->macros     = new_macro_table(NULL);
@@ -263,7 +272,7 @@ PARROT_WARN_UNUSED_RESULT
 bucket *
 new_bucket(ARGIN(lexer_state * const lexer))
 {
-    return pir_mem_allocate_zeroed_typed(lexer, bucket);
+    return pir_mem_allocate_zeroed_typed(lexer, bucket, ALLOC_BUCKET);
 }
 
 /*
@@ -293,12 +302,14 @@ store_string(ARGIN(lexer_state * const lexer), ARGIN(char const * const str))
 /*
 
 =item C<static char const * find_string(lexer_state * const lexer, char const *
-const str)>
+const str, size_t length)>
 
-Find the string C<str> in the lexer's string hashtable. If the string was found,
-then a pointer to that buffer is returned. So, whenever for instance the string
-"print" is used, the string will only be stored in memory once, and a pointer to
-that buffer will be returned.
+Find the first C<length> characters of C<str> in the lexer's string hashtable.
+C<str> doesn't need to be NULL-terminated, so it can point into the lexer's
+input buffer directly. If the string was found, then a pointer to that buffer
+is returned. So, whenever for instance the string "print" is used, the string
+will only be stored in memory once, and a pointer to that buffer will be
+returned.
 
 =cut
 
@@ -306,17 +317,18 @@ that buffer will be returned.
 PARROT_WARN_UNUSED_RESULT
 PARROT_CAN_RETURN_NULL
 static char const *
-find_string(ARGIN(lexer_state * const lexer), ARGIN(char const * const str))
+find_string(ARGIN(lexer_state * const lexer), ARGIN(char const * const str), size_t length)
 {
     ASSERT_ARGS(find_string)
-    hashtable    *table = &lexer->strings;
-    unsigned long hash  = get_hashcode(str, table->size);
-    bucket *b           = get_bucket(table, hash);
+    hashtable *table = &lexer->strings;
+    bucket    *b     = get_bucket(table, hash_chars(str, length) % table->size);
 
     while (b) {
         /* loop through the buckets to see if this is the string */
-        if (STREQ(bucket_string(b), str))
-            return bucket_string(b); /* if so, return a pointer to the actual string. */
+        char const * const s = bucket_string(b);
+
+        if (strncmp(s, str, length) == 0 && s[length] == '\0')
+            return s; /* if so, return a pointer to the actual string. */
 
         b = b->next;
     }
@@ -326,14 +338,13 @@ find_string(ARGIN(lexer_state * const lexer), ARGIN(char const * const str))
 
 /*
 
-=item C<char const * dupstrn(lexer_state * const lexer, char * const source,
-size_t slen)>
+=item C<char const * dupstrn(lexer_state * const lexer, char const * const
+source, size_t slen)>
 
 See dupstr, except that this version takes the number of characters to be
-copied. Easy for copying a string except the quotes, for instance.
-
-XXX maybe make this a runtime (commandline) option? Might be slightly slower.
-XXX Otherwise maybe a build option using #defines.
+copied. Easy for copying a string except the quotes, for instance. C<source>
+is not changed, and it's only copied if it wasn't seen before; so tokens
+can be passed as a pointer into the input buffer and a length.
 
 =cut
 
@@ -341,16 +352,15 @@ XXX Otherwise maybe a build option using #defines.
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 char const *
-dupstrn(ARGIN(lexer_state * const lexer), ARGIN(char * const source), size_t slen)
+dupstrn(ARGIN(lexer_state * const lexer), ARGIN(char const * const source), size_t slen)
 {
-    char const * result = find_string(lexer, source);
-    /* make sure the string is terminated in time */
-    source[slen] = '\0';
+    char const * result = find_string(lexer, source, slen);
 
     if (result == NULL) { /* not found */
-        char * newbuffer = (char *)pir_mem_allocate_zeroed(lexer, slen + 1 * sizeof (char));
-        /* only copy num_chars characters */
-        strncpy(newbuffer, source, slen);
+        char * newbuffer = (char *)pir_mem_allocate_zeroed(lexer, (slen + 1) * sizeof (char),
+                                                           ALLOC_STRING);
+        /* only copy num_chars characters; the buffer was cleared, so it's terminated */
+        memcpy(newbuffer, source, slen);
         /* cache the string */
         store_string(lexer, newbuffer);
 
@@ -362,7 +372,8 @@ dupstrn(ARGIN(lexer_state * const lexer), ARGIN(char * const source), size_t sle
 
 /*
 
-=item C<char const * dupstr(lexer_state * const lexer, char * const source)>
+=item C<char const * dupstr(lexer_state * const lexer, char const * const
+source)>
 
 The C89 standard does not define a strdup() in the C library,
 so define our own strdup. Function names beginning with "str"
@@ -375,7 +386,7 @@ does: duplicate a string.
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 char const *
-dupstr(ARGIN(lexer_state * const lexer), ARGIN(char * const source))
+dupstr(ARGIN(lexer_state * const lexer), ARGIN(char const * const source))
 {
     return dupstrn(lexer, source, strlen(source));
 }
@@ -396,8 +407,11 @@ release_resources(ARGIN(lexer_state *lexer))
 {
     allocated_mem_ptrs *iter;
 
-    if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE))
-        fprintf(stderr, "Total nr of bytes allocated: %d\n", totalmem);
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE)) {
+        fprintf(stderr, "Total nr of bytes allocated: %lu\n", lexer->totalmem);
+        fprintf(stderr, "Op lookup cache: %u hits, %u misses\n",
+                lexer->op_cache_hits, lexer->op_cache_misses);
+    }
 
 
     iter = lexer->mem_allocations;
@@ -430,7 +444,8 @@ const message, ...)>
 Emit a warning message to C<stderr>. The line number (passed in C<lineno>) is reported,
 together with the message. The message can be formatted, meaning it can contain
 C<printf>'s placeholders. C<message> and all variable arguments are passed to
-C<vfprintf()>.
+C<vfprintf()>. Like errors, warnings outside of any sub are not reported if
+C<< lexer->subs_only >> is set.
 
 =cut
 
@@ -442,6 +457,10 @@ pirwarning(ARGIN(lexer_state * const lexer),
         ...)
 {
     va_list arg_ptr;
+
+    if (lexer->subs_only && lexer->open_subs == 0)
+        return;
+
     fprintf(stderr, "warning (line %d): ", lineno);
     va_start(arg_ptr, message);
     vfprintf(stderr, message, arg_ptr);
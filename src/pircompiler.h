@@ -33,7 +33,10 @@ typedef enum lexer_flags {
     LEXER_FLAG_NOOUTPUT            = 1 << 6, /* don't print anything on success, except 'ok' */
     LEXER_FLAG_REGALLOC            = 1 << 7, /* use register allocation optimizer */
     LEXER_FLAG_PASMFILE            = 1 << 8, /* the input is PASM, not PIR code */
-    LEXER_FLAG_OUTPUTPBC           = 1 << 9  /* generate PBC file */
+    LEXER_FLAG_OUTPUTPBC           = 1 << 9, /* generate PBC file */
+    LEXER_FLAG_TREESHAKE           = 1 << 10, /* remove unreachable subs */
+    LEXER_FLAG_REORDERCONSTS       = 1 << 11, /* store most used constants first */
+    LEXER_FLAG_MAPINPUT            = 1 << 12  /* scan the input in place, memory-mapped */
 
 } lexer_flags;
 
@@ -54,6 +57,30 @@ typedef struct allocated_mem_ptrs {
 
 } allocated_mem_ptrs;
 
+/* the kinds of memory that are accounted separately with --mem-stats; each call to
+ * pir_mem_allocate() says what the memory is for. Keep this in sync with the
+ * names in pirstats.c.
+ */
+typedef enum alloc_tag {
+    ALLOC_SUB,            /* subroutines and their multi types, lexicals and annotations */
+    ALLOC_INSTRUCTION,
+    ALLOC_EXPRESSION,
+    ALLOC_TARGET,
+    ALLOC_ARGUMENT,
+    ALLOC_CONSTANT,       /* constants and .const declarations */
+    ALLOC_KEY,            /* keys and key entries */
+    ALLOC_LABEL,          /* labels, local and global labels, and global label fixups */
+    ALLOC_SYMBOL,         /* symbols and PIR registers */
+    ALLOC_BUCKET,         /* hashtable buckets and bucket arrays */
+    ALLOC_STRING,         /* C strings, such as identifiers and op names */
+    ALLOC_OP_CACHE,       /* entries of the op lookup cache */
+    ALLOC_MACRO_BUFFER,   /* macro definitions and their bodies; not pir_mem_allocate()d */
+    ALLOC_PARROT_STRING,  /* STRINGs made by the lexer; not pir_mem_allocate()d */
+
+    NUM_ALLOC_TAGS        /* not a tag; keep this one last */
+
+} alloc_tag;
+
 
 /* struct to represent a global label reference; the contained instruction
  * will be changed, if the label can be found during global label fixup.
@@ -80,6 +107,9 @@ typedef void * yyscan_t;
  */
 #define INIT_MACRO_SIZE     4096
 
+/* number of buckets in the op lookup cache; a prime number */
+#define OP_CACHE_SIZE       1021
+
 
 /* store the "globals" of the lexer in a structure which is passed around.
  * as there's only 1 lexer_state, Size Doesn't Matter (really), so the large
@@ -104,17 +134,27 @@ typedef struct lexer_state {
 
     unsigned       stmt_counter;   /* to count "logical" statements, even if multi-line. */
 
+    unsigned       open_subs;      /* .sub directives scanned, minus subs closed */
+    int            subs_only;      /* only report errors and warnings in subs; the rest is
+                                    * reported by another parser of the same file. See
+                                    * split_and_parse().
+                                    */
+
     Interp        *interp;         /* parrot interpreter */
 
     cache          obj_cache;      /* cache for all sorts of objects to save memory allocations */
     hashtable      constants;
     hashtable      globals;
     hashtable      strings;        /* hashtable containing pointers to all parsed strings */
+    hashtable      op_cache;       /* results of op lookups; see pirop.c */
+    unsigned       op_cache_hits;
+    unsigned       op_cache_misses;
 
     global_fixup  *global_refs;    /* list of instructions that need to be fixed up, as they
                                     * reference global labels.
                                     */
     allocated_mem_ptrs *mem_allocations; /* list of pointers to allocated memory */
+    unsigned long       totalmem;        /* number of bytes in mem_allocations */
 
     yyscan_t       yyscanner;      /* sometimes when we only have a lexer, we want yyscanner
                                     * as well. Useful for if we need yyscanner, but only have
@@ -138,6 +178,13 @@ typedef struct lexer_state {
 
     /* register allocation */
     lsr_allocator            *lsr;
+    unsigned                  jobs;    /* threads that allocate registers after parsing;
+                                        * see allocate_deferred_registers()
+                                        */
+
+    char const               *keep_subs; /* comma-separated names of subs that
+                                          * remove_unreachable_subs() keeps, or NULL
+                                          */
 
     /* bytecode generation */
     struct bytecode          *bc;
@@ -145,6 +192,8 @@ typedef struct lexer_state {
 
     annotation               *annotations;
     unsigned                  num_annotations;
+
+    struct compiler_stats    *stats;   /* phase times and counters; NULL if not requested */
     
     /* XXX Temporary STRING pointer, for the conversion of all lexer code to use
     STRINGs instead of c strings (char pointers). Cannot change yylval union yet,
@@ -158,7 +207,8 @@ typedef struct lexer_state {
 #define CURRENT_MACRO(X)    (X)->macros->definitions
 
 /* same trick as in parrot's memory system, for "automagic" casting */
-#define pir_mem_allocate_zeroed_typed(lxr, type) (type *)pir_mem_allocate_zeroed(lxr, sizeof (type))
+#define pir_mem_allocate_zeroed_typed(lxr, type, tag) \
+    (type *)pir_mem_allocate_zeroed(lxr, sizeof (type), tag)
 
 /* use pir_mem_allocate functions if you don't want to worry about freeing it; all memory
  * allocated will be freed after the compilation. If you only need some memory temporarily
@@ -172,7 +222,7 @@ PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 char const * dupstr(
     ARGIN(lexer_state * const lexer),
-    ARGIN(char * const source))
+    ARGIN(char const * const source))
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
 
@@ -180,7 +230,7 @@ PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 char const * dupstrn(
     ARGIN(lexer_state * const lexer),
-    ARGIN(char * const source),
+    ARGIN(char const * const source),
     size_t slen)
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
@@ -208,13 +258,19 @@ lexer_state * new_lexer(PARROT_INTERP,
 PARROT_MALLOC
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
-void * pir_mem_allocate(ARGIN(lexer_state * const lexer), size_t numbytes)
+void * pir_mem_allocate(
+    ARGIN(lexer_state * const lexer),
+    size_t numbytes,
+    alloc_tag tag)
         __attribute__nonnull__(1);
 
 PARROT_MALLOC
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
-void * pir_mem_allocate_zeroed(ARGMOD(lexer_state *lexer), size_t numbytes)
+void * pir_mem_allocate_zeroed(
+    ARGMOD(lexer_state *lexer),
+    size_t numbytes,
+    alloc_tag tag)
         __attribute__nonnull__(1)
         FUNC_MODIFIES(*lexer);
 
@@ -31,6 +31,8 @@ O(c) (constant) time.
 #include "pirerr.h"
 #include "pirop.h"
 #include "bcgen.h"
+#include "pirstats.h"
+#include "pirjobs.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,12 +47,27 @@ O(c) (constant) time.
 
 /* HEADERIZER HFILE: compilers/pirc/src/pircompunit.h */
 
+/* bookkeeping for remove_unreachable_subs() */
+typedef struct sub_worklist {
+    subroutine **by_index;     /* subs, indexed by the constant table index of their PMC */
+    unsigned     num_indices;  /* number of slots in by_index */
+    subroutine **pending;      /* subs that were marked, but whose code is not scanned yet */
+    unsigned     num_pending;
+    subroutine **aliased;      /* subs with a :nsentry or :subid other than their name */
+    unsigned     num_aliased;
+
+} sub_worklist;
+
 /* HEADERIZER BEGIN: static */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
 static void add_self_parameter(ARGIN(lexer_state * const lexer))
         __attribute__nonnull__(1);
 
+static void allocate_sub_registers(ARGMOD(void *data), unsigned index)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*data);
+
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 static constant * create_const(
@@ -62,6 +79,28 @@ static constant * create_const(
 static void fixup_local_labels(ARGIN(lexer_state * const lexer))
         __attribute__nonnull__(1);
 
+static void mark_expression(
+    ARGIN(lexer_state * const lexer),
+    ARGMOD(sub_worklist *work),
+    ARGIN(expression * const expr))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*work);
+
+static void mark_sub(ARGMOD(sub_worklist *work), int index)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*work);
+
+static void mark_subs_by_name(
+    ARGIN(lexer_state * const lexer),
+    ARGMOD(sub_worklist *work),
+    ARGIN(char const * const name))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*work);
+
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 static expression * new_expr(
@@ -106,12 +145,33 @@ static void new_statement(
         __attribute__nonnull__(1)
         __attribute__nonnull__(2);
 
+static void scan_sub_references(
+    ARGIN(lexer_state * const lexer),
+    ARGMOD(sub_worklist *work),
+    ARGIN(subroutine * const sub))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*work);
+
 #define ASSERT_ARGS_add_self_parameter __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_allocate_sub_registers __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(data))
 #define ASSERT_ARGS_create_const __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_fixup_local_labels __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_mark_expression __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(work) \
+    , PARROT_ASSERT_ARG(expr))
+#define ASSERT_ARGS_mark_sub __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(work))
+#define ASSERT_ARGS_mark_subs_by_name __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(work) \
+    , PARROT_ASSERT_ARG(name))
 #define ASSERT_ARGS_new_expr __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_new_instruction __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
@@ -128,6 +188,10 @@ static void new_statement(
 #define ASSERT_ARGS_new_statement __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer) \
     , PARROT_ASSERT_ARG(opname))
+#define ASSERT_ARGS_scan_sub_references __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(work) \
+    , PARROT_ASSERT_ARG(sub))
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 /* HEADERIZER END: static */
 
@@ -218,7 +282,8 @@ set_sub_multi_types(ARGIN(lexer_state * const lexer),
 
     /* create an array of sufficient size, in which the multi type info is copied */
     CURRENT_SUB(lexer)->info.multi_types
-                          = (multi_type *)pir_mem_allocate(lexer, num_types * sizeof (multi_type));
+                          = (multi_type *)pir_mem_allocate(lexer, num_types * sizeof (multi_type),
+                                                           ALLOC_SUB);
 
 
     /* add types from end to beginning, as the list is in reversed order. */
@@ -428,7 +493,7 @@ their thing.
 void
 new_subr(ARGIN(lexer_state * const lexer), ARGIN(STRING *subname))
 {
-    subroutine *newsub       = pir_mem_allocate_zeroed_typed(lexer, subroutine);
+    subroutine *newsub       = pir_mem_allocate_zeroed_typed(lexer, subroutine, ALLOC_SUB);
     int         index;
 
     /* set the sub fields */
@@ -467,6 +532,8 @@ new_subr(ARGIN(lexer_state * const lexer), ARGIN(STRING *subname))
         CURRENT_SUB(lexer)->next = newsub;    /* set current sub's next to the new sub. */
     }
     CURRENT_SUB(lexer) = newsub;
+    COUNT_STAT(lexer, subs);
+    begin_span(lexer->stats, "sub", newsub->info.subname);
 
     /* store the subroutine identifier as a global label */
     store_global_label(lexer, Parrot_str_to_cstring(lexer->interp, subname));
@@ -510,7 +577,7 @@ static instruction *
 new_instruction(ARGIN(lexer_state * const lexer),
         ARGIN(char const * const opname))
 {
-    instruction *ins = pir_mem_allocate_zeroed_typed(lexer, instruction);
+    instruction *ins = pir_mem_allocate_zeroed_typed(lexer, instruction, ALLOC_INSTRUCTION);
     ins->opname      = opname;
     ins->opcode      = -1; /* make sure this field is properly initialized;
                               it must be >= 0 before being used */
@@ -560,6 +627,7 @@ new_statement(ARGIN(lexer_state * const lexer),
         CURRENT_INSTRUCTION(lexer)->next = instr;
     }
     CURRENT_INSTRUCTION(lexer) = instr;
+    COUNT_STAT(lexer, instructions);
 }
 
 /*
@@ -671,7 +739,7 @@ PARROT_CANNOT_RETURN_NULL
 target *
 new_target(ARGMOD(lexer_state *lexer))
 {
-    target * const t = pir_mem_allocate_zeroed_typed(lexer, target);
+    target * const t = pir_mem_allocate_zeroed_typed(lexer, target, ALLOC_TARGET);
     t->key          = NULL;
     t->next         = t; /* circly linked list */
     return t;
@@ -889,7 +957,7 @@ argument *
 new_argument(ARGIN(lexer_state * const lexer),
         ARGIN(expression * const expr))
 {
-    argument *arg = pir_mem_allocate_zeroed_typed(lexer, argument);
+    argument *arg = pir_mem_allocate_zeroed_typed(lexer, argument, ALLOC_ARGUMENT);
     arg->value    = expr;
     arg->next     = arg;
     return arg;
@@ -1477,7 +1545,7 @@ PARROT_CANNOT_RETURN_NULL
 static constant *
 create_const(ARGIN(lexer_state * const lexer), value_type type, va_list arg_ptr)
 {
-    constant *c = pir_mem_allocate_zeroed_typed(lexer, constant);
+    constant *c = pir_mem_allocate_zeroed_typed(lexer, constant, ALLOC_CONSTANT);
     c->type     = type;
     c->next     = NULL;
 
@@ -1544,7 +1612,7 @@ new_named_const(ARGIN(lexer_state * const lexer), value_type type,
         ARGIN(char const * const name),
         ...)
 {
-    constdecl *c = (constdecl *)pir_mem_allocate(lexer, sizeof (constdecl));
+    constdecl *c = (constdecl *)pir_mem_allocate(lexer, sizeof (constdecl), ALLOC_CONSTANT);
     va_list arg_ptr;
     va_start(arg_ptr, name);
 
@@ -1605,7 +1673,8 @@ new_pmc_const(ARGIN(lexer_state * const lexer),
     /* check whether that PMC isa "Sub" */
     INTVAL is_a_sub      = VTABLE_isa(lexer->interp, constclass, subclassname);
 
-    constdecl *decl      = (constdecl *)pir_mem_allocate(lexer, sizeof (constdecl));
+    constdecl *decl      = (constdecl *)pir_mem_allocate(lexer, sizeof (constdecl),
+                                                         ALLOC_CONSTANT);
     /* fprintf(stderr, "new_pmc_const: is a sub=%d\n", is_a_sub);
     */
 
@@ -1792,7 +1861,7 @@ PARROT_CANNOT_RETURN_NULL
 static expression *
 new_expr(ARGIN(lexer_state * const lexer), expr_type type)
 {
-    expression *expr = pir_mem_allocate_zeroed_typed(lexer, expression);
+    expression *expr = pir_mem_allocate_zeroed_typed(lexer, expression, ALLOC_EXPRESSION);
     expr->type       = type;
     expr->next       = expr;
     return expr;
@@ -1846,6 +1915,7 @@ expr_from_target(ARGIN(lexer_state * const lexer),
 {
     expression *e = new_expr(lexer, EXPR_TARGET);
     e->expr.t     = t;
+    e->sigcode    = get_operand_code(e);
     return e;
 }
 
@@ -1868,6 +1938,7 @@ expr_from_const(ARGIN(lexer_state * const lexer),
 {
     expression *e = new_expr(lexer, EXPR_CONSTANT);
     e->expr.c     = c;
+    e->sigcode    = get_operand_code(e);
     return e;
 }
 
@@ -1947,6 +2018,7 @@ expr_from_ident(ARGIN(lexer_state * const lexer),
 {
     expression *e = new_expr(lexer, EXPR_IDENT);
     e->expr.id    = id;
+    e->sigcode    = get_operand_code(e);
     return e;
 }
 
@@ -2159,7 +2231,7 @@ set_lex_flag(ARGIN(lexer_state * const lexer),
         lex = lex->next;
     }
 
-    lex        = (lexical *)pir_mem_allocate(lexer, sizeof (lexical));
+    lex        = (lexical *)pir_mem_allocate(lexer, sizeof (lexical), ALLOC_SUB);
     lex->name  = name;
 
     /* get a pointer to the "color" field, so that the lexical struct knows
@@ -2280,6 +2352,7 @@ expr_from_key(ARGIN(lexer_state * const lexer), ARGIN(key * const k))
 {
     expression *e = new_expr(lexer, EXPR_KEY);
     e->expr.k     = k;
+    e->sigcode    = get_operand_code(e);
     return e;
 }
 
@@ -2301,7 +2374,7 @@ PARROT_WARN_UNUSED_RESULT
 static key_entry *
 new_key_entry(ARGIN(lexer_state * const lexer), ARGIN(expression * const expr))
 {
-    key_entry *entry = pir_mem_allocate_zeroed_typed(lexer, key_entry);
+    key_entry *entry = pir_mem_allocate_zeroed_typed(lexer, key_entry, ALLOC_KEY);
     entry->expr      = expr;
     entry->next      = NULL;
     return entry;
@@ -2320,7 +2393,7 @@ PARROT_CANNOT_RETURN_NULL
 key *
 new_key(ARGIN(lexer_state * const lexer), ARGIN(expression * const expr))
 {
-    key *k       = pir_mem_allocate_zeroed_typed(lexer, key);
+    key *k       = pir_mem_allocate_zeroed_typed(lexer, key, ALLOC_KEY);
     k->head      = new_key_entry(lexer, expr);
     k->keylength = 1;
     return k;
@@ -2409,33 +2482,6 @@ new_local(ARGIN(lexer_state * const lexer),
 }
 
 
-/*
-
-=item C<int is_parrot_op(lexer_state * const lexer, char const * const name)>
-
-Check whether C<name> is a parrot opcode. C<name> can be either the short
-or fullname of the opcode; for instance, C<print> is the short name, which
-has several full names, such as C<print_i>, C<print_s>, etc., depending on
-the arity and types of operands.
-
-=cut
-
-*/
-int
-is_parrot_op(ARGIN(lexer_state * const lexer),
-        ARGIN(char const * const name))
-{
-    int opcode = lexer->interp->op_lib->op_code(name, 0); /* check short name, e.g. "set" */
-
-    /* do *NOT* check for the "long" name variant, such as "set_i_ic";
-     * signatures (such as the _i_ic part) will be calculated by PIRC,
-     * adding it already will generate e.g. "set_i_ic_i_ic", which is
-     * incorrect, obviously.
-     */
-    return (opcode >= 0);
-}
-
-
 /*
 
 =item C<void new_sub_instr(lexer_state * const lexer, int opcode, char const *
@@ -2530,7 +2576,7 @@ static label *
 new_label(ARGIN(lexer_state * const lexer),
         ARGIN(char const * const labelid), int offset)
 {
-    label *l  = pir_mem_allocate_zeroed_typed(lexer, label);
+    label *l  = pir_mem_allocate_zeroed_typed(lexer, label, ALLOC_LABEL);
     l->name   = labelid;
     l->offset = offset;
     return l;
@@ -2626,6 +2672,8 @@ fixup_global_labels(ARGIN(lexer_state * const lexer))
 {
     global_fixup *iter = lexer->global_refs;
 
+    begin_phase(lexer->stats, PHASE_GLOBAL_LABELS);
+
     while (iter) {
         global_label *glob = find_global_label(lexer, iter->label);
 
@@ -2657,9 +2705,404 @@ fixup_global_labels(ARGIN(lexer_state * const lexer))
         }
         iter = iter->next;
     }
+
+    end_phase(lexer->stats, PHASE_GLOBAL_LABELS);
 }
 
 
+/*
+
+=item C<static void mark_sub(sub_worklist *work, int index)>
+
+Mark the sub whose PMC is stored at index C<index> in the constant table
+as reachable, and schedule its code for scanning. Indices that do not
+refer to a sub are ignored, as are subs that were marked before.
+
+=cut
+
+*/
+static void
+mark_sub(ARGMOD(sub_worklist *work), int index)
+{
+    ASSERT_ARGS(mark_sub)
+    subroutine *sub;
+
+    if (index < 0 || (unsigned)index >= work->num_indices)
+        return;
+
+    sub = work->by_index[index];
+
+    if (sub == NULL || TEST_FLAG(sub->flags, PIRC_SUB_FLAG_REACHABLE))
+        return;
+
+    SET_FLAG(sub->flags, PIRC_SUB_FLAG_REACHABLE);
+    work->pending[work->num_pending++] = sub;
+}
+
+/*
+
+=item C<static void mark_subs_by_name(lexer_state * const lexer, sub_worklist
+*work, char const * const name)>
+
+Mark all subs called C<name> as reachable. There can be more than one,
+for instance in case of C<:multi> subs. A sub is also called by the name
+under which it's stored in the namespace (C<:nsentry>), and by its
+C<:subid>, which C<:outer> may refer to.
+
+=cut
+
+*/
+static void
+mark_subs_by_name(ARGIN(lexer_state * const lexer), ARGMOD(sub_worklist *work),
+        ARGIN(char const * const name))
+{
+    ASSERT_ARGS(mark_subs_by_name)
+    hashtable *table = &lexer->globals;
+    bucket    *b     = get_bucket(table, get_hashcode(name, table->size));
+    unsigned   i;
+
+    while (b) {
+        if (STREQ(bucket_global(b)->name, name))
+            mark_sub(work, bucket_global(b)->const_table_index);
+
+        b = b->next;
+    }
+
+    for (i = 0; i < work->num_aliased; ++i) {
+        subroutine * const sub = work->aliased[i];
+
+        if ((sub->info.nsentry && STREQ(sub->info.nsentry, name))
+        ||  (sub->info.subid   && STREQ(sub->info.subid, name)))
+            mark_sub(work, sub->pmc_index);
+    }
+}
+
+/*
+
+=item C<static void mark_expression(lexer_state * const lexer, sub_worklist
+*work, expression * const expr)>
+
+Mark all subs that may be referenced by the operand C<expr>. Any string
+constant that matches the name of a sub is considered a reference, as it
+might be used to look up the sub during runtime, for instance through
+C<find_sub_not_null> or C<get_global>. Keys are searched as well.
+
+=cut
+
+*/
+static void
+mark_expression(ARGIN(lexer_state * const lexer), ARGMOD(sub_worklist *work),
+        ARGIN(expression * const expr))
+{
+    ASSERT_ARGS(mark_expression)
+    key_entry *iter;
+
+    switch (expr->type) {
+        case EXPR_CONSTANT:
+            switch (expr->expr.c->type) {
+                case STRING_VAL:
+                case PMC_VAL: /* .const 'Sub' constants store the sub's name */
+                    mark_subs_by_name(lexer, work, expr->expr.c->val.sval);
+                    break;
+                case USTRING_VAL:
+                    mark_subs_by_name(lexer, work, expr->expr.c->val.ustr->contents);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case EXPR_KEY:
+            for (iter = expr->expr.k->head; iter != NULL; iter = iter->next)
+                mark_expression(lexer, work, iter->expr);
+            break;
+        case EXPR_TARGET:
+            if (expr->expr.t->key)
+                for (iter = expr->expr.t->key->head; iter != NULL; iter = iter->next)
+                    mark_expression(lexer, work, iter->expr);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+
+=item C<static void scan_sub_references(lexer_state * const lexer, sub_worklist
+*work, subroutine * const sub)>
+
+Mark all subs that are referenced from the code of C<sub>, and the sub
+that C<sub> is lexically nested in, if any.
+
+=cut
+
+*/
+static void
+scan_sub_references(ARGIN(lexer_state * const lexer), ARGMOD(sub_worklist *work),
+        ARGIN(subroutine * const sub))
+{
+    ASSERT_ARGS(scan_sub_references)
+    instruction *iter;
+
+    if (sub->info.outersub)
+        mark_subs_by_name(lexer, work, sub->info.outersub);
+
+    if (sub->statements == NULL)
+        return;
+
+    iter = sub->statements->next;
+
+    do {
+        if (iter->opcode == PARROT_OP_set_p_pc) {
+            /* the second operand is the index of a PMC constant, which may be
+             * a sub. Don't walk the operand list; fixup_global_labels() does
+             * not leave it properly circular.
+             */
+            expression *pmcindex = iter->operands->next->next;
+
+            if (pmcindex->type == EXPR_CONSTANT && pmcindex->expr.c->type == INT_VAL)
+                mark_sub(work, pmcindex->expr.c->val.ival);
+            else
+                mark_expression(lexer, work, pmcindex);
+        }
+        else if (iter->operands) {
+            expression *operand = iter->operands;
+
+            do {
+                operand = operand->next;
+                mark_expression(lexer, work, operand);
+            }
+            while (operand != iter->operands);
+        }
+
+        iter = iter->next;
+    }
+    while (iter != sub->statements->next);
+}
+
+/*
+
+=item C<void remove_unreachable_subs(lexer_state * const lexer)>
+
+Remove all subs that cannot be reached from an entry point. Entry points
+are subs flagged as C<:main>, C<:load>, C<:init>, C<:anon>, C<:immediate>,
+C<:postcomp>, C<:method>, C<:vtable> or C<:multi>, and the first sub in
+the file if there is no C<:main> sub, as that is where Parrot starts
+running then. All other subs are only reachable by name; these are kept
+if their name, C<:nsentry> or C<:subid> is referenced from a reachable sub,
+either directly or as a string constant, or if they are the C<:outer> of a
+reachable sub. Subs whose name, C<:nsentry> or C<:subid> is in the
+comma-separated list C<keep_subs> of C<lexer> are entry points too; these are
+the subs that a library is called through. Without them, every sub that a
+library doesn't call itself is removed.
+
+Removed subs are unlinked from the list of subs and their sub PMCs are no
+longer registered in the fixup table; the code of the remaining subs and
+their annotations are moved down to fill the gaps. This must be done after
+the parse, but before emitting the bytecode.
+
+=cut
+
+*/
+void
+remove_unreachable_subs(ARGIN(lexer_state * const lexer))
+{
+    ASSERT_ARGS(remove_unreachable_subs)
+    sub_worklist  work;
+    subroutine   *first;
+    subroutine   *iter;
+    annotation   *ann;
+    annotation   *kept_anns   = NULL;
+    unsigned      num_anns;
+    unsigned      num_subs    = 0;
+    unsigned      num_removed = 0;
+    int           has_main    = 0;
+    int           shift       = 0;    /* size of code removed so far */
+
+    if (lexer->subs == NULL)
+        return;
+
+    first            = lexer->subs->next;
+    work.num_indices = 0;
+    work.num_pending = 0;
+
+    iter = first;
+    do {
+        ++num_subs;
+
+        if ((unsigned)iter->pmc_index >= work.num_indices)
+            work.num_indices = iter->pmc_index + 1;
+
+        if (TEST_FLAG(iter->flags, PIRC_SUB_FLAG_MAIN))
+            has_main = 1;
+
+        iter = iter->next;
+    }
+    while (iter != first);
+
+    work.by_index    = (subroutine **)mem_sys_allocate_zeroed(work.num_indices
+                                                              * sizeof (subroutine *));
+    work.pending     = (subroutine **)mem_sys_allocate(num_subs * sizeof (subroutine *));
+    work.aliased     = (subroutine **)mem_sys_allocate(num_subs * sizeof (subroutine *));
+    work.num_aliased = 0;
+
+    iter = first;
+    do {
+        work.by_index[iter->pmc_index] = iter;
+        CLEAR_FLAG(iter->flags, PIRC_SUB_FLAG_REACHABLE);
+
+        if ((iter->info.nsentry && !STREQ(iter->info.nsentry, iter->info.subname))
+        ||  (iter->info.subid   && !STREQ(iter->info.subid, iter->info.subname)))
+            work.aliased[work.num_aliased++] = iter;
+
+        iter = iter->next;
+    }
+    while (iter != first);
+
+    /* mark the entry points */
+    if (!has_main)
+        mark_sub(&work, first->pmc_index);
+
+    iter = first;
+    do {
+        if (TEST_FLAG(iter->flags, PIRC_SUB_FLAG_MAIN | PIRC_SUB_FLAG_LOAD
+                                 | PIRC_SUB_FLAG_INIT | PIRC_SUB_FLAG_ANON
+                                 | PIRC_SUB_FLAG_IMMEDIATE | PIRC_SUB_FLAG_POSTCOMP
+                                 | PIRC_SUB_FLAG_METHOD | PIRC_SUB_FLAG_VTABLE
+                                 | PIRC_SUB_FLAG_MULTI))
+            mark_sub(&work, iter->pmc_index);
+
+        iter = iter->next;
+    }
+    while (iter != first);
+
+    /* and the subs that are called from outside the file */
+    if (lexer->keep_subs != NULL) {
+        char const *name = lexer->keep_subs;
+
+        while (*name != '\0') {
+            size_t const length = strcspn(name, ",");
+
+            if (length > 0)
+                mark_subs_by_name(lexer, &work, dupstrn(lexer, name, length));
+
+            name += length;
+
+            if (*name == ',')
+                ++name;
+        }
+    }
+
+    /* mark everything that can be reached from the entry points */
+    while (work.num_pending > 0)
+        scan_sub_references(lexer, &work, work.pending[--work.num_pending]);
+
+    /* rebuild the list of subs, and move the code of the remaining subs down.
+     * Annotations are stored in order of offset, so they can be processed
+     * along the way; annotations in removed subs are removed as well.
+     */
+    ann         = lexer->annotations ? lexer->annotations->next : NULL;
+    num_anns    = lexer->num_annotations;
+    lexer->subs = NULL;
+    iter        = first;
+
+    do {
+        subroutine *next = iter->next;
+        int         live = TEST_FLAG(iter->flags, PIRC_SUB_FLAG_REACHABLE);
+
+        while (num_anns > 0 && ann->offset < iter->info.endoffset) {
+            annotation *next_ann = ann->next;
+
+            if (live) {
+                ann->offset -= shift;
+
+                if (kept_anns) {
+                    ann->next       = kept_anns->next;
+                    kept_anns->next = ann;
+                }
+                else
+                    ann->next = ann;
+
+                kept_anns = ann;
+            }
+            else
+                --lexer->num_annotations;
+
+            ann = next_ann;
+            --num_anns;
+        }
+
+        if (live) {
+            if (shift > 0) {
+                instruction *instr = iter->statements;
+
+                iter->info.startoffset -= shift;
+                iter->info.endoffset   -= shift;
+
+                if (instr) {
+                    do {
+                        instr->offset -= shift;
+                        instr = instr->next;
+                    }
+                    while (instr != iter->statements);
+                }
+
+                relocate_sub_pmc(lexer->bc, iter->pmc_index, iter->info.startoffset,
+                                 iter->info.endoffset);
+            }
+
+            if (lexer->subs) {
+                iter->next        = lexer->subs->next;
+                lexer->subs->next = iter;
+            }
+            else
+                iter->next = iter;
+
+            lexer->subs = iter;
+        }
+        else {
+            if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE))
+                fprintf(stderr, "removing unreachable sub '%s'%s\n", iter->info.subname,
+                        TEST_FLAG(iter->flags, PIRC_SUB_FLAG_ANON) ? ""
+                        : "; if it's called from outside the file, pass it to --keep");
+
+            remove_sub_pmc(lexer->bc, iter->pmc_index);
+            shift += iter->info.endoffset - iter->info.startoffset;
+            ++num_removed;
+        }
+
+        iter = next;
+    }
+    while (iter != first);
+
+    /* annotations after the last sub */
+    while (num_anns > 0) {
+        annotation *next_ann = ann->next;
+
+        ann->offset -= shift;
+
+        if (kept_anns) {
+            ann->next       = kept_anns->next;
+            kept_anns->next = ann;
+        }
+        else
+            ann->next = ann;
+
+        kept_anns = ann;
+        ann       = next_ann;
+        --num_anns;
+    }
+
+    lexer->annotations  = kept_anns;
+    lexer->codesize    -= shift;
+
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE))
+        fprintf(stderr, "removed %u of %u subs (%d opcodes)\n", num_removed, num_subs, shift);
+
+    mem_sys_free(work.by_index);
+    mem_sys_free(work.pending);
+    mem_sys_free(work.aliased);
+}
+
 
 /*
 
@@ -2669,7 +3112,11 @@ Finalize the subroutine. Generate the final instructions in the current
 subroutine, if needed. Then, all local labels are fixed up; i.e., all
 label identifiers are converted into their offsets. The endoffset of this
 subroutine is stored.
-If register optimization was requested, this is invoked here.
+If register optimization was requested, this is invoked here; unless the
+registers are allocated by several threads after parsing (C<lexer>'s C<jobs>
+is more than 1), and the subroutine has no lexicals, whose registers must be
+known when its PMC is created. In that case, the subroutine's live intervals
+are kept for C<allocate_deferred_registers()>.
 
 =cut
 
@@ -2707,14 +3154,34 @@ close_sub(ARGIN(lexer_state * const lexer))
         emit_sub_epilogue(lexer);
 
     /* fix up all local branch labels */
+    begin_phase(lexer->stats, PHASE_LOCAL_LABELS);
     fixup_local_labels(lexer);
+    end_phase(lexer->stats, PHASE_LOCAL_LABELS);
 
     /* store end offset in bytecode of this subroutine */
     CURRENT_SUB(lexer)->info.endoffset = lexer->codesize;
 
-     /* if register allocation was requested, do that now */
-    if (TEST_FLAG(lexer->flags, LEXER_FLAG_REGALLOC))
-        linear_scan_register_allocation(lexer->lsr);
+     /* if register allocation was requested, do that now, or keep it for later */
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_REGALLOC)) {
+        if (lexer->jobs > 1 && CURRENT_SUB(lexer)->info.lexicals == NULL) {
+            CURRENT_SUB(lexer)->lsr = lexer->lsr;
+            lexer->lsr              = new_linear_scan_register_allocator(lexer);
+        }
+        else {
+            /* the lexical info of a sub with .lex variables records their
+             * registers, and it's made with the sub's PMC below; so they can't
+             * be allocated later, on another thread.
+             */
+            if (lexer->jobs > 1 && TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE))
+                fprintf(stderr, "allocating the registers of sub '%s' now, as it has "
+                        "lexicals\n", CURRENT_SUB(lexer)->info.subname);
+
+            begin_phase(lexer->stats, PHASE_REGALLOC);
+            linear_scan_register_allocation(lexer->lsr);
+            update_sub_register_usage(lexer, lexer->lsr->r);
+            end_phase(lexer->stats, PHASE_REGALLOC);
+        }
+    }
 
     /* store the subroutine in the bytecode constant table. */
     sub_const_table_index = add_sub_pmc(lexer->bc, &CURRENT_SUB(lexer)->info,
@@ -2731,6 +3198,100 @@ close_sub(ARGIN(lexer_state * const lexer))
     PARROT_ASSERT(glob != NULL); /* it was stored in new_subr(), so must be there. */
 
     glob->const_table_index = sub_const_table_index;
+    CURRENT_SUB(lexer)->pmc_index = sub_const_table_index;
+
+    /* what's parsed from here on is outside the sub; see yypirerror() */
+    if (lexer->open_subs > 0)
+        --lexer->open_subs;
+
+    end_span(lexer->stats, "sub");
+}
+
+/*
+
+=item C<static void allocate_sub_registers(void *data, unsigned index)>
+
+Job of C<allocate_deferred_registers()>: allocate the registers of the sub
+at C<index> in the array of subroutines C<data>, and store the number of
+registers it uses.
+
+=cut
+
+*/
+static void
+allocate_sub_registers(ARGMOD(void *data), unsigned index)
+{
+    ASSERT_ARGS(allocate_sub_registers)
+    subroutine * const sub = ((subroutine **)data)[index];
+    int                i;
+
+    linear_scan_register_allocation(sub->lsr);
+
+    for (i = 0; i < NUM_PARROT_TYPES; ++i)
+        sub->info.regs_used[i] = sub->lsr->r[i];
+}
+
+/*
+
+=item C<void allocate_deferred_registers(lexer_state * const lexer)>
+
+Allocate the registers of all subs that C<close_sub()> didn't allocate, on
+C<lexer>'s C<jobs> threads. Each sub has a register allocator of its own, and
+the allocation only touches that sub's symbols and registers, so subs can be
+done in any order. Their PMCs, which were created by C<close_sub()>, are
+updated afterwards, in order. As the constant table is not touched until
+then, the bytecode is the same as when the registers are allocated one sub
+at a time, while parsing.
+
+=cut
+
+*/
+void
+allocate_deferred_registers(ARGIN(lexer_state * const lexer))
+{
+    ASSERT_ARGS(allocate_deferred_registers)
+    subroutine **subs;
+    subroutine  *iter;
+    unsigned     numsubs = 0;
+    unsigned     i;
+
+    if (lexer->subs == NULL)
+        return;
+
+    iter = lexer->subs->next;
+    do {
+        if (iter->lsr != NULL)
+            ++numsubs;
+        iter = iter->next;
+    }
+    while (iter != lexer->subs->next);
+
+    if (numsubs == 0)
+        return;
+
+    begin_phase(lexer->stats, PHASE_REGALLOC);
+
+    subs    = mem_allocate_n_typed(numsubs, subroutine *);
+    numsubs = 0;
+
+    do {
+        if (iter->lsr != NULL)
+            subs[numsubs++] = iter;
+        iter = iter->next;
+    }
+    while (iter != lexer->subs->next);
+
+    run_jobs(numsubs, lexer->jobs, allocate_sub_registers, subs);
+
+    for (i = 0; i < numsubs; ++i) {
+        set_sub_pmc_registers(lexer->bc, subs[i]->pmc_index, subs[i]->info.regs_used);
+        destroy_linear_scan_register_allocator(subs[i]->lsr);
+        subs[i]->lsr = NULL;
+    }
+
+    mem_sys_free(subs);
+
+    end_phase(lexer->stats, PHASE_REGALLOC);
 }
 
 /*
@@ -2769,7 +3330,7 @@ annotate(ARGIN(lexer_state * const lexer),
         ARGIN(char const * const key),
         ARGIN(constant * const value))
 {
-    annotation *ann     = (annotation *)pir_mem_allocate(lexer, sizeof (annotation));
+    annotation *ann     = (annotation *)pir_mem_allocate(lexer, sizeof (annotation), ALLOC_SUB);
     ann->key            = key;
     ann->value          = value;
 
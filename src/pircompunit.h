@@ -87,7 +87,10 @@ typedef enum sub_flags {
     PIRC_SUB_FLAG_LEX        = 1 << 14, /* this sub needs a LexPad */
     PIRC_SUB_FLAG_MULTI      = 1 << 15, /* this sub is a multi method/sub */
     PIRC_SUB_FLAG_SUBID      = 1 << 16, /* this sub has a namespace-unaware identifier */
-    PIRC_SUB_FLAG_INSTANCEOF = 1 << 17  /* this sub has an :instanceof flag */
+    PIRC_SUB_FLAG_INSTANCEOF = 1 << 17, /* this sub has an :instanceof flag */
+
+    /* pir compiler internal flag, used by remove_unreachable_subs() */
+    PIRC_SUB_FLAG_REACHABLE  = 1 << 18  /* this sub can be reached from an entry point */
 
 } sub_flag;
 
@@ -213,7 +216,8 @@ typedef struct expression {
 
     } expr;
 
-    expr_type          type;  /* selector for expression_union */
+    expr_type          type;    /* selector for expression_union */
+    unsigned           sigcode; /* this operand's part of the op signature; see pirop.c */
 
     struct expression *next;
 
@@ -327,6 +331,7 @@ typedef struct bucket {
         struct local_label  *loc;
         struct global_label *glob;
         struct constdecl    *cons;
+        struct op_cache_entry *opc;
     } u;
 
     struct bucket *next; /* link to next bucket, in case of hash clash */
@@ -339,12 +344,14 @@ typedef struct bucket {
 #define bucket_local(B)     (B)->u.loc
 #define bucket_global(B)    (B)->u.glob
 #define bucket_constant(B)  (B)->u.cons
+#define bucket_opcache(B)   (B)->u.opc
 
 /* hashtable structure */
 typedef struct hashtable {
     bucket   **contents;       /* array of bucket pointers */
     unsigned   size;           /* number of slots in contents array */
     unsigned   obj_count;
+    unsigned long probes;      /* number of lookups, for --stats */
 
 } hashtable;
 
@@ -373,6 +380,7 @@ typedef struct subroutine {
     int                 flags;         /* this sub's flags */
 
     struct sub_info     info;          /* see bcgen.h */
+    int                 pmc_index;     /* index of this sub's PMC in the constant table */
 
     target             *parameters;    /* parameters of this sub */
     instruction        *statements;    /* statements of this sub */
@@ -382,6 +390,9 @@ typedef struct subroutine {
 
     struct pir_reg     *registers[NUM_PARROT_TYPES];  /* used PIR registers in this sub */
 
+    /* live intervals whose registers are not allocated yet; see close_sub() */
+    struct linear_scan_register_allocator *lsr;
+
     struct subroutine  *next;          /* pointer to next subroutine in the list */
 
 } subroutine;
@@ -445,6 +456,9 @@ target * add_target(
         __attribute__nonnull__(3)
         FUNC_MODIFIES(*last);
 
+void allocate_deferred_registers(ARGIN(lexer_state * const lexer))
+        __attribute__nonnull__(1);
+
 void annotate(
     ARGIN(lexer_state * const lexer),
     ARGIN(char const * const key),
@@ -534,12 +548,6 @@ PARROT_CANNOT_RETURN_NULL
 invocation * invoke(ARGIN(lexer_state * const lexer), invoke_type type, ...)
         __attribute__nonnull__(1);
 
-int is_parrot_op(
-    ARGIN(lexer_state * const lexer),
-    ARGIN(char const * const name))
-        __attribute__nonnull__(1)
-        __attribute__nonnull__(2);
-
 void load_library(
     ARGIN(lexer_state * const lexer),
     ARGIN(char const * const library))
@@ -630,6 +638,9 @@ void push_operand(
 void remove_all_operands(ARGIN(lexer_state * const lexer))
         __attribute__nonnull__(1);
 
+void remove_unreachable_subs(ARGIN(lexer_state * const lexer))
+        __attribute__nonnull__(1);
+
 void reset_register_allocator(ARGIN(lexer_state * const lexer))
         __attribute__nonnull__(1);
 
@@ -870,6 +881,8 @@ void update_sub_register_usage(
 #define ASSERT_ARGS_add_target __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(last) \
     , PARROT_ASSERT_ARG(t))
+#define ASSERT_ARGS_allocate_deferred_registers __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_annotate __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer) \
     , PARROT_ASSERT_ARG(key) \
@@ -909,9 +922,6 @@ void update_sub_register_usage(
        PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_invoke __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
-#define ASSERT_ARGS_is_parrot_op __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
-       PARROT_ASSERT_ARG(lexer) \
-    , PARROT_ASSERT_ARG(name))
 #define ASSERT_ARGS_load_library __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer) \
     , PARROT_ASSERT_ARG(library))
@@ -949,6 +959,8 @@ void update_sub_register_usage(
     , PARROT_ASSERT_ARG(operand))
 #define ASSERT_ARGS_remove_all_operands __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_remove_unreachable_subs __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_reset_register_allocator __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_set_arg_alias __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
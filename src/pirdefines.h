@@ -11,6 +11,31 @@
 #define TRUE              1
 #define FALSE             0
 
+/* A lock that is shared by all compilations in a process is declared with
+ * PIRC_STATIC_MUTEX, and made ready with PIRC_MUTEX_READY before it is taken.
+ * With POSIX threads, such a lock is initialized statically, so that compilers
+ * that are started at the same time don't race to initialize it. Otherwise,
+ * it is initialized when it's used first, which is only safe if the first
+ * compilation is done before any other threads are started.
+ */
+#if defined(PARROT_HAS_THREADS) && defined(PTHREAD_MUTEX_INITIALIZER)
+#  define PIRC_STATIC_MUTEX(name) \
+    static Parrot_mutex name = PTHREAD_MUTEX_INITIALIZER; \
+    static int          name ## _ready = 1
+#else
+#  define PIRC_STATIC_MUTEX(name) \
+    static Parrot_mutex name; \
+    static int          name ## _ready = 0
+#endif
+
+#define PIRC_MUTEX_READY(name) \
+    do { \
+        if (!name ## _ready) { \
+            MUTEX_INIT(name); \
+            name ## _ready = 1; \
+        } \
+    } while (0)
+
 #endif /* PARROT_PIR_PIRDEFINES_H_GUARD */
 
 /*
@@ -10,6 +10,7 @@
 #include "pircompiler.h"
 #include "pirerr.h"
 #include "bcgen.h"
+#include "pirstats.h"
 
 #include "parrot/oplib/ops.h"
 
@@ -1029,26 +1030,30 @@ emit_pbc_annotations(ARGIN(lexer_state * const lexer))
 Generate Parrot Byte Code from the abstract syntax tree.
 This is the top-level function. After all instructions
 have been emitted, the PBC is written to the specified
-file (or "a.pbc" if outfile is NULL).
+file. If C<outfile> is NULL, nothing is written; the bytecode is only
+kept in the interpreter, as for an eval.
 
 =cut
 
 */
 void
 emit_pbc(ARGIN(lexer_state * const lexer),
-        ARGIN(const char *outfile))
+        ARGIN_NULLOK(const char *outfile))
 {
     ASSERT_ARGS(emit_pbc)
     subroutine *subiter;
-
-    if (!outfile)
-        outfile = "a.pbc";
+    int         removed;
 
     if (lexer->subs == NULL)
         return;
 /*
     fprintf(stderr, "emit_pbc(): starting...\n");
 */
+    begin_phase(lexer->stats, PHASE_EMIT);
+
+    /* drop subs that can't be reached, before any code is emitted */
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_TREESHAKE))
+        remove_unreachable_subs(lexer);
 
     /* after everything is parsed we know how many instructions and operands
      * there are, and thus how many bytes must be allocated for emitting
@@ -1069,7 +1074,9 @@ emit_pbc(ARGIN(lexer_state * const lexer),
         fprintf(stderr, "start offset of sub '%s' is: %d\tend offest: %d\n",
                     subiter->info.subname, subiter->info.startoffset, subiter->info.endoffset);
 */
+        begin_span(lexer->stats, "emit", subiter->info.subname);
         emit_pbc_sub(lexer, subiter);
+        end_span(lexer->stats, "emit");
         subiter = subiter->next;
     }
     while (subiter != lexer->subs->next);
@@ -1077,8 +1084,23 @@ emit_pbc(ARGIN(lexer_state * const lexer),
     /* emit annotations */
     emit_pbc_annotations(lexer);
 
+    /* remove constants that are not used anymore */
+    removed = compact_constants(lexer->bc);
+
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE))
+        fprintf(stderr, "removed %d unused constants\n", removed);
+
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_REORDERCONSTS))
+        reorder_constants(lexer->bc);
+
     /* write the output to a file. */
-    write_pbc_file(lexer->bc, outfile);
+    if (outfile) {
+        begin_phase(lexer->stats, PHASE_WRITE);
+        write_pbc_file(lexer->bc, outfile);
+        end_phase(lexer->stats, PHASE_WRITE);
+    }
+
+    end_phase(lexer->stats, PHASE_EMIT);
 
     /* XXX just make sure no seg. faults  happened */
 /*
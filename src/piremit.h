@@ -12,9 +12,10 @@ struct constant;
 /* HEADERIZER BEGIN: compilers/pirc/src/piremit.c */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
-void emit_pbc(ARGIN(lexer_state * const lexer), ARGIN(const char *outfile))
-        __attribute__nonnull__(1)
-        __attribute__nonnull__(2);
+void emit_pbc(
+    ARGIN(lexer_state * const lexer),
+    ARGIN_NULLOK(const char *outfile))
+        __attribute__nonnull__(1);
 
 void emit_pir_subs(
     ARGIN(lexer_state * const lexer),
@@ -64,8 +65,7 @@ void print_target(ARGIN(lexer_state * const lexer), ARGIN(target * const t))
         __attribute__nonnull__(2);
 
 #define ASSERT_ARGS_emit_pbc __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
-       PARROT_ASSERT_ARG(lexer) \
-    , PARROT_ASSERT_ARG(outfile))
+       PARROT_ASSERT_ARG(lexer))
 #define ASSERT_ARGS_emit_pir_subs __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer) \
     , PARROT_ASSERT_ARG(outfile))
@@ -49,7 +49,8 @@ panic(ARGIN(lexer_state * lexer), ARGIN(char const * const message), ...)
 * const message, ...)>
 
 Default parse error handling routine, that is invoked when the bison-generated
-parser finds a syntax error.
+parser finds a syntax error. If C<< lexer->subs_only >> is set, an error outside
+of any sub is neither reported nor counted.
 
 =cut
 
@@ -63,6 +64,9 @@ yypirerror(yyscan_t yyscanner, ARGIN(lexer_state * const lexer),
     char const * const current_token = yypirget_text(yyscanner);
     va_list arg_ptr;
 
+    if (lexer->subs_only && lexer->open_subs == 0)
+        return 0;
+
     fprintf(stderr, "\nError in file '%s' (line %d)\n\t", lexer->filename,
             yypirget_lineno(yyscanner));
 
@@ -8,7 +8,25 @@
 
 #include <stdio.h> /* for FILE */
 
-void process_heredocs(PARROT_INTERP, char * const filename, FILE *outputfile);
+/* callback for visit_included_definitions(); gets the path of an included file,
+ * its modification time and size, and the data passed to visit_included_definitions().
+ */
+typedef void (*include_visitor)(char const * const path, long mtime, long size, void *data);
+
+/* list of the files that were included by a file; see process_heredocs() */
+typedef struct include_list include_list;
+
+include_list *process_heredocs(PARROT_INTERP, char * const filename, FILE *outputfile,
+                               int *errors);
+
+void free_include_list(include_list *list);
+
+void write_dependencies(include_list *includes, char const * const target,
+                        char const * const source, FILE *depfile);
+
+void visit_included_definitions(include_list *includes, include_visitor visit, void *data);
+
+int preload_include(char const * const path, long mtime, long size);
 
 #endif /* PARROT_PIR_PIRHEREDOC_H_GUARD */
 
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements a small pool of threads, that runs a number of
+independent jobs. The jobs are numbered, and each thread takes the job with
+the lowest number that wasn't taken yet, until none are left; the calling
+thread takes part as well. As jobs take as long as they take, it's not known
+which thread runs which job, so jobs must not depend on each other, and
+anything that depends on the order of the jobs must be done afterwards, by
+the caller.
+
+C<run_stealing_jobs()> is for jobs that differ a lot in size. The jobs are
+dealt to the threads in turn, so that each thread has a queue of its own,
+which it works through from the front. A thread whose queue is empty steals
+a job from the back of the longest queue of another thread. If the caller
+numbers the jobs from large to small, each thread starts with a large job,
+and the small ones are left to fill the gaps at the end.
+
+If Parrot was built without threads, all jobs are run in order by the calling
+thread.
+
+=head1 FUNCTIONS
+
+=over 4
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include "pirjobs.h"
+
+/* HEADERIZER HFILE: compilers/pirc/src/pirjobs.h */
+
+/* the maximum number of threads that run_jobs() starts */
+#define MAX_JOB_THREADS     64
+
+/* the jobs of a call to run_jobs(), shared by its threads */
+typedef struct job_queue {
+    Parrot_mutex  lock;       /* protects next */
+    unsigned      next;       /* number of the next job to be taken */
+    unsigned      numjobs;
+    job_function  run;
+    void         *data;
+
+} job_queue;
+
+/* the jobs that were dealt to a thread of run_stealing_jobs(); these are the
+ * jobs owner, owner + numthreads, owner + 2 * numthreads, and so on, of which
+ * the ones from the head up to the tail are left.
+ */
+typedef struct job_deque {
+    Parrot_mutex  lock;       /* protects head and tail */
+    unsigned      head;
+    unsigned      tail;
+
+} job_deque;
+
+/* the jobs of a call to run_stealing_jobs(), shared by its threads */
+typedef struct job_pool {
+    job_deque       deques[MAX_JOB_THREADS];
+    unsigned        numthreads;
+    worker_function run;
+    void           *data;
+
+} job_pool;
+
+/* what a thread of run_stealing_jobs() gets */
+typedef struct job_worker {
+    job_pool     *pool;
+    unsigned      number;
+
+} job_worker;
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+PARROT_CAN_RETURN_NULL
+static void * run_deques(ARGMOD(void *arg))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*arg);
+
+PARROT_CAN_RETURN_NULL
+static void * run_queue(ARGMOD(void *arg))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*arg);
+
+PARROT_WARN_UNUSED_RESULT
+static int take_job(
+    ARGMOD(job_pool *pool),
+    unsigned number,
+    ARGOUT(unsigned *index))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*pool)
+        FUNC_MODIFIES(*index);
+
+#define ASSERT_ARGS_run_deques __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(arg))
+#define ASSERT_ARGS_run_queue __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(arg))
+#define ASSERT_ARGS_take_job __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(pool) \
+    , PARROT_ASSERT_ARG(index))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+/*
+
+=item C<static void * run_queue(void *arg)>
+
+Thread body: take jobs from the C<job_queue> C<arg> and run them, until all
+jobs were taken. Returns NULL.
+
+=cut
+
+*/
+PARROT_CAN_RETURN_NULL
+static void *
+run_queue(ARGMOD(void *arg))
+{
+    ASSERT_ARGS(run_queue)
+    job_queue * const queue = (job_queue *)arg;
+
+    for (;;) {
+        unsigned index;
+
+        LOCK(queue->lock);
+        index = queue->next++;
+        UNLOCK(queue->lock);
+
+        if (index >= queue->numjobs)
+            break;
+
+        queue->run(queue->data, index);
+    }
+
+    return NULL;
+}
+
+/*
+
+=item C<void run_jobs(unsigned numjobs, unsigned numthreads, job_function run,
+void *data)>
+
+Run the jobs 0 up to C<numjobs> by calling C<run> with C<data> and the number
+of the job, on C<numthreads> threads, including the calling thread. Returns
+when all jobs are done. No more threads are used than there are jobs; if
+C<numthreads> is 1 or less, the jobs are run in order by the calling thread.
+
+=cut
+
+*/
+void
+run_jobs(unsigned numjobs, unsigned numthreads, NOTNULL(job_function run),
+         ARGIN_NULLOK(void *data))
+{
+    ASSERT_ARGS(run_jobs)
+    unsigned      index;
+#ifdef PARROT_HAS_THREADS
+    Parrot_thread threads[MAX_JOB_THREADS];
+    job_queue     queue;
+
+    if (numthreads > numjobs)
+        numthreads = numjobs;
+
+    if (numthreads > MAX_JOB_THREADS)
+        numthreads = MAX_JOB_THREADS;
+
+    if (numthreads > 1) {
+        queue.next    = 0;
+        queue.numjobs = numjobs;
+        queue.run     = run;
+        queue.data    = data;
+        MUTEX_INIT(queue.lock);
+
+        /* the calling thread is one of the threads */
+        for (index = 1; index < numthreads; ++index)
+            THREAD_CREATE_JOINABLE(threads[index], run_queue, &queue);
+
+        run_queue(&queue);
+
+        for (index = 1; index < numthreads; ++index) {
+            void *result;
+            JOIN(threads[index], result);
+        }
+
+        MUTEX_DESTROY(queue.lock);
+        return;
+    }
+#else
+    UNUSED(numthreads);
+#endif
+
+    for (index = 0; index < numjobs; ++index)
+        run(data, index);
+}
+
+/*
+
+=item C<static int take_job(job_pool *pool, unsigned number, unsigned *index)>
+
+Take the next job for thread C<number> of C<pool>, and store its number in
+C<index>: the first job of the thread's own queue or, if that is empty, the
+last job of the longest queue. Returns false if no jobs are left at all.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+take_job(ARGMOD(job_pool *pool), unsigned number, ARGOUT(unsigned *index))
+{
+    ASSERT_ARGS(take_job)
+    job_deque * const own = &pool->deques[number];
+
+    for (;;) {
+        job_deque *victim = NULL;
+        unsigned   most   = 0;
+        unsigned   other;
+
+        LOCK(own->lock);
+        if (own->head < own->tail) {
+            *index = number + own->head++ * pool->numthreads;
+            UNLOCK(own->lock);
+            return TRUE;
+        }
+        UNLOCK(own->lock);
+
+        /* the lengths may change while looking; that's checked below */
+        for (other = 0; other < pool->numthreads; ++other) {
+            job_deque * const deque = &pool->deques[other];
+            unsigned          left;
+
+            LOCK(deque->lock);
+            left = deque->tail - deque->head;
+            UNLOCK(deque->lock);
+
+            if (left > most) {
+                most   = left;
+                victim = deque;
+            }
+        }
+
+        if (victim == NULL)
+            return FALSE;
+
+        LOCK(victim->lock);
+        if (victim->head < victim->tail) {
+            *index = (unsigned)(victim - pool->deques) + --victim->tail * pool->numthreads;
+            UNLOCK(victim->lock);
+            return TRUE;
+        }
+        UNLOCK(victim->lock);
+
+        /* the victim's owner got there first; look again */
+    }
+}
+
+/*
+
+=item C<static void * run_deques(void *arg)>
+
+Thread body: run the jobs of the C<job_worker> C<arg>, and then those that
+can be stolen from the other threads, until no jobs are left. Returns NULL.
+
+=cut
+
+*/
+PARROT_CAN_RETURN_NULL
+static void *
+run_deques(ARGMOD(void *arg))
+{
+    ASSERT_ARGS(run_deques)
+    job_worker * const worker = (job_worker *)arg;
+    unsigned           index;
+
+    while (take_job(worker->pool, worker->number, &index))
+        worker->pool->run(worker->pool->data, index, worker->number);
+
+    return NULL;
+}
+
+/*
+
+=item C<void run_stealing_jobs(unsigned numjobs, unsigned numthreads,
+worker_function run, void *data)>
+
+Run the jobs 0 up to C<numjobs> by calling C<run> with C<data>, the number of
+the job and the number of the thread, on C<numthreads> threads, including the
+calling thread, which is thread 0. Jobs are dealt to the threads in turn, and
+threads that run out of jobs steal them from the others; number the jobs from
+large to small to keep all threads busy. Returns when all jobs are done. No
+more threads are used than there are jobs, so the thread number is less than
+both C<numjobs> and C<numthreads>; if C<numthreads> is 1 or less, the jobs are
+run in order by the calling thread.
+
+=cut
+
+*/
+void
+run_stealing_jobs(unsigned numjobs, unsigned numthreads, NOTNULL(worker_function run),
+                  ARGIN_NULLOK(void *data))
+{
+    ASSERT_ARGS(run_stealing_jobs)
+    unsigned      index;
+#ifdef PARROT_HAS_THREADS
+    Parrot_thread threads[MAX_JOB_THREADS];
+    job_worker    workers[MAX_JOB_THREADS];
+    job_pool      pool;
+
+    if (numthreads > numjobs)
+        numthreads = numjobs;
+
+    if (numthreads > MAX_JOB_THREADS)
+        numthreads = MAX_JOB_THREADS;
+
+    if (numthreads > 1) {
+        pool.numthreads = numthreads;
+        pool.run        = run;
+        pool.data       = data;
+
+        for (index = 0; index < numthreads; ++index) {
+            job_deque * const deque = &pool.deques[index];
+
+            /* thread index gets the jobs index, index + numthreads, and so on */
+            deque->head = 0;
+            deque->tail = (numjobs - index + numthreads - 1) / numthreads;
+            MUTEX_INIT(deque->lock);
+
+            workers[index].pool   = &pool;
+            workers[index].number = index;
+        }
+
+        /* the calling thread is thread 0 */
+        for (index = 1; index < numthreads; ++index)
+            THREAD_CREATE_JOINABLE(threads[index], run_deques, &workers[index]);
+
+        run_deques(&workers[0]);
+
+        for (index = 1; index < numthreads; ++index) {
+            void *result;
+            JOIN(threads[index], result);
+        }
+
+        for (index = 0; index < numthreads; ++index)
+            MUTEX_DESTROY(pool.deques[index].lock);
+
+        return;
+    }
+#else
+    UNUSED(numthreads);
+#endif
+
+    for (index = 0; index < numjobs; ++index)
+        run(data, index, 0);
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
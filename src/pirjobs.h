@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRJOBS_H_GUARD
+#define PARROT_PIR_PIRJOBS_H_GUARD
+
+#include "parrot/parrot.h"
+
+/* a job of run_jobs(); gets the data passed to run_jobs() and the number of the job */
+typedef void (*job_function)(void *data, unsigned index);
+
+/* a job of run_stealing_jobs(); also gets the number of the thread that runs it */
+typedef void (*worker_function)(void *data, unsigned index, unsigned thread);
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pirjobs.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+void run_jobs(
+    unsigned numjobs,
+    unsigned numthreads,
+    NOTNULL(job_function run),
+    ARGIN_NULLOK(void *data))
+        __attribute__nonnull__(3);
+
+void run_stealing_jobs(
+    unsigned numjobs,
+    unsigned numthreads,
+    NOTNULL(worker_function run),
+    ARGIN_NULLOK(void *data))
+        __attribute__nonnull__(3);
+
+#define ASSERT_ARGS_run_jobs __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(run))
+#define ASSERT_ARGS_run_stealing_jobs __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(run))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pirjobs.c */
+
+#endif /* PARROT_PIR_PIRJOBS_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
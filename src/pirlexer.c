@@ -1465,6 +1465,7 @@ are processed by a different preprocessor; see F<hdocprep.l>.
 #include "pircompiler.h"
 #include "pirmacro.h"
 #include "pirerr.h"
+#include "pirstats.h"
 
 #include "parrot/parrot.h"
 
@@ -1499,6 +1500,7 @@ static int is_pir_directive(char * const text);
 static macro_table *pop_macro_table(lexer_state * const lexer);
 static macro_table *peek_macro_table(lexer_state * const lexer);
 static char * munge_id(char const * const id, lexer_state * const lexer);
+static void scan_macro_body(yyscan_t yyscanner, macro_def * const macro);
 
 static void save_filestate(yyscan_t yyscanner);
 static int restore_filestate(yyscan_t yyscanner);
@@ -1543,7 +1545,7 @@ static int restore_filestate(yyscan_t yyscanner);
 
 /* The PASM state is an exclusive state, recognizing ONLY PASM tokens. */
 
-#line 1548 "pirlexer.c"
+#line 1550 "pirlexer.c"
 
 #define INITIAL 0
 #define MACROHEAD 1
@@ -1856,11 +1858,11 @@ YY_DECL
     struct yyguts_t * yyg = (struct yyguts_t*)yyscanner;
 
 /* %% [7.0] user's declarations go here */
-#line 223 "pir.l"
+#line 225 "pir.l"
 
 
 
-#line 1865 "pirlexer.c"
+#line 1867 "pirlexer.c"
 
     yylval = yylval_param;
 
@@ -1987,7 +1989,7 @@ do_action:	/* This label is used only to access EOF actions. */
 case 1:
 /* rule 1 can match eol */
 YY_RULE_SETUP
-#line 226 "pir.l"
+#line 228 "pir.l"
 { /* only when the scanning starts, is this state used. Only a single
                          * character is read, pushed back, and then, depending on the
                          * lexer flags, either PASM or PIR mode (INITIAL state) is activated.
@@ -2012,19 +2014,19 @@ YY_RULE_SETUP
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 248 "pir.l"
+#line 250 "pir.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 3:
 /* rule 3 can match eol */
 YY_RULE_SETUP
-#line 250 "pir.l"
+#line 252 "pir.l"
 { /* ignore line comments */ }
 	YY_BREAK
 case 4:
 /* rule 4 can match eol */
 YY_RULE_SETUP
-#line 252 "pir.l"
+#line 254 "pir.l"
 { /* a set of continuous newlines yields a single newline token. */
                     int index        = 0;
                     int num_newlines = 0;
@@ -2049,414 +2051,414 @@ YY_RULE_SETUP
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 274 "pir.l"
+#line 276 "pir.l"
 { return TK_ASSIGN_USHIFT; }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 275 "pir.l"
+#line 277 "pir.l"
 { return TK_USHIFT; }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 276 "pir.l"
+#line 278 "pir.l"
 { return TK_ASSIGN_RSHIFT; }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 277 "pir.l"
+#line 279 "pir.l"
 { return TK_RSHIFT; }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 278 "pir.l"
+#line 280 "pir.l"
 { return TK_LSHIFT; }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 279 "pir.l"
+#line 281 "pir.l"
 { return TK_ARROW; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 280 "pir.l"
+#line 282 "pir.l"
 { return TK_EQ; }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 281 "pir.l"
+#line 283 "pir.l"
 { return TK_NE; }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 282 "pir.l"
+#line 284 "pir.l"
 { return TK_LE; }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 283 "pir.l"
+#line 285 "pir.l"
 { return TK_GE; }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 284 "pir.l"
+#line 286 "pir.l"
 { return TK_LT; }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 285 "pir.l"
+#line 287 "pir.l"
 { return TK_GT; }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 287 "pir.l"
+#line 289 "pir.l"
 { return TK_FDIV; }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 288 "pir.l"
+#line 290 "pir.l"
 { return TK_AND; }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 289 "pir.l"
+#line 291 "pir.l"
 { return TK_OR; }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 290 "pir.l"
+#line 292 "pir.l"
 { return TK_XOR; }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 292 "pir.l"
+#line 294 "pir.l"
 { return '+'; }
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 293 "pir.l"
+#line 295 "pir.l"
 { return '%'; }
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 294 "pir.l"
+#line 296 "pir.l"
 { return '*'; }
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 295 "pir.l"
+#line 297 "pir.l"
 { return '/'; }
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 296 "pir.l"
+#line 298 "pir.l"
 { return '!'; }
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 297 "pir.l"
+#line 299 "pir.l"
 { return '~'; }
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 298 "pir.l"
+#line 300 "pir.l"
 { return '-'; }
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 299 "pir.l"
+#line 301 "pir.l"
 { return '('; }
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 300 "pir.l"
+#line 302 "pir.l"
 { return ')'; }
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 301 "pir.l"
+#line 303 "pir.l"
 { return ','; }
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 302 "pir.l"
+#line 304 "pir.l"
 { return '['; }
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 303 "pir.l"
+#line 305 "pir.l"
 { return ']'; }
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 305 "pir.l"
+#line 307 "pir.l"
 { /* if the dot is surrounded by whitespace, it's a concatenation operator */
                     return TK_CONC;
                   }
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 310 "pir.l"
+#line 312 "pir.l"
 { return '='; }
 	YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 311 "pir.l"
+#line 313 "pir.l"
 { return ';'; }
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 313 "pir.l"
+#line 315 "pir.l"
 { return TK_ASSIGN_INC; }
 	YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 314 "pir.l"
+#line 316 "pir.l"
 { return TK_ASSIGN_DEC; }
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 315 "pir.l"
+#line 317 "pir.l"
 { return TK_ASSIGN_DIV; }
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 316 "pir.l"
+#line 318 "pir.l"
 { return TK_ASSIGN_MUL; }
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 317 "pir.l"
+#line 319 "pir.l"
 { return TK_ASSIGN_MOD; }
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 318 "pir.l"
+#line 320 "pir.l"
 { return TK_ASSIGN_POW; }
 	YY_BREAK
 case 42:
 YY_RULE_SETUP
-#line 319 "pir.l"
+#line 321 "pir.l"
 { return TK_ASSIGN_BOR; }
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 320 "pir.l"
+#line 322 "pir.l"
 { return TK_ASSIGN_BAND; }
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 321 "pir.l"
+#line 323 "pir.l"
 { return TK_ASSIGN_FDIV; }
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 322 "pir.l"
+#line 324 "pir.l"
 { return TK_ASSIGN_BNOT; }
 	YY_BREAK
 case 46:
 YY_RULE_SETUP
-#line 323 "pir.l"
+#line 325 "pir.l"
 { return TK_ASSIGN_CONC; }
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 325 "pir.l"
+#line 327 "pir.l"
 { return TK_IF; }
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 326 "pir.l"
+#line 328 "pir.l"
 { return TK_GOTO; }
 	YY_BREAK
 case 49:
 YY_RULE_SETUP
-#line 327 "pir.l"
+#line 329 "pir.l"
 { return TK_UNLESS; }
 	YY_BREAK
 case 50:
 YY_RULE_SETUP
-#line 328 "pir.l"
+#line 330 "pir.l"
 { return TK_NULL; }
 	YY_BREAK
 case 51:
 YY_RULE_SETUP
-#line 330 "pir.l"
+#line 332 "pir.l"
 { return TK_INT; }
 	YY_BREAK
 case 52:
 YY_RULE_SETUP
-#line 331 "pir.l"
+#line 333 "pir.l"
 { return TK_NUM; }
 	YY_BREAK
 case 53:
 YY_RULE_SETUP
-#line 332 "pir.l"
+#line 334 "pir.l"
 { return TK_PMC; }
 	YY_BREAK
 case 54:
 YY_RULE_SETUP
-#line 333 "pir.l"
+#line 335 "pir.l"
 { return TK_STRING; }
 	YY_BREAK
 case 55:
 YY_RULE_SETUP
-#line 335 "pir.l"
+#line 337 "pir.l"
 { return TK_ANNOTATE; }
 	YY_BREAK
 case 56:
 YY_RULE_SETUP
-#line 336 "pir.l"
+#line 338 "pir.l"
 { return TK_SET_ARG; }
 	YY_BREAK
 case 57:
 YY_RULE_SETUP
-#line 337 "pir.l"
+#line 339 "pir.l"
 { return TK_CONST; }
 	YY_BREAK
 case 58:
 YY_RULE_SETUP
-#line 338 "pir.l"
+#line 340 "pir.l"
 { return TK_END; }
 	YY_BREAK
 case 59:
 YY_RULE_SETUP
-#line 339 "pir.l"
+#line 341 "pir.l"
 { return TK_FILE; }
 	YY_BREAK
 case 60:
 YY_RULE_SETUP
-#line 341 "pir.l"
+#line 343 "pir.l"
 { return TK_GET_RESULTS; }
 	YY_BREAK
 case 61:
 YY_RULE_SETUP
-#line 342 "pir.l"
+#line 344 "pir.l"
 { return TK_GLOBALCONST; }
 	YY_BREAK
 case 62:
 YY_RULE_SETUP
-#line 343 "pir.l"
+#line 345 "pir.l"
 { return TK_HLL; }
 	YY_BREAK
 case 63:
 YY_RULE_SETUP
-#line 344 "pir.l"
+#line 346 "pir.l"
 { return TK_INVOCANT; }
 	YY_BREAK
 case 64:
 YY_RULE_SETUP
-#line 345 "pir.l"
+#line 347 "pir.l"
 { return TK_LEX; }
 	YY_BREAK
 case 65:
 YY_RULE_SETUP
-#line 346 "pir.l"
+#line 348 "pir.l"
 { return TK_LINE; }
 	YY_BREAK
 case 66:
 YY_RULE_SETUP
-#line 347 "pir.l"
+#line 349 "pir.l"
 { return TK_LOADLIB; }
 	YY_BREAK
 case 67:
 YY_RULE_SETUP
-#line 348 "pir.l"
+#line 350 "pir.l"
 { return TK_LOCAL; }
 	YY_BREAK
 case 68:
 YY_RULE_SETUP
-#line 350 "pir.l"
+#line 352 "pir.l"
 { return TK_METH_CALL; }
 	YY_BREAK
 case 69:
 YY_RULE_SETUP
-#line 351 "pir.l"
+#line 353 "pir.l"
 { return TK_NAMESPACE; }
 	YY_BREAK
 case 70:
 YY_RULE_SETUP
-#line 352 "pir.l"
+#line 354 "pir.l"
 { return TK_NCI_CALL; }
 	YY_BREAK
 case 71:
 YY_RULE_SETUP
-#line 353 "pir.l"
+#line 355 "pir.l"
 { return TK_PARAM; }
 	YY_BREAK
 case 72:
 YY_RULE_SETUP
-#line 354 "pir.l"
+#line 356 "pir.l"
 { return TK_BEGIN_CALL; }
 	YY_BREAK
 case 73:
 YY_RULE_SETUP
-#line 355 "pir.l"
+#line 357 "pir.l"
 { return TK_BEGIN_RETURN; }
 	YY_BREAK
 case 74:
 YY_RULE_SETUP
-#line 356 "pir.l"
+#line 358 "pir.l"
 { return TK_BEGIN_YIELD; }
 	YY_BREAK
 case 75:
 YY_RULE_SETUP
-#line 357 "pir.l"
+#line 359 "pir.l"
 { return TK_CALL; }
 	YY_BREAK
 case 76:
 YY_RULE_SETUP
-#line 358 "pir.l"
+#line 360 "pir.l"
 { return TK_END_CALL; }
 	YY_BREAK
 case 77:
 YY_RULE_SETUP
-#line 359 "pir.l"
+#line 361 "pir.l"
 { return TK_END_RETURN; }
 	YY_BREAK
 case 78:
 YY_RULE_SETUP
-#line 360 "pir.l"
+#line 362 "pir.l"
 { return TK_END_YIELD; }
 	YY_BREAK
 case 79:
 YY_RULE_SETUP
-#line 361 "pir.l"
+#line 363 "pir.l"
 { return TK_GET_RESULT; }
 	YY_BREAK
 case 80:
 YY_RULE_SETUP
-#line 362 "pir.l"
+#line 364 "pir.l"
 { return TK_RETURN; }
 	YY_BREAK
 case 81:
 YY_RULE_SETUP
-#line 363 "pir.l"
-{ return TK_SUB; }
+#line 365 "pir.l"
+{ ++yyget_extra(yyscanner)->open_subs; return TK_SUB; }
 	YY_BREAK
 case 82:
 YY_RULE_SETUP
-#line 364 "pir.l"
+#line 366 "pir.l"
 { return TK_YIELD; }
 	YY_BREAK
 case 83:
 YY_RULE_SETUP
-#line 365 "pir.l"
+#line 367 "pir.l"
 { return TK_SET_RETURN; }
 	YY_BREAK
 case 84:
 YY_RULE_SETUP
-#line 366 "pir.l"
+#line 368 "pir.l"
 { return TK_SET_YIELD; }
 	YY_BREAK
 case 85:
 YY_RULE_SETUP
-#line 367 "pir.l"
+#line 369 "pir.l"
 { return TK_TAILCALL; }
 	YY_BREAK
 case 86:
 YY_RULE_SETUP
-#line 370 "pir.l"
+#line 372 "pir.l"
 { /* make sure these are not used outside macro defs */
                     yypirerror(yyscanner, yypirget_extra(yyscanner),
                                "cannot use '%s' outside of macro definitions", yytext);
@@ -2464,124 +2466,124 @@ YY_RULE_SETUP
 	YY_BREAK
 case 87:
 YY_RULE_SETUP
-#line 377 "pir.l"
+#line 379 "pir.l"
 { return TK_FLAG_ANON; }
 	YY_BREAK
 case 88:
 YY_RULE_SETUP
-#line 378 "pir.l"
+#line 380 "pir.l"
 { return TK_FLAG_INIT; }
 	YY_BREAK
 case 89:
 YY_RULE_SETUP
-#line 379 "pir.l"
+#line 381 "pir.l"
 { return TK_FLAG_LOAD; }
 	YY_BREAK
 case 90:
 YY_RULE_SETUP
-#line 380 "pir.l"
+#line 382 "pir.l"
 { return TK_FLAG_POSTCOMP; }
 	YY_BREAK
 case 91:
 YY_RULE_SETUP
-#line 381 "pir.l"
+#line 383 "pir.l"
 { return TK_FLAG_IMMEDIATE; }
 	YY_BREAK
 case 92:
 YY_RULE_SETUP
-#line 382 "pir.l"
+#line 384 "pir.l"
 { return TK_FLAG_MAIN; }
 	YY_BREAK
 case 93:
 YY_RULE_SETUP
-#line 383 "pir.l"
+#line 385 "pir.l"
 { return TK_FLAG_METHOD; }
 	YY_BREAK
 case 94:
 YY_RULE_SETUP
-#line 384 "pir.l"
+#line 386 "pir.l"
 { return TK_FLAG_LEX; }
 	YY_BREAK
 case 95:
 YY_RULE_SETUP
-#line 385 "pir.l"
+#line 387 "pir.l"
 { return TK_FLAG_OUTER; }
 	YY_BREAK
 case 96:
 YY_RULE_SETUP
-#line 386 "pir.l"
+#line 388 "pir.l"
 { return TK_FLAG_VTABLE; }
 	YY_BREAK
 case 97:
 YY_RULE_SETUP
-#line 387 "pir.l"
+#line 389 "pir.l"
 { return TK_FLAG_MULTI; }
 	YY_BREAK
 case 98:
 YY_RULE_SETUP
-#line 388 "pir.l"
+#line 390 "pir.l"
 { return TK_FLAG_SUBID; }
 	YY_BREAK
 case 99:
 YY_RULE_SETUP
-#line 389 "pir.l"
+#line 391 "pir.l"
 { return TK_FLAG_INSTANCEOF; }
 	YY_BREAK
 case 100:
 YY_RULE_SETUP
-#line 390 "pir.l"
+#line 392 "pir.l"
 { return TK_FLAG_NSENTRY; }
 	YY_BREAK
 case 101:
 YY_RULE_SETUP
-#line 392 "pir.l"
+#line 394 "pir.l"
 { return TK_FLAG_UNIQUE_REG; }
 	YY_BREAK
 case 102:
 YY_RULE_SETUP
-#line 393 "pir.l"
+#line 395 "pir.l"
 { return TK_FLAG_OPTIONAL; }
 	YY_BREAK
 case 103:
 YY_RULE_SETUP
-#line 394 "pir.l"
+#line 396 "pir.l"
 { return TK_FLAG_OPT_FLAG; }
 	YY_BREAK
 case 104:
 YY_RULE_SETUP
-#line 395 "pir.l"
+#line 397 "pir.l"
 { return TK_FLAG_SLURPY; }
 	YY_BREAK
 case 105:
 YY_RULE_SETUP
-#line 396 "pir.l"
+#line 398 "pir.l"
 { return TK_FLAG_NAMED; }
 	YY_BREAK
 case 106:
 YY_RULE_SETUP
-#line 397 "pir.l"
+#line 399 "pir.l"
 { return TK_FLAG_FLAT; }
 	YY_BREAK
 case 107:
 YY_RULE_SETUP
-#line 398 "pir.l"
+#line 400 "pir.l"
 { return TK_FLAG_INVOCANT; }
 	YY_BREAK
 case 108:
 YY_RULE_SETUP
-#line 399 "pir.l"
+#line 401 "pir.l"
 { return TK_FLAG_LOOKAHEAD; }
 	YY_BREAK
 case 109:
 YY_RULE_SETUP
-#line 401 "pir.l"
+#line 403 "pir.l"
 { yypirerror(yyscanner, yypirget_extra(yyscanner),
                                "unrecognized flag: '%s'", yytext);
                   }
 	YY_BREAK
 case 110:
 YY_RULE_SETUP
-#line 405 "pir.l"
+#line 407 "pir.l"
 { /* XXX this is a bit hacky. First the string is unescaped, but that
                      * returns a STRING * object; that's not what we want at this point.
                      * So, convert it back to a C string, and return that. Later, that
@@ -2595,6 +2597,8 @@ YY_RULE_SETUP
 
                     char *str = Parrot_str_to_cstring(lexer->interp, pstr);
 
+                    COUNT_STRING(lexer, pstr);
+
                     yylval->sval = str;
                     
                     /* store the STRING in lexer's sval buffer; once PIRC is doing
@@ -2606,11 +2610,12 @@ YY_RULE_SETUP
 	YY_BREAK
 case 111:
 YY_RULE_SETUP
-#line 427 "pir.l"
+#line 431 "pir.l"
 { /* copy the string, remove the quotes. */
                     lexer_state * const lexer = yypirget_extra(yyscanner);
                     
                     STRING *str = Parrot_str_unescape(lexer->interp, yytext + 1, '\'', "ascii");
+                    COUNT_STRING(lexer, str);
                     lexer->sval = str;
                     
                     yylval->sval = dupstrn(lexer, yytext + 1, yyleng - 2);
@@ -2621,16 +2626,15 @@ YY_RULE_SETUP
 	YY_BREAK
 case 112:
 YY_RULE_SETUP
-#line 439 "pir.l"
+#line 444 "pir.l"
 { /* XXX these double-quoted strings are not unescaped (yet) */
                     /* parse yytext, which contains the charset, a ':', and the quoted string */
                     char        *colon = strchr(yytext, ':');
                     lexer_state *lexer = yypirget_extra(yyscanner);
-                    ucstring    *ustr  = (ucstring *)pir_mem_allocate(lexer, sizeof (ucstring));
+                    ucstring    *ustr  = (ucstring *)pir_mem_allocate(lexer, sizeof (ucstring),
+                                                                     ALLOC_CONSTANT);
                     /* copy the charset part */
                     ustr->charset      = dupstrn(lexer, yytext, colon - yytext);
-                    /* the colon becomes a NULL character to end the encoding string */
-                    *colon = '\0';
                     /* copy the string contents, strip the quotes. Example:
                      *   iso-8859-1:"hi there"
                      *   123456789012345678901
@@ -2653,7 +2657,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 113:
 YY_RULE_SETUP
-#line 468 "pir.l"
+#line 472 "pir.l"
 { /* XXX these double-quoted strings are not unescaped (yet) */
                     /* parse yytext, which contains the encoding, a ':', a charset,
                      * a ':', and the quoted string
@@ -2661,7 +2665,8 @@ YY_RULE_SETUP
                     char        *colon1 = strchr(yytext, ':');
                     char        *colon2;
                     lexer_state *lexer = yypirget_extra(yyscanner);
-                    ucstring    *ustr  = (ucstring *)pir_mem_allocate(lexer, sizeof (ucstring));
+                    ucstring    *ustr  = (ucstring *)pir_mem_allocate(lexer, sizeof (ucstring),
+                                                                     ALLOC_CONSTANT);
 
                     /* yytext has the following structure:
                      *
@@ -2680,8 +2685,6 @@ YY_RULE_SETUP
 
                     /* look for the second colon after this one */
                     colon2 = strchr(colon1 + 1, ':');
-                    /* the colon becomes a NULL character to end the encoding string */
-                    *colon1 = '\0';
 
                     ustr->charset  = dupstrn(lexer, colon1 + 1, colon2 - colon1 - 1);
 
@@ -2703,30 +2706,31 @@ YY_RULE_SETUP
 	YY_BREAK
 case 114:
 YY_RULE_SETUP
-#line 516 "pir.l"
+#line 519 "pir.l"
 { yylval->ival = atoi(yytext + 2); return TK_PREG; }
 	YY_BREAK
 case 115:
 YY_RULE_SETUP
-#line 517 "pir.l"
+#line 520 "pir.l"
 { yylval->ival = atoi(yytext + 2); return TK_SREG; }
 	YY_BREAK
 case 116:
 YY_RULE_SETUP
-#line 518 "pir.l"
+#line 521 "pir.l"
 { yylval->ival = atoi(yytext + 2); return TK_NREG; }
 	YY_BREAK
 case 117:
 YY_RULE_SETUP
-#line 519 "pir.l"
+#line 522 "pir.l"
 { yylval->ival = atoi(yytext + 2); return TK_IREG; }
 	YY_BREAK
 case 118:
 YY_RULE_SETUP
-#line 521 "pir.l"
+#line 524 "pir.l"
 { /* make the label Id available in the parser. remove the ":" first. */
                     lexer_state * const lexer = yypirget_extra(yyscanner);
                     STRING *str = Parrot_str_new(lexer->interp, yytext, yyleng - 1);
+                    COUNT_STRING(lexer, str);
                     lexer->sval = str;
                     
                     yylval->sval = dupstrn(yypirget_extra(yyscanner), yytext, yyleng - 1);
@@ -2735,7 +2739,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 119:
 YY_RULE_SETUP
-#line 530 "pir.l"
+#line 534 "pir.l"
 { /* give a warning when using PASM registers as PIR identifiers */
                     lexer_state * const lexer = yypirget_extra(yyscanner);
 
@@ -2750,7 +2754,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 120:
 YY_RULE_SETUP
-#line 542 "pir.l"
+#line 546 "pir.l"
 { /* identifier; can be a global (sub or const), local or parrot op */
                     lexer_state * const lexer = yypirget_extra(yyscanner);
                     constdecl   * const c = find_global_constant(lexer, yytext);
@@ -2775,6 +2779,7 @@ YY_RULE_SETUP
                         }
                     }
                     lexer->sval = Parrot_str_new(lexer->interp, yytext, yyleng);
+                    COUNT_STRING(lexer, lexer->sval);
                     					
                     yylval->sval = dupstr(lexer, yytext);
                     return TK_IDENT;
@@ -2782,27 +2787,27 @@ YY_RULE_SETUP
 	YY_BREAK
 case 121:
 YY_RULE_SETUP
-#line 571 "pir.l"
+#line 576 "pir.l"
 { yylval->dval = atof(yytext); return TK_NUMC; }
 	YY_BREAK
 case 122:
 YY_RULE_SETUP
-#line 572 "pir.l"
+#line 577 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 123:
 YY_RULE_SETUP
-#line 573 "pir.l"
+#line 578 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 124:
 YY_RULE_SETUP
-#line 574 "pir.l"
+#line 579 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 125:
 YY_RULE_SETUP
-#line 575 "pir.l"
+#line 580 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 126:
@@ -2810,7 +2815,7 @@ case 126:
 yyg->yy_c_buf_p = yy_cp = yy_bp + 1;
 YY_DO_BEFORE_ACTION; /* set up yytext again */
 YY_RULE_SETUP
-#line 577 "pir.l"
+#line 582 "pir.l"
 { /* Make sure the dot is followed by a character that
                      * starts a method object. $ for registers,
                      * quotes for quoted strings, and letters for identifiers.
@@ -2822,7 +2827,7 @@ YY_RULE_SETUP
 case 127:
 /* rule 127 can match eol */
 YY_RULE_SETUP
-#line 585 "pir.l"
+#line 590 "pir.l"
 { yypirerror(yyscanner, yypirget_extra(yyscanner),
                     "no space allowed before a methodcall dot, "
                     "or space expected after the '.' operator");
@@ -2845,20 +2850,23 @@ YY_RULE_SETUP
 
 
 case YY_STATE_EOF(SCANSTR):
-#line 607 "pir.l"
+#line 612 "pir.l"
 { /* switch back from .macro_const buffer to file. */
                      lexer_state * const lexer = yypirget_extra(yyscanner);
+                     YY_BUFFER_STATE     done  = YY_CURRENT_BUFFER;
                      yy_pop_state(yyscanner);
                      yypir_switch_to_buffer(lexer->buffer,yyscanner);
+                     yypir_delete_buffer(done,yyscanner);
                    }
 	YY_BREAK
 case YY_STATE_EOF(SCANMACRO):
-#line 613 "pir.l"
+#line 620 "pir.l"
 { /* override the default <<EOF>> action; go back to normal state and
                       * switch back to the saved file.
                       */
                      lexer_state * const lexer = yypirget_extra(yyscanner);
                      macro_table * const table = pop_macro_table(lexer);
+                     YY_BUFFER_STATE     done  = YY_CURRENT_BUFFER;
 
                      yy_pop_state(yyscanner); /* pop off the SCANMACRO scanner state */
 
@@ -2866,6 +2874,7 @@ case YY_STATE_EOF(SCANMACRO):
                       * to read the macro's buffer.
                       */
                      yypir_switch_to_buffer(table->prev_buff,yyscanner);
+                     yypir_delete_buffer(done,yyscanner);
 
                      /* restore line number */
                      yypirset_lineno(table->lineno,yyscanner);
@@ -2879,7 +2888,7 @@ case YY_STATE_EOF(SCANMACRO):
 	YY_BREAK
 case 128:
 YY_RULE_SETUP
-#line 636 "pir.l"
+#line 645 "pir.l"
 { /* when scanning a macro body, the @ marker indicates the {IDENT} must
                           * be munged.
                           */
@@ -2890,14 +2899,14 @@ YY_RULE_SETUP
                        }
 	YY_BREAK
 case YY_STATE_EOF(INITIAL):
-#line 645 "pir.l"
+#line 654 "pir.l"
 { /* end of file, stop scanning. */
                     yyterminate();
                   }
 	YY_BREAK
 case 129:
 YY_RULE_SETUP
-#line 649 "pir.l"
+#line 658 "pir.l"
 { /* any character not covered in the rules above is an error. */
                     yypirerror(yyscanner, yypirget_extra(yyscanner),
                                "unexpected character: '%c'", yytext[0]);
@@ -2918,7 +2927,7 @@ YY_RULE_SETUP
 
 case 130:
 YY_RULE_SETUP
-#line 671 "pir.l"
+#line 680 "pir.l"
 {
                                yy_push_state(MACROCONST, yyscanner);
                                return TK_MACRO_CONST;
@@ -2926,7 +2935,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 131:
 YY_RULE_SETUP
-#line 676 "pir.l"
+#line 685 "pir.l"
 {
                                yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
                                return TK_IDENT;
@@ -2934,7 +2943,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 132:
 YY_RULE_SETUP
-#line 681 "pir.l"
+#line 690 "pir.l"
 {
                                /* only these tokens can be macro constant values */
                                yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
@@ -2944,19 +2953,19 @@ YY_RULE_SETUP
 	YY_BREAK
 case 133:
 YY_RULE_SETUP
-#line 688 "pir.l"
+#line 697 "pir.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 134:
 YY_RULE_SETUP
-#line 689 "pir.l"
+#line 698 "pir.l"
 {
                                yypirerror(yyscanner, yypirget_extra(yyscanner),
                                           "unknown character: '%c'", yytext[0]);
                              }
 	YY_BREAK
 case YY_STATE_EOF(MACROCONST):
-#line 693 "pir.l"
+#line 702 "pir.l"
 {
                                yypirerror(yyscanner, yypirget_extra(yyscanner),
                                           "read end of file during .macro_const definition");
@@ -2969,7 +2978,7 @@ case YY_STATE_EOF(MACROCONST):
 
 case 135:
 YY_RULE_SETUP
-#line 704 "pir.l"
+#line 713 "pir.l"
 { /* start a macro definition */
                                yy_push_state(MACROHEAD, yyscanner);
                                return TK_MACRO;
@@ -2977,12 +2986,12 @@ YY_RULE_SETUP
 	YY_BREAK
 case 136:
 YY_RULE_SETUP
-#line 709 "pir.l"
+#line 718 "pir.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 137:
 YY_RULE_SETUP
-#line 710 "pir.l"
+#line 719 "pir.l"
 {
                                yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
                                return TK_IDENT;
@@ -2990,23 +2999,23 @@ YY_RULE_SETUP
 	YY_BREAK
 case 138:
 YY_RULE_SETUP
-#line 715 "pir.l"
+#line 724 "pir.l"
 { return '('; }
 	YY_BREAK
 case 139:
 YY_RULE_SETUP
-#line 716 "pir.l"
+#line 725 "pir.l"
 { return ')'; }
 	YY_BREAK
 case 140:
 YY_RULE_SETUP
-#line 717 "pir.l"
+#line 726 "pir.l"
 { return ','; }
 	YY_BREAK
 case 141:
 /* rule 141 can match eol */
 YY_RULE_SETUP
-#line 719 "pir.l"
+#line 728 "pir.l"
 { /* a set of continuous newlines yields a single newline token. */
                                yy_pop_state(yyscanner); /* remove MACROHEAD state */
                                yy_push_state(MACROBODY, yyscanner); /* enter MACROBODY state */
@@ -3024,7 +3033,7 @@ YY_RULE_SETUP
 
 case 142:
 YY_RULE_SETUP
-#line 735 "pir.l"
+#line 744 "pir.l"
 { /* .foo; it can be a macro, macro_local, or just $P0.foo(),
                                 * but we need to check that.
                                 */
@@ -3037,8 +3046,8 @@ YY_RULE_SETUP
                                    macro_table *table = peek_macro_table(lexer);
 
                                    if (table->thismacro != NULL) { /* not expanding a macro */
-
-                                       if (is_macro_local(table->thismacro, yytext + 1)) {
+                                       char const * const name = dupstr(lexer, yytext + 1);
+                                       if (is_macro_local(table->thismacro, name)) {
                                            yylval->sval = munge_id(yytext + 1, lexer);
                                            return TK_IDENT;
                                        }
@@ -3074,14 +3083,14 @@ YY_RULE_SETUP
                                            * adding this to the grammar. */
                                        /* goto SCANSTR state, and scan macro->body */
                                        yy_push_state(SCANSTR, yyscanner);
-                                       yypir_scan_string(macro->body,yyscanner);
+                                       scan_macro_body(yyscanner, macro);
                                    }
                                }
                              }
 	YY_BREAK
 case 143:
 YY_RULE_SETUP
-#line 789 "pir.l"
+#line 798 "pir.l"
 { /* expand a .macro_const or parameter in argument list */
                                lexer_state * const lexer = yypirget_extra(yyscanner);
                                macro_def   * const macro = find_macro(lexer->macros, yytext + 1);
@@ -3103,7 +3112,7 @@ YY_RULE_SETUP
                                    else { /* we do allow expansion of .macro_consts as macro args */
                                        lexer->buffer = YY_CURRENT_BUFFER;
                                        yy_push_state(STRINGEXPAND, yyscanner);
-                                       yypir_scan_string(macro->body,yyscanner);
+                                       scan_macro_body(yyscanner, macro);
                                    }
                                }
                                else
@@ -3112,7 +3121,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 144:
 YY_RULE_SETUP
-#line 817 "pir.l"
+#line 826 "pir.l"
 {
                                yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
                                return TK_MACRO_ARG_IDENT;
@@ -3120,7 +3129,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 145:
 YY_RULE_SETUP
-#line 822 "pir.l"
+#line 831 "pir.l"
 {
                                yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
                                return TK_MACRO_ARG_OTHER;
@@ -3128,22 +3137,22 @@ YY_RULE_SETUP
 	YY_BREAK
 case 146:
 YY_RULE_SETUP
-#line 827 "pir.l"
+#line 836 "pir.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 147:
 YY_RULE_SETUP
-#line 828 "pir.l"
+#line 837 "pir.l"
 { return ','; }
 	YY_BREAK
 case 148:
 YY_RULE_SETUP
-#line 829 "pir.l"
+#line 838 "pir.l"
 { return '('; }
 	YY_BREAK
 case 149:
 YY_RULE_SETUP
-#line 830 "pir.l"
+#line 839 "pir.l"
 {
                                yy_pop_state(yyscanner); /* leave MACROEXPAND state */
                                return ')';
@@ -3151,39 +3160,41 @@ YY_RULE_SETUP
 	YY_BREAK
 case 150:
 YY_RULE_SETUP
-#line 835 "pir.l"
+#line 844 "pir.l"
 {
                                yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
                                return TK_MACRO_ARG_OTHER;
                              }
 	YY_BREAK
 case YY_STATE_EOF(STRINGEXPAND):
-#line 840 "pir.l"
+#line 849 "pir.l"
 {
                                lexer_state * const lexer = yypirget_extra(yyscanner);
+                               YY_BUFFER_STATE     done  = YY_CURRENT_BUFFER;
                                yy_pop_state(yyscanner);
                                yypir_switch_to_buffer(lexer->buffer,yyscanner);
+                               yypir_delete_buffer(done,yyscanner);
                              }
 	YY_BREAK
 case 151:
 YY_RULE_SETUP
-#line 846 "pir.l"
+#line 857 "pir.l"
 { return '{'; }
 	YY_BREAK
 case 152:
 YY_RULE_SETUP
-#line 847 "pir.l"
+#line 858 "pir.l"
 { return '}'; }
 	YY_BREAK
 case 153:
 /* rule 153 can match eol */
 YY_RULE_SETUP
-#line 849 "pir.l"
+#line 860 "pir.l"
 { yylval->sval = "\n"; return TK_NL; }
 	YY_BREAK
 case 154:
 YY_RULE_SETUP
-#line 851 "pir.l"
+#line 862 "pir.l"
 { yypirerror(yyscanner, yypirget_extra(yyscanner),
                                           "unknown character in macro expansion: %c", yytext[0]);
                              }
@@ -3195,7 +3206,7 @@ YY_RULE_SETUP
 
 case 155:
 YY_RULE_SETUP
-#line 862 "pir.l"
+#line 873 "pir.l"
 { /* give a warning if the right flag is set */
                               /*
                               lexer_state * const lexer = yypirget_extra(yyscanner);
@@ -3211,7 +3222,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 156:
 YY_RULE_SETUP
-#line 876 "pir.l"
+#line 887 "pir.l"
 {
                               yy_push_state(MACROLOCAL, yyscanner);
                               return TK_MACRO_LOCAL;
@@ -3219,27 +3230,27 @@ YY_RULE_SETUP
 	YY_BREAK
 case 157:
 YY_RULE_SETUP
-#line 881 "pir.l"
+#line 892 "pir.l"
 { return TK_INT; }
 	YY_BREAK
 case 158:
 YY_RULE_SETUP
-#line 882 "pir.l"
+#line 893 "pir.l"
 { return TK_PMC; }
 	YY_BREAK
 case 159:
 YY_RULE_SETUP
-#line 883 "pir.l"
+#line 894 "pir.l"
 { return TK_NUM; }
 	YY_BREAK
 case 160:
 YY_RULE_SETUP
-#line 884 "pir.l"
+#line 895 "pir.l"
 { return TK_STRING; }
 	YY_BREAK
 case 161:
 YY_RULE_SETUP
-#line 886 "pir.l"
+#line 897 "pir.l"
 { /* normal .macro_local */
                               lexer_state * const lexer = yypirget_extra(yyscanner);
                               /* reserve space for {IDENT}, the @ marker and the NULL char. */
@@ -3257,7 +3268,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 162:
 YY_RULE_SETUP
-#line 901 "pir.l"
+#line 912 "pir.l"
 { /* declare a .macro_local based on a parameter */
                               lexer_state * const lexer = yypirget_extra(yyscanner);
 
@@ -3274,7 +3285,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 163:
 YY_RULE_SETUP
-#line 915 "pir.l"
+#line 926 "pir.l"
 { /* .$foo */
                               lexer_state * const lexer = yypirget_extra(yyscanner);
                               macro_table * const table = peek_macro_table(lexer);
@@ -3306,7 +3317,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 164:
 YY_RULE_SETUP
-#line 944 "pir.l"
+#line 955 "pir.l"
 { /* expanding a .macro_local using a macro parameter value */
                              lexer_state * const lexer     = yypirget_extra(yyscanner);
                              char  const * const paramname = dupstrn(lexer, yytext + 1, yyleng - 2);
@@ -3334,13 +3345,13 @@ YY_RULE_SETUP
 	YY_BREAK
 case 165:
 YY_RULE_SETUP
-#line 969 "pir.l"
+#line 980 "pir.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 166:
 /* rule 166 can match eol */
 YY_RULE_SETUP
-#line 971 "pir.l"
+#line 982 "pir.l"
 { /* newline after .macro_local <type> <ident> line */
                               yy_pop_state(yyscanner);
                               return TK_NL;
@@ -3348,7 +3359,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 167:
 YY_RULE_SETUP
-#line 976 "pir.l"
+#line 987 "pir.l"
 { /* this state is only used for declaring .macro_locals */
                               yypirerror(yyscanner, yypirget_extra(yyscanner),
                                  "unknown character '%c' when declaring .macro_local", yytext[0]);
@@ -3361,7 +3372,7 @@ YY_RULE_SETUP
 
 case 168:
 YY_RULE_SETUP
-#line 986 "pir.l"
+#line 997 "pir.l"
 {
                               yy_push_state(MACROLABEL, yyscanner);
                               return TK_MACRO_LABEL;
@@ -3369,13 +3380,14 @@ YY_RULE_SETUP
 	YY_BREAK
 case 169:
 YY_RULE_SETUP
-#line 991 "pir.l"
+#line 1002 "pir.l"
 { /* if the "$" is there, it's a macro label using a macro
                                * parameter's value; otherwise it's a normal macro label
                                */
                               lexer_state * const lexer = yypirget_extra(yyscanner);
                               char * temp = (char *)pir_mem_allocate(lexer,
-                                                                     (yyleng + 2) * sizeof (char));
+                                                                     (yyleng + 2) * sizeof (char),
+                                                                     ALLOC_STRING);
                               /* stick a special marker "@" so we can recognize this as a label
                                * that must be munged.
                                */
@@ -3390,7 +3402,7 @@ YY_RULE_SETUP
 case 170:
 /* rule 170 can match eol */
 YY_RULE_SETUP
-#line 1009 "pir.l"
+#line 1021 "pir.l"
 { /* the newline character after a ".macro_label $foo:" declaration */
                               yy_pop_state(yyscanner); /* leave MACROLABEL state */
                               return TK_NL;
@@ -3398,7 +3410,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 171:
 YY_RULE_SETUP
-#line 1015 "pir.l"
+#line 1027 "pir.l"
 { /* scan a label when expanding a buffer; declared as .macro_label */
                               lexer_state * const lexer = yypirget_extra(yyscanner);
                               char const  * const label = dupstrn(lexer, yytext, yyleng - 2);
@@ -3408,7 +3420,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 172:
 YY_RULE_SETUP
-#line 1022 "pir.l"
+#line 1034 "pir.l"
 { /* scan a label when expanding macro; was a macro parameter */
                              lexer_state * const lexer     = yypirget_extra(yyscanner);
                              char const  * const paramname = dupstrn(lexer, yytext + 1, yyleng - 3);
@@ -3443,12 +3455,12 @@ YY_RULE_SETUP
 case 173:
 /* rule 173 can match eol */
 YY_RULE_SETUP
-#line 1055 "pir.l"
+#line 1067 "pir.l"
 { store_macro_char(CURRENT_MACRO(yypirget_extra(yyscanner)), '\n'); }
 	YY_BREAK
 case 174:
 YY_RULE_SETUP
-#line 1057 "pir.l"
+#line 1069 "pir.l"
 {
                                yy_pop_state(yyscanner); /* leave MACROBODY state */
                                return TK_ENDM;
@@ -3456,13 +3468,13 @@ YY_RULE_SETUP
 	YY_BREAK
 case 175:
 YY_RULE_SETUP
-#line 1062 "pir.l"
+#line 1074 "pir.l"
 { /* store everything else */
                                store_macro_char(CURRENT_MACRO(yypirget_extra(yyscanner)), yytext[0]);
                              }
 	YY_BREAK
 case YY_STATE_EOF(MACROBODY):
-#line 1066 "pir.l"
+#line 1078 "pir.l"
 { /* catch run-away macro bodys */
                                yypirerror(yyscanner, yypirget_extra(yyscanner),
                                           "read end of file while reading macro body");
@@ -3494,67 +3506,67 @@ case YY_STATE_EOF(MACROBODY):
 
 case 176:
 YY_RULE_SETUP
-#line 1098 "pir.l"
+#line 1110 "pir.l"
 { return ','; }
 	YY_BREAK
 case 177:
 YY_RULE_SETUP
-#line 1099 "pir.l"
+#line 1111 "pir.l"
 { return '['; }
 	YY_BREAK
 case 178:
 YY_RULE_SETUP
-#line 1100 "pir.l"
+#line 1112 "pir.l"
 { return ']'; }
 	YY_BREAK
 case 179:
 YY_RULE_SETUP
-#line 1102 "pir.l"
+#line 1114 "pir.l"
 { return TK_FLAG_MAIN; }
 	YY_BREAK
 case 180:
 YY_RULE_SETUP
-#line 1103 "pir.l"
+#line 1115 "pir.l"
 { return TK_FLAG_LOAD; }
 	YY_BREAK
 case 181:
 YY_RULE_SETUP
-#line 1104 "pir.l"
+#line 1116 "pir.l"
 { return TK_FLAG_INIT; }
 	YY_BREAK
 case 182:
 YY_RULE_SETUP
-#line 1105 "pir.l"
+#line 1117 "pir.l"
 { return TK_FLAG_ANON; }
 	YY_BREAK
 case 183:
 YY_RULE_SETUP
-#line 1106 "pir.l"
+#line 1118 "pir.l"
 { return TK_FLAG_POSTCOMP; }
 	YY_BREAK
 case 184:
 YY_RULE_SETUP
-#line 1107 "pir.l"
+#line 1119 "pir.l"
 { return TK_FLAG_IMMEDIATE; }
 	YY_BREAK
 case 185:
 YY_RULE_SETUP
-#line 1109 "pir.l"
+#line 1121 "pir.l"
 { return TK_PCC_SUB; }
 	YY_BREAK
 case 186:
 YY_RULE_SETUP
-#line 1110 "pir.l"
+#line 1122 "pir.l"
 { return TK_LEX; }
 	YY_BREAK
 case 187:
 YY_RULE_SETUP
-#line 1111 "pir.l"
+#line 1123 "pir.l"
 { return TK_NAMESPACE; }
 	YY_BREAK
 case 188:
 YY_RULE_SETUP
-#line 1113 "pir.l"
+#line 1125 "pir.l"
 {
                           yy_push_state(MACROHEAD, yyscanner);
                           return TK_MACRO;
@@ -3562,7 +3574,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 189:
 YY_RULE_SETUP
-#line 1118 "pir.l"
+#line 1130 "pir.l"
 {
                           yy_push_state(MACROCONST, yyscanner);
                           return TK_MACRO_CONST;
@@ -3570,17 +3582,17 @@ YY_RULE_SETUP
 	YY_BREAK
 case 190:
 YY_RULE_SETUP
-#line 1123 "pir.l"
+#line 1135 "pir.l"
 { return TK_LINE; }
 	YY_BREAK
 case 191:
 YY_RULE_SETUP
-#line 1124 "pir.l"
+#line 1136 "pir.l"
 { return TK_FILE; }
 	YY_BREAK
 case 192:
 YY_RULE_SETUP
-#line 1127 "pir.l"
+#line 1139 "pir.l"
 { /* macro expansion in PASM mode. */
                           lexer_state * const lexer = yypirget_extra(yyscanner);
                           macro_def   * const macro = find_macro(lexer->macros, yytext + 1);
@@ -3610,14 +3622,14 @@ YY_RULE_SETUP
                                       * adding this to the grammar. */
                                   /* goto SCANSTR state, and scan macro->body */
                                   yy_push_state(SCANSTR, yyscanner);
-                                  yypir_scan_string(macro->body,yyscanner);
+                                  scan_macro_body(yyscanner, macro);
                               }
                           }
                         }
 	YY_BREAK
 case 193:
 YY_RULE_SETUP
-#line 1161 "pir.l"
+#line 1173 "pir.l"
 { /* a label in PASM */
                           yylval->sval = dupstrn(yypirget_extra(yyscanner), yytext, yyleng - 1);
                           return TK_LABEL;
@@ -3625,34 +3637,34 @@ YY_RULE_SETUP
 	YY_BREAK
 case 194:
 YY_RULE_SETUP
-#line 1166 "pir.l"
+#line 1178 "pir.l"
 { yypirerror(yyscanner, yypirget_extra(yyscanner),
                                      "symbolic registers are not allowed in PASM mode");
                         }
 	YY_BREAK
 case 195:
 YY_RULE_SETUP
-#line 1169 "pir.l"
+#line 1181 "pir.l"
 { yylval->ival = atoi(yytext + 1); return TK_PREG; }
 	YY_BREAK
 case 196:
 YY_RULE_SETUP
-#line 1170 "pir.l"
+#line 1182 "pir.l"
 { yylval->ival = atoi(yytext + 1); return TK_NREG; }
 	YY_BREAK
 case 197:
 YY_RULE_SETUP
-#line 1171 "pir.l"
+#line 1183 "pir.l"
 { yylval->ival = atoi(yytext + 1); return TK_IREG; }
 	YY_BREAK
 case 198:
 YY_RULE_SETUP
-#line 1172 "pir.l"
+#line 1184 "pir.l"
 { yylval->ival = atoi(yytext + 1); return TK_SREG; }
 	YY_BREAK
 case 199:
 YY_RULE_SETUP
-#line 1174 "pir.l"
+#line 1186 "pir.l"
 { /* can be a parrot op or a label; the check is done in the parser. */
                           yylval->sval = dupstr(yypirget_extra(yyscanner), yytext);
                           return TK_IDENT;
@@ -3660,32 +3672,32 @@ YY_RULE_SETUP
 	YY_BREAK
 case 200:
 YY_RULE_SETUP
-#line 1179 "pir.l"
+#line 1191 "pir.l"
 { yylval->dval = atof(yytext); return TK_NUMC; }
 	YY_BREAK
 case 201:
 YY_RULE_SETUP
-#line 1180 "pir.l"
+#line 1192 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 202:
 YY_RULE_SETUP
-#line 1181 "pir.l"
+#line 1193 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 203:
 YY_RULE_SETUP
-#line 1182 "pir.l"
+#line 1194 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 204:
 YY_RULE_SETUP
-#line 1183 "pir.l"
+#line 1195 "pir.l"
 { yylval->ival = atoi(yytext); return TK_INTC; }
 	YY_BREAK
 case 205:
 YY_RULE_SETUP
-#line 1185 "pir.l"
+#line 1197 "pir.l"
 { /* copy the string, remove the quotes. */
                           yylval->sval = dupstrn(yypirget_extra(yyscanner), yytext + 1, yyleng - 2);
                           return TK_STRINGC;
@@ -3693,32 +3705,32 @@ YY_RULE_SETUP
 	YY_BREAK
 case 206:
 YY_RULE_SETUP
-#line 1190 "pir.l"
+#line 1202 "pir.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 207:
 /* rule 207 can match eol */
 YY_RULE_SETUP
-#line 1192 "pir.l"
+#line 1204 "pir.l"
 { return TK_NL; }
 	YY_BREAK
 case 208:
 YY_RULE_SETUP
-#line 1194 "pir.l"
+#line 1206 "pir.l"
 { yypirerror(yyscanner, yypirget_extra(yyscanner),
                                      "unrecognized character: %c", yytext[0]);
                         }
 	YY_BREAK
 case YY_STATE_EOF(PASM):
-#line 1197 "pir.l"
+#line 1209 "pir.l"
 { yyterminate(); }
 	YY_BREAK
 case 209:
 YY_RULE_SETUP
-#line 1199 "pir.l"
+#line 1211 "pir.l"
 ECHO;
 	YY_BREAK
-#line 3723 "pirlexer.c"
+#line 3735 "pirlexer.c"
 case YY_STATE_EOF(MACROHEAD):
 case YY_STATE_EOF(MACROLOCAL):
 case YY_STATE_EOF(MACROLABEL):
@@ -5018,7 +5030,7 @@ static int yy_flex_strlen (yyconst char * s , yyscan_t yyscanner)
 
 /* %ok-for-header */
 
-#line 1199 "pir.l"
+#line 1211 "pir.l"
 
 
 
@@ -5127,7 +5139,8 @@ munge_id(char const * const id, lexer_state * const lexer) {
     /* add length of the actual label id */
     length += strlen(id);
 
-    munged_id = (char *)pir_mem_allocate_zeroed(lexer, (length + 1) * sizeof (char));
+    munged_id = (char *)pir_mem_allocate_zeroed(lexer, (length + 1) * sizeof (char),
+                                                ALLOC_STRING);
 
     sprintf(munged_id, format, table->thismacro->name, id, lexer->unique_id);
 
@@ -5228,6 +5241,8 @@ expand_macro(yyscan_t yyscanner, macro_def * const macro, macro_param * args) {
     macro_table *macro_params = new_macro_table(lexer->macros);
     macro_param *params       = macro->parameters;
 
+    COUNT_STAT(lexer, macro_expansions);
+
     /* push the new macro_table, acting as a local symbol scope */
     push_macro_table(lexer, macro_params);
 
@@ -5263,19 +5278,43 @@ expand_macro(yyscan_t yyscanner, macro_def * const macro, macro_param * args) {
     lexer->unique_id = lexer->id_gen;
 
     /* switch to SCANMACRO state, and tell the lexer to get
-     * next tokens from the string buffer by calling yypir_scan_string().
+     * next tokens from the macro's body.
      */
     yy_push_state(SCANMACRO, yyscanner);
-    yypir_scan_string(macro->body,yyscanner);
+    scan_macro_body(yyscanner, macro);
     /* update the line number in the yyscanner so that any error message occuring
      * refers to the bad line in the macro definition. Note that this must done
-     * **after** the call to yypir_scan_string(), which sets the line number to 1.
+     * **after** the call to scan_macro_body(), which switches buffers.
      */
     yypirset_lineno(macro->linedefined,yyscanner);
 
     return macro->body;
 }
 
+/*
+
+=item C<static void
+scan_macro_body(yyscan_t yyscanner, macro_def * const macro)>
+
+Switch to a new buffer to scan the body of C<macro>, which may be a .macro, a
+.macro_const or a macro parameter. The body is scanned in place, rather than
+copied on each expansion like C<yypir_scan_string()> does; for that, it must be
+followed by two NULL characters (see C<close_macro_body()>). The buffer is
+deleted again at the end of the body.
+
+=cut
+
+*/
+static void
+scan_macro_body(yyscan_t yyscanner, macro_def * const macro) {
+    unsigned length = macro->cursor - macro->body;
+
+    /* a body that was not closed properly is scanned from a copy */
+    if (length + 2 > macro->buffersize
+    ||  yypir_scan_buffer(macro->body,length + 2,yyscanner) == NULL)
+        yypir_scan_bytes(macro->body,length,yyscanner);
+}
+
 
 /* override Flex generated memory functions: all memory allocated
  * by Flex goes through Parrot's memory allocators.
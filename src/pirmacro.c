@@ -16,8 +16,11 @@
 static void check_size(ARGIN(macro_def * const macro), unsigned length)
         __attribute__nonnull__(1);
 
+static void free_macro_params(ARGIN_NULLOK(macro_param *param));
+
 #define ASSERT_ARGS_check_size __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(macro))
+#define ASSERT_ARGS_free_macro_params __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 /* HEADERIZER END: static */
 
@@ -54,7 +57,8 @@ new_macro(ARGIN(macro_table * const table),
         unsigned initsize)
 {
     ASSERT_ARGS(new_macro)
-    macro_def *macro   = (macro_def *)mem_sys_allocate(sizeof (macro_def));
+    macro_def  *macro  = (macro_def *)mem_sys_allocate_zeroed(sizeof (macro_def));
+    macro_def **bucket;
 
     macro->name        = name;
     macro->linedefined = lineno;
@@ -69,6 +73,12 @@ new_macro(ARGIN(macro_table * const table),
     macro->next        = table->definitions;
     table->definitions = macro;
 
+    /* and in its bucket; redefinitions are found first */
+    macro->hash        = hash_chars(name, strlen(name));
+    bucket             = table->buckets + macro->hash % table->size;
+    macro->hashnext    = *bucket;
+    *bucket            = macro;
+
     return macro;
 }
 
@@ -123,7 +133,8 @@ add_macro_param(ARGIN*macro_def * const macro),
 char const * const value, int lineno)>
 
 Define a new C<.macro_const>, by name of C<name> as an alias for C<value> The new macro
-const is entered in the macro_table C<table>
+const is entered in the macro_table C<table>. The value is copied into the body,
+followed by two NULL characters, so that the lexer can scan it in place.
 
 =cut
 
@@ -134,12 +145,11 @@ new_macro_const(ARGIN(macro_table * const table),
         ARGIN(char const * const value), int lineno)
 {
     ASSERT_ARGS(new_macro_const)
-    /* macro constants are just macros, but they have no body; the value is already
-     * parsed and allocated in memory.
-     */
-    macro_def *def     = new_macro(table, name, lineno, FALSE, 0);
-    /* XXX is this cast from const * const to const * dangerous? */
-    def->body          = (char *)value;
+    unsigned const  length = strlen(value);
+    macro_def      *def    = new_macro(table, name, lineno, FALSE, length + 2);
+
+    memcpy(def->body, value, length);
+    def->cursor            = def->body + length;
 }
 
 
@@ -147,8 +157,9 @@ new_macro_const(ARGIN(macro_table * const table),
 
 =item C<static void check_size(macro_def * const macro, unsigned length)>
 
-Check C<macro>'s buffer size whether C<length> bytes can be added;
-if not, then the buffer is doubled in size.
+Check C<macro>'s buffer size whether C<length> bytes can be added, while
+keeping one spare byte for a NULL character; if not, then the buffer is
+doubled in size until they fit. The new part of the buffer is cleared.
 
 =cut
 
@@ -159,20 +170,45 @@ check_size(ARGIN(macro_def * const macro), unsigned length)
     ASSERT_ARGS(check_size)
     unsigned used = macro->cursor - macro->body;
     if (used + length >= macro->buffersize) {
-        unsigned  newsize = macro->buffersize << 1;
-        char     *newbuffer;
+        unsigned newsize = macro->buffersize ? macro->buffersize : MACRO_MIN_BUFFER_SIZE;
+
         /* double the size (moving all bits left by 1 means doubling) */
-        newbuffer = (char *)mem_sys_allocate(sizeof (char) * macro->buffersize);
-        memcpy(newbuffer, macro->body, macro->buffersize);
-        mem_sys_free(macro->body);
+        while (used + length >= newsize)
+            newsize <<= 1;
+
+        macro->body       = (char *)mem_sys_realloc(macro->body, sizeof (char) * newsize);
+        memset(macro->body + macro->buffersize, 0, newsize - macro->buffersize);
         macro->buffersize = newsize;
-        macro->body       = newbuffer;
         /* update cursor as well */
         macro->cursor     = macro->body + used;
     }
 }
 
 
+/*
+
+=item C<void close_macro_body(macro_def * const macro)>
+
+Finish the body of C<macro> after its last character was stored; the body is
+terminated by two NULL characters, so that the lexer can scan it in place on
+each expansion.
+
+=cut
+
+*/
+void
+close_macro_body(ARGIN(macro_def * const macro))
+{
+    ASSERT_ARGS(close_macro_body)
+    /* check_size() keeps a spare character after the body already */
+    if (macro->cursor + 2 > macro->body + macro->buffersize)
+        check_size(macro, 2);
+
+    macro->cursor[0] = '\0';
+    macro->cursor[1] = '\0';
+}
+
+
 /*
 
 =item C<void store_macro_char(macro_def * const macro, char c)>
@@ -199,9 +235,11 @@ store_macro_char(ARGIN(macro_def * const macro), char c)
 =item C<void store_macro_string(macro_def * const macro, char const * const str,
 ...)>
 
-Store the string C<str> in C<macro>'s body buffer. The total number
-of characters to be written should not exceed MAX_NUM_CHARS. It's not known
-beforehand how much space we need in the buffer due to the var. arg. list.
+Store the string C<str>, formatted with the arguments that follow like
+C<sprintf()> does, in C<macro>'s body buffer. It's not known beforehand how
+much space we need in the buffer due to the var. arg. list; the string is
+formatted into the free space, and if it didn't fit, the buffer is grown to
+the size that was reported and the string is formatted again.
 
 =cut
 
@@ -213,15 +251,28 @@ store_macro_string(ARGIN(macro_def * const macro),
 {
     ASSERT_ARGS(store_macro_string)
     va_list arg_ptr;
+    int     length;
 
-#define MAX_NUM_CHARS_IN_STRING   256
-
-    check_size(macro, MAX_NUM_CHARS_IN_STRING);
+    check_size(macro, 1);
 
     va_start(arg_ptr, str);
-    /* vsprintf returns number of characters written; adjust cursor with that. */
-    macro->cursor += vsprintf(macro->cursor, str, arg_ptr);
+    /* vsnprintf returns the number of characters it would have written */
+    length = vsnprintf(macro->cursor, macro->buffersize - (macro->cursor - macro->body),
+                       str, arg_ptr);
     va_end(arg_ptr);
+
+    if (length < 0)
+        return;
+
+    if ((unsigned)length >= macro->buffersize - (macro->cursor - macro->body)) {
+        check_size(macro, length);
+
+        va_start(arg_ptr, str);
+        vsnprintf(macro->cursor, length + 1, str, arg_ptr);
+        va_end(arg_ptr);
+    }
+
+    macro->cursor += length;
 }
 
 
@@ -230,8 +281,12 @@ store_macro_string(ARGIN(macro_def * const macro),
 =item C<macro_def * find_macro(macro_table * const table, char const * const
 name)>
 
-Find the specified macro. If the specified macro does not exist,
-NULL is returned.
+Find the specified macro in C<table>, or any of the tables below it.
+If the specified macro does not exist, NULL is returned.
+
+The hash value of C<name> is calculated once, and used for all tables;
+names are only compared if their hash values are equal. Names are
+usually interned, in which case comparing the pointers suffices.
 
 =cut
 
@@ -243,22 +298,20 @@ find_macro(ARGIN(macro_table * const table),
         ARGIN(char const * const name))
 {
     ASSERT_ARGS(find_macro)
-    macro_def *iter = table->definitions;
+    macro_table         *scope = table;
+    unsigned long const  hash  = hash_chars(name, strlen(name));
 
-    PARROT_ASSERT(name != NULL);
+    while (scope != NULL) {
+        macro_def *iter = scope->buckets[hash % scope->size];
 
-    /* iterate over the list and compare each node's name */
-    while (iter != NULL) {
-        if (STREQ(iter->name, name)) {
-        /*    fprintf(stderr, "found (%s)\n", name); */
-            return iter;
+        while (iter != NULL) {
+            if (iter->hash == hash && (iter->name == name || STREQ(iter->name, name)))
+                return iter;
+
+            iter = iter->hashnext;
         }
-        iter = iter->next;
-    }
 
-    if (table->prev) {
-        /* fprintf(stderr, "not found (%s); trying previous table\n", name); */
-        return find_macro(table->prev, name);
+        scope = scope->prev;
     }
 
     return NULL;
@@ -270,6 +323,8 @@ find_macro(ARGIN(macro_table * const table),
 =item C<macro_table * new_macro_table(macro_table * const current)>
 
 Create a new macro_table structure; set C<current> as its previous.
+The outermost table (if C<current> is NULL) gets C<MACRO_TABLE_SIZE>
+buckets; tables for macro arguments get C<MACRO_SCOPE_SIZE> buckets.
 The newly created table is returned.
 
 =cut
@@ -279,12 +334,15 @@ PARROT_MALLOC
 PARROT_CANNOT_RETURN_NULL
 PARROT_WARN_UNUSED_RESULT
 macro_table *
-new_macro_table(ARGIN(macro_table * const current))
+new_macro_table(ARGIN_NULLOK(macro_table * const current))
 {
     ASSERT_ARGS(new_macro_table)
-    macro_table *table       = (macro_table *)mem_sys_allocate_zeroed(sizeof (macro_table));
+    unsigned const  size  = current ? MACRO_SCOPE_SIZE : MACRO_TABLE_SIZE;
+    macro_table    *table = (macro_table *)mem_sys_allocate_zeroed(sizeof (macro_table)
+                                                         + size * sizeof (macro_def *));
     table->definitions       = NULL;
-    table->prev = NULL;
+    table->buckets           = (macro_def **)(table + 1);
+    table->size              = size;
 
     table->prev              = current;
     table->thismacro         = NULL;
@@ -293,11 +351,34 @@ new_macro_table(ARGIN(macro_table * const current))
 }
 
 
+/*
+
+=item C<static void free_macro_params(macro_param *param)>
+
+Free the list of macro parameters or C<.macro_local>s C<param>.
+
+=cut
+
+*/
+static void
+free_macro_params(ARGIN_NULLOK(macro_param *param))
+{
+    ASSERT_ARGS(free_macro_params)
+    while (param != NULL) {
+        macro_param *temp = param;
+        param             = param->next;
+        mem_sys_free(temp);
+    }
+}
+
+
 /*
 
 =item C<void delete_macro_table(macro_table * table)>
 
-Free resources allocated for the macro_table C<table>.
+Free resources allocated for the macro_table C<table>, including its
+buckets and the definitions in it; these are the arguments of a macro
+expansion that ended.
 
 =cut
 
@@ -306,6 +387,17 @@ void
 delete_macro_table(ARGMOD(macro_table * table))
 {
     ASSERT_ARGS(delete_macro_table)
+    macro_def *iter = table->definitions;
+
+    while (iter != NULL) {
+        macro_def *temp = iter;
+        iter            = iter->next;
+        free_macro_params(temp->parameters);
+        free_macro_params(temp->macrolocals);
+        mem_sys_free(temp->body);
+        mem_sys_free(temp);
+    }
+
     mem_sys_free(table);
 }
 
@@ -335,7 +427,8 @@ declare_macro_local(ARGIN(macro_def * const macro),
 =item C<int is_macro_local(macro_def * const macro, char const * const name)>
 
 Check whether C<name> was declared as a C<.macro_local> in the macro
-definition C<macro>.
+definition C<macro>. The names of macro locals are interned, so C<name>
+must be interned as well (see C<dupstr()>); only the pointers are compared.
 
 =cut
 
@@ -349,7 +442,7 @@ is_macro_local(ARGIN(macro_def * const macro),
     macro_param *iter = macro->macrolocals;
 
     while (iter) {
-        if (STREQ(iter->name, name))
+        if (iter->name == name)
             return TRUE;
         iter = iter->next;
     }
@@ -4,6 +4,15 @@
 #ifndef PARROT_PIR_PIRMACRO_H_GUARD
 #define PARROT_PIR_PIRMACRO_H_GUARD
 
+/* number of hash buckets of the outermost macro_table, which holds all
+ * definitions, and of the tables that hold the arguments of a macro
+ * expansion, which only have a few entries each.
+ */
+#define MACRO_TABLE_SIZE    128
+#define MACRO_SCOPE_SIZE    8
+
+/* size a macro body buffer grows from if it had none */
+#define MACRO_MIN_BUFFER_SIZE   64
 
 /* struct to represent macro parameter declaration, or,
  * a macro argument, or, a .macro_local.
@@ -36,6 +45,9 @@ typedef struct macro_def {
 
     unsigned          buffersize;
 
+    unsigned long     hash;     /* hash value of name; see find_macro() */
+    struct macro_def *hashnext; /* next definition in the same hash bucket */
+
     struct macro_def *next; /* macro definitions are stored in a list */
 
 } macro_def;
@@ -51,7 +63,13 @@ typedef struct macro_def {
  * table pointed to by the "prev" field.
  */
 typedef struct macro_table {
-    macro_def *definitions;
+    macro_def *definitions;   /* all definitions, most recent first */
+
+    /* the definitions, hashed by name; the array is allocated together
+     * with the table, so pushing and popping a scope is a single allocation.
+     */
+    macro_def **buckets;
+    unsigned    size;
 
     /* when a macro's buffer is being scanned, yyscan_t's YY_CURRENT_BUFFER must be stored
      * somewhere; this is the buffer that wat being scanned before the macro expansion.
@@ -87,6 +105,9 @@ void add_macro_param(
     ARGIN(char const * const name))
         __attribute__nonnull__(2);
 
+void close_macro_body(ARGIN(macro_def * const macro))
+        __attribute__nonnull__(1);
+
 void declare_macro_local(
     ARGIN(macro_def * const macro),
     ARGIN(char const * const name))
@@ -142,8 +163,7 @@ macro_param * new_macro_param(ARGIN(char const * const value))
 PARROT_MALLOC
 PARROT_CANNOT_RETURN_NULL
 PARROT_WARN_UNUSED_RESULT
-macro_table * new_macro_table(ARGIN(macro_table * const current))
-        __attribute__nonnull__(1);
+macro_table * new_macro_table(ARGIN_NULLOK(macro_table * const current));
 
 void store_macro_char(ARGIN(macro_def * const macro), char c)
         __attribute__nonnull__(1);
@@ -157,6 +177,8 @@ void store_macro_string(
 
 #define ASSERT_ARGS_add_macro_param __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(name))
+#define ASSERT_ARGS_close_macro_body __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(macro))
 #define ASSERT_ARGS_declare_macro_local __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(macro) \
     , PARROT_ASSERT_ARG(name))
@@ -177,8 +199,7 @@ void store_macro_string(
     , PARROT_ASSERT_ARG(value))
 #define ASSERT_ARGS_new_macro_param __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(value))
-#define ASSERT_ARGS_new_macro_table __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
-       PARROT_ASSERT_ARG(current))
+#define ASSERT_ARGS_new_macro_table __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
 #define ASSERT_ARGS_store_macro_char __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(macro))
 #define ASSERT_ARGS_store_macro_string __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
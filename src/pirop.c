@@ -5,9 +5,12 @@
 
 #include "pircompiler.h"
 #include "pircompunit.h"
+#include "pirsymbol.h"
 #include "pirop.h"
 #include "pirerr.h"
 
+#include <limits.h>
+
 /*
 
 =head1 DESCRIPTION
@@ -47,163 +50,149 @@ static char const type_codes[10] = {
 
 /* HEADERIZER BEGIN: static */
 
-/*
-
-=item C<static int
-get_signature_length(expression * const e)>
-
-Calculate the length of the signature for one operand; an operand is separated
-from the instruction name or another operand through '_', which must also
-be counted.
-
- set $I0, 42  --> set_i_ic
-
-therefore, for $I0 (a target), return 1 for the type, 1 for the '_', and whatever
-is needed for a key, if any, as in this example:
-
- set $P0[1] = "hi"  --> set_p_kic_sc
-
-$P0 is a target, resulting in "_p", the key [1] is a key ('k') of type int ('i'),
-and it's a constant ('c'). Add 1 for the '_'.
-
-=cut
-
-*/
-PARROT_WARN_UNUSED_RESULT
-static int
-get_signature_length(NOTNULL(expression * const e)) {
-    switch (e->type) {
-      case EXPR_TARGET:
-        return 2 + ((e->expr.t->key != NULL) /* if there's a key on this target ... */
-                                             /* ... get its length. */
-                   ? get_signature_length(e->expr.t->key->head->expr) + 1
-                   : 0);
-      case EXPR_CONSTANT:
-        return 3;    /* for _, 'k', 'c' */
-      case EXPR_IDENT:
-        return 3; /* 1 for '_', 1 for 'i', 1 for 'c' */
-      case EXPR_KEY: { /* for '_', 'k' */
-        int n;
-        /* if the key is an integer constant, then signature becomes '_kic', otherwise _kc. */
-        if (e->expr.k->head->expr->type         == EXPR_CONSTANT
-         && e->expr.k->head->expr->expr.c->type == INT_VAL)
-            n = 3;
-        else
-            n = 2;
-
-        return n + get_signature_length(e->expr.k->head->expr);
-      }
-      default:
-        fprintf(stderr, "wrong expression typein get_signature_length()\n");
-        break;
-    }
-    return 0;
-}
+/* Each operand's contribution to the signature is encoded in a small integer,
+ * so that a full signature can be computed and compared without building
+ * a string. The lower 4 bits hold 1 + the index into type_codes (0 means
+ * there's nothing to write); the upper 4 bits select a suffix for keyed
+ * targets from key_codes.
+ */
+#define SIG_CODE(type, keycode)     (((unsigned)(type) + 1) | ((unsigned)(keycode) << 4))
+#define SIG_TYPE(code)              ((int)((code) & 0x0f) - 1)
+#define SIG_KEY(code)               ((code) >> 4)
 
+/* number of bits per operand in a packed signature code */
+#define SIG_BITS                    8
 
+/* the maximum number of operands that fit in a packed signature code */
+#define SIG_MAX_OPERANDS            ((sizeof (unsigned long) * CHAR_BIT) / SIG_BITS)
 
+/* signature code for looking up an op by its short name; no combination of
+ * operand codes yields this value.
+ */
+#define SIG_SHORT_NAME              (~0UL)
+
+/* suffixes for keyed targets, selected by SIG_KEY() */
+static char const * const key_codes[] = {
+    "",         /* no key                          */
+    "_k",       /* $P0[$P1]                        */
+    "_kc",      /* $P0[$S1], $P0["x"] and $P0[1]   */
+    "_ki",      /* $P0[$I1]                        */
+    "_kic",     /* $P0[L], L an identifier         */
+    "_kpc"      /* $P0[["x"]]                      */
+};
 
 /*
 
-=item C<static char *
-write_signature(expression * const iter, char *instr_writer)>
+=item C<unsigned get_operand_code(expression * const e)>
+
+Calculate the signature code for one operand; see SIG_CODE. The code is
+computed once, when the expression node is created, and stored in its
+C<sigcode> field, so that selecting an op only combines integers. Some
+examples of the signature that the code represents:
 
-Write the signature for the operand C<iter>, using the character
-pointer C<instr_writer>. When the operand is an indexed target node
-(in other words, it has a key node), this function is invoked recursively
-passing the key as an argument.
+ set $I0, 42        --> set_i_ic
+ set $P0[1], "hi"   --> set_p_kc_sc
 
-This function returns the updated character pointer (due to pass-by-value
-semantics of the C calling conventions).
+Note that a constant key on a target always results in C<kc>, as the key is
+emitted as a key constant by C<emit_pbc_key()>.
 
 =cut
 
 */
 PARROT_WARN_UNUSED_RESULT
-PARROT_CANNOT_RETURN_NULL
-static char *
-write_signature(NOTNULL(expression * const iter), NOTNULL(char *instr_writer)) {
-    switch (iter->type) {
-      case EXPR_TARGET:
-        *instr_writer++ = type_codes[iter->expr.t->info->type];
+unsigned
+get_operand_code(ARGIN(expression * const e)) {
+    ASSERT_ARGS(get_operand_code)
+    switch (e->type) {
+      case EXPR_TARGET: {
+        target * const t       = e->expr.t;
+        unsigned       keycode = 0;
 
-        if (iter->expr.t->key) {
-            *instr_writer++ = '_';
-            *instr_writer++ = 'k';
+        if (t->key) {
+            expression * const keyexpr = t->key->head->expr;
 
-            switch (iter->expr.t->key->head->expr->type) {
+            switch (keyexpr->type) {
               case EXPR_TARGET:
-                switch (iter->expr.t->key->head->expr->expr.t->info->type) {
-                  case PMC_TYPE:
-                    /* the key is a target, and its type is a PMC. In that
-                     * case, do not print the signature; 'kp' is not valid.
-                     */
-                    break;
+                switch (keyexpr->expr.t->info->type) {
                   case STRING_TYPE: /* strings become key-constant */
-                    *instr_writer++ = 'c';
+                    keycode = 2;
                     break;
                   case INT_TYPE:
-                    *instr_writer++ = 'i';
+                    keycode = 3;
                     break;
-                  default:
+                  default: /* 'kp' is not valid; write just 'k' */
+                    keycode = 1;
                     break;
                 }
                 break;
               case EXPR_CONSTANT:
-                /* integer constant key results in '_kic' signature */
-                if (iter->expr.c->type == INT_VAL)
-                    *instr_writer++ = 'i';
-
-                *instr_writer++ = 'c';
+                keycode = 2;
+                break;
+              case EXPR_IDENT:
+                keycode = 4;
+                break;
+              case EXPR_KEY:
+                keycode = 5;
                 break;
               default:
-                /* XXX does this ever happen? */
-                fprintf(stderr, "write_signature: non-constant key\n");
-                instr_writer = write_signature(iter->expr.t->key->head->expr, instr_writer);
+                keycode = 1;
                 break;
             }
-
         }
-        break;
+
+        return SIG_CODE(t->info->type, keycode);
+      }
       case EXPR_CONSTANT:
-        *instr_writer++ = type_codes[iter->expr.c->type];
-        *instr_writer++ = 'c';
-        break;
+        return SIG_CODE(e->expr.c->type, 0);
       case EXPR_IDENT: /* used for labels; these will be converted to (i)nteger (c)onstants*/
-        *instr_writer++ = 'i';
-        *instr_writer++ = 'c';
-        break;
+        return SIG_CODE(INT_VAL, 0);
       case EXPR_KEY:
-        *instr_writer++ = 'p';
-        *instr_writer++ = 'c';
-
-        /* XXX figure out what signature is needed. I think 'pc' */
-        /*
-        else {
-            *instr_writer++ = 'k';
-        }
-        */
-        /*instr_writer    = write_signature(iter->expr.k->head->expr, instr_writer);*/
-
-        /*
-
-        switch (iter->expr.k->expr->type) {
-          case EXPR_CONSTANT:
-            *instr_writer++ = 'c';
-            break;
-          default:
-            fprintf(stderr, "write_signature: non-constant key\n");
-            instr_writer = write_signature(iter->expr.k->expr, instr_writer);
-            break;
-        }
-        */
-
-        break;
+        return SIG_CODE(PMC_VAL, 0);
       default:
-        fprintf(stderr, "wrong expression type in write_signature()\n");
+        fprintf(stderr, "wrong expression type in get_operand_code()\n");
         break;
     }
-    return instr_writer;
+    return 0;
+}
+
+/*
+
+=item C<static int
+get_signature_code(instruction * const instr, unsigned long *sigcode)>
+
+Compute the signature code of the operands of C<instr>, by packing the
+precomputed codes of all operands, and store it in C<sigcode>. If the
+signature cannot be represented (there are too many operands), FALSE is
+returned; otherwise TRUE is returned.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+get_signature_code(NOTNULL(instruction * const instr), NOTNULL(unsigned long *sigcode)) {
+    expression *iter         = instr->operands;
+    unsigned    num_operands = 0;
+
+    *sigcode = 0;
+
+    if (iter == NULL)
+        return TRUE;
+
+    do {
+        unsigned code;
+
+        iter = iter->next;
+        code = iter->sigcode;
+
+        if (code == 0 || ++num_operands > SIG_MAX_OPERANDS)
+            return FALSE;
+
+        *sigcode = (*sigcode << SIG_BITS) | code;
+    }
+    while (iter != instr->operands);
+
+    return TRUE;
 }
 
 
@@ -218,7 +207,7 @@ below:
 
  set I0, 10        --> set_i_ic
  print "hi"        --> print_sc
- set P0[1], 3.14   --> set_p_kic_nc
+ set P0[1], 3.14   --> set_p_kc_nc
 
 For each operand, an underscore is added; then for the types
 int, num, string or pmc, an 'i', 'n', 's' or 'p' is added
@@ -242,22 +231,21 @@ get_signatured_opname(NOTNULL(lexer_state * const lexer), NOTNULL(instruction *
     /* get length of short opname (and add 1 for the NULL character) */
     fullname_length = strlen(instr->opname) + 1;
 
-    /* for each operand, calculate the length of the signature (for that op.)
-     * and add it to the full length.
+    /* for each operand, add the length of its signature: 1 for the '_',
+     * 1 for the type and 1 for a 'c' if it's a constant, and the key suffix.
      */
     if (iter) {
-        iter = iter->next;
         do {
-            int keylength    = get_signature_length(iter);
-            fullname_length += keylength;
             iter             = iter->next;
+            fullname_length += 3 + strlen(key_codes[SIG_KEY(iter->sigcode)]);
             ++num_operands;
         }
-        while (iter != instr->operands->next);
+        while (iter != instr->operands);
     }
 
     /* now we know how long the fullname will be, allocate enough memory. */
-    fullname = (char *)pir_mem_allocate_zeroed(lexer, fullname_length * sizeof (char));
+    fullname = (char *)pir_mem_allocate_zeroed(lexer, fullname_length * sizeof (char),
+                                               ALLOC_STRING);
 
     /* copy the short name into fullname buffer, and set instr_writer to
      * the character after that.
@@ -270,14 +258,135 @@ get_signatured_opname(NOTNULL(lexer_state * const lexer), NOTNULL(instruction *
      */
     iter = instr->operands;
     while (num_operands-- > 0) {
+        unsigned code;
+        int      type;
+
         iter            = iter->next;
+        code            = iter->sigcode;
+        type            = SIG_TYPE(code);
         *instr_writer++ = '_'; /* separate each operand code by a '_' */
-        instr_writer    = write_signature(iter, instr_writer);
+
+        if (type >= 0) {
+            *instr_writer++ = type_codes[type];
+
+            /* the value types (constants) come after the pir types */
+            if (type > UNKNOWN_TYPE)
+                *instr_writer++ = 'c';
+        }
+
+        strcpy(instr_writer, key_codes[SIG_KEY(code)]);
+        instr_writer += strlen(instr_writer);
     }
 
     return fullname;
 }
 
+/*
+
+=item C<op_cache_entry * find_cached_op(lexer_state * const lexer, char const *
+const opname, unsigned long sigcode)>
+
+Find the cached lookup result for the op C<opname> with the signature code
+C<sigcode>. Op names are compared by pointer, not by contents; C<opname>
+must be a string that stays valid during the compilation, such as a string
+returned by C<dupstr()> or a string literal. If there is no cached result,
+NULL is returned. Hits and misses are counted in C<lexer>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+op_cache_entry *
+find_cached_op(ARGIN(lexer_state * const lexer), ARGIN(char const * const opname),
+        unsigned long sigcode)
+{
+    ASSERT_ARGS(find_cached_op)
+    hashtable    *table = &lexer->op_cache;
+    unsigned long hash  = ((unsigned long)opname / sizeof (char *) ^ sigcode) % table->size;
+    bucket       *b     = get_bucket(table, hash);
+
+    while (b) {
+        op_cache_entry * const entry = bucket_opcache(b);
+
+        if (entry->opname == opname && entry->sigcode == sigcode) {
+            ++lexer->op_cache_hits;
+            return entry;
+        }
+
+        b = b->next;
+    }
+
+    ++lexer->op_cache_misses;
+    return NULL;
+}
+
+/*
+
+=item C<void cache_op(lexer_state * const lexer, char const * const opname,
+unsigned long sigcode, int opcode)>
+
+Store the result of looking up the op C<opname> with signature code C<sigcode>;
+C<opcode> is the opcode that was found, or -1 if the op does not exist.
+See C<find_cached_op()>.
+
+=cut
+
+*/
+void
+cache_op(ARGIN(lexer_state * const lexer), ARGIN(char const * const opname),
+        unsigned long sigcode, int opcode)
+{
+    ASSERT_ARGS(cache_op)
+    hashtable      *table = &lexer->op_cache;
+    unsigned long   hash  = ((unsigned long)opname / sizeof (char *) ^ sigcode) % table->size;
+    bucket         *b     = new_bucket(lexer);
+    op_cache_entry *entry = (op_cache_entry *)pir_mem_allocate(lexer, sizeof (op_cache_entry),
+                                                               ALLOC_OP_CACHE);
+
+    entry->opname     = opname;
+    entry->sigcode    = sigcode;
+    entry->opcode     = opcode;
+    bucket_opcache(b) = entry;
+
+    store_bucket(table, b, hash);
+}
+
+/*
+
+=item C<int is_parrot_op(lexer_state * const lexer, char const * const name)>
+
+Check whether C<name> is a parrot opcode. C<name> can be either the short
+or fullname of the opcode; for instance, C<print> is the short name, which
+has several full names, such as C<print_i>, C<print_s>, etc., depending on
+the arity and types of operands.
+
+=cut
+
+*/
+int
+is_parrot_op(ARGIN(lexer_state * const lexer),
+        ARGIN(char const * const name))
+{
+    ASSERT_ARGS(is_parrot_op)
+    op_cache_entry *entry = find_cached_op(lexer, name, SIG_SHORT_NAME);
+    int             opcode;
+
+    if (entry)
+        opcode = entry->opcode;
+    else {
+        opcode = lexer->interp->op_lib->op_code(name, 0); /* check short name, e.g. "set" */
+        cache_op(lexer, name, SIG_SHORT_NAME, opcode);
+    }
+
+    /* do *NOT* check for the "long" name variant, such as "set_i_ic";
+     * signatures (such as the _i_ic part) will be calculated by PIRC,
+     * adding it already will generate e.g. "set_i_ic_i_ic", which is
+     * incorrect, obviously.
+     */
+    return (opcode >= 0);
+}
+
 
 /*
 
@@ -290,6 +399,10 @@ C<add_i_ic_ic> and the like do not exist, but instead should be replaced
 by C<set_i_ic> (and the like). If it's not one of these special cases,
 then that means the op is not valid, and an error message will be reported.
 
+The result of the lookup is cached, keyed by the short name of the op and the
+signature code of its operands, so that for ops that were seen before, no
+signatured opname needs to be built.
+
 =cut
 
 */
@@ -298,14 +411,29 @@ int
 get_opinfo(ARGIN(lexer_state * const lexer))
 {
     ASSERT_ARGS(get_opinfo)
-    instruction * const instr = CURRENT_INSTRUCTION(lexer);
+    instruction * const instr     = CURRENT_INSTRUCTION(lexer);
+    op_cache_entry     *entry     = NULL;
+    unsigned long       sigcode;
+    int                 cacheable = get_signature_code(instr, &sigcode);
+    int                 opcode;
+
+    if (cacheable)
+        entry = find_cached_op(lexer, instr->opname, sigcode);
 
-    char * const fullopname   = get_signatured_opname(lexer, instr);
-    /* find the numeric opcode for the signatured op. */
-    int          opcode       = lexer->interp->op_lib->op_code(fullopname, 1);
+    if (entry)
+        opcode = entry->opcode;
+    else {
+        char * const fullopname = get_signatured_opname(lexer, instr);
+        /* find the numeric opcode for the signatured op. */
+        opcode = lexer->interp->op_lib->op_code(fullopname, 1);
+
+        if (cacheable)
+            cache_op(lexer, instr->opname, sigcode, opcode);
+    }
 
     if (opcode < 0) {
-        yypirerror(lexer->yyscanner, lexer, "'%s' is not a parrot op", fullopname);
+        yypirerror(lexer->yyscanner, lexer, "'%s' is not a parrot op",
+                   get_signatured_opname(lexer, instr));
         return FALSE;
     }
     else {
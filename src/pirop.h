@@ -7,16 +7,62 @@
 
 #include "pircompiler.h"
 
+/* cached result of an op lookup; see find_cached_op() */
+typedef struct op_cache_entry {
+    char const    *opname;   /* short name of the op; compared by pointer */
+    unsigned long  sigcode;  /* signature code of the operands */
+    int            opcode;   /* the op that was found, or -1 if there is none */
+
+} op_cache_entry;
+
 /* HEADERIZER BEGIN: compilers/pirc/src/pirop.c */
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 
+void cache_op(
+    ARGIN(lexer_state * const lexer),
+    ARGIN(char const * const opname),
+    unsigned long sigcode,
+    int opcode)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+op_cache_entry * find_cached_op(
+    ARGIN(lexer_state * const lexer),
+    ARGIN(char const * const opname),
+    unsigned long sigcode)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
 PARROT_IGNORABLE_RESULT
 int /*@alt void@*/
 get_opinfo(ARGIN(lexer_state * const lexer))
         __attribute__nonnull__(1);
 
+PARROT_WARN_UNUSED_RESULT
+unsigned get_operand_code(ARGIN(expression * const e))
+        __attribute__nonnull__(1);
+
+int is_parrot_op(
+    ARGIN(lexer_state * const lexer),
+    ARGIN(char const * const name))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+#define ASSERT_ARGS_cache_op __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(opname))
+#define ASSERT_ARGS_find_cached_op __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(opname))
 #define ASSERT_ARGS_get_opinfo __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_get_operand_code __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(e))
+#define ASSERT_ARGS_is_parrot_op __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(name))
 /* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
 /* HEADERIZER END: compilers/pirc/src/pirop.c */
 
@@ -686,7 +686,7 @@ static char const * const pir_type_names[] = { "int", "string", "pmc", "num" };
 
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 typedef union YYSTYPE
-#line 236 "pir.y"
+#line 243 "pir.y"
 {
     double              dval;
     int                 ival;
@@ -707,7 +707,7 @@ typedef union YYSTYPE
 
 }
 /* Line 193 of yacc.c.  */
-#line 592 "pirparser.c"
+#line 711 "pirparser.c"
 	YYSTYPE;
 # define yystype YYSTYPE /* obsolescent; will be withdrawn */
 # define YYSTYPE_IS_DECLARED 1
@@ -720,7 +720,7 @@ typedef union YYSTYPE
 
 
 /* Line 216 of yacc.c.  */
-#line 605 "pirparser.c"
+#line 724 "pirparser.c"
 
 #ifdef short
 # undef short
@@ -2765,27 +2765,27 @@ yyreduce:
   switch (yyn)
     {
         case 4:
-#line 572 "pir.y"
+#line 579 "pir.y"
     { fixup_global_labels(lexer); ;}
     break;
 
   case 7:
-#line 580 "pir.y"
+#line 587 "pir.y"
     { lexer->linenr += (yyvsp[(1) - (1)].ival); ;}
     break;
 
   case 20:
-#line 606 "pir.y"
+#line 613 "pir.y"
     { new_macro_const(lexer->macros, (yyvsp[(2) - (3)].sval), (yyvsp[(3) - (3)].sval), yypirget_lineno(yyscanner)); ;}
     break;
 
   case 21:
-#line 612 "pir.y"
-    { /* fprintf(stderr, "macro body: [%s]\n", CURRENT_MACRO(lexer)->body);*/ ;}
+#line 619 "pir.y"
+    { close_macro_body(CURRENT_MACRO(lexer)); ;}
     break;
 
   case 22:
-#line 616 "pir.y"
+#line 623 "pir.y"
     {
                           new_macro(lexer->macros, (yyvsp[(2) - (2)].sval), yypirget_lineno(yyscanner), TRUE,
                                     lexer->macro_size);
@@ -2793,17 +2793,17 @@ yyreduce:
     break;
 
   case 27:
-#line 631 "pir.y"
+#line 638 "pir.y"
     { add_macro_param(CURRENT_MACRO(lexer), (yyvsp[(1) - (1)].sval)); ;}
     break;
 
   case 35:
-#line 650 "pir.y"
+#line 657 "pir.y"
     { store_macro_string(CURRENT_MACRO(lexer), "%s\n", (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 36:
-#line 654 "pir.y"
+#line 661 "pir.y"
     {
                           store_macro_string(CURRENT_MACRO(lexer), ".local %s %s\n",
                                              pir_type_names[(yyvsp[(2) - (3)].ival)], (yyvsp[(3) - (3)].sval));
@@ -2811,142 +2811,142 @@ yyreduce:
     break;
 
   case 37:
-#line 665 "pir.y"
+#line 672 "pir.y"
     { load_library(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 38:
-#line 669 "pir.y"
+#line 676 "pir.y"
     { yypirset_lineno ((yyvsp[(2) - (2)].ival), yyscanner); ;}
     break;
 
   case 39:
-#line 671 "pir.y"
+#line 678 "pir.y"
     { lexer->filename = (yyvsp[(2) - (2)].sval); ;}
     break;
 
   case 40:
-#line 677 "pir.y"
+#line 684 "pir.y"
     { set_hll(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 41:
-#line 681 "pir.y"
+#line 688 "pir.y"
     { set_namespace(lexer, (yyvsp[(3) - (4)].key)); ;}
     break;
 
   case 42:
-#line 685 "pir.y"
+#line 692 "pir.y"
     { (yyval.key) = NULL; ;}
     break;
 
   case 43:
-#line 687 "pir.y"
+#line 694 "pir.y"
     { (yyval.key) = (yyvsp[(1) - (1)].key); ;}
     break;
 
   case 44:
-#line 691 "pir.y"
+#line 698 "pir.y"
     { (yyval.key) = new_key(lexer, (yyvsp[(1) - (1)].expr)); ;}
     break;
 
   case 45:
-#line 693 "pir.y"
+#line 700 "pir.y"
     { (yyval.key) = add_key(lexer, (yyvsp[(1) - (3)].key), (yyvsp[(3) - (3)].expr)); ;}
     break;
 
   case 46:
-#line 697 "pir.y"
+#line 704 "pir.y"
     { (yyval.expr) = expr_from_string(lexer, (yyvsp[(1) - (1)].sval)); ;}
     break;
 
   case 48:
-#line 707 "pir.y"
+#line 714 "pir.y"
     { close_sub(lexer); ;}
     break;
 
   case 49:
-#line 711 "pir.y"
+#line 718 "pir.y"
     { new_subr(lexer, lexer->sval /*$2*/); ;}
     break;
 
   case 54:
-#line 723 "pir.y"
+#line 730 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_ANON);;}
     break;
 
   case 55:
-#line 725 "pir.y"
+#line 732 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_INIT); ;}
     break;
 
   case 56:
-#line 727 "pir.y"
+#line 734 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_LOAD); ;}
     break;
 
   case 57:
-#line 729 "pir.y"
+#line 736 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_MAIN); ;}
     break;
 
   case 58:
-#line 731 "pir.y"
+#line 738 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_LEX); ;}
     break;
 
   case 59:
-#line 733 "pir.y"
+#line 740 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_POSTCOMP); ;}
     break;
 
   case 60:
-#line 735 "pir.y"
+#line 742 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_IMMEDIATE); ;}
     break;
 
   case 61:
-#line 737 "pir.y"
+#line 744 "pir.y"
     { set_sub_flag(lexer, PIRC_SUB_FLAG_MULTI); ;}
     break;
 
   case 62:
-#line 739 "pir.y"
+#line 746 "pir.y"
     { set_sub_outer(lexer, (yyvsp[(3) - (4)].sval)); ;}
     break;
 
   case 63:
-#line 741 "pir.y"
+#line 748 "pir.y"
     { set_sub_methodname(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 64:
-#line 743 "pir.y"
+#line 750 "pir.y"
     { set_sub_vtable(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 65:
-#line 745 "pir.y"
+#line 752 "pir.y"
     { set_sub_subid(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 66:
-#line 747 "pir.y"
+#line 754 "pir.y"
     { set_sub_instanceof(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 67:
-#line 749 "pir.y"
+#line 756 "pir.y"
     { set_sub_nsentry(lexer, (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 68:
-#line 753 "pir.y"
+#line 760 "pir.y"
     { set_sub_multi_types(lexer, (yyvsp[(2) - (3)].expr)); ;}
     break;
 
   case 69:
-#line 757 "pir.y"
+#line 764 "pir.y"
     {
                           CURRENT_SUB(lexer)->info.num_multi_types = 1;
                           /* n=1 means :multi() -- without any types. */
@@ -2954,12 +2954,12 @@ yyreduce:
     break;
 
   case 70:
-#line 762 "pir.y"
+#line 769 "pir.y"
     { (yyval.expr) = (yyvsp[(1) - (1)].expr); ;}
     break;
 
   case 71:
-#line 766 "pir.y"
+#line 773 "pir.y"
     {
                           CURRENT_SUB(lexer)->info.num_multi_types = 2;
                           /* start counting multi types; always 1 higher than actual number
@@ -2971,7 +2971,7 @@ yyreduce:
     break;
 
   case 72:
-#line 775 "pir.y"
+#line 782 "pir.y"
     {
                           ++CURRENT_SUB(lexer)->info.num_multi_types;
                           /* link the multi types in reverse other. That's fine,
@@ -2983,32 +2983,32 @@ yyreduce:
     break;
 
   case 73:
-#line 786 "pir.y"
+#line 793 "pir.y"
     { (yyval.expr) = expr_from_ident(lexer, (yyvsp[(1) - (1)].sval)); ;}
     break;
 
   case 74:
-#line 788 "pir.y"
+#line 795 "pir.y"
     { (yyval.expr) = expr_from_string(lexer, (yyvsp[(1) - (1)].sval)); ;}
     break;
 
   case 75:
-#line 790 "pir.y"
+#line 797 "pir.y"
     { (yyval.expr) = expr_from_key(lexer, (yyvsp[(1) - (1)].key)); ;}
     break;
 
   case 76:
-#line 794 "pir.y"
+#line 801 "pir.y"
     { generate_parameters_instr(lexer, (yyvsp[(1) - (1)].uval)); ;}
     break;
 
   case 77:
-#line 798 "pir.y"
+#line 805 "pir.y"
     { (yyval.uval) = 0; ;}
     break;
 
   case 78:
-#line 800 "pir.y"
+#line 807 "pir.y"
     {
                           /* if the :named flag was set, there's an extra
                            * constant string argument for the name. count that too.
@@ -3022,27 +3022,27 @@ yyreduce:
     break;
 
   case 79:
-#line 813 "pir.y"
+#line 820 "pir.y"
     { (yyval.targ) = set_param_flag(lexer, (yyvsp[(2) - (4)].targ), (yyvsp[(3) - (4)].ival)); ;}
     break;
 
   case 80:
-#line 817 "pir.y"
+#line 824 "pir.y"
     { (yyval.targ) = add_param(lexer, (yyvsp[(1) - (2)].ival), (yyvsp[(2) - (2)].sval)); ;}
     break;
 
   case 81:
-#line 821 "pir.y"
+#line 828 "pir.y"
     { (yyval.ival) = 0; ;}
     break;
 
   case 82:
-#line 823 "pir.y"
+#line 830 "pir.y"
     { SET_FLAG((yyval.ival), (yyvsp[(2) - (2)].ival)); ;}
     break;
 
   case 87:
-#line 833 "pir.y"
+#line 840 "pir.y"
     {
                            (yyval.ival) = TARGET_FLAG_LOOKAHEAD;
                            set_param_alias(lexer, (yyvsp[(2) - (2)].sval));
@@ -3050,7 +3050,7 @@ yyreduce:
     break;
 
   case 88:
-#line 840 "pir.y"
+#line 847 "pir.y"
     { (yyval.ival) = TARGET_FLAG_INVOCANT;
                            /* XXX handle multi_type */
 
@@ -3058,12 +3058,12 @@ yyreduce:
     break;
 
   case 89:
-#line 847 "pir.y"
+#line 854 "pir.y"
     { (yyval.ival) = TARGET_FLAG_UNIQUE_REG; ;}
     break;
 
   case 91:
-#line 854 "pir.y"
+#line 861 "pir.y"
     {
                          ++lexer->stmt_counter;
                          /* increment the logical statement counter; a statement can be
@@ -3074,42 +3074,42 @@ yyreduce:
     break;
 
   case 92:
-#line 864 "pir.y"
+#line 871 "pir.y"
     { set_label(lexer, (yyvsp[(1) - (2)].sval)); ;}
     break;
 
   case 110:
-#line 887 "pir.y"
+#line 894 "pir.y"
     { annotate(lexer, (yyvsp[(2) - (5)].sval), (yyvsp[(4) - (5)].cval)); ;}
     break;
 
   case 112:
-#line 897 "pir.y"
+#line 904 "pir.y"
     { (yyval.sval) = expand_macro(yyscanner, (yyvsp[(1) - (3)].mval), (yyvsp[(2) - (3)].pval)); ;}
     break;
 
   case 113:
-#line 901 "pir.y"
+#line 908 "pir.y"
     { (yyval.pval) = NULL; ;}
     break;
 
   case 114:
-#line 903 "pir.y"
+#line 910 "pir.y"
     { (yyval.pval) = (yyvsp[(2) - (3)].pval); ;}
     break;
 
   case 115:
-#line 907 "pir.y"
+#line 914 "pir.y"
     { (yyval.pval) = NULL; ;}
     break;
 
   case 117:
-#line 912 "pir.y"
+#line 919 "pir.y"
     { (yyval.pval) = new_macro_param((yyvsp[(1) - (1)].sval)); ;}
     break;
 
   case 118:
-#line 914 "pir.y"
+#line 921 "pir.y"
     {
                           macro_param *param = new_macro_param((yyvsp[(3) - (3)].sval));
                           param->next = (yyvsp[(1) - (3)].pval);
@@ -3118,7 +3118,7 @@ yyreduce:
     break;
 
   case 119:
-#line 922 "pir.y"
+#line 929 "pir.y"
     {
                           symbol *sym = find_symbol(lexer, (yyvsp[(1) - (1)].sval));
                           if (sym == NULL) {
@@ -3129,22 +3129,22 @@ yyreduce:
     break;
 
   case 121:
-#line 931 "pir.y"
+#line 938 "pir.y"
     { (yyval.sval) = expand_macro(yyscanner, (yyvsp[(1) - (2)].mval), (yyvsp[(2) - (2)].pval)); ;}
     break;
 
   case 123:
-#line 936 "pir.y"
+#line 943 "pir.y"
     { (yyval.sval) = (yyvsp[(2) - (3)].sval); ;}
     break;
 
   case 124:
-#line 941 "pir.y"
+#line 948 "pir.y"
     { (yyval.sval) = ""; ;}
     break;
 
   case 125:
-#line 943 "pir.y"
+#line 950 "pir.y"
     { /* XXX cleanup memory stuff */
                           char *newbuff = (char *)mem_sys_allocate((strlen((yyvsp[(1) - (2)].sval)) + strlen((yyvsp[(2) - (2)].sval)) + 2)
                                                                    * sizeof (char));
@@ -3154,22 +3154,22 @@ yyreduce:
     break;
 
   case 126:
-#line 952 "pir.y"
+#line 959 "pir.y"
     { (yyval.sval) = "\n"; ;}
     break;
 
   case 129:
-#line 956 "pir.y"
+#line 963 "pir.y"
     { (yyval.sval) = expand_macro(yyscanner, (yyvsp[(1) - (2)].mval), (yyvsp[(2) - (2)].pval)); ;}
     break;
 
   case 130:
-#line 964 "pir.y"
+#line 971 "pir.y"
     { set_instr(lexer, NULL); ;}
     break;
 
   case 132:
-#line 972 "pir.y"
+#line 979 "pir.y"
     {
                            if (lexer->parse_errors > MAX_NUM_ERRORS)
                                panic(lexer, "Too many errors. Compilation aborted.\n");
@@ -3179,7 +3179,7 @@ yyreduce:
     break;
 
   case 133:
-#line 981 "pir.y"
+#line 988 "pir.y"
     {
                            set_instrf(lexer, "null", "%T", (yyvsp[(2) - (3)].targ));
                            get_opinfo(lexer);
@@ -3187,14 +3187,14 @@ yyreduce:
     break;
 
   case 134:
-#line 988 "pir.y"
+#line 995 "pir.y"
     {
                            generate_getresults_instr(lexer, (yyvsp[(2) - (3)].targ));
                          ;}
     break;
 
   case 138:
-#line 1001 "pir.y"
+#line 1008 "pir.y"
     { /* at this point, TK_IDENT may in fact be a symbol identifier,
                             * not an op, so don't do any checks like is_parrot_op() just yet.
                             */
@@ -3204,7 +3204,7 @@ yyreduce:
     break;
 
   case 139:
-#line 1010 "pir.y"
+#line 1017 "pir.y"
     { /* when this rule is activated, the initial identifier must
                            * be a parrot op.
                            */
@@ -3214,7 +3214,7 @@ yyreduce:
     break;
 
   case 145:
-#line 1028 "pir.y"
+#line 1035 "pir.y"
     {
                          /* the "instruction" that was set now appears to be
                           * an identifier; get the name, and check its type.
@@ -3251,22 +3251,22 @@ yyreduce:
     break;
 
   case 146:
-#line 1064 "pir.y"
+#line 1071 "pir.y"
     { push_operand(lexer, (yyvsp[(1) - (1)].expr)); ;}
     break;
 
   case 147:
-#line 1066 "pir.y"
+#line 1073 "pir.y"
     { push_operand(lexer, expr_from_key(lexer, (yyvsp[(1) - (1)].key))); ;}
     break;
 
   case 148:
-#line 1070 "pir.y"
+#line 1077 "pir.y"
     { (yyval.expr) = expr_from_const(lexer, (yyvsp[(1) - (1)].cval)); ;}
     break;
 
   case 149:
-#line 1072 "pir.y"
+#line 1079 "pir.y"
     { /* this is either a LABEL or a symbol; in the latter case, the type
                             * will be filled in later. */
                            (yyval.expr) = expr_from_ident(lexer, (yyvsp[(1) - (1)].sval));
@@ -3274,17 +3274,17 @@ yyreduce:
     break;
 
   case 150:
-#line 1077 "pir.y"
+#line 1084 "pir.y"
     { (yyval.expr) = expr_from_target(lexer, (yyvsp[(1) - (1)].targ)); ;}
     break;
 
   case 151:
-#line 1079 "pir.y"
+#line 1086 "pir.y"
     { (yyval.expr) = expr_from_target(lexer, (yyvsp[(1) - (1)].targ)); ;}
     break;
 
   case 152:
-#line 1083 "pir.y"
+#line 1090 "pir.y"
     {
                            /* if $1 is a register, just return that */
                            if (TEST_FLAG((yyvsp[(1) - (2)].targ)->flags, TARGET_FLAG_IS_REG))
@@ -3308,22 +3308,22 @@ yyreduce:
     break;
 
   case 153:
-#line 1106 "pir.y"
+#line 1113 "pir.y"
     { (yyval.key) = (yyvsp[(2) - (3)].key); ;}
     break;
 
   case 154:
-#line 1110 "pir.y"
+#line 1117 "pir.y"
     { (yyval.key) = new_key(lexer, (yyvsp[(1) - (1)].expr)); ;}
     break;
 
   case 155:
-#line 1112 "pir.y"
+#line 1119 "pir.y"
     { (yyval.key) = add_key(lexer, (yyvsp[(1) - (3)].key), (yyvsp[(3) - (3)].expr)); ;}
     break;
 
   case 156:
-#line 1121 "pir.y"
+#line 1128 "pir.y"
     {
                           /* the instruction is already set in parrot_op rule */
                           unshift_operand(lexer, (yyvsp[(4) - (6)].expr));
@@ -3337,7 +3337,7 @@ yyreduce:
     break;
 
   case 157:
-#line 1132 "pir.y"
+#line 1139 "pir.y"
     {
                           /* the instruction is already set in parrot_op rule */
                           unshift_operand(lexer, (yyvsp[(4) - (4)].expr));
@@ -3352,7 +3352,7 @@ yyreduce:
     break;
 
   case 158:
-#line 1144 "pir.y"
+#line 1151 "pir.y"
     {
                           unshift_operand(lexer, expr_from_key(lexer, (yyvsp[(4) - (6)].key)));
                           unshift_operand(lexer, expr_from_target(lexer, (yyvsp[(1) - (6)].targ)));
@@ -3363,7 +3363,7 @@ yyreduce:
     break;
 
   case 162:
-#line 1161 "pir.y"
+#line 1168 "pir.y"
     {
                           if ((yyvsp[(3) - (3)].ival) == 0)
                               set_instrf(lexer, "null", "%T", (yyvsp[(1) - (3)].targ));
@@ -3375,7 +3375,7 @@ yyreduce:
     break;
 
   case 163:
-#line 1170 "pir.y"
+#line 1177 "pir.y"
     {
                           if ((yyvsp[(3) - (3)].dval) == 0.0)
                               set_instrf(lexer, "null", "%T", (yyvsp[(1) - (3)].targ));
@@ -3387,7 +3387,7 @@ yyreduce:
     break;
 
   case 164:
-#line 1179 "pir.y"
+#line 1186 "pir.y"
     {
                           set_instrf(lexer, "set", "%T%C", (yyvsp[(1) - (3)].targ), (yyvsp[(3) - (3)].cval));
                           get_opinfo(lexer);
@@ -3395,7 +3395,7 @@ yyreduce:
     break;
 
   case 165:
-#line 1184 "pir.y"
+#line 1191 "pir.y"
     {
                           set_instrf(lexer, "set", "%T%T", (yyvsp[(1) - (3)].targ), (yyvsp[(3) - (3)].targ));
                           get_opinfo(lexer);
@@ -3403,7 +3403,7 @@ yyreduce:
     break;
 
   case 166:
-#line 1189 "pir.y"
+#line 1196 "pir.y"
     {
                           symbol *sym = find_symbol(lexer, (yyvsp[(3) - (3)].sval));
                           if (sym) {
@@ -3427,7 +3427,7 @@ yyreduce:
     break;
 
   case 167:
-#line 1210 "pir.y"
+#line 1217 "pir.y"
     {
                           unshift_operand(lexer, expr_from_target(lexer, (yyvsp[(1) - (3)].targ)));
                           get_opinfo(lexer);
@@ -3435,7 +3435,7 @@ yyreduce:
     break;
 
   case 168:
-#line 1215 "pir.y"
+#line 1222 "pir.y"
     {
                           /*   $P0 = foo ["bar"]    # PIR style
                            *
@@ -3479,7 +3479,7 @@ yyreduce:
     break;
 
   case 169:
-#line 1256 "pir.y"
+#line 1263 "pir.y"
     {
                           symbol *sym = find_symbol(lexer, (yyvsp[(3) - (4)].sval));
                           target *t;
@@ -3500,7 +3500,7 @@ yyreduce:
     break;
 
   case 170:
-#line 1274 "pir.y"
+#line 1281 "pir.y"
     {
                           target *preg = new_reg(lexer, PMC_TYPE, (yyvsp[(3) - (4)].ival));
                           set_target_key(preg, (yyvsp[(4) - (4)].key));
@@ -3510,7 +3510,7 @@ yyreduce:
     break;
 
   case 171:
-#line 1281 "pir.y"
+#line 1288 "pir.y"
     {
                           set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival)], "%T%E", (yyvsp[(1) - (3)].targ), (yyvsp[(3) - (3)].expr));
                           get_opinfo(lexer);
@@ -3518,7 +3518,7 @@ yyreduce:
     break;
 
   case 172:
-#line 1286 "pir.y"
+#line 1293 "pir.y"
     {
                           if ((yyvsp[(3) - (3)].ival) == 1)
                               set_instrf(lexer, "inc", "%T", (yyvsp[(1) - (3)].targ));
@@ -3532,7 +3532,7 @@ yyreduce:
     break;
 
   case 173:
-#line 1297 "pir.y"
+#line 1304 "pir.y"
     {
                           if ((yyvsp[(3) - (3)].dval) == 1.0)
                               set_instrf(lexer, "inc", "%T", (yyvsp[(1) - (3)].targ));
@@ -3546,7 +3546,7 @@ yyreduce:
     break;
 
   case 174:
-#line 1308 "pir.y"
+#line 1315 "pir.y"
     {
                           if ((yyvsp[(3) - (3)].ival) == 1)
                               set_instrf(lexer, "dec", "%T", (yyvsp[(1) - (3)].targ));
@@ -3560,7 +3560,7 @@ yyreduce:
     break;
 
   case 175:
-#line 1319 "pir.y"
+#line 1326 "pir.y"
     {
                           if ((yyvsp[(3) - (3)].dval) == 1.0)
                               set_instrf(lexer, "dec", "%T", (yyvsp[(1) - (3)].targ));
@@ -3574,7 +3574,7 @@ yyreduce:
     break;
 
   case 176:
-#line 1330 "pir.y"
+#line 1337 "pir.y"
     {
                           set_instrf(lexer, "add", "%T%T", (yyvsp[(1) - (3)].targ), (yyvsp[(3) - (3)].targ));
                           get_opinfo(lexer);
@@ -3582,7 +3582,7 @@ yyreduce:
     break;
 
   case 177:
-#line 1335 "pir.y"
+#line 1342 "pir.y"
     {
                           set_instrf(lexer, "sub", "%T%T", (yyvsp[(1) - (3)].targ), (yyvsp[(3) - (3)].targ));
                           get_opinfo(lexer);
@@ -3590,7 +3590,7 @@ yyreduce:
     break;
 
   case 178:
-#line 1340 "pir.y"
+#line 1347 "pir.y"
     {
                           set_instrf(lexer, (yyvsp[(3) - (4)].sval), "%T%E", (yyvsp[(1) - (4)].targ), (yyvsp[(4) - (4)].expr));
                           get_opinfo(lexer);
@@ -3598,7 +3598,7 @@ yyreduce:
     break;
 
   case 179:
-#line 1345 "pir.y"
+#line 1352 "pir.y"
     {
                           if (targets_equal((yyvsp[(1) - (5)].targ), (yyvsp[(3) - (5)].targ))) /* $P0 = $P0 + $P1 ==> $P0 += $P1 */
                               set_instrf(lexer, opnames[(yyvsp[(4) - (5)].ival)], "%T%E", (yyvsp[(1) - (5)].targ), (yyvsp[(5) - (5)].expr));
@@ -3611,7 +3611,7 @@ yyreduce:
     break;
 
   case 180:
-#line 1355 "pir.y"
+#line 1362 "pir.y"
     {
                           symbol *sym = find_symbol(lexer, (yyvsp[(1) - (4)].sval));
                           target *t;
@@ -3633,7 +3633,7 @@ yyreduce:
     break;
 
   case 181:
-#line 1374 "pir.y"
+#line 1381 "pir.y"
     {
                           target *preg = new_reg(lexer, PMC_TYPE, (yyvsp[(1) - (4)].ival));
                           set_target_key(preg, (yyvsp[(2) - (4)].key));
@@ -3643,97 +3643,97 @@ yyreduce:
     break;
 
   case 182:
-#line 1408 "pir.y"
+#line 1415 "pir.y"
     { set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival)], "%i%T", (yyvsp[(1) - (3)].ival), (yyvsp[(3) - (3)].targ)); ;}
     break;
 
   case 183:
-#line 1410 "pir.y"
+#line 1417 "pir.y"
     { set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival)], "%n%T", (yyvsp[(1) - (3)].dval), (yyvsp[(3) - (3)].targ)); ;}
     break;
 
   case 184:
-#line 1412 "pir.y"
+#line 1419 "pir.y"
     { set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival)], "%s%T", (yyvsp[(1) - (3)].sval), (yyvsp[(3) - (3)].targ)); ;}
     break;
 
   case 185:
-#line 1414 "pir.y"
+#line 1421 "pir.y"
     { set_instrf(lexer, "set", "%C", fold_s_s(yyscanner, (yyvsp[(1) - (3)].sval), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].sval))); ;}
     break;
 
   case 186:
-#line 1416 "pir.y"
+#line 1423 "pir.y"
     { set_instrf(lexer, "set", "%C", fold_i_i(yyscanner, (yyvsp[(1) - (3)].ival), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].ival))); ;}
     break;
 
   case 187:
-#line 1418 "pir.y"
+#line 1425 "pir.y"
     { set_instrf(lexer, "set", "%C", fold_n_n(yyscanner, (yyvsp[(1) - (3)].dval), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].dval))); ;}
     break;
 
   case 188:
-#line 1420 "pir.y"
+#line 1427 "pir.y"
     { set_instrf(lexer, "set", "%C", fold_i_n(yyscanner, (yyvsp[(1) - (3)].ival), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].dval))); ;}
     break;
 
   case 189:
-#line 1422 "pir.y"
+#line 1429 "pir.y"
     { set_instrf(lexer, "set", "%C", fold_n_i(yyscanner, (yyvsp[(1) - (3)].dval), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].ival))); ;}
     break;
 
   case 190:
-#line 1427 "pir.y"
+#line 1434 "pir.y"
     { get_opinfo(lexer); ;}
     break;
 
   case 191:
-#line 1436 "pir.y"
+#line 1443 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, (yyvsp[(3) - (5)].sval), (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 192:
-#line 1438 "pir.y"
+#line 1445 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "int", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 193:
-#line 1440 "pir.y"
+#line 1447 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "num", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 194:
-#line 1442 "pir.y"
+#line 1449 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "pmc", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 195:
-#line 1444 "pir.y"
+#line 1451 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "string", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 196:
-#line 1446 "pir.y"
+#line 1453 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "if", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 197:
-#line 1448 "pir.y"
+#line 1455 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "unless", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 198:
-#line 1450 "pir.y"
+#line 1457 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "goto", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 199:
-#line 1452 "pir.y"
+#line 1459 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (5)].ival), 1, "null", (yyvsp[(5) - (5)].sval)); ;}
     break;
 
   case 200:
-#line 1454 "pir.y"
+#line 1461 "pir.y"
     {
                           int istrue = evaluate_c(lexer, (yyvsp[(2) - (4)].cval));
                           /* if "unless", invert the true-ness */
@@ -3748,7 +3748,7 @@ yyreduce:
     break;
 
   case 201:
-#line 1466 "pir.y"
+#line 1473 "pir.y"
     {
                           set_instrf(lexer, (yyvsp[(1) - (5)].ival) ? "unless_null" : "if_null", "%T%I",
                                      new_reg(lexer, PMC_TYPE, (yyvsp[(3) - (5)].ival)), (yyvsp[(5) - (5)].sval));
@@ -3758,12 +3758,12 @@ yyreduce:
     break;
 
   case 202:
-#line 1473 "pir.y"
+#line 1480 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, (yyvsp[(2) - (4)].sval), (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 203:
-#line 1475 "pir.y"
+#line 1482 "pir.y"
     {
                           set_instrf(lexer, (yyvsp[(1) - (4)].ival) ? "unless" : "if", "%T%I", (yyvsp[(2) - (4)].targ), (yyvsp[(4) - (4)].sval));
                           /* set a flag indicating that the 2nd operand is a label */
@@ -3772,57 +3772,57 @@ yyreduce:
     break;
 
   case 204:
-#line 1481 "pir.y"
+#line 1488 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "int", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 205:
-#line 1483 "pir.y"
+#line 1490 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "num", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 206:
-#line 1485 "pir.y"
+#line 1492 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "pmc", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 207:
-#line 1487 "pir.y"
+#line 1494 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "string", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 208:
-#line 1489 "pir.y"
+#line 1496 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "if", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 209:
-#line 1491 "pir.y"
+#line 1498 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "unless", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 210:
-#line 1493 "pir.y"
+#line 1500 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "goto", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 211:
-#line 1495 "pir.y"
+#line 1502 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "goto", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 212:
-#line 1497 "pir.y"
+#line 1504 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "null", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 213:
-#line 1499 "pir.y"
+#line 1506 "pir.y"
     { create_if_instr(lexer, (yyvsp[(1) - (4)].ival), 0, "null", (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 214:
-#line 1501 "pir.y"
+#line 1508 "pir.y"
     {
                           if ((yyvsp[(2) - (4)].ival) == COMPUTE_DURING_RUNTIME) {
                              if ((yyvsp[(1) - (4)].ival) == NEED_INVERT_OPNAME) /* "unless" */
@@ -3850,7 +3850,7 @@ yyreduce:
     break;
 
   case 215:
-#line 1532 "pir.y"
+#line 1539 "pir.y"
     {
                           /* the instructions "gt" and "ge" are converted to "lt" and "le".
                            * if so, then the arguments must be reversed as well. "lt" and
@@ -3879,7 +3879,7 @@ yyreduce:
     break;
 
   case 216:
-#line 1558 "pir.y"
+#line 1565 "pir.y"
     {
                           if (((yyvsp[(0) - (3)].ival) != NEED_INVERT_OPNAME) && ((yyvsp[(2) - (3)].ival) == OP_GE || (yyvsp[(2) - (3)].ival) == OP_GT))
                               set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival) + 1], "%T%i", (yyvsp[(3) - (3)].targ), (yyvsp[(1) - (3)].ival));
@@ -3890,7 +3890,7 @@ yyreduce:
     break;
 
   case 217:
-#line 1566 "pir.y"
+#line 1573 "pir.y"
     {
                           if (((yyvsp[(0) - (3)].ival) != NEED_INVERT_OPNAME) && ((yyvsp[(2) - (3)].ival) == OP_GE || (yyvsp[(2) - (3)].ival) == OP_GT))
                               set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival) + 1], "%T%n", (yyvsp[(3) - (3)].targ), (yyvsp[(1) - (3)].dval));
@@ -3902,7 +3902,7 @@ yyreduce:
     break;
 
   case 218:
-#line 1575 "pir.y"
+#line 1582 "pir.y"
     {
                           if (((yyvsp[(0) - (3)].ival) != NEED_INVERT_OPNAME) && ((yyvsp[(2) - (3)].ival) == OP_GE || (yyvsp[(2) - (3)].ival) == OP_GT))
                               set_instrf(lexer, opnames[(yyvsp[(2) - (3)].ival)], "%T%s", (yyvsp[(3) - (3)].targ), (yyvsp[(1) - (3)].sval));
@@ -3914,32 +3914,32 @@ yyreduce:
     break;
 
   case 219:
-#line 1584 "pir.y"
+#line 1591 "pir.y"
     { (yyval.ival) = evaluate_i_i((yyvsp[(1) - (3)].ival), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].ival)); ;}
     break;
 
   case 220:
-#line 1586 "pir.y"
+#line 1593 "pir.y"
     { (yyval.ival) = evaluate_i_n((yyvsp[(1) - (3)].ival), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].dval)); ;}
     break;
 
   case 221:
-#line 1588 "pir.y"
+#line 1595 "pir.y"
     { (yyval.ival) = evaluate_n_i((yyvsp[(1) - (3)].dval), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].ival)); ;}
     break;
 
   case 222:
-#line 1590 "pir.y"
+#line 1597 "pir.y"
     { (yyval.ival) = evaluate_n_n((yyvsp[(1) - (3)].dval), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].dval)); ;}
     break;
 
   case 223:
-#line 1592 "pir.y"
+#line 1599 "pir.y"
     { (yyval.ival) = evaluate_s_s((yyvsp[(1) - (3)].sval), (yyvsp[(2) - (3)].ival), (yyvsp[(3) - (3)].sval)); ;}
     break;
 
   case 224:
-#line 1596 "pir.y"
+#line 1603 "pir.y"
     {
                           yypirerror(yyscanner, lexer, "cannot compare string to %s",
                                      (yyvsp[(3) - (3)].ival) == INT_TYPE ? "integer" : "number");
@@ -3947,37 +3947,37 @@ yyreduce:
     break;
 
   case 225:
-#line 1601 "pir.y"
+#line 1608 "pir.y"
     { yypirerror(yyscanner, lexer, "cannot compare integer to string"); ;}
     break;
 
   case 226:
-#line 1603 "pir.y"
+#line 1610 "pir.y"
     { yypirerror(yyscanner, lexer, "cannot compare number to string"); ;}
     break;
 
   case 227:
-#line 1607 "pir.y"
+#line 1614 "pir.y"
     { (yyval.ival) = INT_TYPE; ;}
     break;
 
   case 228:
-#line 1608 "pir.y"
+#line 1615 "pir.y"
     { (yyval.ival) = NUM_TYPE; ;}
     break;
 
   case 229:
-#line 1611 "pir.y"
+#line 1618 "pir.y"
     { (yyval.ival) = DONT_INVERT_OPNAME; /* no need to invert */ ;}
     break;
 
   case 230:
-#line 1612 "pir.y"
+#line 1619 "pir.y"
     { (yyval.ival) = NEED_INVERT_OPNAME; /* yes, invert opname */ ;}
     break;
 
   case 233:
-#line 1620 "pir.y"
+#line 1627 "pir.y"
     {
                           set_instrf(lexer, "branch", "%I", (yyvsp[(2) - (3)].sval));
                           set_op_labelflag(lexer, BIT(0)); /* bit 0 means: "1 << 0" */
@@ -3986,37 +3986,37 @@ yyreduce:
     break;
 
   case 234:
-#line 1628 "pir.y"
+#line 1635 "pir.y"
     { declare_local(lexer, (yyvsp[(2) - (4)].ival), (yyvsp[(3) - (4)].symb)); ;}
     break;
 
   case 235:
-#line 1632 "pir.y"
+#line 1639 "pir.y"
     { (yyval.symb) = (yyvsp[(1) - (1)].symb); ;}
     break;
 
   case 236:
-#line 1634 "pir.y"
+#line 1641 "pir.y"
     { (yyval.symb) = add_local((yyvsp[(1) - (3)].symb), (yyvsp[(3) - (3)].symb)); ;}
     break;
 
   case 237:
-#line 1638 "pir.y"
+#line 1645 "pir.y"
     { (yyval.symb) = new_local(lexer, (yyvsp[(1) - (2)].sval), (yyvsp[(2) - (2)].ival)); ;}
     break;
 
   case 238:
-#line 1641 "pir.y"
+#line 1648 "pir.y"
     { (yyval.ival) = 0; ;}
     break;
 
   case 239:
-#line 1642 "pir.y"
+#line 1649 "pir.y"
     { (yyval.ival) = 1; ;}
     break;
 
   case 240:
-#line 1646 "pir.y"
+#line 1653 "pir.y"
     { /* if $4 is not a register, it must be a declared symbol */
                           if (!TEST_FLAG((yyvsp[(4) - (5)].targ)->flags, TARGET_FLAG_IS_REG)) {
 
@@ -4029,12 +4029,12 @@ yyreduce:
     break;
 
   case 241:
-#line 1661 "pir.y"
+#line 1668 "pir.y"
     { convert_inv_to_instr(lexer, (yyvsp[(1) - (1)].invo)); ;}
     break;
 
   case 244:
-#line 1673 "pir.y"
+#line 1680 "pir.y"
     { /* $4 contains an invocation object */
                               set_invocation_args(lexer, (yyvsp[(4) - (8)].invo), (yyvsp[(3) - (8)].argm));
                               (yyval.invo) = set_invocation_results(lexer, (yyvsp[(4) - (8)].invo), (yyvsp[(6) - (8)].targ));
@@ -4042,72 +4042,72 @@ yyreduce:
     break;
 
   case 245:
-#line 1680 "pir.y"
+#line 1687 "pir.y"
     { (yyval.argm) = NULL; ;}
     break;
 
   case 246:
-#line 1682 "pir.y"
+#line 1689 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 247:
-#line 1686 "pir.y"
+#line 1693 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 248:
-#line 1688 "pir.y"
+#line 1695 "pir.y"
     { (yyval.argm) = add_arg((yyvsp[(1) - (2)].argm), (yyvsp[(2) - (2)].argm)); ;}
     break;
 
   case 249:
-#line 1692 "pir.y"
+#line 1699 "pir.y"
     { (yyval.argm) = (yyvsp[(2) - (3)].argm); ;}
     break;
 
   case 250:
-#line 1696 "pir.y"
+#line 1703 "pir.y"
     { (yyval.invo) = invoke(lexer, CALL_PCC, (yyvsp[(2) - (3)].targ), (yyvsp[(3) - (3)].targ)); ;}
     break;
 
   case 251:
-#line 1698 "pir.y"
+#line 1705 "pir.y"
     { (yyval.invo) = invoke(lexer, CALL_NCI, (yyvsp[(2) - (2)].targ)); ;}
     break;
 
   case 252:
-#line 1701 "pir.y"
+#line 1708 "pir.y"
     { (yyval.invo) = invoke(lexer, CALL_METHOD, (yyvsp[(2) - (5)].targ), (yyvsp[(5) - (5)].expr)); ;}
     break;
 
   case 253:
-#line 1705 "pir.y"
+#line 1712 "pir.y"
     { (yyval.targ) = NULL; ;}
     break;
 
   case 254:
-#line 1707 "pir.y"
+#line 1714 "pir.y"
     { (yyval.targ) = (yyvsp[(2) - (2)].targ); ;}
     break;
 
   case 255:
-#line 1711 "pir.y"
+#line 1718 "pir.y"
     { (yyval.targ) = NULL; ;}
     break;
 
   case 256:
-#line 1713 "pir.y"
+#line 1720 "pir.y"
     { (yyval.targ) = (yyvsp[(1) - (1)].targ); ;}
     break;
 
   case 257:
-#line 1717 "pir.y"
+#line 1724 "pir.y"
     { (yyval.targ) = (yyvsp[(1) - (1)].targ); ;}
     break;
 
   case 258:
-#line 1719 "pir.y"
+#line 1726 "pir.y"
     {
                              if ((yyvsp[(2) - (2)].targ))
                                  (yyval.targ) = add_target(lexer, (yyvsp[(1) - (2)].targ), (yyvsp[(2) - (2)].targ));
@@ -4117,32 +4117,32 @@ yyreduce:
     break;
 
   case 259:
-#line 1728 "pir.y"
+#line 1735 "pir.y"
     { (yyval.targ) = (yyvsp[(2) - (3)].targ); ;}
     break;
 
   case 260:
-#line 1730 "pir.y"
+#line 1737 "pir.y"
     { (yyval.targ) = NULL; ;}
     break;
 
   case 262:
-#line 1738 "pir.y"
+#line 1745 "pir.y"
     { (yyval.invo) = set_invocation_results(lexer, (yyvsp[(3) - (3)].invo), (yyvsp[(1) - (3)].targ)); ;}
     break;
 
   case 263:
-#line 1740 "pir.y"
+#line 1747 "pir.y"
     { (yyval.invo) = set_invocation_results(lexer, (yyvsp[(3) - (3)].invo), (yyvsp[(1) - (3)].targ)); ;}
     break;
 
   case 264:
-#line 1742 "pir.y"
+#line 1749 "pir.y"
     {  (yyval.invo) = set_invocation_results(lexer, (yyvsp[(1) - (1)].invo), NULL); ;}
     break;
 
   case 267:
-#line 1750 "pir.y"
+#line 1757 "pir.y"
     {
                              /* if $1 is not a register, check whether the symbol was declared */
                              if (!TEST_FLAG((yyvsp[(1) - (4)].targ)->flags, TARGET_FLAG_IS_REG)) {
@@ -4163,7 +4163,7 @@ yyreduce:
     break;
 
   case 268:
-#line 1770 "pir.y"
+#line 1777 "pir.y"
     {
                              (yyval.invo) = invoke(lexer, CALL_PCC, (yyvsp[(1) - (2)].targ), NULL);
                              set_invocation_args(lexer, (yyval.invo), (yyvsp[(2) - (2)].argm));
@@ -4171,12 +4171,12 @@ yyreduce:
     break;
 
   case 269:
-#line 1777 "pir.y"
+#line 1784 "pir.y"
     { (yyval.targ) = (yyvsp[(1) - (1)].targ); ;}
     break;
 
   case 270:
-#line 1779 "pir.y"
+#line 1786 "pir.y"
     {
                              symbol *sym = find_symbol(lexer, (yyvsp[(1) - (1)].sval));
                              if (sym == NULL)
@@ -4187,7 +4187,7 @@ yyreduce:
     break;
 
   case 271:
-#line 1789 "pir.y"
+#line 1796 "pir.y"
     { /* check that this identifier was declared */
                              symbol *sym = find_symbol(lexer, (yyvsp[(1) - (1)].sval));
 
@@ -4207,22 +4207,22 @@ yyreduce:
     break;
 
   case 272:
-#line 1806 "pir.y"
+#line 1813 "pir.y"
     { (yyval.expr) = expr_from_target(lexer, new_reg(lexer, PMC_TYPE, (yyvsp[(1) - (1)].ival))); ;}
     break;
 
   case 273:
-#line 1808 "pir.y"
+#line 1815 "pir.y"
     { (yyval.expr) = expr_from_target(lexer, new_reg(lexer, STRING_TYPE, (yyvsp[(1) - (1)].ival))); ;}
     break;
 
   case 274:
-#line 1810 "pir.y"
+#line 1817 "pir.y"
     { (yyval.expr) = expr_from_const(lexer, new_const(lexer, STRING_VAL, (yyvsp[(1) - (1)].sval))); ;}
     break;
 
   case 275:
-#line 1814 "pir.y"
+#line 1821 "pir.y"
     {
                              symbol *sym = find_symbol(lexer, (yyvsp[(1) - (1)].sval));
                              if (sym == NULL)
@@ -4234,74 +4234,74 @@ yyreduce:
     break;
 
   case 276:
-#line 1823 "pir.y"
+#line 1830 "pir.y"
     { (yyval.targ) = new_reg(lexer, PMC_TYPE, (yyvsp[(1) - (1)].ival)); ;}
     break;
 
   case 277:
-#line 1828 "pir.y"
+#line 1835 "pir.y"
     {
                              (yyval.targ) = (yyvsp[(2) - (3)].targ);
                            ;}
     break;
 
   case 278:
-#line 1834 "pir.y"
+#line 1841 "pir.y"
     { (yyval.targ) = NULL; ;}
     break;
 
   case 279:
-#line 1836 "pir.y"
+#line 1843 "pir.y"
     { (yyval.targ) = (yyvsp[(1) - (1)].targ); ;}
     break;
 
   case 280:
-#line 1840 "pir.y"
+#line 1847 "pir.y"
     { (yyval.targ) = (yyvsp[(1) - (1)].targ); ;}
     break;
 
   case 281:
-#line 1842 "pir.y"
+#line 1849 "pir.y"
     { (yyval.targ) = add_target(lexer, (yyvsp[(1) - (3)].targ), (yyvsp[(3) - (3)].targ)); ;}
     break;
 
   case 282:
-#line 1846 "pir.y"
+#line 1853 "pir.y"
     { (yyval.targ) = set_param_flag(lexer, (yyvsp[(1) - (2)].targ), (yyvsp[(2) - (2)].ival)); ;}
     break;
 
   case 283:
-#line 1848 "pir.y"
+#line 1855 "pir.y"
     { (yyval.targ) = set_param_alias(lexer, (yyvsp[(1) - (3)].sval)); ;}
     break;
 
   case 284:
-#line 1852 "pir.y"
+#line 1859 "pir.y"
     { (yyval.ival) = 0; ;}
     break;
 
   case 285:
-#line 1854 "pir.y"
+#line 1861 "pir.y"
     { SET_FLAG((yyval.ival), (yyvsp[(2) - (2)].ival)); ;}
     break;
 
   case 286:
-#line 1858 "pir.y"
+#line 1865 "pir.y"
     { (yyval.ival) = TARGET_FLAG_OPTIONAL; ;}
     break;
 
   case 287:
-#line 1860 "pir.y"
+#line 1867 "pir.y"
     { (yyval.ival) = TARGET_FLAG_OPT_FLAG; ;}
     break;
 
   case 288:
-#line 1862 "pir.y"
+#line 1869 "pir.y"
     { (yyval.ival) = TARGET_FLAG_SLURPY; ;}
     break;
 
   case 289:
-#line 1864 "pir.y"
+#line 1871 "pir.y"
     {
                              (yyval.ival) = TARGET_FLAG_NAMED;
                              set_param_alias(lexer, (yyvsp[(2) - (2)].sval));
@@ -4309,12 +4309,12 @@ yyreduce:
     break;
 
   case 290:
-#line 1874 "pir.y"
+#line 1881 "pir.y"
     { convert_inv_to_instr(lexer, (yyvsp[(1) - (1)].invo)); ;}
     break;
 
   case 295:
-#line 1884 "pir.y"
+#line 1891 "pir.y"
     {
                               (yyval.invo) = invoke(lexer, CALL_RETURN);
                               set_invocation_args(lexer, (yyval.invo), (yyvsp[(2) - (3)].argm));
@@ -4322,7 +4322,7 @@ yyreduce:
     break;
 
   case 296:
-#line 1889 "pir.y"
+#line 1896 "pir.y"
     { /* was the invocation a method call? then it becomes a method tail
                                * call, otherwise it's just a normal (sub) tail call.
                                */
@@ -4334,7 +4334,7 @@ yyreduce:
     break;
 
   case 297:
-#line 1900 "pir.y"
+#line 1907 "pir.y"
     {
                               (yyval.invo) = invoke(lexer, CALL_YIELD);
                               set_invocation_args(lexer, (yyval.invo), (yyvsp[(2) - (3)].argm));
@@ -4342,47 +4342,47 @@ yyreduce:
     break;
 
   case 298:
-#line 1907 "pir.y"
+#line 1914 "pir.y"
     { (yyval.argm) = (yyvsp[(2) - (3)].argm); ;}
     break;
 
   case 299:
-#line 1911 "pir.y"
+#line 1918 "pir.y"
     { (yyval.argm) = NULL; ;}
     break;
 
   case 300:
-#line 1913 "pir.y"
+#line 1920 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 301:
-#line 1917 "pir.y"
+#line 1924 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 302:
-#line 1919 "pir.y"
+#line 1926 "pir.y"
     { (yyval.argm) = add_arg((yyvsp[(1) - (3)].argm), (yyvsp[(3) - (3)].argm)); ;}
     break;
 
   case 305:
-#line 1927 "pir.y"
+#line 1934 "pir.y"
     { (yyval.argm) = set_arg_alias(lexer, (yyvsp[(1) - (3)].sval)); ;}
     break;
 
   case 306:
-#line 1931 "pir.y"
+#line 1938 "pir.y"
     { (yyval.argm) = set_arg_flag((yyval.argm), (yyvsp[(2) - (2)].ival)); ;}
     break;
 
   case 307:
-#line 1935 "pir.y"
+#line 1942 "pir.y"
     { (yyval.argm) = set_curarg(lexer, new_argument(lexer, (yyvsp[(1) - (1)].expr)));  ;}
     break;
 
   case 308:
-#line 1941 "pir.y"
+#line 1948 "pir.y"
     {
                               (yyval.invo) = invoke(lexer, CALL_RETURN);
                               set_invocation_args(lexer, (yyval.invo), (yyvsp[(3) - (5)].argm));
@@ -4390,7 +4390,7 @@ yyreduce:
     break;
 
   case 309:
-#line 1950 "pir.y"
+#line 1957 "pir.y"
     {
                               (yyval.invo) = invoke(lexer, CALL_YIELD);
                               set_invocation_args(lexer, (yyval.invo), (yyvsp[(3) - (5)].argm));
@@ -4398,72 +4398,72 @@ yyreduce:
     break;
 
   case 310:
-#line 1957 "pir.y"
+#line 1964 "pir.y"
     { (yyval.argm) = NULL; ;}
     break;
 
   case 311:
-#line 1959 "pir.y"
+#line 1966 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 312:
-#line 1964 "pir.y"
+#line 1971 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 313:
-#line 1966 "pir.y"
+#line 1973 "pir.y"
     { (yyval.argm) = add_arg((yyvsp[(1) - (2)].argm), (yyvsp[(2) - (2)].argm)); ;}
     break;
 
   case 314:
-#line 1971 "pir.y"
+#line 1978 "pir.y"
     { (yyval.argm) = (yyvsp[(2) - (3)].argm); ;}
     break;
 
   case 315:
-#line 1975 "pir.y"
+#line 1982 "pir.y"
     { (yyval.argm) = NULL; ;}
     break;
 
   case 316:
-#line 1977 "pir.y"
+#line 1984 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 317:
-#line 1981 "pir.y"
+#line 1988 "pir.y"
     { (yyval.argm) = (yyvsp[(1) - (1)].argm); ;}
     break;
 
   case 318:
-#line 1983 "pir.y"
+#line 1990 "pir.y"
     { (yyval.argm) = add_arg((yyvsp[(1) - (2)].argm), (yyvsp[(2) - (2)].argm)); ;}
     break;
 
   case 319:
-#line 1987 "pir.y"
+#line 1994 "pir.y"
     { (yyval.argm) = (yyvsp[(2) - (3)].argm); ;}
     break;
 
   case 320:
-#line 1992 "pir.y"
+#line 1999 "pir.y"
     { (yyval.ival) = 0; ;}
     break;
 
   case 321:
-#line 1994 "pir.y"
+#line 2001 "pir.y"
     { SET_FLAG((yyval.ival), (yyvsp[(2) - (2)].ival)); ;}
     break;
 
   case 322:
-#line 1998 "pir.y"
+#line 2005 "pir.y"
     { (yyval.ival) = ARG_FLAG_FLAT; ;}
     break;
 
   case 323:
-#line 2000 "pir.y"
+#line 2007 "pir.y"
     {
                                (yyval.ival) = ARG_FLAG_NAMED;
                                set_arg_alias(lexer, (yyvsp[(2) - (2)].sval));
@@ -4471,62 +4471,62 @@ yyreduce:
     break;
 
   case 324:
-#line 2007 "pir.y"
+#line 2014 "pir.y"
     { (yyval.sval) = NULL; ;}
     break;
 
   case 325:
-#line 2009 "pir.y"
+#line 2016 "pir.y"
     { (yyval.sval) = (yyvsp[(1) - (1)].sval); ;}
     break;
 
   case 326:
-#line 2013 "pir.y"
+#line 2020 "pir.y"
     { (yyval.sval) = (yyvsp[(2) - (3)].sval); ;}
     break;
 
   case 328:
-#line 2020 "pir.y"
+#line 2027 "pir.y"
     { store_global_constant(lexer, (yyvsp[(2) - (2)].cdec)); ;}
     break;
 
   case 331:
-#line 2028 "pir.y"
+#line 2035 "pir.y"
     { (yyval.cdec) = (yyvsp[(2) - (2)].cdec); ;}
     break;
 
   case 334:
-#line 2036 "pir.y"
+#line 2043 "pir.y"
     { store_global_constant(lexer, (yyvsp[(2) - (2)].cdec)); ;}
     break;
 
   case 335:
-#line 2040 "pir.y"
+#line 2047 "pir.y"
     { (yyval.cdec) = new_named_const(lexer, INT_VAL, (yyvsp[(2) - (4)].sval), (yyvsp[(4) - (4)].ival)); ;}
     break;
 
   case 336:
-#line 2042 "pir.y"
+#line 2049 "pir.y"
     { (yyval.cdec) = new_named_const(lexer, NUM_VAL, (yyvsp[(2) - (4)].sval), (yyvsp[(4) - (4)].dval)); ;}
     break;
 
   case 337:
-#line 2044 "pir.y"
+#line 2051 "pir.y"
     { (yyval.cdec) = new_named_const(lexer, STRING_VAL, (yyvsp[(2) - (4)].sval), (yyvsp[(4) - (4)].sval)); ;}
     break;
 
   case 338:
-#line 2046 "pir.y"
+#line 2053 "pir.y"
     { (yyval.cdec) = new_named_const(lexer, USTRING_VAL, (yyvsp[(2) - (4)].sval), (yyvsp[(4) - (4)].ustr)); ;}
     break;
 
   case 339:
-#line 2050 "pir.y"
+#line 2057 "pir.y"
     { (yyval.cdec) = new_pmc_const(lexer, (yyvsp[(1) - (4)].sval), (yyvsp[(2) - (4)].sval), (yyvsp[(4) - (4)].cval)); ;}
     break;
 
   case 341:
-#line 2055 "pir.y"
+#line 2062 "pir.y"
     { /* this alternative is necessary, otherwise the parser
                                * just stops when assigning an identifier to a pmc
                                * const, without an error message. That may be
@@ -4537,97 +4537,97 @@ yyreduce:
     break;
 
   case 342:
-#line 2067 "pir.y"
+#line 2074 "pir.y"
     { (yyval.expr) = expr_from_target(lexer, (yyvsp[(1) - (1)].targ)); ;}
     break;
 
   case 343:
-#line 2068 "pir.y"
+#line 2075 "pir.y"
     { (yyval.expr) = expr_from_const(lexer, (yyvsp[(1) - (1)].cval)); ;}
     break;
 
   case 344:
-#line 2072 "pir.y"
+#line 2079 "pir.y"
     { (yyval.cval) = new_const(lexer, INT_VAL, (yyvsp[(1) - (1)].ival)); ;}
     break;
 
   case 345:
-#line 2073 "pir.y"
+#line 2080 "pir.y"
     { (yyval.cval) = new_const(lexer, NUM_VAL, (yyvsp[(1) - (1)].dval)); ;}
     break;
 
   case 346:
-#line 2074 "pir.y"
+#line 2081 "pir.y"
     { (yyval.cval) = (yyvsp[(1) - (1)].cval); ;}
     break;
 
   case 347:
-#line 2077 "pir.y"
+#line 2084 "pir.y"
     { (yyval.cval) = new_const(lexer, STRING_VAL, (yyvsp[(1) - (1)].sval)); ;}
     break;
 
   case 348:
-#line 2078 "pir.y"
+#line 2085 "pir.y"
     { (yyval.cval) = new_const(lexer, USTRING_VAL, (yyvsp[(1) - (1)].ustr)); ;}
     break;
 
   case 349:
-#line 2081 "pir.y"
+#line 2088 "pir.y"
     { (yyval.ival) = OP_NE; ;}
     break;
 
   case 350:
-#line 2082 "pir.y"
+#line 2089 "pir.y"
     { (yyval.ival) = OP_EQ; ;}
     break;
 
   case 351:
-#line 2083 "pir.y"
+#line 2090 "pir.y"
     { (yyval.ival) = OP_LT; ;}
     break;
 
   case 352:
-#line 2084 "pir.y"
+#line 2091 "pir.y"
     { (yyval.ival) = OP_LE; ;}
     break;
 
   case 353:
-#line 2085 "pir.y"
+#line 2092 "pir.y"
     { (yyval.ival) = OP_GE; ;}
     break;
 
   case 354:
-#line 2086 "pir.y"
+#line 2093 "pir.y"
     { (yyval.ival) = OP_GT; ;}
     break;
 
   case 355:
-#line 2089 "pir.y"
+#line 2096 "pir.y"
     { (yyval.ival) = INT_TYPE; ;}
     break;
 
   case 356:
-#line 2090 "pir.y"
+#line 2097 "pir.y"
     { (yyval.ival) = NUM_TYPE; ;}
     break;
 
   case 357:
-#line 2091 "pir.y"
+#line 2098 "pir.y"
     { (yyval.ival) = PMC_TYPE; ;}
     break;
 
   case 358:
-#line 2092 "pir.y"
+#line 2099 "pir.y"
     { (yyval.ival) = STRING_TYPE; ;}
     break;
 
   case 359:
-#line 2100 "pir.y"
+#line 2107 "pir.y"
     { set_curtarget(lexer, (yyvsp[(1) - (1)].targ));  ;}
     break;
 
   case 361:
-#line 2104 "pir.y"
+#line 2111 "pir.y"
     { /* a symbol must have been declared; check that at this point. */
                            symbol * sym = find_symbol(lexer, (yyvsp[(1) - (1)].sval));
                            if (sym == NULL) {
@@ -4642,277 +4642,277 @@ yyreduce:
     break;
 
   case 362:
-#line 2117 "pir.y"
+#line 2124 "pir.y"
     { (yyval.targ) = new_reg(lexer, PMC_TYPE, (yyvsp[(1) - (1)].ival));    ;}
     break;
 
   case 363:
-#line 2118 "pir.y"
+#line 2125 "pir.y"
     { (yyval.targ) = new_reg(lexer, NUM_TYPE, (yyvsp[(1) - (1)].ival));    ;}
     break;
 
   case 364:
-#line 2119 "pir.y"
+#line 2126 "pir.y"
     { (yyval.targ) = new_reg(lexer, INT_TYPE, (yyvsp[(1) - (1)].ival));    ;}
     break;
 
   case 365:
-#line 2120 "pir.y"
+#line 2127 "pir.y"
     { (yyval.targ) = new_reg(lexer, STRING_TYPE, (yyvsp[(1) - (1)].ival)); ;}
     break;
 
   case 368:
-#line 2128 "pir.y"
+#line 2135 "pir.y"
     { (yyval.sval) = "if"; ;}
     break;
 
   case 369:
-#line 2129 "pir.y"
+#line 2136 "pir.y"
     { (yyval.sval) = "unless"; ;}
     break;
 
   case 370:
-#line 2130 "pir.y"
+#line 2137 "pir.y"
     { (yyval.sval) = "goto"; ;}
     break;
 
   case 371:
-#line 2131 "pir.y"
+#line 2138 "pir.y"
     { (yyval.sval) = "int"; ;}
     break;
 
   case 372:
-#line 2132 "pir.y"
+#line 2139 "pir.y"
     { (yyval.sval) = "num"; ;}
     break;
 
   case 373:
-#line 2133 "pir.y"
+#line 2140 "pir.y"
     { (yyval.sval) = "string"; ;}
     break;
 
   case 374:
-#line 2134 "pir.y"
+#line 2141 "pir.y"
     { (yyval.sval) = "pmc"; ;}
     break;
 
   case 375:
-#line 2135 "pir.y"
+#line 2142 "pir.y"
     { (yyval.sval) = "null"; ;}
     break;
 
   case 376:
-#line 2138 "pir.y"
+#line 2145 "pir.y"
     { (yyval.sval) = "neg"; ;}
     break;
 
   case 377:
-#line 2139 "pir.y"
+#line 2146 "pir.y"
     { (yyval.sval) = "not"; ;}
     break;
 
   case 378:
-#line 2140 "pir.y"
+#line 2147 "pir.y"
     { (yyval.sval) = "bnot"; ;}
     break;
 
   case 379:
-#line 2143 "pir.y"
+#line 2150 "pir.y"
     { (yyval.ival) = OP_ADD; ;}
     break;
 
   case 380:
-#line 2144 "pir.y"
+#line 2151 "pir.y"
     { (yyval.ival) = OP_SUB; ;}
     break;
 
   case 381:
-#line 2145 "pir.y"
+#line 2152 "pir.y"
     { (yyval.ival) = OP_DIV; ;}
     break;
 
   case 382:
-#line 2146 "pir.y"
+#line 2153 "pir.y"
     { (yyval.ival) = OP_MUL; ;}
     break;
 
   case 383:
-#line 2147 "pir.y"
+#line 2154 "pir.y"
     { (yyval.ival) = OP_MOD; ;}
     break;
 
   case 384:
-#line 2148 "pir.y"
+#line 2155 "pir.y"
     { (yyval.ival) = OP_BOR; ;}
     break;
 
   case 385:
-#line 2149 "pir.y"
+#line 2156 "pir.y"
     { (yyval.ival) = OP_BAND; ;}
     break;
 
   case 386:
-#line 2150 "pir.y"
+#line 2157 "pir.y"
     { (yyval.ival) = OP_BXOR; ;}
     break;
 
   case 387:
-#line 2151 "pir.y"
+#line 2158 "pir.y"
     { (yyval.ival) = OP_POW; ;}
     break;
 
   case 388:
-#line 2152 "pir.y"
+#line 2159 "pir.y"
     { (yyval.ival) = OP_CONCAT; ;}
     break;
 
   case 389:
-#line 2153 "pir.y"
+#line 2160 "pir.y"
     { (yyval.ival) = OP_LSR; ;}
     break;
 
   case 390:
-#line 2154 "pir.y"
+#line 2161 "pir.y"
     { (yyval.ival) = OP_SHR; ;}
     break;
 
   case 391:
-#line 2155 "pir.y"
+#line 2162 "pir.y"
     { (yyval.ival) = OP_SHL; ;}
     break;
 
   case 392:
-#line 2156 "pir.y"
+#line 2163 "pir.y"
     { (yyval.ival) = OP_OR; ;}
     break;
 
   case 393:
-#line 2157 "pir.y"
+#line 2164 "pir.y"
     { (yyval.ival) = OP_AND; ;}
     break;
 
   case 394:
-#line 2158 "pir.y"
+#line 2165 "pir.y"
     { (yyval.ival) = OP_FDIV; ;}
     break;
 
   case 395:
-#line 2159 "pir.y"
+#line 2166 "pir.y"
     { (yyval.ival) = OP_XOR; ;}
     break;
 
   case 396:
-#line 2160 "pir.y"
+#line 2167 "pir.y"
     { (yyval.ival) = OP_ISEQ; ;}
     break;
 
   case 397:
-#line 2161 "pir.y"
+#line 2168 "pir.y"
     { (yyval.ival) = OP_ISLE; ;}
     break;
 
   case 398:
-#line 2162 "pir.y"
+#line 2169 "pir.y"
     { (yyval.ival) = OP_ISLT; ;}
     break;
 
   case 399:
-#line 2163 "pir.y"
+#line 2170 "pir.y"
     { (yyval.ival) = OP_ISGE; ;}
     break;
 
   case 400:
-#line 2164 "pir.y"
+#line 2171 "pir.y"
     { (yyval.ival) = OP_ISGT; ;}
     break;
 
   case 401:
-#line 2165 "pir.y"
+#line 2172 "pir.y"
     { (yyval.ival) = OP_ISNE; ;}
     break;
 
   case 402:
-#line 2171 "pir.y"
+#line 2178 "pir.y"
     { (yyval.ival) = OP_MUL; ;}
     break;
 
   case 403:
-#line 2172 "pir.y"
+#line 2179 "pir.y"
     { (yyval.ival) = OP_MOD; ;}
     break;
 
   case 404:
-#line 2173 "pir.y"
+#line 2180 "pir.y"
     { (yyval.ival) = OP_POW; ;}
     break;
 
   case 405:
-#line 2174 "pir.y"
+#line 2181 "pir.y"
     { (yyval.ival) = OP_DIV; ;}
     break;
 
   case 406:
-#line 2175 "pir.y"
+#line 2182 "pir.y"
     { (yyval.ival) = OP_FDIV; ;}
     break;
 
   case 407:
-#line 2176 "pir.y"
+#line 2183 "pir.y"
     { (yyval.ival) = OP_BOR; ;}
     break;
 
   case 408:
-#line 2177 "pir.y"
+#line 2184 "pir.y"
     { (yyval.ival) = OP_BAND; ;}
     break;
 
   case 409:
-#line 2178 "pir.y"
+#line 2185 "pir.y"
     { (yyval.ival) = OP_BXOR; ;}
     break;
 
   case 410:
-#line 2179 "pir.y"
+#line 2186 "pir.y"
     { (yyval.ival) = OP_CONCAT; ;}
     break;
 
   case 411:
-#line 2180 "pir.y"
+#line 2187 "pir.y"
     { (yyval.ival) = OP_SHR; ;}
     break;
 
   case 412:
-#line 2181 "pir.y"
+#line 2188 "pir.y"
     { (yyval.ival) = OP_SHL; ;}
     break;
 
   case 413:
-#line 2182 "pir.y"
+#line 2189 "pir.y"
     { (yyval.ival) = OP_LSR; ;}
     break;
 
   case 415:
-#line 2203 "pir.y"
+#line 2210 "pir.y"
     { new_subr(lexer, Parrot_str_new(lexer->interp, "@start", 6)); ;}
     break;
 
   case 424:
-#line 2219 "pir.y"
+#line 2226 "pir.y"
     { set_label(lexer, (yyvsp[(1) - (2)].sval)); ;}
     break;
 
   case 429:
-#line 2229 "pir.y"
+#line 2236 "pir.y"
     { set_sub_name(lexer, (yyvsp[(3) - (3)].sval)); ;}
     break;
 
   case 430:
-#line 2233 "pir.y"
+#line 2240 "pir.y"
     { new_subr(lexer, NULL); ;}
     break;
 
   case 431:
-#line 2238 "pir.y"
+#line 2245 "pir.y"
     {
 
                                   if (is_parrot_op(lexer, (yyvsp[(1) - (3)].sval))) {
@@ -4927,7 +4927,7 @@ yyreduce:
 
 
 /* Line 1267 of yacc.c.  */
-#line 4812 "pirparser.c"
+#line 4931 "pirparser.c"
       default: break;
     }
   YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
@@ -5141,7 +5141,7 @@ yyreturn:
 }
 
 
-#line 2252 "pir.y"
+#line 2259 "pir.y"
 
 
 
@@ -5766,7 +5766,8 @@ concat_strings(ARGMOD(lexer_state *lexer), ARGIN(const char * a),
 {
     const size_t strlen_a = strlen(a);
     const char * const newstr = (char *)pir_mem_allocate_zeroed(lexer, (strlen_a + strlen(b) + 1)
-                                                          * sizeof (char));
+                                                          * sizeof (char),
+                                                   ALLOC_STRING);
     strcpy(newstr, a);
     strcpy(newstr + strlen_a, b);
     a = b = NULL;
@@ -6260,6 +6261,7 @@ check_op_args_for_symbols(ARGMOD(lexer_state *lexer)) {
                 */
                 operand->expr.t = target_from_symbol(lexer, sym);
                 operand->type   = EXPR_TARGET; /* convert operand node into EXPR_TARGET */
+                operand->sigcode = get_operand_code(operand);
             }
             else { /* it may be a constant, otherwise it's a label */
 
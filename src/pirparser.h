@@ -280,7 +280,7 @@
 
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 typedef union YYSTYPE
-#line 236 "pir.y"
+#line 243 "pir.y"
 {
     double              dval;
     int                 ival;
@@ -589,7 +589,7 @@ save_global_reference(ARGIN(lexer_state * const lexer),
 {
     ASSERT_ARGS(save_global_reference)
 
-    global_fixup *ref = pir_mem_allocate_zeroed_typed(lexer, global_fixup);
+    global_fixup *ref = pir_mem_allocate_zeroed_typed(lexer, global_fixup, ALLOC_LABEL);
 
     ref->instr = instr;
     ref->label = label;
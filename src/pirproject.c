@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements building all files of a project at once. The files are
+listed in a file, one per line, or are all C<.pir> and C<.pasm> files in a
+directory. Each file is compiled to a bytecode file next to it, with the
+extension C<.pbc>.
+
+Files are compiled on several threads, each with an interpreter of its own.
+The jobs are whole files: preprocessing, parsing, register allocation and
+writing a file all happen in one job, on one thread. The files are started
+from large to small by C<run_stealing_jobs()>, and threads that are done steal
+the small files that are left, but a file that is much larger than all others
+still takes as long as it takes on its own; the other threads are idle by
+then.
+The contents of included files are cached by the heredoc preprocessor for
+all threads, so a file that is included by many others is only read once.
+
+=head1 FUNCTIONS
+
+=over 4
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#  include <dirent.h>
+#  include <unistd.h>
+#else
+#  include <process.h>
+#  define getpid _getpid
+#endif
+#include "pircompiler.h"
+#include "pirheredoc.h"
+#include "pircapi.h"
+#include "pircache.h"
+#include "pirjobs.h"
+#include "pirproject.h"
+
+/* HEADERIZER HFILE: compilers/pirc/src/pirproject.h */
+
+/* a file of the project */
+typedef struct project_file {
+    char   *source;
+    char   *output;    /* the bytecode file, or NULL if no output is written */
+    long    size;      /* size of source, to sort the files by */
+    int     errors;
+
+} project_file;
+
+/* what the threads building the files share */
+typedef struct project {
+    project_file  *files;
+    unsigned       numfiles;
+    unsigned       allocated;
+    Interp       **interps;    /* one for each thread */
+    int            flags;
+    unsigned       macro_size;
+    snapshot      *snap;
+    char const    *keep;       /* subs that -t keeps; see remove_unreachable_subs() */
+    unsigned long  pid;        /* names the scratch files; see scratch_file() */
+
+} project;
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+static void add_file(ARGMOD(project *proj), ARGIN(char const * const source))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*proj);
+
+static void build_file(ARGMOD(void *data), unsigned index, unsigned thread)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*data);
+
+static int by_size(ARGIN(const void *a), ARGIN(const void *b))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+static int read_project(
+    ARGMOD(project *proj),
+    ARGIN(char const * const listing))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*proj);
+
+static void scratch_file(
+    ARGOUT(char *name),
+    ARGIN(char const * const prefix),
+    ARGIN(project const * const proj),
+    unsigned thread)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*name);
+
+#define ASSERT_ARGS_add_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(proj) \
+    , PARROT_ASSERT_ARG(source))
+#define ASSERT_ARGS_build_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(data))
+#define ASSERT_ARGS_by_size __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(a) \
+    , PARROT_ASSERT_ARG(b))
+#define ASSERT_ARGS_read_project __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(proj) \
+    , PARROT_ASSERT_ARG(listing))
+#define ASSERT_ARGS_scratch_file __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(name) \
+    , PARROT_ASSERT_ARG(prefix) \
+    , PARROT_ASSERT_ARG(proj))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+
+/*
+
+=item C<static void add_file(project *proj, char const * const source)>
+
+Add the file C<source> to the project C<proj>. Its bytecode file is named
+after it, unless no output is written. A file that can't be found is added
+as well; it'll fail to compile.
+
+=cut
+
+*/
+static void
+add_file(ARGMOD(project *proj), ARGIN(char const * const source))
+{
+    ASSERT_ARGS(add_file)
+    project_file *file;
+    struct stat   info;
+    char const   *dot;
+
+    if (proj->numfiles == proj->allocated) {
+        proj->allocated = proj->allocated ? proj->allocated * 2 : 64;
+        proj->files     = proj->files
+                        ? mem_realloc_n_typed(proj->files, proj->allocated, project_file)
+                        : mem_allocate_n_typed(proj->allocated, project_file);
+    }
+
+    file         = &proj->files[proj->numfiles++];
+    file->source = (char *)mem_sys_allocate(strlen(source) + 1);
+    file->output = NULL;
+    file->size   = stat(source, &info) == 0 ? (long)info.st_size : 0;
+    file->errors = 0;
+    strcpy(file->source, source);
+
+    if (TEST_FLAG(proj->flags, LEXER_FLAG_NOOUTPUT))
+        return;
+
+    /* replace the extension, if any, by .pbc */
+    dot = strrchr(source, '.');
+    if (dot == NULL || strpbrk(dot, "/\\") != NULL)
+        dot = source + strlen(source);
+
+    file->output = (char *)mem_sys_allocate((dot - source) + 5);
+    memcpy(file->output, source, dot - source);
+    strcpy(file->output + (dot - source), ".pbc");
+}
+
+/*
+
+=item C<static int read_project(project *proj, char const * const listing)>
+
+Add the files of C<listing> to C<proj>. If C<listing> is a directory, these
+are its C<.pir> and C<.pasm> files; otherwise it's a file that names one file
+on each line. Empty lines, and lines that start with C<#>, are skipped.
+Returns false if C<listing> can't be read.
+
+=cut
+
+*/
+static int
+read_project(ARGMOD(project *proj), ARGIN(char const * const listing))
+{
+    ASSERT_ARGS(read_project)
+    struct stat  info;
+    FILE        *file;
+    char         line[1024];
+
+    if (stat(listing, &info) != 0) {
+        fprintf(stderr, "Can't find project '%s'\n", listing);
+        return FALSE;
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+#ifndef _WIN32
+        DIR           *dir = opendir(listing);
+        struct dirent *entry;
+
+        if (dir == NULL) {
+            fprintf(stderr, "Can't read directory '%s'\n", listing);
+            return FALSE;
+        }
+
+        while ((entry = readdir(dir)) != NULL) {
+            char const * const name = entry->d_name;
+            char const * const ext  = strrchr(name, '.');
+
+            if (ext != NULL && (STREQ(ext, ".pir") || STREQ(ext, ".pasm"))) {
+                char * const path = (char *)mem_sys_allocate(strlen(listing) + strlen(name) + 2);
+
+                sprintf(path, "%s/%s", listing, name);
+                add_file(proj, path);
+                mem_sys_free(path);
+            }
+        }
+
+        closedir(dir);
+        return TRUE;
+#else
+        fprintf(stderr, "Can't read directory '%s'; list its files in a file instead\n",
+                listing);
+        return FALSE;
+#endif
+    }
+
+    file = open_file(listing, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Can't read project '%s'\n", listing);
+        return FALSE;
+    }
+
+    while (fgets(line, sizeof (line), file) != NULL) {
+        char   *name   = line;
+        size_t  length;
+
+        while (*name == ' ' || *name == '\t')
+            ++name;
+
+        length = strlen(name);
+        while (length > 0 && (name[length - 1] == '\n' || name[length - 1] == '\r'
+                          ||  name[length - 1] == ' '  || name[length - 1] == '\t'))
+            name[--length] = '\0';
+
+        if (length > 0 && *name != '#')
+            add_file(proj, name);
+    }
+
+    fclose(file);
+    return TRUE;
+}
+
+/*
+
+=item C<static int by_size(const void *a, const void *b)>
+
+Compare two C<project_file>s for C<qsort()>, so that the largest comes first.
+Files of the same size keep the order of their names.
+
+=cut
+
+*/
+static int
+by_size(ARGIN(const void *a), ARGIN(const void *b))
+{
+    ASSERT_ARGS(by_size)
+    project_file const * const x = (project_file const *)a;
+    project_file const * const y = (project_file const *)b;
+
+    if (x->size != y->size)
+        return x->size > y->size ? -1 : 1;
+
+    return strcmp(x->source, y->source);
+}
+
+/*
+
+=item C<static void scratch_file(char *name, char const * const prefix,
+project const * const proj, unsigned thread)>
+
+Write to C<name> the name of the scratch file C<prefix> of thread C<thread>.
+The name includes the process id, so that several builds can run in the same
+directory at the same time. C<name> must hold 48 characters.
+
+=cut
+
+*/
+static void
+scratch_file(ARGOUT(char *name), ARGIN(char const * const prefix),
+             ARGIN(project const * const proj), unsigned thread)
+{
+    ASSERT_ARGS(scratch_file)
+    /* thread 0 is the main thread, whose files are numbered 0 */
+    sprintf(name, "%s_%lu_%u", prefix, proj->pid, thread + 1);
+}
+
+/*
+
+=item C<static void build_file(void *data, unsigned index, unsigned thread)>
+
+Job of C<build_project()>: run the heredoc preprocessor on the file at
+C<index> of the C<project> C<data>, and compile the result, with the
+interpreter of thread C<thread>.
+
+=cut
+
+*/
+static void
+build_file(ARGMOD(void *data), unsigned index, unsigned thread)
+{
+    ASSERT_ARGS(build_file)
+    project      * const proj   = (project *)data;
+    project_file * const file   = &proj->files[index];
+    Interp       * const interp = proj->interps[thread];
+    char                 hdocfile[48];
+    char                 listfile[48];
+    FILE                *input;
+    include_list        *includes;
+    compile_options      options;
+
+    scratch_file(hdocfile, "hdoctemp", proj, thread);
+    scratch_file(listfile, "output_thr", proj, thread);
+
+    input = open_file(hdocfile, "w");
+    if (input == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", hdocfile);
+        file->errors = 1;
+        return;
+    }
+
+    includes = process_heredocs(interp, file->source, input, &file->errors);
+    fclose(input);
+
+    /* the file, or a file it includes, can't be read */
+    if (file->errors > 0) {
+        free_include_list(includes);
+        return;
+    }
+
+    input = open_file(hdocfile, "r");
+    if (input == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", hdocfile);
+        free_include_list(includes);
+        file->errors = 1;
+        return;
+    }
+
+    /* the threads are busy with the other files, so the registers of the
+     * subs are allocated by this thread.
+     */
+    init_compile_options(&options, proj->flags);
+    options.thr_id     = thread + 1;
+    options.listfile   = listfile;
+    options.macro_size = proj->macro_size;
+    options.outputfile = file->output;
+    options.snap       = proj->snap;
+    options.keep       = proj->keep;
+    options.includes   = includes;
+
+    /* parse_file() closes input */
+    file->errors = parse_file(interp, input, file->source, &options);
+
+    free_include_list(includes);
+}
+
+/*
+
+=item C<int build_project(PARROT_INTERP, char const * const listing, int
+flags, unsigned macro_size, unsigned numthreads, snapshot * const snap, char
+const * const keep)>
+
+Compile all files of the project C<listing> (see C<read_project()>) on
+C<numthreads> threads; the first uses C<interp>, the others get an
+interpreter of their own. C<flags>, C<macro_size>, C<snap> and C<keep> are as
+for C<parse_file()>, and apply to all files. Unless C<LEXER_FLAG_NOOUTPUT> is set,
+the bytecode of each file is written next to it. The files that failed to
+compile are listed on stderr, and their number is returned; if the project
+can't be read, -1 is returned.
+
+=cut
+
+*/
+int
+build_project(PARROT_INTERP, ARGIN(char const * const listing), int flags, unsigned macro_size,
+              unsigned numthreads, ARGIN_NULLOK(snapshot * const snap),
+              ARGIN_NULLOK(char const * const keep))
+{
+    ASSERT_ARGS(build_project)
+    project   proj;
+    unsigned  i;
+    int       failed = 0;
+
+    proj.files      = NULL;
+    proj.numfiles   = 0;
+    proj.allocated  = 0;
+    proj.flags      = flags;
+    proj.macro_size = macro_size;
+    proj.snap       = snap;
+    proj.keep       = keep;
+    proj.pid        = (unsigned long)getpid();
+
+    if (!read_project(&proj, listing)) {
+        if (proj.files != NULL)
+            mem_sys_free(proj.files);
+
+        return -1;
+    }
+
+    /* large files first, so that they don't start when all other threads are
+     * done; a single file can't be split over threads, though.
+     */
+    if (proj.numfiles > 1)
+        qsort(proj.files, proj.numfiles, sizeof (project_file), by_size);
+
+    if (numthreads > proj.numfiles)
+        numthreads = proj.numfiles;
+
+    if (numthreads < 1)
+        numthreads = 1;
+
+    /* interpreters are created here, as creating them isn't thread-safe */
+    proj.interps    = mem_allocate_n_typed(numthreads, Interp *);
+    proj.interps[0] = interp;
+
+    for (i = 1; i < numthreads; ++i)
+        proj.interps[i] = Parrot_new(interp);
+
+    run_stealing_jobs(proj.numfiles, numthreads, build_file, &proj);
+
+    for (i = 0; i < numthreads; ++i) {
+        char name[48];
+
+        if (i > 0) {
+            forget_cached_evals(proj.interps[i]);
+            Parrot_destroy(proj.interps[i]);
+        }
+
+        scratch_file(name, "hdoctemp", &proj, i);
+        remove(name);
+        scratch_file(name, "output_thr", &proj, i);
+        remove(name);
+    }
+
+    for (i = 0; i < proj.numfiles; ++i) {
+        project_file * const file = &proj.files[i];
+
+        if (file->errors != 0) {
+            fprintf(stderr, "Failed to compile '%s'\n", file->source);
+            ++failed;
+        }
+
+        mem_sys_free(file->source);
+
+        if (file->output != NULL)
+            mem_sys_free(file->output);
+    }
+
+    if (TEST_FLAG(flags, LEXER_FLAG_VERBOSE))
+        fprintf(stderr, "%u files, %d failed, on %u threads\n", proj.numfiles, failed,
+                numthreads);
+
+    mem_sys_free(proj.interps);
+
+    if (proj.files != NULL)
+        mem_sys_free(proj.files);
+
+    return failed;
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRPROJECT_H_GUARD
+#define PARROT_PIR_PIRPROJECT_H_GUARD
+
+#include "pirsnapshot.h"
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pirproject.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+int build_project(PARROT_INTERP,
+    ARGIN(char const * const listing),
+    int flags,
+    unsigned macro_size,
+    unsigned numthreads,
+    ARGIN_NULLOK(snapshot * const snap),
+    ARGIN_NULLOK(char const * const keep))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+#define ASSERT_ARGS_build_project __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(listing))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pirproject.c */
+
+#endif /* PARROT_PIR_PIRPROJECT_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
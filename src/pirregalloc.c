@@ -609,7 +609,12 @@ cache_interval_object(ARGIN(lsr_allocator * const lsr),
 
 Go over all live intervals; before handling any interval, expire all old ones;
 they might have expired (see expire_old_intervals()). Then, allocate a new
-register; this can be one that was just expired.
+register; this can be one that was just expired. Afterwards, the number of
+registers of each type that are used is in C<lsr>'s C<r> field.
+
+Only C<lsr> and the symbols and registers of its intervals are touched, so
+the registers of different subs can be allocated by different threads, each
+with an allocator of its own.
 
 =cut
 
@@ -668,11 +673,6 @@ linear_scan_register_allocation(ARGIN(lsr_allocator * const lsr))
          */
         --lsr->r[type];
     }
-
-
-    /* update the register usage in the current subroutine structure. */
-    update_sub_register_usage(lsr->lexer, lsr->r);
-
 }
 
 
@@ -0,0 +1,740 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements a compile server, and the client that talks to it.
+Starting PIRC costs more than compiling a small file: the process must be
+started, and an interpreter created with all its op libraries. A build that
+compiles thousands of small files pays for that each time.
+
+The server (C<pirc --server=E<lt>socketE<gt>>) does all that once, and then
+listens on a Unix domain socket. For each client it forks a worker, which
+starts with the server's warm interpreter. The worker reads the request,
+and forks once more to run the compiler in the client's working directory
+with the client's command line; the compiler may C<exit()> at any point, so
+it can't run in the worker itself. The worker passes the compiler's stdout
+and stderr on to the client, followed by its exit status. The server itself
+never reads from or writes to a client, so a slow client only holds up its
+own worker. A limited number of workers runs at once; other requests wait
+in the socket's queue.
+
+Workers are processes rather than threads, as the compiler writes its
+messages to stdout and stderr, and opens files relative to the working
+directory, which are both shared by all threads of a process. For the same
+reason, what a worker adds to the caches of included files and evaluated
+code is lost when it exits: each worker starts with the caches of the
+server, which stay as they were when the server started.
+
+A client can have files written anywhere the server can write, so the
+server only serves its owner: the socket can only be used by the user that
+started the server, and where the system tells who's on the other side of a
+connection, clients of other users are turned away.
+
+When the environment variable C<PIRC_SERVER> names the socket of a server,
+C<pirc> sends its command line there instead of compiling it, and exits
+with the status of the compilation. If no server is listening, or the server
+closes the connection before answering, it compiles the file itself, so
+scripts that run C<pirc> work either way.
+
+=head2 Protocol
+
+A request consists of NUL-terminated strings: the number of arguments, in
+decimal, the client's working directory, and then that many arguments, any
+of which may be empty. The server answers with a number of frames. Each
+starts with a line with a letter and a number: C<O> and C<E> are followed
+by that many bytes of stdout or stderr, respectively; C<X> gives the exit
+status, and is the last frame.
+
+=head1 FUNCTIONS
+
+=over 4
+
+=cut
+
+*/
+
+/* for struct ucred, to check who connected to the server */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pircompiler.h"
+#include "pirserver.h"
+
+#ifndef _WIN32
+#  include <errno.h>
+#  include <signal.h>
+#  include <unistd.h>
+#  include <poll.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <sys/wait.h>
+#endif
+
+/* HEADERIZER HFILE: compilers/pirc/src/pirserver.h */
+
+/* the maximum size of a request, and the maximum number of workers */
+#define SERVER_MAX_REQUEST  65536
+#define SERVER_MAX_WORKERS  64
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+PARROT_WARN_UNUSED_RESULT
+static int client_is_owner(int client);
+
+static int connect_server(ARGIN(char const * const path))
+        __attribute__nonnull__(1);
+
+static void fail_request(int client, ARGIN(char const * const message))
+        __attribute__nonnull__(2);
+
+static int read_request(int client, ARGOUT(char *buffer))
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*buffer);
+
+static void relay_output(int client, int out, int err);
+
+PARROT_WARN_UNUSED_RESULT
+static int send_all(int fd, ARGIN(char const *data), size_t size)
+        __attribute__nonnull__(2);
+
+static void send_frame(
+    int fd,
+    char kind,
+    ARGIN_NULLOK(char const *data),
+    long size);
+
+PARROT_DOES_NOT_RETURN
+static void serve_request(PARROT_INTERP,
+    int client,
+    ARGIN(char const * const program_name),
+    NOTNULL(command_function compile))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3)
+        __attribute__nonnull__(4);
+
+#define ASSERT_ARGS_client_is_owner __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_connect_server __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(path))
+#define ASSERT_ARGS_fail_request __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(message))
+#define ASSERT_ARGS_read_request __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(buffer))
+#define ASSERT_ARGS_relay_output __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_send_all __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(data))
+#define ASSERT_ARGS_send_frame __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_serve_request __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(program_name) \
+    , PARROT_ASSERT_ARG(compile))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+
+#ifndef _WIN32
+
+/*
+
+=item C<static int send_all(int fd, char const *data, size_t size)>
+
+Write the C<size> bytes of C<data> to C<fd>. Returns false if that failed,
+for instance because the other side went away.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+send_all(int fd, ARGIN(char const *data), size_t size)
+{
+    ASSERT_ARGS(send_all)
+
+    while (size > 0) {
+        ssize_t const written = write(fd, data, size);
+
+        if (written < 0 && errno == EINTR)
+            continue;
+
+        if (written <= 0)
+            return FALSE;
+
+        data += written;
+        size -= (size_t)written;
+    }
+
+    return TRUE;
+}
+
+/*
+
+=item C<static void send_frame(int fd, char kind, char const *data, long size)>
+
+Send a frame of kind C<kind> to the client C<fd>; for C<O> and C<E>, the
+C<size> bytes of C<data> follow the header, for C<X>, C<size> is the exit
+status. A client that went away is ignored; the compiler's output is still
+read, so that the compiler doesn't block.
+
+=cut
+
+*/
+static void
+send_frame(int fd, char kind, ARGIN_NULLOK(char const *data), long size)
+{
+    ASSERT_ARGS(send_frame)
+    char header[32];
+
+    sprintf(header, "%c%ld\n", kind, size);
+
+    if (send_all(fd, header, strlen(header)) && data != NULL)
+        (void)send_all(fd, data, (size_t)size);
+}
+
+/*
+
+=item C<static void fail_request(int client, char const * const message)>
+
+Tell the client C<client> that its request failed, with the error C<message>.
+
+=cut
+
+*/
+static void
+fail_request(int client, ARGIN(char const * const message))
+{
+    ASSERT_ARGS(fail_request)
+
+    send_frame(client, 'E', message, (long)strlen(message));
+    send_frame(client, 'X', NULL, EXIT_FAILURE);
+}
+
+/*
+
+=item C<static int client_is_owner(int client)>
+
+Check whether the client C<client> runs as the same user as the server. Where
+the system can't tell, this is left to the mode of the socket, which only
+lets the server's user connect.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+client_is_owner(int client)
+{
+    ASSERT_ARGS(client_is_owner)
+#if defined(SO_PEERCRED)
+    struct ucred peer;
+    socklen_t    length = sizeof (peer);
+
+    return getsockopt(client, SOL_SOCKET, SO_PEERCRED, &peer, &length) == 0
+        && peer.uid == geteuid();
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+    uid_t uid;
+    gid_t gid;
+
+    return getpeereid(client, &uid, &gid) == 0 && uid == geteuid();
+#else
+    UNUSED(client);
+
+    return TRUE;
+#endif
+}
+
+/*
+
+=item C<static int read_request(int client, char *buffer)>
+
+Read a request from C<client> into C<buffer>, which holds up to
+C<SERVER_MAX_REQUEST> bytes. Returns the number of arguments, which follow
+the count and the working directory in C<buffer>, or -1 if the request is
+incomplete, malformed or too large.
+
+=cut
+
+*/
+static int
+read_request(int client, ARGOUT(char *buffer))
+{
+    ASSERT_ARGS(read_request)
+    size_t size    = 0;
+    size_t scanned = 0;   /* the bytes that were checked for the end of a string */
+    long   strings = 0;   /* the number of complete strings */
+    long   count   = 0;
+
+    while (size < SERVER_MAX_REQUEST) {
+        ssize_t const got = read(client, buffer + size, SERVER_MAX_REQUEST - size);
+
+        if (got < 0 && errno == EINTR)
+            continue;
+
+        if (got <= 0)
+            return -1;
+
+        size += (size_t)got;
+
+        for (; scanned < size; ++scanned) {
+            if (buffer[scanned] != '\0')
+                continue;
+
+            /* the first string is the number of arguments */
+            if (++strings == 1) {
+                char *end;
+
+                count = strtol(buffer, &end, 10);
+
+                if (end == buffer || *end != '\0' || count < 0 || count >= SERVER_MAX_REQUEST)
+                    return -1;
+            }
+
+            /* the count, the directory, and the arguments */
+            if (strings == count + 2)
+                return scanned + 1 == size ? (int)count : -1;
+        }
+    }
+
+    return -1;
+}
+
+/*
+
+=item C<static void relay_output(int client, int out, int err)>
+
+Send what is written to the pipes C<out> and C<err> to the client C<client>,
+as C<O> and C<E> frames, until the writer closes both. The pipes are closed.
+
+=cut
+
+*/
+static void
+relay_output(int client, int out, int err)
+{
+    ASSERT_ARGS(relay_output)
+    int fds[2];
+
+    fds[0] = out;
+    fds[1] = err;
+
+    while (fds[0] >= 0 || fds[1] >= 0) {
+        struct pollfd polled[2];
+        int           i;
+
+        /* closed pipes have fd -1, which poll() skips */
+        for (i = 0; i < 2; ++i) {
+            polled[i].fd      = fds[i];
+            polled[i].events  = POLLIN;
+            polled[i].revents = 0;
+        }
+
+        if (poll(polled, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        for (i = 0; i < 2; ++i) {
+            if (fds[i] >= 0 && (polled[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                char    data[4096];
+                ssize_t got = read(fds[i], data, sizeof (data));
+
+                if (got > 0)
+                    send_frame(client, i ? 'E' : 'O', data, (long)got);
+                else if (got == 0 || errno != EINTR) {
+                    close(fds[i]);
+                    fds[i] = -1;
+                }
+            }
+        }
+    }
+
+    if (fds[0] >= 0)
+        close(fds[0]);
+
+    if (fds[1] >= 0)
+        close(fds[1]);
+}
+
+/*
+
+=item C<static void serve_request(PARROT_INTERP, int client, char const *
+const program_name, command_function compile)>
+
+Serve the client C<client>, in a worker that was forked by the server: check
+that it runs as the server's user, read its request, and compile it in a process of its own, which runs C<compile>
+with C<interp> and the request's arguments, preceded by C<program_name>.
+The compiler's output and exit status are sent to the client. Exits when
+done.
+
+=cut
+
+*/
+PARROT_DOES_NOT_RETURN
+static void
+serve_request(PARROT_INTERP, int client, ARGIN(char const * const program_name),
+              NOTNULL(command_function compile))
+{
+    ASSERT_ARGS(serve_request)
+    char  *buffer;
+    int    argc;
+    int    out[2];
+    int    err[2];
+    int    status;
+    pid_t  pid;
+
+    if (!client_is_owner(client)) {
+        fail_request(client, "pirc: the server only compiles for its own user\n");
+        exit(EXIT_FAILURE);
+    }
+
+    buffer = (char *)mem_sys_allocate(SERVER_MAX_REQUEST);
+    argc   = read_request(client, buffer);
+
+    if (argc < 0) {
+        fail_request(client, "pirc: incomplete request\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pipe(out) != 0 || pipe(err) != 0) {
+        fail_request(client, "pirc: server can't start a worker\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+
+    if (pid == 0) {
+        /* the compiler; the directory follows the count, and the arguments follow it */
+        char  * const cwd  = buffer + strlen(buffer) + 1;
+        char         *iter = cwd + strlen(cwd) + 1;
+        char        **argv = mem_allocate_n_typed(argc + 2, char *);
+        int           i;
+
+        close(client);
+        close(out[0]);
+        close(err[0]);
+        dup2(out[1], STDOUT_FILENO);
+        dup2(err[1], STDERR_FILENO);
+        close(out[1]);
+        close(err[1]);
+
+        if (chdir(cwd) != 0) {
+            fprintf(stderr, "pirc: can't change to directory '%s'\n", cwd);
+            exit(EXIT_FAILURE);
+        }
+
+        argv[0] = (char *)program_name;
+
+        for (i = 1; i <= argc; ++i) {
+            argv[i] = iter;
+            iter   += strlen(iter) + 1;
+        }
+
+        argv[argc + 1] = NULL;
+
+        exit(compile(interp, argc + 1, argv));
+    }
+
+    mem_sys_free(buffer);
+    close(out[1]);
+    close(err[1]);
+
+    if (pid < 0) {
+        close(out[0]);
+        close(err[0]);
+        fail_request(client, "pirc: server can't start a worker\n");
+        exit(EXIT_FAILURE);
+    }
+
+    relay_output(client, out[0], err[0]);
+
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    send_frame(client, 'X', NULL, WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE);
+    close(client);
+    exit(EXIT_SUCCESS);
+}
+
+/*
+
+=item C<static int connect_server(char const * const path)>
+
+Connect to the server listening on the socket C<path>. Returns the connected
+socket, or -1 if there's no server.
+
+=cut
+
+*/
+static int
+connect_server(ARGIN(char const * const path))
+{
+    ASSERT_ARGS(connect_server)
+    struct sockaddr_un address;
+    int                fd;
+
+    if (strlen(path) >= sizeof (address.sun_path))
+        return -1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    memset(&address, 0, sizeof (address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    if (connect(fd, (struct sockaddr *)&address, sizeof (address)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+#endif /* _WIN32 */
+
+/*
+
+=item C<int run_server(PARROT_INTERP, char const * const path, char const *
+const program_name, unsigned numworkers, command_function compile)>
+
+Listen on the Unix domain socket C<path>, and serve each client by a worker
+that compiles its request by running C<compile> with a copy of C<interp> and
+the request's arguments, preceded by C<program_name>. At most C<numworkers>
+workers run at once. A file C<path> that exists already is removed first;
+the socket is only accessible to the server's user, and clients that run as
+another user are refused.
+If no worker can be started for a client, its connection is closed, so that
+the client compiles the file itself. Only returns if the socket can't be set
+up or fails, with the exit status for the server.
+
+=cut
+
+*/
+int
+run_server(PARROT_INTERP, ARGIN(char const * const path), ARGIN(char const * const program_name),
+           unsigned numworkers, NOTNULL(command_function compile))
+{
+    ASSERT_ARGS(run_server)
+#ifndef _WIN32
+    struct sockaddr_un address;
+    unsigned           running = 0;
+    int                listener;
+    mode_t             mask;
+
+    if (numworkers < 1)
+        numworkers = 1;
+    else if (numworkers > SERVER_MAX_WORKERS)
+        numworkers = SERVER_MAX_WORKERS;
+
+    if (strlen(path) >= sizeof (address.sun_path)) {
+        fprintf(stderr, "Socket path '%s' is too long\n", path);
+        return EXIT_FAILURE;
+    }
+
+    memset(&address, 0, sizeof (address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+
+    /* only the server's user may connect; a client can write files anywhere */
+    mask = umask(077);
+
+    if (listener < 0
+    ||  bind(listener, (struct sockaddr *)&address, sizeof (address)) != 0
+    ||  chmod(path, 0600) != 0
+    ||  listen(listener, SOMAXCONN) != 0)
+    {
+        umask(mask);
+        fprintf(stderr, "Can't listen on socket '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+
+    umask(mask);
+
+    /* a client that goes away mustn't take its worker with it */
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int   client;
+        int   status;
+        pid_t pid;
+
+        /* reap the workers that are done; new requests wait in the socket's
+         * queue while all workers are busy.
+         */
+        while (running > 0) {
+            pid = waitpid(-1, &status, running < numworkers ? WNOHANG : 0);
+
+            if (pid > 0)
+                --running;
+            else if (pid == 0 || errno != EINTR)
+                break;
+        }
+
+        client = accept(listener, NULL, NULL);
+
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            fprintf(stderr, "Server stopped: %s\n", strerror(errno));
+            close(listener);
+            unlink(path);
+            return EXIT_FAILURE;
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+
+        pid = fork();
+
+        if (pid == 0) {
+            close(listener);
+            serve_request(interp, client, program_name, compile);
+        }
+
+        close(client);
+
+        if (pid > 0)
+            ++running;
+        else
+            fprintf(stderr, "Can't start a worker: %s\n", strerror(errno));
+    }
+#else
+    UNUSED(interp);
+    UNUSED(program_name);
+    UNUSED(numworkers);
+    UNUSED(compile);
+
+    fprintf(stderr, "Can't listen on '%s'; the compile server needs Unix domain sockets\n",
+            path);
+    return EXIT_FAILURE;
+#endif
+}
+
+/*
+
+=item C<int forward_command(char const * const path, int argc, char *argv[])>
+
+Send the C<argc> arguments in C<argv> to the server listening on the socket
+C<path>, and pass on its output. Returns the exit status of the compilation,
+or -1 if there's no server, or it closed the connection before answering;
+the caller then compiles the file itself. If the connection is lost after
+part of the answer was passed on, that can't be undone, and it's an error.
+
+=cut
+
+*/
+int
+forward_command(ARGIN(char const * const path), int argc, ARGIN(char *argv[]))
+{
+    ASSERT_ARGS(forward_command)
+#ifndef _WIN32
+    char   cwd[4096];
+    char   count[16];
+    FILE  *answer;
+    int    fd       = connect_server(path);
+    int    answered = 0;
+    int    i;
+    char   kind;
+    long   size;
+
+    if (fd < 0)
+        return -1;
+
+    sprintf(count, "%d", argc);
+
+    if (!send_all(fd, count, strlen(count) + 1)
+    ||  getcwd(cwd, sizeof (cwd)) == NULL
+    ||  !send_all(fd, cwd, strlen(cwd) + 1))
+    {
+        close(fd);
+        return -1;
+    }
+
+    for (i = 0; i < argc; ++i) {
+        if (!send_all(fd, argv[i], strlen(argv[i]) + 1)) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    answer = fdopen(fd, "rb");
+    if (answer == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    /* the data of a frame may start with white space, so don't let fscanf() skip it */
+    while (fscanf(answer, "%c%ld", &kind, &size) == 2 && fgetc(answer) == '\n') {
+        FILE * const output = kind == 'O' ? stdout : stderr;
+
+        answered = 1;
+
+        if (kind == 'X') {
+            fclose(answer);
+            return (int)size;
+        }
+
+        while (size > 0) {
+            char         data[4096];
+            size_t const want = size < (long)sizeof (data) ? (size_t)size : sizeof (data);
+            size_t const got  = fread(data, 1, want, answer);
+
+            if (got == 0)
+                break;
+
+            fwrite(data, 1, got, output);
+            size -= (long)got;
+        }
+
+        fflush(output);
+    }
+
+    fclose(answer);
+
+    if (!answered)
+        return -1;
+
+    fprintf(stderr, "pirc: lost the connection to the compile server\n");
+    return EXIT_FAILURE;
+#else
+    UNUSED(path);
+    UNUSED(argc);
+    UNUSED(argv);
+
+    return -1;
+#endif
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
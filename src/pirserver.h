@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRSERVER_H_GUARD
+#define PARROT_PIR_PIRSERVER_H_GUARD
+
+#include "parrot/parrot.h"
+
+/* the number of workers of a compile server, if not given */
+#define SERVER_WORKERS      4
+
+/* compiles with a command line, as pirc does; returns the exit status */
+typedef int (*command_function)(PARROT_INTERP, int argc, char *argv[]);
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pirserver.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+int forward_command(
+    ARGIN(char const * const path),
+    int argc,
+    ARGIN(char *argv[]))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3);
+
+int run_server(PARROT_INTERP,
+    ARGIN(char const * const path),
+    ARGIN(char const * const program_name),
+    unsigned numworkers,
+    NOTNULL(command_function compile))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        __attribute__nonnull__(5);
+
+#define ASSERT_ARGS_forward_command __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(path) \
+    , PARROT_ASSERT_ARG(argv))
+#define ASSERT_ARGS_run_server __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(path) \
+    , PARROT_ASSERT_ARG(program_name) \
+    , PARROT_ASSERT_ARG(compile))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pirserver.c */
+
+#endif /* PARROT_PIR_PIRSERVER_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
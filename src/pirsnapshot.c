@@ -0,0 +1,704 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements snapshots of the macro definitions and global constants
+that are known after parsing a file. A "prelude" file, that only includes
+files with C<.macro>, C<.macro_const>, C<.const> and C<.globalconst>
+definitions, can be compiled once into a snapshot; other files are then
+compiled starting from the restored definitions, without parsing the prelude
+again. The files that the prelude included are recorded in the snapshot, so
+that the heredoc preprocessor skips them as long as they're not changed.
+
+A snapshot is a text file. The first line contains C<SNAPSHOT_MAGIC> and
+C<SNAPSHOT_VERSION>; the last line is C<end>. Each line in between is a
+record; strings are written as their length, a colon, and the characters:
+
+ include <mtime> <size> <path>
+ macro <takes_args> <linedefined> <name> <body>
+ param <name>
+ local <name>
+ const <type> <name> <value>
+
+C<param> and C<local> records belong to the last C<macro> record. The value
+of a string constant is a string; of a unicode string constant it's three
+strings (contents, charset and encoding).
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pircompiler.h"
+#include "pircompunit.h"
+#include "pirsymbol.h"
+#include "pirmacro.h"
+#include "pirheredoc.h"
+#include "pirsnapshot.h"
+
+/* HEADERIZER HFILE: compilers/pirc/src/pirsnapshot.h */
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+static char * read_field(
+    ARGMOD(char **cursor),
+    ARGIN(char const * const limit),
+    ARGOUT(size_t *length))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*cursor)
+        FUNC_MODIFIES(*length);
+
+PARROT_WARN_UNUSED_RESULT
+static int read_keyword(ARGMOD(char **cursor), ARGIN(char const * const keyword))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*cursor);
+
+PARROT_WARN_UNUSED_RESULT
+static int read_number(ARGMOD(char **cursor), ARGOUT(long *number))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*cursor)
+        FUNC_MODIFIES(*number);
+
+static void write_constants(ARGIN(FILE *out), ARGIN_NULLOK(bucket *b))
+        __attribute__nonnull__(1);
+
+static void write_field(ARGIN(FILE *out), ARGIN(char const * const str), size_t length)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+static void write_include(
+    ARGIN(char const * const path),
+    long mtime,
+    long size,
+    ARGIN(void *data))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(4);
+
+static void write_macros(ARGIN(FILE *out), ARGIN_NULLOK(macro_def *macro))
+        __attribute__nonnull__(1);
+
+static void write_params(
+    ARGIN(FILE *out),
+    ARGIN(char const * const keyword),
+    ARGIN_NULLOK(macro_param *param))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+#define ASSERT_ARGS_read_field __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(cursor) \
+    , PARROT_ASSERT_ARG(limit) \
+    , PARROT_ASSERT_ARG(length))
+#define ASSERT_ARGS_read_keyword __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(cursor) \
+    , PARROT_ASSERT_ARG(keyword))
+#define ASSERT_ARGS_read_number __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(cursor) \
+    , PARROT_ASSERT_ARG(number))
+#define ASSERT_ARGS_write_constants __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(out))
+#define ASSERT_ARGS_write_field __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(out) \
+    , PARROT_ASSERT_ARG(str))
+#define ASSERT_ARGS_write_include __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(path) \
+    , PARROT_ASSERT_ARG(data))
+#define ASSERT_ARGS_write_macros __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(out))
+#define ASSERT_ARGS_write_params __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(out) \
+    , PARROT_ASSERT_ARG(keyword))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+/*
+
+=head1 FUNCTIONS
+
+=over 4
+
+=item C<static void write_field(FILE *out, char const * const str, size_t length)>
+
+Write the C<length> characters of C<str> to C<out>, preceded by the length
+and a colon.
+
+=cut
+
+*/
+static void
+write_field(ARGIN(FILE *out), ARGIN(char const * const str), size_t length)
+{
+    ASSERT_ARGS(write_field)
+    fprintf(out, "%lu:", (unsigned long)length);
+    fwrite(str, sizeof (char), length, out);
+}
+
+/*
+
+=item C<static void write_include(char const * const path, long mtime, long size,
+void *data)>
+
+Write an C<include> record for the file C<path> to the file C<data>.
+This is called through C<visit_included_definitions()>.
+
+=cut
+
+*/
+static void
+write_include(ARGIN(char const * const path), long mtime, long size, ARGIN(void *data))
+{
+    ASSERT_ARGS(write_include)
+    FILE * const out = (FILE *)data;
+
+    fprintf(out, "include %ld %ld ", mtime, size);
+    write_field(out, path, strlen(path));
+    fputc('\n', out);
+}
+
+/*
+
+=item C<static void write_params(FILE *out, char const * const keyword,
+macro_param *param)>
+
+Write a record with C<keyword> for each element in the list C<param>. The
+list is written in reverse order, so that adding each element to the front
+of a list when reading the snapshot restores the original order.
+
+=cut
+
+*/
+static void
+write_params(ARGIN(FILE *out), ARGIN(char const * const keyword),
+             ARGIN_NULLOK(macro_param *param))
+{
+    ASSERT_ARGS(write_params)
+    if (param == NULL)
+        return;
+
+    write_params(out, keyword, param->next);
+
+    fprintf(out, "%s ", keyword);
+    write_field(out, param->name, strlen(param->name));
+    fputc('\n', out);
+}
+
+/*
+
+=item C<static void write_macros(FILE *out, macro_def *macro)>
+
+Write a C<macro> record for each macro definition in the list C<macro>,
+in reverse order, each followed by its parameters and C<.macro_local>s.
+
+=cut
+
+*/
+static void
+write_macros(ARGIN(FILE *out), ARGIN_NULLOK(macro_def *macro))
+{
+    ASSERT_ARGS(write_macros)
+    size_t length;
+
+    if (macro == NULL)
+        return;
+
+    write_macros(out, macro->next);
+
+    /* a .macro_const has no buffer; its body is just the value */
+    if (macro->takes_args)
+        length = macro->cursor - macro->body;
+    else
+        length = macro->body ? strlen(macro->body) : 0;
+
+    fprintf(out, "macro %d %d ", macro->takes_args, macro->linedefined);
+    write_field(out, macro->name, strlen(macro->name));
+    fputc(' ', out);
+    write_field(out, macro->body ? macro->body : "", length);
+    fputc('\n', out);
+
+    write_params(out, "param", macro->parameters);
+    write_params(out, "local", macro->macrolocals);
+}
+
+/*
+
+=item C<static void write_constants(FILE *out, bucket *b)>
+
+Write a C<const> record for each constant in the bucket list C<b>, in reverse
+order.
+
+=cut
+
+*/
+static void
+write_constants(ARGIN(FILE *out), ARGIN_NULLOK(bucket *b))
+{
+    ASSERT_ARGS(write_constants)
+    constdecl *c;
+
+    if (b == NULL)
+        return;
+
+    write_constants(out, b->next);
+
+    c = bucket_constant(b);
+
+    fprintf(out, "const %d ", c->type);
+    write_field(out, c->name, strlen(c->name));
+    fputc(' ', out);
+
+    switch (c->type) {
+        case INT_VAL:
+            fprintf(out, "%d", c->val.ival);
+            break;
+        case NUM_VAL:
+            fprintf(out, "%.17g", c->val.nval);
+            break;
+        case STRING_VAL:
+            write_field(out, c->val.sval, strlen(c->val.sval));
+            break;
+        case USTRING_VAL:
+            write_field(out, c->val.ustr->contents, strlen(c->val.ustr->contents));
+            fputc(' ', out);
+            write_field(out, c->val.ustr->charset, strlen(c->val.ustr->charset));
+            fputc(' ', out);
+            write_field(out, c->val.ustr->encoding, strlen(c->val.ustr->encoding));
+            break;
+        default:
+            break;
+    }
+
+    fputc('\n', out);
+}
+
+/*
+
+=item C<int save_snapshot(lexer_state * const lexer, include_list *includes,
+char const * const filename)>
+
+Write a snapshot of the macro definitions and global constants of C<lexer>,
+and of the files in C<includes> that only contain such definitions, to
+the file C<filename>. Returns TRUE if successful, FALSE otherwise.
+
+=cut
+
+*/
+PARROT_IGNORABLE_RESULT
+int
+save_snapshot(ARGIN(lexer_state * const lexer), ARGIN_NULLOK(include_list *includes),
+              ARGIN(char const * const filename))
+{
+    ASSERT_ARGS(save_snapshot)
+    macro_table *table = lexer->macros;
+    FILE        *out   = fopen(filename, "w");
+    unsigned     i;
+
+    if (out == NULL) {
+        fprintf(stderr, "Failed to open file '%s'\n", filename);
+        return FALSE;
+    }
+
+    /* only the outermost macro table holds definitions */
+    while (table->prev)
+        table = table->prev;
+
+    fprintf(out, "%s %d\n", SNAPSHOT_MAGIC, SNAPSHOT_VERSION);
+
+    visit_included_definitions(includes, write_include, out);
+    write_macros(out, table->definitions);
+
+    for (i = 0; i < lexer->constants.size; ++i)
+        write_constants(out, lexer->constants.contents[i]);
+
+    fputs("end\n", out);
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Failed to write file '%s'\n", filename);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+
+=item C<snapshot * read_snapshot(char const * const filename)>
+
+Read the snapshot file C<filename> into memory. If the file can't be read,
+or it's not a snapshot, an error message is printed and NULL is returned.
+
+=cut
+
+*/
+PARROT_MALLOC
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+snapshot *
+read_snapshot(ARGIN(char const * const filename))
+{
+    ASSERT_ARGS(read_snapshot)
+    snapshot *snap;
+    FILE     *in = fopen(filename, "rb");
+    long      length;
+    char     *cursor;
+    long      version;
+
+    if (in == NULL) {
+        fprintf(stderr, "Failed to open file '%s'\n", filename);
+        return NULL;
+    }
+
+    fseek(in, 0, SEEK_END);
+    length = ftell(in);
+    rewind(in);
+
+    snap           = mem_allocate_zeroed_typed(snapshot);
+    snap->filename = (char *)mem_sys_allocate((strlen(filename) + 1) * sizeof (char));
+    strcpy(snap->filename, filename);
+
+    /* NULL-terminate the data, so that the numbers can be read with strtol() */
+    snap->data     = (char *)mem_sys_allocate_zeroed((length + 1) * sizeof (char));
+    snap->length   = fread(snap->data, sizeof (char), length, in);
+    fclose(in);
+
+    cursor = snap->data;
+
+    if (!read_keyword(&cursor, SNAPSHOT_MAGIC)
+    ||  !read_number(&cursor, &version)
+    ||  version != SNAPSHOT_VERSION)
+    {
+        fprintf(stderr, "'%s' is not a snapshot, or it was written by another version\n",
+                filename);
+        free_snapshot(snap);
+        return NULL;
+    }
+
+    return snap;
+}
+
+/*
+
+=item C<void free_snapshot(snapshot *snap)>
+
+Free the memory of the snapshot C<snap>.
+
+=cut
+
+*/
+void
+free_snapshot(ARGMOD(snapshot *snap))
+{
+    ASSERT_ARGS(free_snapshot)
+    mem_sys_free(snap->data);
+    mem_sys_free(snap->filename);
+    mem_sys_free(snap);
+}
+
+/*
+
+=item C<static int read_keyword(char **cursor, char const * const keyword)>
+
+Check whether the record at C<cursor> starts with C<keyword>, followed by a
+space or a newline. If so, C<cursor> is moved past it and TRUE is returned;
+otherwise FALSE is returned, and C<cursor> is not changed.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+read_keyword(ARGMOD(char **cursor), ARGIN(char const * const keyword))
+{
+    ASSERT_ARGS(read_keyword)
+    size_t length = strlen(keyword);
+
+    if (strncmp(*cursor, keyword, length) != 0
+    || ((*cursor)[length] != ' ' && (*cursor)[length] != '\n'))
+        return FALSE;
+
+    *cursor += length + 1;
+    return TRUE;
+}
+
+/*
+
+=item C<static int read_number(char **cursor, long *number)>
+
+Read a number, followed by a space or a newline, at C<cursor> into C<number>,
+and move C<cursor> past it. Returns FALSE if there's no number.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+read_number(ARGMOD(char **cursor), ARGOUT(long *number))
+{
+    ASSERT_ARGS(read_number)
+    char *end;
+
+    *number = strtol(*cursor, &end, 10);
+
+    if (end == *cursor || (*end != ' ' && *end != '\n'))
+        return FALSE;
+
+    *cursor = end + 1;
+    return TRUE;
+}
+
+/*
+
+=item C<static char * read_field(char **cursor, char const * const limit,
+size_t *length)>
+
+Read a string, written by C<write_field()> and followed by a space or a
+newline, at C<cursor>. C<limit> is the end of the snapshot's data. C<cursor>
+is moved past the string, its length is stored in C<length>, and a pointer to
+its first character is returned. The string is not NULL-terminated. If there's
+no valid string at C<cursor>, NULL is returned.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+static char *
+read_field(ARGMOD(char **cursor), ARGIN(char const * const limit), ARGOUT(size_t *length))
+{
+    ASSERT_ARGS(read_field)
+    char          *end;
+    char          *str;
+    unsigned long  count = strtoul(*cursor, &end, 10);
+
+    if (end == *cursor || *end != ':')
+        return NULL;
+
+    str = end + 1;
+
+    /* the string must be followed by a separator, within the data */
+    if ((size_t)(limit - str) < count + 1 || (str[count] != ' ' && str[count] != '\n'))
+        return NULL;
+
+    *length = count;
+    *cursor = str + count + 1;
+    return str;
+}
+
+/*
+
+=item C<unsigned preload_snapshot_includes(snapshot * const snap)>
+
+Tell the heredoc preprocessor to skip the files that were included when
+the snapshot C<snap> was taken, as their definitions will be restored from
+the snapshot. Files that were changed since are not skipped. This must be
+done before the heredoc preprocessor runs. The number of files that will be
+skipped is returned.
+
+=cut
+
+*/
+PARROT_IGNORABLE_RESULT
+unsigned
+preload_snapshot_includes(ARGIN(snapshot * const snap))
+{
+    ASSERT_ARGS(preload_snapshot_includes)
+    char const * const limit  = snap->data + snap->length;
+    char              *cursor = strchr(snap->data, '\n') + 1;
+    unsigned           count  = 0;
+
+    while (read_keyword(&cursor, "include")) {
+        long    mtime, size;
+        size_t  length;
+        char   *path;
+        char   *str;
+
+        if (!read_number(&cursor, &mtime) || !read_number(&cursor, &size))
+            break;
+
+        str = read_field(&cursor, limit, &length);
+        if (str == NULL)
+            break;
+
+        path = (char *)mem_sys_allocate((length + 1) * sizeof (char));
+        memcpy(path, str, length);
+        path[length] = '\0';
+
+        if (preload_include(path, mtime, size))
+            ++count;
+
+        mem_sys_free(path);
+    }
+
+    return count;
+}
+
+/*
+
+=item C<void restore_snapshot(lexer_state * const lexer, snapshot * const snap)>
+
+Define the macros and global constants of the snapshot C<snap> in C<lexer>.
+If the snapshot is damaged, an error is reported, and the definitions that
+were read so far are kept.
+
+=cut
+
+*/
+void
+restore_snapshot(ARGIN(lexer_state * const lexer), ARGIN(snapshot * const snap))
+{
+    ASSERT_ARGS(restore_snapshot)
+    char const * const limit      = snap->data + snap->length;
+    char              *cursor     = strchr(snap->data, '\n') + 1;
+    macro_def         *macro      = NULL;
+    unsigned           num_macros = 0;
+    unsigned           num_consts = 0;
+    int                ok         = TRUE;
+
+    while (ok && !read_keyword(&cursor, "end")) {
+        long    number1, number2;
+        size_t  length1, length2;
+        char   *str1, *str2;
+
+        ok = FALSE;
+
+        if (read_keyword(&cursor, "include")) {
+            /* these were handled by preload_snapshot_includes() */
+            ok = read_number(&cursor, &number1)
+              && read_number(&cursor, &number2)
+              && read_field(&cursor, limit, &length1) != NULL;
+        }
+        else if (read_keyword(&cursor, "macro")) {
+            if (read_number(&cursor, &number1)
+            &&  read_number(&cursor, &number2)
+            && (str1 = read_field(&cursor, limit, &length1)) != NULL
+            && (str2 = read_field(&cursor, limit, &length2)) != NULL)
+            {
+                char const * const name = dupstrn(lexer, str1, length1);
+
+                if (number1) { /* a .macro; copy the body into its buffer */
+                    unsigned size = lexer->macro_size >= length2 + 2 ? lexer->macro_size
+                                                                     : length2 + 2;
+
+                    macro = new_macro(lexer->macros, name, number2, TRUE, size);
+                    memcpy(macro->body, str2, length2);
+                    macro->cursor = macro->body + length2;
+                    close_macro_body(macro);
+                }
+                else {
+                    new_macro_const(lexer->macros, name, dupstrn(lexer, str2, length2),
+                                    number2);
+                    macro = NULL;
+                }
+
+                ++num_macros;
+                ok = TRUE;
+            }
+        }
+        else if (read_keyword(&cursor, "param")) {
+            if (macro != NULL && (str1 = read_field(&cursor, limit, &length1)) != NULL) {
+                add_macro_param(macro, dupstrn(lexer, str1, length1));
+                ok = TRUE;
+            }
+        }
+        else if (read_keyword(&cursor, "local")) {
+            if (macro != NULL && (str1 = read_field(&cursor, limit, &length1)) != NULL) {
+                declare_macro_local(macro, dupstrn(lexer, str1, length1));
+                ok = TRUE;
+            }
+        }
+        else if (read_keyword(&cursor, "const")) {
+            if (read_number(&cursor, &number1)
+            && (str1 = read_field(&cursor, limit, &length1)) != NULL)
+            {
+                char const * const name = dupstrn(lexer, str1, length1);
+                constdecl         *c    = NULL;
+
+                switch (number1) {
+                    case INT_VAL:
+                        if (read_number(&cursor, &number2))
+                            c = new_named_const(lexer, INT_VAL, name, (int)number2);
+                        break;
+                    case NUM_VAL: {
+                        char   *end;
+                        double  value = strtod(cursor, &end);
+
+                        if (end != cursor && *end == '\n') {
+                            cursor = end + 1;
+                            c      = new_named_const(lexer, NUM_VAL, name, value);
+                        }
+                        break;
+                    }
+                    case STRING_VAL:
+                        if ((str2 = read_field(&cursor, limit, &length2)) != NULL)
+                            c = new_named_const(lexer, STRING_VAL, name,
+                                                dupstrn(lexer, str2, length2));
+                        break;
+                    case USTRING_VAL: {
+                        ucstring *ustr = (ucstring *)pir_mem_allocate(lexer, sizeof (ucstring),
+                                                                      ALLOC_CONSTANT);
+                        char     *str3;
+                        size_t    length3;
+
+                        if ((str2 = read_field(&cursor, limit, &length2)) == NULL)
+                            break;
+                        ustr->contents = dupstrn(lexer, str2, length2);
+
+                        if ((str3 = read_field(&cursor, limit, &length3)) == NULL)
+                            break;
+                        ustr->charset  = dupstrn(lexer, str3, length3);
+
+                        if ((str3 = read_field(&cursor, limit, &length3)) == NULL)
+                            break;
+                        ustr->encoding = dupstrn(lexer, str3, length3);
+
+                        c = new_named_const(lexer, USTRING_VAL, name, ustr);
+                        break;
+                    }
+                    default:
+                        break;
+                }
+
+                if (c != NULL) {
+                    store_global_constant(lexer, c);
+                    ++num_consts;
+                    ok = TRUE;
+                }
+            }
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Snapshot '%s' is damaged\n", snap->filename);
+        ++lexer->parse_errors;
+    }
+
+    if (TEST_FLAG(lexer->flags, LEXER_FLAG_VERBOSE))
+        fprintf(stderr, "Restored %u macros and %u constants from snapshot '%s'\n",
+                num_macros, num_consts, snap->filename);
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
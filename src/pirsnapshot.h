@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRSNAPSHOT_H_GUARD
+#define PARROT_PIR_PIRSNAPSHOT_H_GUARD
+
+#include "pircompiler.h"
+#include "pirheredoc.h"
+
+/* first line of a snapshot file */
+#define SNAPSHOT_MAGIC      "pirc-snapshot"
+#define SNAPSHOT_VERSION    1
+
+/* a snapshot file, read into memory; see read_snapshot() */
+typedef struct snapshot {
+    char   *filename;  /* name of the snapshot file */
+    char   *data;      /* contents of the file */
+    size_t  length;    /* number of characters in data */
+
+} snapshot;
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pirsnapshot.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+void free_snapshot(ARGMOD(snapshot *snap))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*snap);
+
+PARROT_IGNORABLE_RESULT
+unsigned preload_snapshot_includes(ARGIN(snapshot * const snap))
+        __attribute__nonnull__(1);
+
+PARROT_MALLOC
+PARROT_WARN_UNUSED_RESULT
+PARROT_CAN_RETURN_NULL
+snapshot * read_snapshot(ARGIN(char const * const filename))
+        __attribute__nonnull__(1);
+
+void restore_snapshot(
+    ARGIN(lexer_state * const lexer),
+    ARGIN(snapshot * const snap))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2);
+
+PARROT_IGNORABLE_RESULT
+int save_snapshot(
+    ARGIN(lexer_state * const lexer),
+    ARGIN_NULLOK(include_list *includes),
+    ARGIN(char const * const filename))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3);
+
+#define ASSERT_ARGS_free_snapshot __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(snap))
+#define ASSERT_ARGS_preload_snapshot_includes __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(snap))
+#define ASSERT_ARGS_read_snapshot __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(filename))
+#define ASSERT_ARGS_restore_snapshot __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(snap))
+#define ASSERT_ARGS_save_snapshot __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(filename))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pirsnapshot.c */
+
+#endif /* PARROT_PIR_PIRSNAPSHOT_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
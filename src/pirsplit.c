@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements parsing a file in pieces, on several threads at once.
+Generated PIR files often consist of many independent subs; after heredoc
+preprocessing, the C<.sub> and C<.end> lines of these can be found with a
+cheap scan of the lines, without running the lexer.
+
+The subs are divided into a number of chunks of consecutive subs, of about
+the same size. Each chunk is parsed by a thread of its own, with a lexer and
+an interpreter of its own. A chunk is a copy of the whole input, in which the
+subs of the other chunks are replaced by their newlines. Everything outside
+the subs (C<.namespace>, C<.HLL>, C<.loadlib>, C<.macro> and C<.const>
+definitions, and so on) is therefore seen by each chunk in the same order as
+in the whole file, and line numbers in messages are those of the whole file.
+Errors and warnings outside the subs are only reported and counted by the
+first chunk; the others only report those in their own subs.
+
+As each chunk has its own constant table and global labels, their bytecode
+can't be merged; so this is only used to check the input, with C<-n>. Globals
+and constants are not merged, and no bytecode is written.
+
+=head1 FUNCTIONS
+
+=over 4
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "pirparser.h"
+#include "pircompiler.h"
+#include "piryy.h"
+#include "pirlexer.h"
+#include "pirsplit.h"
+#include "pircache.h"
+#include "pirjobs.h"
+
+/* HEADERIZER HFILE: compilers/pirc/src/pirsplit.h */
+
+/* the bytes of a sub in the input, from the start of its .sub line up to and
+ * including the newline of its .end line
+ */
+typedef struct sub_range {
+    size_t start;
+    size_t end;
+    size_t lines;      /* number of newlines in the sub */
+
+} sub_range;
+
+/* a chunk of the input, and the results of parsing it */
+typedef struct split_chunk {
+    Interp *interp;    /* interpreter of this chunk's parser */
+    char   *text;      /* the chunk, followed by two NULL characters */
+    size_t  size;
+    int     errors;    /* number of errors found in the chunk */
+
+} split_chunk;
+
+/* what the threads parsing the chunks share */
+typedef struct split_state {
+    split_chunk    *chunks;
+    char           *filename;
+    int             flags;
+    unsigned        macro_size;
+    snapshot       *snap;
+
+} split_state;
+
+/* where split_subs() is, when it looks at a line */
+typedef enum split_scope {
+    SCOPE_TOP,      /* outside of any sub */
+    SCOPE_SUB,      /* between .sub and .end */
+    SCOPE_MACRO,    /* between .macro and .endm */
+    SCOPE_POD       /* in POD, up to =cut */
+
+} split_scope;
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+PARROT_WARN_UNUSED_RESULT
+static int is_directive(
+    ARGIN(char const *line),
+    ARGIN(char const *end),
+    ARGIN(char const * const name))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3);
+
+PARROT_CANNOT_RETURN_NULL
+PARROT_WARN_UNUSED_RESULT
+static char * make_chunk(
+    ARGIN(char const * const input),
+    size_t size,
+    ARGIN(sub_range const * const subs),
+    unsigned numsubs,
+    unsigned first,
+    unsigned last,
+    ARGOUT(size_t *chunksize))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3)
+        __attribute__nonnull__(7)
+        FUNC_MODIFIES(*chunksize);
+
+static void parse_chunk(ARGMOD(void *data), unsigned index)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*data);
+
+PARROT_CAN_RETURN_NULL
+PARROT_WARN_UNUSED_RESULT
+static sub_range * split_subs(
+    ARGIN(char const * const input),
+    size_t size,
+    ARGOUT(unsigned *numsubs))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*numsubs);
+
+#define ASSERT_ARGS_is_directive __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(line) \
+    , PARROT_ASSERT_ARG(end) \
+    , PARROT_ASSERT_ARG(name))
+#define ASSERT_ARGS_make_chunk __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(input) \
+    , PARROT_ASSERT_ARG(subs) \
+    , PARROT_ASSERT_ARG(chunksize))
+#define ASSERT_ARGS_parse_chunk __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(data))
+#define ASSERT_ARGS_split_subs __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(input) \
+    , PARROT_ASSERT_ARG(numsubs))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+
+void init_scanner_state(yyscan_t yyscanner);
+struct yy_buffer_state *yypir_scan_buffer(char *base, size_t size, yyscan_t yyscanner);
+
+
+/*
+
+=item C<static int is_directive(char const *line, char const *end, char const *
+const name)>
+
+Returns true if the first word of the line that starts at C<line> and ends
+at C<end> is C<name>; so C<.end> is found in C<.end>, but not in C<.endm>
+or C<.end_call>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static int
+is_directive(ARGIN(char const *line), ARGIN(char const *end), ARGIN(char const * const name))
+{
+    ASSERT_ARGS(is_directive)
+    size_t const length = strlen(name);
+
+    while (line < end && (*line == ' ' || *line == '\t'))
+        ++line;
+
+    if ((size_t)(end - line) < length || strncmp(line, name, length) != 0)
+        return FALSE;
+
+    line += length;
+
+    return line == end || !(isalnum((unsigned char)*line) || *line == '_');
+}
+
+/*
+
+=item C<static sub_range * split_subs(char const * const input, size_t size,
+unsigned *numsubs)>
+
+Find the subs in the C<size> characters of C<input>, and return an array of
+their ranges, of which there are C<numsubs>. Lines that start with C<.sub>
+and C<.end> are only looked for outside of macro definitions and POD.
+NULL is returned if there are no subs, or if a sub isn't closed.
+
+=cut
+
+*/
+PARROT_CAN_RETURN_NULL
+PARROT_WARN_UNUSED_RESULT
+static sub_range *
+split_subs(ARGIN(char const * const input), size_t size, ARGOUT(unsigned *numsubs))
+{
+    ASSERT_ARGS(split_subs)
+    sub_range   *subs      = NULL;
+    unsigned     allocated = 0;
+    size_t       start     = 0;
+    size_t       line      = 0;
+    size_t       lines     = 0;
+    split_scope  scope     = SCOPE_TOP;
+
+    *numsubs = 0;
+
+    while (line < size) {
+        char const *begin = input + line;
+        char const *end   = (char const *)memchr(begin, '\n', size - line);
+        size_t      next;
+
+        if (end == NULL)
+            end = input + size;
+
+        next = (size_t)(end - input) + (end < input + size ? 1 : 0);
+
+        switch (scope) {
+            case SCOPE_TOP:
+                if (*begin == '=' && end - begin > 1 && isalpha((unsigned char)begin[1]))
+                    scope = SCOPE_POD;
+                else if (is_directive(begin, end, ".macro"))
+                    scope = SCOPE_MACRO;
+                else if (is_directive(begin, end, ".sub")) {
+                    scope = SCOPE_SUB;
+                    start = line;
+                    lines = 1;
+                }
+                break;
+            case SCOPE_SUB:
+                if (end < input + size)
+                    ++lines;
+
+                if (is_directive(begin, end, ".end")) {
+                    if (*numsubs == allocated) {
+                        allocated = allocated ? allocated * 2 : 64;
+                        subs      = subs ? mem_realloc_n_typed(subs, allocated, sub_range)
+                                         : mem_allocate_n_typed(allocated, sub_range);
+                    }
+
+                    subs[*numsubs].start = start;
+                    subs[*numsubs].end   = next;
+                    subs[*numsubs].lines = lines;
+                    ++*numsubs;
+                    scope = SCOPE_TOP;
+                }
+                break;
+            case SCOPE_MACRO:
+                if (is_directive(begin, end, ".endm"))
+                    scope = SCOPE_TOP;
+                break;
+            case SCOPE_POD:
+                if (end - begin >= 4 && strncmp(begin, "=cut", 4) == 0)
+                    scope = SCOPE_TOP;
+                break;
+            default:
+                break;
+        }
+
+        line = next;
+    }
+
+    if (scope == SCOPE_SUB || *numsubs == 0) {
+        if (subs != NULL)
+            mem_sys_free(subs);
+
+        *numsubs = 0;
+        return NULL;
+    }
+
+    return subs;
+}
+
+/*
+
+=item C<static char * make_chunk(char const * const input, size_t size,
+sub_range const * const subs, unsigned numsubs, unsigned first, unsigned last,
+size_t *chunksize)>
+
+Return a copy of the C<size> characters of C<input>, in which the C<numsubs>
+subs in C<subs> are replaced by their newlines, except for the subs C<first>
+up to and including C<last>. The copy is followed by two NULL characters; its
+size without these is stored in C<chunksize>. Only that much is allocated, so
+a chunk's copy doesn't take more memory than the text it parses.
+
+=cut
+
+*/
+PARROT_CANNOT_RETURN_NULL
+PARROT_WARN_UNUSED_RESULT
+static char *
+make_chunk(ARGIN(char const * const input), size_t size, ARGIN(sub_range const * const subs),
+           unsigned numsubs, unsigned first, unsigned last, ARGOUT(size_t *chunksize))
+{
+    ASSERT_ARGS(make_chunk)
+    char     *chunk;
+    char     *out;
+    size_t    done   = 0;
+    size_t    length = size;
+    unsigned  i;
+
+    for (i = 0; i < numsubs; ++i) {
+        if (i < first || i > last)
+            length -= subs[i].end - subs[i].start - subs[i].lines;
+    }
+
+    chunk = (char *)mem_sys_allocate_zeroed((length + 2) * sizeof (char));
+    out   = chunk;
+
+    for (i = 0; i < numsubs; ++i) {
+        /* copy what's in front of the sub */
+        memcpy(out, input + done, subs[i].start - done);
+        out += subs[i].start - done;
+
+        if (i >= first && i <= last) {
+            memcpy(out, input + subs[i].start, subs[i].end - subs[i].start);
+            out += subs[i].end - subs[i].start;
+        }
+        else {
+            memset(out, '\n', subs[i].lines);
+            out += subs[i].lines;
+        }
+
+        done = subs[i].end;
+    }
+
+    memcpy(out, input + done, size - done);
+    out += size - done;
+
+    *chunksize = (size_t)(out - chunk);
+    return chunk;
+}
+
+/*
+
+=item C<static void parse_chunk(void *data, unsigned index)>
+
+Job of C<split_and_parse()>: parse the chunk at C<index> of the C<split_state>
+C<data>, and store the number of errors that were found. Except in the first
+chunk, errors outside of the chunk's subs are not counted.
+
+=cut
+
+*/
+static void
+parse_chunk(ARGMOD(void *data), unsigned index)
+{
+    ASSERT_ARGS(parse_chunk)
+    split_state * const state = (split_state *)data;
+    split_chunk * const chunk = &state->chunks[index];
+    yyscan_t            yyscanner;
+    lexer_state        *lexer;
+
+    yypirlex_init(&yyscanner);
+    yypirset_debug(0, yyscanner);
+
+    lexer = new_lexer(chunk->interp, state->filename, state->flags);
+    lexer->macro_size = state->macro_size;
+
+    /* the text outside the subs is in all chunks; only the first reports on it */
+    lexer->subs_only  = index > 0;
+
+    if (state->snap != NULL)
+        restore_snapshot(lexer, state->snap);
+
+    init_scanner_state(yyscanner);
+
+    if (strstr(state->filename, ".pasm"))
+        SET_FLAG(lexer->flags, LEXER_FLAG_PASMFILE);
+
+    yypirset_extra(lexer, yyscanner);
+    lexer->yyscanner = yyscanner;
+
+    yypir_scan_buffer(chunk->text, chunk->size + 2, yyscanner);
+    yypirparse(yyscanner, lexer);
+
+    if (lexer->parse_errors == 0 && TEST_FLAG(lexer->flags, LEXER_FLAG_WARNINGS))
+        check_unused_symbols(lexer);
+
+    chunk->errors = lexer->parse_errors;
+
+    release_resources(lexer);
+    yypirlex_destroy(yyscanner);
+}
+
+/*
+
+=item C<int split_and_parse(PARROT_INTERP, FILE *infile, char * const
+filename, int flags, unsigned macro_size, unsigned numchunks, snapshot * const
+snap, compiler_stats *stats)>
+
+Parse the file C<infile>, which was preprocessed by C<process_heredocs()>, in
+at most C<numchunks> chunks on as many threads, and close it. Each chunk has
+an interpreter of its own; the first uses C<interp>. C<filename>, C<flags>,
+C<macro_size> and C<snap> are as for C<parse_file()>; nothing is emitted, so
+only C<LEXER_FLAG_NOOUTPUT> makes sense as output flag. If C<stats> is not
+NULL, the time spent parsing is added to it. The number of errors in all
+chunks is returned.
+
+=cut
+
+*/
+PARROT_IGNORABLE_RESULT
+int
+split_and_parse(PARROT_INTERP, ARGIN(FILE *infile), ARGIN(char * const filename), int flags,
+                unsigned macro_size, unsigned numchunks, ARGIN_NULLOK(snapshot * const snap),
+                ARGMOD_NULLOK(compiler_stats *stats))
+{
+    ASSERT_ARGS(split_and_parse)
+    split_state  state;
+    sub_range   *subs;
+    unsigned     numsubs;
+    char        *input;
+    size_t       size;
+    size_t       total;
+    size_t       done;
+    unsigned     first = 0;
+    unsigned     i;
+    int          errors = 0;
+
+    /* read the whole file */
+    fseek(infile, 0, SEEK_END);
+    size = (size_t)ftell(infile);
+    rewind(infile);
+
+    input = (char *)mem_sys_allocate_zeroed((size + 2) * sizeof (char));
+    size  = fread(input, sizeof (char), size, infile);
+    fclose(infile);
+
+    subs = split_subs(input, size, &numsubs);
+
+    /* if the subs can't be found, parse the file as one chunk */
+    if (subs == NULL)
+        numchunks = 1;
+    else if (numchunks > numsubs)
+        numchunks = numsubs;
+
+    if (numchunks < 1)
+        numchunks = 1;
+
+    state.chunks     = mem_allocate_n_zeroed_typed(numchunks, split_chunk);
+    state.filename   = filename;
+    state.flags      = flags;
+    state.macro_size = macro_size;
+    state.snap       = snap;
+
+    /* divide the subs over the chunks, by size; each chunk gets at least one sub */
+    total = subs ? subs[numsubs - 1].end - subs[0].start : 0;
+    done  = 0;
+
+    for (i = 0; i < numchunks; ++i) {
+        split_chunk * const chunk = &state.chunks[i];
+        unsigned            last  = first;
+
+        if (subs == NULL) {
+            chunk->text = input;
+            chunk->size = size;
+        }
+        else {
+            if (i == numchunks - 1)
+                last = numsubs - 1;
+            else {
+                size_t const goal = total / numchunks * (i + 1);
+
+                /* leave a sub for each of the chunks after this one */
+                while (last + 1 < numsubs - (numchunks - 1 - i)
+                &&     subs[last].end - subs[0].start < goal)
+                    ++last;
+            }
+
+            chunk->text = make_chunk(input, size, subs, numsubs, first, last, &chunk->size);
+            first       = last + 1;
+        }
+
+        /* interpreters are created here, as creating them isn't thread-safe */
+        chunk->interp = i == 0 ? interp : Parrot_new(interp);
+    }
+
+    begin_phase(stats, PHASE_PARSE);
+    run_jobs(numchunks, numchunks, parse_chunk, &state);
+    end_phase(stats, PHASE_PARSE);
+
+    for (i = 0; i < numchunks; ++i) {
+        split_chunk * const chunk = &state.chunks[i];
+
+        errors += chunk->errors;
+
+        if (chunk->text != input)
+            mem_sys_free(chunk->text);
+
+        if (chunk->interp != interp) {
+            forget_cached_evals(chunk->interp);
+            Parrot_destroy(chunk->interp);
+        }
+    }
+
+    if (errors > 0)
+        fprintf(stderr, "There were %d errors\n", errors);
+    else if (TEST_FLAG(flags, LEXER_FLAG_NOOUTPUT))
+        fprintf(stdout, "ok\n");
+
+    if (subs != NULL)
+        mem_sys_free(subs);
+
+    mem_sys_free(state.chunks);
+    mem_sys_free(input);
+
+    return errors;
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
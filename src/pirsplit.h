@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRSPLIT_H_GUARD
+#define PARROT_PIR_PIRSPLIT_H_GUARD
+
+#include <stdio.h>
+#include "pirsnapshot.h"
+#include "pirstats.h"
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pirsplit.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+PARROT_IGNORABLE_RESULT
+int split_and_parse(PARROT_INTERP,
+    ARGIN(FILE *infile),
+    ARGIN(char * const filename),
+    int flags,
+    unsigned macro_size,
+    unsigned numchunks,
+    ARGIN_NULLOK(snapshot * const snap),
+    ARGMOD_NULLOK(compiler_stats *stats))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*stats);
+
+#define ASSERT_ARGS_split_and_parse __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(interp) \
+    , PARROT_ASSERT_ARG(infile) \
+    , PARROT_ASSERT_ARG(filename))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pirsplit.c */
+
+#endif /* PARROT_PIR_PIRSPLIT_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,683 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 DESCRIPTION
+
+This file implements the statistics that are printed with C<--stats>: the
+time spent in each phase of a compilation, and counts of the things that
+were created along the way. Phases are timed by calling C<begin_phase()> and
+C<end_phase()> around them; a phase may run more than once (for instance,
+register allocation runs once per sub), in which case the times are added.
+Both functions do nothing if no statistics are collected, so they can be
+called unconditionally.
+
+Some phases run as part of another: label fixups and register allocation
+happen while parsing, and writing the PBC file is part of emitting it.
+The report shows these nested in the phase they're part of.
+
+With C<--trace>, every phase is also written as a span to a file in the
+Chrome trace event format, which can be loaded in C<chrome://tracing> or
+converted into a flame graph. Spans for each file, each sub (from
+C<new_subr()> to C<close_sub()>) and the emission of each sub are written
+with C<begin_span()> and C<end_span()>; spans that nest in time show up
+nested in the trace. Times are taken from a monotonic clock, if there is one.
+
+With C<--mem-stats>, the memory that is allocated through C<pir_mem_allocate()>
+is accounted by what it's used for (see C<enum alloc_tag>), and so are the
+STRINGs that are made by the lexer. That memory is only freed after the
+compilation, so everything that is counted stays live until then; macro
+buffers, however, are allocated and freed by F<pirmacro.c>, which knows
+nothing about the lexer, so they are measured by walking the macro tables at
+each phase boundary. The report shows the bytes and number of allocations per
+kind, the high-water mark, and the bytes live before and after each phase.
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "pircompiler.h"
+#include "pirstats.h"
+#include "bcgen.h"
+
+/* HEADERIZER HFILE: compilers/pirc/src/pirstats.h */
+
+/* HEADERIZER BEGIN: static */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+PARROT_WARN_UNUSED_RESULT
+static unsigned long count_probes(ARGIN(lexer_state * const lexer))
+        __attribute__nonnull__(1);
+
+PARROT_WARN_UNUSED_RESULT
+static FLOATVAL current_time(void);
+
+PARROT_WARN_UNUSED_RESULT
+static unsigned long live_bytes(ARGMOD(compiler_stats *stats))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*stats);
+
+PARROT_WARN_UNUSED_RESULT
+static unsigned long measure_macros(
+    ARGIN(lexer_state * const lexer),
+    ARGOUT(unsigned long *count))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*count);
+
+static void write_event(
+    ARGMOD(compiler_stats *stats),
+    char type,
+    ARGIN(char const * const category),
+    ARGIN_NULLOK(char const *name),
+    FLOATVAL time)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*stats);
+
+static void write_json_string(ARGMOD(FILE *out), ARGIN(char const *str))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*out);
+
+#define ASSERT_ARGS_count_probes __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_current_time __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_live_bytes __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats))
+#define ASSERT_ARGS_measure_macros __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer) \
+    , PARROT_ASSERT_ARG(count))
+#define ASSERT_ARGS_write_event __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats) \
+    , PARROT_ASSERT_ARG(category))
+#define ASSERT_ARGS_write_json_string __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(out) \
+    , PARROT_ASSERT_ARG(str))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: static */
+
+/* how each phase is reported; in the order of enum compiler_phase */
+static const struct phase_info {
+    char const *key;          /* name in the JSON report */
+    char const *description;  /* name in the text report */
+    int         nested;       /* whether the phase is part of the one before */
+
+} phase_info[NUM_COMPILER_PHASES] = {
+    { "heredoc",       "heredoc preprocessing", 0 },
+    { "parse",         "lexing and parsing",    0 },
+    { "local_labels",  "local label fixup",     1 },
+    { "regalloc",      "register allocation",   1 },
+    { "global_labels", "global label fixup",    1 },
+    { "emit",          "bytecode emission",     0 },
+    { "write",         "writing PBC file",      1 }
+};
+
+/* how each kind of allocation is reported; in the order of enum alloc_tag */
+static const struct tag_info {
+    char const *key;          /* name in the JSON report */
+    char const *description;  /* name in the text report */
+
+} tag_info[NUM_ALLOC_TAGS] = {
+    { "sub",           "subroutines"    },
+    { "instruction",   "instructions"   },
+    { "expression",    "expressions"    },
+    { "target",        "targets"        },
+    { "argument",      "arguments"      },
+    { "constant",      "constants"      },
+    { "key",           "keys"           },
+    { "label",         "labels"         },
+    { "symbol",        "symbols"        },
+    { "bucket",        "hash buckets"   },
+    { "string",        "C strings"      },
+    { "op_cache",      "op cache"       },
+    { "macro_buffer",  "macro buffers"  },
+    { "parrot_string", "Parrot STRINGs" }
+};
+
+/*
+
+=head1 FUNCTIONS
+
+=over 4
+
+=item C<compiler_stats * new_compiler_stats(void)>
+
+Create a new statistics structure, with all times and counters set to zero.
+
+=cut
+
+*/
+PARROT_MALLOC
+PARROT_CANNOT_RETURN_NULL
+compiler_stats *
+new_compiler_stats(void)
+{
+    ASSERT_ARGS(new_compiler_stats)
+    return mem_allocate_zeroed_typed(compiler_stats);
+}
+
+/*
+
+=item C<static FLOATVAL current_time(void)>
+
+Return the current time in seconds. The monotonic clock is used if the
+system has one, so that times don't jump when the system clock is set;
+otherwise, the time of day is returned.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static FLOATVAL
+current_time(void)
+{
+    ASSERT_ARGS(current_time)
+#ifdef CLOCK_MONOTONIC
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+        return (FLOATVAL)now.tv_sec + (FLOATVAL)now.tv_nsec * 1e-9;
+#endif
+    return Parrot_floatval_time();
+}
+
+/*
+
+=item C<void begin_phase(compiler_stats *stats, compiler_phase phase)>
+
+Start timing the phase C<phase>, and start a span for it in the trace, if
+one is written. The first time the phase begins, the bytes that are live
+are recorded. If C<stats> is NULL, nothing is done.
+
+=cut
+
+*/
+void
+begin_phase(ARGMOD_NULLOK(compiler_stats *stats), compiler_phase phase)
+{
+    ASSERT_ARGS(begin_phase)
+    if (stats) {
+        if (stats->live_before[phase] == 0)
+            stats->live_before[phase] = live_bytes(stats);
+
+        stats->started[phase] = current_time();
+
+        if (stats->trace)
+            write_event(stats, 'B', "phase", phase_info[phase].description,
+                        stats->started[phase]);
+    }
+}
+
+/*
+
+=item C<void end_phase(compiler_stats *stats, compiler_phase phase)>
+
+Stop timing the phase C<phase>, add the time since the matching
+C<begin_phase()> to its total, and record the bytes that are live now.
+If C<stats> is NULL, nothing is done.
+
+=cut
+
+*/
+void
+end_phase(ARGMOD_NULLOK(compiler_stats *stats), compiler_phase phase)
+{
+    ASSERT_ARGS(end_phase)
+    if (stats) {
+        FLOATVAL const now = current_time();
+
+        stats->times[phase]     += now - stats->started[phase];
+        stats->live_after[phase]  = live_bytes(stats);
+
+        if (stats->trace)
+            write_event(stats, 'E', "phase", NULL, now);
+    }
+}
+
+/*
+
+=item C<void count_allocation(compiler_stats *stats, alloc_tag tag, size_t
+numbytes)>
+
+Account for an allocation of C<numbytes> bytes, which are used for the kind
+of thing C<tag>, and update the high-water mark.
+
+=cut
+
+*/
+void
+count_allocation(ARGMOD(compiler_stats *stats), alloc_tag tag, size_t numbytes)
+{
+    ASSERT_ARGS(count_allocation)
+    stats->alloc_bytes[tag] += numbytes;
+    stats->alloc_counts[tag]++;
+    stats->allocated        += numbytes;
+
+    if (stats->allocated + stats->macro_bytes > stats->peak_bytes)
+        stats->peak_bytes = stats->allocated + stats->macro_bytes;
+}
+
+/*
+
+=item C<static unsigned long measure_macros(lexer_state * const lexer, unsigned
+long *count)>
+
+Return the number of bytes in the macro tables of C<lexer> that are in scope,
+and the macro definitions in them; the number of definitions is stored in
+C<count>.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static unsigned long
+measure_macros(ARGIN(lexer_state * const lexer), ARGOUT(unsigned long *count))
+{
+    ASSERT_ARGS(measure_macros)
+    macro_table const *table = lexer->macros;
+    unsigned long      bytes = 0;
+
+    *count = 0;
+
+    for (; table != NULL; table = table->prev) {
+        macro_def const *macro;
+
+        bytes += sizeof (macro_table) + table->size * sizeof (macro_def *);
+
+        for (macro = table->definitions; macro != NULL; macro = macro->next) {
+            bytes += sizeof (macro_def) + macro->buffersize;
+            ++*count;
+        }
+    }
+
+    return bytes;
+}
+
+/*
+
+=item C<static unsigned long live_bytes(compiler_stats *stats)>
+
+Measure the macro buffers of the lexer that is being compiled, if any, and
+return the number of bytes that are live now.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static unsigned long
+live_bytes(ARGMOD(compiler_stats *stats))
+{
+    ASSERT_ARGS(live_bytes)
+    unsigned long live;
+
+    if (stats->lexer) {
+        unsigned long count;
+        stats->macro_bytes = measure_macros(stats->lexer, &count);
+    }
+
+    live = stats->allocated + stats->macro_bytes;
+
+    if (live > stats->peak_bytes)
+        stats->peak_bytes = live;
+
+    return live;
+}
+
+/*
+
+=item C<void begin_span(compiler_stats *stats, char const * const category,
+char const * const name)>
+
+Start a span called C<name> in the trace, if one is written; C<category> is
+the kind of thing the span is for, such as C<"sub">. Each span must be
+ended by C<end_span()>, in the reverse order in which they were started.
+
+=cut
+
+*/
+void
+begin_span(ARGMOD_NULLOK(compiler_stats *stats), ARGIN(char const * const category),
+           ARGIN(char const * const name))
+{
+    ASSERT_ARGS(begin_span)
+    if (stats && stats->trace)
+        write_event(stats, 'B', category, name, current_time());
+}
+
+/*
+
+=item C<void end_span(compiler_stats *stats, char const * const category)>
+
+End the span that was started last by C<begin_span()>.
+
+=cut
+
+*/
+void
+end_span(ARGMOD_NULLOK(compiler_stats *stats), ARGIN(char const * const category))
+{
+    ASSERT_ARGS(end_span)
+    if (stats && stats->trace)
+        write_event(stats, 'E', category, NULL, current_time());
+}
+
+/*
+
+=item C<int open_trace(compiler_stats *stats, char const * const filename)>
+
+Open the file C<filename> to write trace events to; all events are timed
+relative to now. If the file can't be opened, an error message is printed
+and 0 is returned; otherwise 1 is returned.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+int
+open_trace(ARGMOD(compiler_stats *stats), ARGIN(char const * const filename))
+{
+    ASSERT_ARGS(open_trace)
+    stats->trace = fopen(filename, "w");
+
+    if (stats->trace == NULL) {
+        fprintf(stderr, "Failed to open trace file '%s'\n", filename);
+        return 0;
+    }
+
+    stats->trace_start  = current_time();
+    stats->trace_events = 0;
+    fprintf(stats->trace, "{\"traceEvents\":[\n");
+    return 1;
+}
+
+/*
+
+=item C<void close_trace(compiler_stats *stats)>
+
+Finish and close the trace file of C<stats>, if it was opened.
+
+=cut
+
+*/
+void
+close_trace(ARGMOD(compiler_stats *stats))
+{
+    ASSERT_ARGS(close_trace)
+    if (stats->trace == NULL)
+        return;
+
+    fprintf(stats->trace, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(stats->trace);
+    stats->trace = NULL;
+}
+
+/*
+
+=item C<static void write_event(compiler_stats *stats, char type, char const *
+const category, char const *name, FLOATVAL time)>
+
+Write an event of type C<type> (C<'B'> for the beginning of a span, C<'E'>
+for its end) at time C<time> to the trace. C<name> may be NULL for events
+of type C<'E'>.
+
+=cut
+
+*/
+static void
+write_event(ARGMOD(compiler_stats *stats), char type, ARGIN(char const * const category),
+            ARGIN_NULLOK(char const *name), FLOATVAL time)
+{
+    ASSERT_ARGS(write_event)
+    FILE * const out = stats->trace;
+
+    fprintf(out, "%s{\"ph\":\"%c\",\"cat\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":1",
+            stats->trace_events++ ? ",\n" : "", type, category,
+            (time - stats->trace_start) * 1e6);
+
+    if (name) {
+        fprintf(out, ",\"name\":");
+        write_json_string(out, name);
+    }
+
+    fputc('}', out);
+}
+
+/*
+
+=item C<static void write_json_string(FILE *out, char const *str)>
+
+Write C<str> to C<out> as a JSON string, escaping quotes, backslashes and
+control characters.
+
+=cut
+
+*/
+static void
+write_json_string(ARGMOD(FILE *out), ARGIN(char const *str))
+{
+    ASSERT_ARGS(write_json_string)
+    fputc('"', out);
+
+    for (; *str; str++) {
+        unsigned char const c = (unsigned char)*str;
+
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+
+    fputc('"', out);
+}
+
+/*
+
+=item C<static unsigned long count_probes(lexer_state * const lexer)>
+
+Return the number of bucket lookups that were done in the hashtables of
+C<lexer> and of all its subs.
+
+=cut
+
+*/
+PARROT_WARN_UNUSED_RESULT
+static unsigned long
+count_probes(ARGIN(lexer_state * const lexer))
+{
+    ASSERT_ARGS(count_probes)
+    unsigned long probes = lexer->constants.probes
+                         + lexer->globals.probes
+                         + lexer->strings.probes
+                         + lexer->op_cache.probes;
+
+    if (lexer->subs) {
+        subroutine *subiter = lexer->subs->next;
+
+        do {
+            probes += subiter->symbols.probes + subiter->labels.probes;
+            subiter = subiter->next;
+        }
+        while (subiter != lexer->subs->next);
+    }
+
+    return probes;
+}
+
+/*
+
+=item C<void collect_stats(lexer_state * const lexer)>
+
+Store the counters that can only be found in C<lexer> in its statistics,
+if these are collected, and measure its macro buffers for the last time.
+Call this after the code was emitted, but before C<lexer> is released.
+
+=cut
+
+*/
+void
+collect_stats(ARGIN(lexer_state * const lexer))
+{
+    ASSERT_ARGS(collect_stats)
+    compiler_stats * const stats = lexer->stats;
+
+    if (stats == NULL)
+        return;
+
+    stats->hash_probes += count_probes(lexer);
+    stats->constants    = count_constants(lexer->bc);
+
+    stats->macro_bytes  = measure_macros(lexer, &stats->alloc_counts[ALLOC_MACRO_BUFFER]);
+    stats->alloc_bytes[ALLOC_MACRO_BUFFER] = stats->macro_bytes;
+
+    if (stats->allocated + stats->macro_bytes > stats->peak_bytes)
+        stats->peak_bytes = stats->allocated + stats->macro_bytes;
+
+    /* the lexer is about to be released, and its memory with it */
+    stats->lexer        = NULL;
+    stats->macro_bytes  = 0;
+}
+
+/*
+
+=item C<void print_stats(compiler_stats const * const stats, FILE *out,
+stats_format format)>
+
+Print the times and counters in C<stats> to C<out>, either as a table,
+or as a JSON object if C<format> is C<STATS_FORMAT_JSON>.
+
+=cut
+
+*/
+void
+print_stats(ARGIN(compiler_stats const * const stats), ARGMOD(FILE *out),
+            stats_format format)
+{
+    ASSERT_ARGS(print_stats)
+    FLOATVAL total = 0.0;
+    int      i;
+
+    for (i = 0; i < NUM_COMPILER_PHASES; i++)
+        if (!phase_info[i].nested)
+            total += stats->times[i];
+
+    if (format == STATS_FORMAT_JSON) {
+        fprintf(out, "{\n  \"times\": {\n");
+
+        for (i = 0; i < NUM_COMPILER_PHASES; i++)
+            fprintf(out, "    \"%s\": %.6f,\n", phase_info[i].key, stats->times[i]);
+
+        fprintf(out, "    \"total\": %.6f\n  },\n", total);
+        fprintf(out, "  \"counts\": {\n"
+                     "    \"subs\": %u,\n"
+                     "    \"instructions\": %u,\n"
+                     "    \"constants\": %u,\n"
+                     "    \"symbols\": %u,\n"
+                     "    \"macro_expansions\": %u,\n"
+                     "    \"hash_probes\": %lu\n"
+                     "  }\n}\n",
+                stats->subs, stats->instructions, stats->constants, stats->symbols,
+                stats->macro_expansions, stats->hash_probes);
+        return;
+    }
+
+    fprintf(out, "Phase                          Seconds\n");
+
+    for (i = 0; i < NUM_COMPILER_PHASES; i++)
+        fprintf(out, "%s%-*s %10.6f\n", phase_info[i].nested ? "  " : "",
+                phase_info[i].nested ? 28 : 30, phase_info[i].description,
+                stats->times[i]);
+
+    fprintf(out, "%-30s %10.6f\n\n", "total", total);
+    fprintf(out, "%-30s %10u\n", "subs", stats->subs);
+    fprintf(out, "%-30s %10u\n", "instructions", stats->instructions);
+    fprintf(out, "%-30s %10u\n", "constants", stats->constants);
+    fprintf(out, "%-30s %10u\n", "symbols", stats->symbols);
+    fprintf(out, "%-30s %10u\n", "macro expansions", stats->macro_expansions);
+    fprintf(out, "%-30s %10lu\n", "hash table probes", stats->hash_probes);
+}
+
+/*
+
+=item C<void print_memory_stats(compiler_stats const * const stats, FILE *out,
+stats_format format)>
+
+Print the memory accounting in C<stats> to C<out>: the bytes and number of
+allocations of each kind, the high-water mark, and the bytes live before
+and after each phase; either as a table, or as a JSON object if C<format>
+is C<STATS_FORMAT_JSON>. The macro buffers are those that were defined when
+the file was parsed.
+
+=cut
+
+*/
+void
+print_memory_stats(ARGIN(compiler_stats const * const stats), ARGMOD(FILE *out),
+                   stats_format format)
+{
+    ASSERT_ARGS(print_memory_stats)
+    unsigned long total_bytes  = 0;
+    unsigned long total_counts = 0;
+    int           i;
+
+    for (i = 0; i < NUM_ALLOC_TAGS; i++) {
+        total_bytes  += stats->alloc_bytes[i];
+        total_counts += stats->alloc_counts[i];
+    }
+
+    if (format == STATS_FORMAT_JSON) {
+        fprintf(out, "{\n  \"allocations\": {\n");
+
+        for (i = 0; i < NUM_ALLOC_TAGS; i++)
+            fprintf(out, "    \"%s\": { \"count\": %lu, \"bytes\": %lu },\n",
+                    tag_info[i].key, stats->alloc_counts[i], stats->alloc_bytes[i]);
+
+        fprintf(out, "    \"total\": { \"count\": %lu, \"bytes\": %lu }\n  },\n",
+                total_counts, total_bytes);
+        fprintf(out, "  \"peak_bytes\": %lu,\n  \"live_bytes\": {\n", stats->peak_bytes);
+
+        for (i = 0; i < NUM_COMPILER_PHASES; i++)
+            fprintf(out, "    \"%s\": { \"before\": %lu, \"after\": %lu }%s\n",
+                    phase_info[i].key, stats->live_before[i], stats->live_after[i],
+                    i + 1 < NUM_COMPILER_PHASES ? "," : "");
+
+        fprintf(out, "  }\n}\n");
+        return;
+    }
+
+    fprintf(out, "%-24s %11s %14s\n", "Allocations", "Count", "Bytes");
+
+    for (i = 0; i < NUM_ALLOC_TAGS; i++)
+        fprintf(out, "%-24s %11lu %14lu\n", tag_info[i].description,
+                stats->alloc_counts[i], stats->alloc_bytes[i]);
+
+    fprintf(out, "%-24s %11lu %14lu\n\n", "total", total_counts, total_bytes);
+    fprintf(out, "%-24s %26lu\n\n", "high-water mark", stats->peak_bytes);
+    fprintf(out, "%-22s %14s %14s\n", "Live bytes", "Before", "After");
+
+    for (i = 0; i < NUM_COMPILER_PHASES; i++)
+        fprintf(out, "%s%-*s %14lu %14lu\n", phase_info[i].nested ? "  " : "",
+                phase_info[i].nested ? 20 : 22, phase_info[i].description,
+                stats->live_before[i], stats->live_after[i]);
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
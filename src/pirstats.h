@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+#ifndef PARROT_PIR_PIRSTATS_H_GUARD
+#define PARROT_PIR_PIRSTATS_H_GUARD
+
+#include "pircompiler.h"
+
+/* the phases of a compilation that are timed separately */
+typedef enum compiler_phase {
+    PHASE_HEREDOC,        /* process_heredocs() */
+    PHASE_PARSE,          /* yypirparse(), including the next three phases */
+    PHASE_LOCAL_LABELS,   /* fixup_local_labels(), from close_sub() */
+    PHASE_REGALLOC,       /* linear_scan_register_allocation() */
+    PHASE_GLOBAL_LABELS,  /* fixup_global_labels() */
+    PHASE_EMIT,           /* emit_pbc(), including writing the file */
+    PHASE_WRITE,          /* write_pbc_file() */
+
+    NUM_COMPILER_PHASES   /* not a phase; keep this one last */
+
+} compiler_phase;
+
+/* output formats of print_stats() */
+typedef enum stats_format {
+    STATS_FORMAT_TEXT,
+    STATS_FORMAT_JSON
+
+} stats_format;
+
+/* timings and counters of a compilation; requested with --stats or --trace */
+typedef struct compiler_stats {
+    FLOATVAL      times[NUM_COMPILER_PHASES];   /* total seconds spent in each phase */
+    FLOATVAL      started[NUM_COMPILER_PHASES]; /* start of the current run of each phase */
+
+    unsigned      subs;
+    unsigned      instructions;
+    unsigned      constants;         /* size of the constant table, after emitting */
+    unsigned      symbols;
+    unsigned      macro_expansions;
+    unsigned long hash_probes;       /* bucket lookups in all of the lexer's hashtables */
+
+    FILE         *trace;             /* trace event file, if requested with --trace */
+    FLOATVAL      trace_start;       /* time at which the trace was opened */
+    unsigned      trace_events;      /* number of events written to trace */
+
+    /* memory accounting, reported with --mem-stats; see count_allocation() */
+    unsigned long alloc_bytes[NUM_ALLOC_TAGS];
+    unsigned long alloc_counts[NUM_ALLOC_TAGS];
+    unsigned long allocated;         /* bytes allocated so far, except macro buffers */
+    unsigned long macro_bytes;       /* bytes in macro buffers, when last measured */
+    unsigned long peak_bytes;        /* high-water mark of allocated + macro_bytes */
+    unsigned long live_before[NUM_COMPILER_PHASES]; /* bytes live when a phase first began */
+    unsigned long live_after[NUM_COMPILER_PHASES];  /* bytes live when a phase last ended */
+
+    struct lexer_state *lexer;       /* lexer being compiled; its macro buffers are measured */
+
+} compiler_stats;
+
+/* increment counter FIELD of the lexer's statistics, if these are collected */
+#define COUNT_STAT(L, FIELD)    do { if ((L)->stats) ++(L)->stats->FIELD; } while (0)
+
+/* account for STRING S that was made by the lexer, if statistics are collected */
+#define COUNT_STRING(L, S) \
+    do { \
+        if ((L)->stats) \
+            count_allocation((L)->stats, ALLOC_PARROT_STRING, sizeof (STRING) + (S)->bufused); \
+    } while (0)
+
+/* HEADERIZER BEGIN: compilers/pirc/src/pirstats.c */
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+
+void begin_phase(ARGMOD_NULLOK(compiler_stats *stats), compiler_phase phase)
+        FUNC_MODIFIES(*stats);
+
+void begin_span(
+    ARGMOD_NULLOK(compiler_stats *stats),
+    ARGIN(char const * const category),
+    ARGIN(char const * const name))
+        __attribute__nonnull__(2)
+        __attribute__nonnull__(3)
+        FUNC_MODIFIES(*stats);
+
+void close_trace(ARGMOD(compiler_stats *stats))
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*stats);
+
+void collect_stats(ARGIN(lexer_state * const lexer))
+        __attribute__nonnull__(1);
+
+void count_allocation(
+    ARGMOD(compiler_stats *stats),
+    alloc_tag tag,
+    size_t numbytes)
+        __attribute__nonnull__(1)
+        FUNC_MODIFIES(*stats);
+
+void end_phase(ARGMOD_NULLOK(compiler_stats *stats), compiler_phase phase)
+        FUNC_MODIFIES(*stats);
+
+void end_span(
+    ARGMOD_NULLOK(compiler_stats *stats),
+    ARGIN(char const * const category))
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*stats);
+
+PARROT_MALLOC
+PARROT_CANNOT_RETURN_NULL
+compiler_stats * new_compiler_stats(void);
+
+PARROT_WARN_UNUSED_RESULT
+int open_trace(
+    ARGMOD(compiler_stats *stats),
+    ARGIN(char const * const filename))
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*stats);
+
+void print_memory_stats(
+    ARGIN(compiler_stats const * const stats),
+    ARGMOD(FILE *out),
+    stats_format format)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*out);
+
+void print_stats(
+    ARGIN(compiler_stats const * const stats),
+    ARGMOD(FILE *out),
+    stats_format format)
+        __attribute__nonnull__(1)
+        __attribute__nonnull__(2)
+        FUNC_MODIFIES(*out);
+
+#define ASSERT_ARGS_begin_phase __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_begin_span __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(category) \
+    , PARROT_ASSERT_ARG(name))
+#define ASSERT_ARGS_close_trace __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats))
+#define ASSERT_ARGS_collect_stats __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(lexer))
+#define ASSERT_ARGS_count_allocation __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats))
+#define ASSERT_ARGS_end_phase __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_end_span __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(category))
+#define ASSERT_ARGS_new_compiler_stats __attribute__unused__ int _ASSERT_ARGS_CHECK = (0)
+#define ASSERT_ARGS_open_trace __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats) \
+    , PARROT_ASSERT_ARG(filename))
+#define ASSERT_ARGS_print_memory_stats __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats) \
+    , PARROT_ASSERT_ARG(out))
+#define ASSERT_ARGS_print_stats __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(stats) \
+    , PARROT_ASSERT_ARG(out))
+/* Don't modify between HEADERIZER BEGIN / HEADERIZER END.  Your changes will be lost. */
+/* HEADERIZER END: compilers/pirc/src/pirstats.c */
+
+#endif /* PARROT_PIR_PIRSTATS_H_GUARD */
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
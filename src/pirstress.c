@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2009, Parrot Foundation.
+ */
+
+/*
+
+=head1 NAME
+
+pirstress.c - compile a file in many threads at the same time
+
+=head1 SYNOPSIS
+
+ $ ./pirstress file.pir [threads [rounds]]
+
+=head1 DESCRIPTION
+
+Compiles C<file.pir> to bytecode once, as a reference, and then starts
+C<threads> threads (32 by default) that each compile it C<rounds> times
+(4 by default), all at the same time. Every round runs the heredoc
+preprocessor and C<parse_file()>, writing the bytecode to a file of the
+thread's own, and evaluates a small PIR string with C<parse_string()>.
+The bytecode must be identical to the reference every time; a thread that
+sees a difference, or an error, reports it.
+
+Each thread has an interpreter of its own, which is created by the main
+thread before any thread is started. The files written by the threads are
+removed afterwards. When the interpreters are destroyed, a new one evaluates
+the same string; it must not find the bytecode of a destroyed interpreter in
+the eval cache, even if it's created at the same address.
+
+The exit status is 0 if all compilations succeeded and matched, and 1
+otherwise. If Parrot was built without threads, nothing is done, and the
+exit status is 0.
+
+=cut
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pircompiler.h"
+#include "pirheredoc.h"
+#include "pircapi.h"
+#include "pircache.h"
+
+/* HEADERIZER HFILE: none */
+
+/* number of threads and rounds, if not given */
+#define STRESS_THREADS      32
+#define STRESS_ROUNDS       4
+
+/* maximum number of threads */
+#define STRESS_MAX_THREADS  256
+
+/* PIR code that is evaluated in each round, next to compiling the file */
+#define STRESS_EVAL         ".sub stress_eval\n    $I0 = 42\n    .return ($I0)\n.end\n"
+
+/* what a thread needs to know, and what it reports */
+typedef struct stress_job {
+    Interp       *interp;
+    char         *source;          /* the file to compile */
+    char const   *reference;       /* the reference bytecode */
+    size_t        reference_size;
+    unsigned      thr_id;          /* names the output files; 0 is the reference */
+    unsigned      rounds;
+    unsigned      failures;        /* number of rounds that failed */
+
+} stress_job;
+
+/*
+
+=over 4
+
+=item C<static char * slurp(char const * const filename, size_t *size)>
+
+Read the file C<filename> into a new buffer, and store its size in C<size>.
+NULL is returned if the file can't be read.
+
+=cut
+
+*/
+static char *
+slurp(char const * const filename, size_t *size)
+{
+    FILE *file = fopen(filename, "rb");
+    char *buffer;
+    long  length;
+
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    rewind(file);
+
+    buffer = (char *)mem_sys_allocate(length + 1);
+    *size  = fread(buffer, 1, length, file);
+    fclose(file);
+
+    return buffer;
+}
+
+/*
+
+=item C<static int compile(PARROT_INTERP, char *source, unsigned thr_id, char
+*pbcfile)>
+
+Run the heredoc preprocessor on C<source> and compile the result to the
+bytecode file C<pbcfile>, using C<thr_id> to name the other files that are
+written. The number of errors is returned.
+
+=cut
+
+*/
+static int
+compile(PARROT_INTERP, char *source, unsigned thr_id, char *pbcfile)
+{
+    char             hdocfile[32];
+    FILE            *file;
+    include_list    *includes;
+    int              errors;
+    compile_options  options;
+
+    sprintf(hdocfile, "stress_hdoc_%u", thr_id);
+
+    file = open_file(hdocfile, "w");
+    if (file == NULL)
+        return 1;
+
+    includes = process_heredocs(interp, source, file, &errors);
+    fclose(file);
+
+    if (errors > 0) {
+        free_include_list(includes);
+        remove(hdocfile);
+        return errors;
+    }
+
+    file = open_file(hdocfile, "r");
+    if (file == NULL) {
+        free_include_list(includes);
+        return 1;
+    }
+
+    init_compile_options(&options, LEXER_FLAG_OUTPUTPBC);
+    options.thr_id     = thr_id;
+    options.outputfile = pbcfile;
+    options.includes   = includes;
+
+    /* parse_file() closes file */
+    errors = parse_file(interp, file, source, &options);
+
+    free_include_list(includes);
+    remove(hdocfile);
+
+    return errors;
+}
+
+/*
+
+=item C<static void * run_job(void *arg)>
+
+Thread body: compile the file of the C<stress_job> C<arg> as many times as
+it says, and count the rounds in which something went wrong.
+
+=cut
+
+*/
+static void *
+run_job(void *arg)
+{
+    stress_job * const job = (stress_job *)arg;
+    char               pbcfile[32];
+    char               listing[32];
+    unsigned           round;
+
+    sprintf(pbcfile, "stress_%u.pbc", job->thr_id);
+    sprintf(listing, "output_thr_%u", job->thr_id);
+
+    for (round = 0; round < job->rounds; round++) {
+        char   *output;
+        size_t  size = 0;
+
+        if (compile(job->interp, job->source, job->thr_id, pbcfile) != 0) {
+            fprintf(stderr, "thread %u: errors in round %u\n", job->thr_id, round);
+            ++job->failures;
+            continue;
+        }
+
+        output = slurp(pbcfile, &size);
+
+        if (output == NULL
+        ||  size != job->reference_size
+        ||  memcmp(output, job->reference, size) != 0)
+        {
+            fprintf(stderr, "thread %u: bytecode differs in round %u\n", job->thr_id, round);
+            ++job->failures;
+        }
+        else if (parse_string(job->interp, (char *)STRESS_EVAL, LEXER_FLAG_OUTPUTPBC, 0,
+                              INIT_MACRO_SIZE) == NULL)
+        {
+            fprintf(stderr, "thread %u: evaluation failed in round %u\n", job->thr_id, round);
+            ++job->failures;
+        }
+
+        if (output != NULL)
+            mem_sys_free(output);
+    }
+
+    remove(pbcfile);
+    remove(listing);
+
+    return NULL;
+}
+
+/*
+
+=item C<int main(int argc, char *argv[])>
+
+Compile the reference, run the threads and report the failures.
+
+=cut
+
+*/
+int
+main(int argc, char *argv[])
+{
+#ifdef PARROT_HAS_THREADS
+    PARROT_INTERP             = Parrot_new(NULL);
+    unsigned      threads     = STRESS_THREADS;
+    unsigned      rounds      = STRESS_ROUNDS;
+    unsigned      failures    = 0;
+    unsigned      hits;
+    unsigned      misses;
+    unsigned      fresh_hits;
+    Interp       *fresh;
+    char          reffile[]   = "stress_0.pbc";
+    char         *reference   = NULL;
+    size_t        refsize     = 0;
+    unsigned      i;
+    Parrot_thread threadids[STRESS_MAX_THREADS];
+    stress_job    jobs[STRESS_MAX_THREADS];
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s file.pir [threads [rounds]]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (argc > 2)
+        threads = strtoul(argv[2], NULL, 10);
+
+    if (argc > 3)
+        rounds = strtoul(argv[3], NULL, 10);
+
+    if (threads == 0 || threads > STRESS_MAX_THREADS || rounds == 0) {
+        fprintf(stderr, "The number of threads must be 1 to %d, and of rounds at least 1\n",
+                STRESS_MAX_THREADS);
+        exit(EXIT_FAILURE);
+    }
+
+    /* the reference is compiled before any thread runs */
+    if (compile(interp, argv[1], 0, reffile) != 0
+    ||  (reference = slurp(reffile, &refsize)) == NULL)
+    {
+        fprintf(stderr, "Failed to compile '%s'\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    remove(reffile);
+    remove("output_thr_0");
+
+    /* interpreters are created here, as creating them isn't thread-safe */
+    for (i = 0; i < threads; i++) {
+        jobs[i].interp         = Parrot_new(interp);
+        jobs[i].source         = argv[1];
+        jobs[i].reference      = reference;
+        jobs[i].reference_size = refsize;
+        jobs[i].thr_id         = i + 1;
+        jobs[i].rounds         = rounds;
+        jobs[i].failures       = 0;
+    }
+
+    for (i = 0; i < threads; i++)
+        THREAD_CREATE_JOINABLE(threadids[i], run_job, &jobs[i]);
+
+    for (i = 0; i < threads; i++) {
+        void *result;
+        JOIN(threadids[i], result);
+        failures += jobs[i].failures;
+    }
+
+    for (i = 0; i < threads; i++) {
+        forget_cached_evals(jobs[i].interp);
+        Parrot_destroy(jobs[i].interp);
+    }
+
+    get_eval_cache_stats(&hits, &misses);
+
+    fresh = Parrot_new(interp);
+
+    if (parse_string(fresh, (char *)STRESS_EVAL, LEXER_FLAG_OUTPUTPBC, 0,
+                     INIT_MACRO_SIZE) == NULL)
+    {
+        fprintf(stderr, "evaluation failed in a new interpreter\n");
+        ++failures;
+    }
+
+    get_eval_cache_stats(&fresh_hits, &misses);
+
+    if (fresh_hits != hits) {
+        fprintf(stderr, "a new interpreter found the bytecode of a destroyed one\n");
+        ++failures;
+    }
+
+    forget_cached_evals(fresh);
+    Parrot_destroy(fresh);
+
+    mem_sys_free(reference);
+
+    printf("%u threads, %u rounds each: %u failed\n", threads, rounds, failures);
+    printf("eval cache: %u hits, %u misses\n", fresh_hits, misses);
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+    UNUSED(argc);
+    UNUSED(argv);
+
+    printf("Parrot was built without threads; nothing to do\n");
+    return EXIT_SUCCESS;
+#endif
+}
+
+/*
+
+=back
+
+=cut
+
+*/
+
+/*
+ * Local variables:
+ *   c-file-style: "parrot"
+ * End:
+ * vim: expandtab shiftwidth=4:
+ */
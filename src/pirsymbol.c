@@ -6,6 +6,7 @@
 #include "pircompunit.h"
 #include "piryy.h"
 #include "pirerr.h"
+#include "pirstats.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -196,8 +197,8 @@ assign_vanilla_register(ARGIN(lexer_state * const lexer),
 
 =item C<unsigned get_hashcode(char const * const str, unsigned num_buckets)>
 
-Calculate the hash code for the string C<str>.
-This code is taken from IMCC.
+Calculate the hash code for the string C<str>, as an index into a table of
+C<num_buckets> buckets; see C<hash_chars()>.
 
 =cut
 
@@ -208,13 +209,34 @@ unsigned
 get_hashcode(ARGIN(char const * const str), unsigned num_buckets)
 {
     ASSERT_ARGS(get_hashcode)
-    unsigned long  key = 0;
-    char const    *s;
+    return hash_chars(str, strlen(str)) % num_buckets;
+}
+
+/*
+
+=item C<unsigned long hash_chars(char const * const str, size_t length)>
 
-    for (s = str; *s ; s++)
-        key = key * 65599 + *s;
+Calculate the hash value of the C<length> characters at C<str>, which need
+not be NULL-terminated. This code is taken from IMCC. The value is not
+reduced to a bucket index, so tables of different sizes can be searched
+with it.
 
-    return key % num_buckets;
+=cut
+
+*/
+PARROT_PURE_FUNCTION
+PARROT_WARN_UNUSED_RESULT
+unsigned long
+hash_chars(ARGIN(char const * const str), size_t length)
+{
+    ASSERT_ARGS(hash_chars)
+    unsigned long key = 0;
+    size_t        i;
+
+    for (i = 0; i < length; i++)
+        key = key * 65599 + str[i];
+
+    return key;
 }
 
 /*
@@ -241,6 +263,7 @@ store_bucket(ARGIN(hashtable * const table),
 =item C<bucket * get_bucket(hashtable * const table, unsigned long hash)>
 
 Return the bucket at hash index C<hash> from the hashtable C<table>.
+The lookup is counted in C<table>'s number of probes.
 
 =cut
 
@@ -251,6 +274,7 @@ bucket *
 get_bucket(ARGIN(hashtable * const table), unsigned long hash)
 {
     ASSERT_ARGS(get_bucket)
+    ++table->probes;
     return table->contents[hash];
 }
 
@@ -271,13 +295,15 @@ new_symbol(ARGIN(lexer_state * const lexer),
         ARGIN(char const * const name), pir_type type)
 {
     ASSERT_ARGS(new_symbol)
-    symbol *sym = pir_mem_allocate_zeroed_typed(lexer, symbol);
+    symbol *sym = pir_mem_allocate_zeroed_typed(lexer, symbol, ALLOC_SYMBOL);
 
     sym->info.id.name = name;
     sym->info.type    = type;
     sym->info.color   = NO_REG_ALLOCATED;
 
     sym->next   = NULL;
+
+    COUNT_STAT(lexer, symbols);
     return sym;
 }
 
@@ -454,7 +480,7 @@ static pir_reg *
 new_pir_reg(ARGMOD(lexer_state *lexer), pir_type type, int regno)
 {
     ASSERT_ARGS(new_pir_reg)
-    pir_reg *r = pir_mem_allocate_zeroed_typed(lexer, pir_reg);
+    pir_reg *r = pir_mem_allocate_zeroed_typed(lexer, pir_reg, ALLOC_SYMBOL);
 
     r->info.type     = type;
     r->info.color    = NO_REG_ALLOCATED;
@@ -649,7 +675,7 @@ new_global_label(ARGIN(lexer_state * const lexer),
         ARGIN(char const * const name))
 {
     ASSERT_ARGS(new_global_label)
-    global_label *glob = pir_mem_allocate_zeroed_typed(lexer, global_label);
+    global_label *glob = pir_mem_allocate_zeroed_typed(lexer, global_label, ALLOC_LABEL);
     glob->name         = name;
     glob->const_table_index = 0;
     return glob;
@@ -788,7 +814,7 @@ new_local_label(ARGIN(lexer_state * const lexer),
 {
     ASSERT_ARGS(new_local_label)
 
-    local_label *l = pir_mem_allocate_zeroed_typed(lexer, local_label);
+    local_label *l = pir_mem_allocate_zeroed_typed(lexer, local_label, ALLOC_LABEL);
     l->name        = name;
     l->offset      = offset;
     return l;
@@ -144,6 +144,11 @@ PARROT_WARN_UNUSED_RESULT
 unsigned get_hashcode(ARGIN(char const * const str), unsigned num_buckets)
         __attribute__nonnull__(1);
 
+PARROT_PURE_FUNCTION
+PARROT_WARN_UNUSED_RESULT
+unsigned long hash_chars(ARGIN(char const * const str), size_t length)
+        __attribute__nonnull__(1);
+
 PARROT_WARN_UNUSED_RESULT
 PARROT_CANNOT_RETURN_NULL
 symbol * new_symbol(
@@ -207,6 +212,8 @@ void store_local_label(
        PARROT_ASSERT_ARG(table))
 #define ASSERT_ARGS_get_hashcode __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(str))
+#define ASSERT_ARGS_hash_chars __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
+       PARROT_ASSERT_ARG(str))
 #define ASSERT_ARGS_new_symbol __attribute__unused__ int _ASSERT_ARGS_CHECK = (\
        PARROT_ASSERT_ARG(lexer) \
     , PARROT_ASSERT_ARG(name))
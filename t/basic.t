@@ -5,7 +5,7 @@ use strict;
 use warnings;
 
 use lib qw(lib);
-use Parrot::Test tests => 6;
+use Parrot::Test tests => 7;
 
 pirc_2_pasm_is(<<'CODE', <<'OUTPUT', "a local, a reg and an if-stat");
 .sub main
@@ -121,6 +121,36 @@ CODE
 3.3
 OUTPUT
 
+pirc_2_pasm_is(<<'CODE', <<'OUTPUT', "the same op with operands of other types");
+.sub main
+    $I0 = 1
+    $I1 = 2
+    add $I0, $I1
+    add $I0, 3
+    $N0 = 0.5
+    add $N0, 1.25
+    add $N0, $N0
+    say $I0
+    say $N0
+    $I0 = 1
+    add $I0, 3
+    say $I0
+    $P0 = new "Hash"
+    $P0["a"] = 7
+    $I2 = $P0["a"]
+    say $I2
+    $P0[1] = 8
+    $I2 = $P0[1]
+    say $I2
+.end
+CODE
+6
+3.5
+4
+7
+8
+OUTPUT
+
 
 
 # Local Variables:
@@ -0,0 +1,105 @@
+#!perl
+# Copyright (C) 2009, Parrot Foundation.
+
+use strict;
+use warnings;
+
+use lib qw(lib compilers/pirc/t/lib);
+use Test::More tests => 6;
+use File::Spec::Functions qw(catfile);
+use Pirc::Test;
+
+my $lib = catfile(qw(compilers pirc t), 'include_lib.pir');
+
+my $twice = <<"CODE";
+.sub main :main
+    .include "$lib"
+    .include "$lib"
+    say \$I0
+.end
+CODE
+
+# a file is inserted each time it's included, unless it says otherwise
+
+write_file($lib, <<'LIB');
+.macro_const STEP 1
+    $I0 += .STEP
+LIB
+
+is( pirc_run($twice), "2\n", "a file is inserted each time it is included" );
+
+write_file($lib, <<'LIB');
+# increments $I0 once per file
+#pragma once
+.macro_const STEP 1
+    $I0 += .STEP
+LIB
+
+is( pirc_run($twice), "1\n", "a file marked '#pragma once' is inserted once" );
+
+# the file is included by another file, after it was included directly
+
+my $outer = catfile(qw(compilers pirc t), 'include_outer.pir');
+
+write_file($outer, <<"OUTER");
+    .include "$lib"
+    \$I1 += 1
+OUTER
+
+is( pirc_run(<<"CODE"), "1 1\n", "a '#pragma once' file isn't inserted again by another file" );
+.sub main :main
+    .include "$lib"
+    .include "$outer"
+    print \$I0
+    print " "
+    say \$I1
+.end
+CODE
+
+is( pirc_run(<<"CODE"), "1 2\n", "nor by another file that is included twice" );
+.sub main :main
+    .include "$outer"
+    .include "$outer"
+    .include "$lib"
+    print \$I0
+    print " "
+    say \$I1
+.end
+CODE
+
+unlink $outer;
+
+# -M writes a make rule for the output file, listing all included files
+
+{
+    my $base = write_source(<<"CODE", 'include_deps');
+.sub main :main
+    .include "$lib"
+    say \$I0
+.end
+CODE
+
+    pirc('-b', '-o', "$base.pbc", '-M', "$base.d", "$base.pir");
+
+    my $rules = '';
+    if (open my $fh, '<', "$base.d") {
+        local $/;
+        $rules = <$fh>;
+        close $fh;
+    }
+
+    like( $rules, qr/^\Q$base.pbc: $base.pir\E \\\n\s+\S*include_lib\.pir$/m,
+        "-M lists the included file as a prerequisite" );
+    like( $rules, qr/^\S*include_lib\.pir:$/m, "-M adds an empty rule for the included file" );
+
+    unlink "$base.pir", "$base.pbc", "$base.d";
+}
+
+unlink $lib;
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
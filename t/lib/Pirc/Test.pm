@@ -0,0 +1,187 @@
+# Copyright (C) 2009, Parrot Foundation.
+
+package Pirc::Test;
+
+use strict;
+use warnings;
+
+use Exporter;
+use Parrot::Config;
+use File::Basename qw(fileparse);
+use File::Spec::Functions qw(catfile);
+
+our @ISA    = qw(Exporter);
+our @EXPORT = qw($pirc $parrot write_file write_source pirc pirc_run pirc_run_as
+                 pirc_pbc pirc_check);
+
+=head1 NAME
+
+Pirc::Test - helpers for the tests of pirc that run it with options
+
+=head1 SYNOPSIS
+
+    use lib qw(lib compilers/pirc/t/lib);
+    use Test::More tests => 1;
+    use Pirc::Test;
+
+    is( pirc_run($code, '-O'), "ok\n", "-O keeps the output" );
+
+=head1 DESCRIPTION
+
+C<Parrot::Test>'s C<pirc_2_pasm_is()> can't pass options to pirc; the tests
+that need them use these functions. They are run from the root of the Parrot
+tree. The files they write are in F<compilers/pirc/t>, named after the test
+script, and are removed when done.
+
+=head2 Variables
+
+=over 4
+
+=item C<$pirc>, C<$parrot>
+
+The paths of the executables.
+
+=back
+
+=cut
+
+our $pirc   = catfile(qw(. compilers pirc), "pirc$PConfig{exe}");
+our $parrot = catfile('.', "parrot$PConfig{exe}");
+
+# the files of a test script are named after it, e.g. options_1.pir
+my ($prefix) = fileparse($0, '.t');
+my $count    = 0;
+
+=head2 Functions
+
+=over 4
+
+=item C<write_file($name, $contents)>
+
+Write C<$contents> to the file C<$name>.
+
+=cut
+
+sub write_file {
+    my ($name, $contents) = @_;
+
+    open my $fh, '>', $name or die "Can't write $name: $!";
+    print {$fh} $contents;
+    close $fh;
+}
+
+=item C<write_source($code [, $name])>
+
+Write C<$code> to F<compilers/pirc/t/$name.pir>, and return its name without
+the extension. Without C<$name>, a new name is made up.
+
+=cut
+
+sub write_source {
+    my ($code, $name) = @_;
+
+    $name = $prefix . '_' . ++$count unless defined $name;
+
+    my $base = catfile(qw(compilers pirc t), $name);
+    write_file("$base.pir", $code);
+
+    return $base;
+}
+
+=item C<pirc(@args)>
+
+Run pirc with the arguments in C<@args>, and return what it printed; in list
+context, its exit status too.
+
+=cut
+
+sub pirc {
+    my @args   = @_;
+    my $output = `$pirc @args 2>&1`;
+
+    return wantarray ? ($output, $? >> 8) : $output;
+}
+
+=item C<pirc_run($code, @opts)>
+
+Compile C<$code> with pirc and the options in C<@opts>, run the bytecode, and
+return what both printed.
+
+=item C<pirc_run_as($name, $code, @opts)>
+
+The same, but the code is stored in F<compilers/pirc/t/$name.pir>, for tests
+that depend on the name of the file.
+
+=cut
+
+sub pirc_run {
+    my ($code, @opts) = @_;
+
+    return pirc_run_as(undef, $code, @opts);
+}
+
+sub pirc_run_as {
+    my ($name, $code, @opts) = @_;
+    my $base = write_source($code, $name);
+
+    my $output = pirc(@opts, '-b', '-o', "$base.pbc", "$base.pir");
+    $output   .= `$parrot $base.pbc 2>&1` if -e "$base.pbc";
+
+    unlink "$base.pir", "$base.pbc";
+    return $output;
+}
+
+=item C<pirc_pbc($code, @opts)>
+
+Compile C<$code> with pirc and the options in C<@opts>, and return the
+bytecode. The name of the input file is part of it, so it's always the same.
+
+=cut
+
+sub pirc_pbc {
+    my ($code, @opts) = @_;
+    my $base = write_source($code, $prefix . '_pbc');
+
+    pirc(@opts, '-b', '-o', "$base.pbc", "$base.pir");
+
+    my $pbc = '';
+    if (open my $in, '<', "$base.pbc") {
+        binmode $in;
+        local $/;
+        $pbc = <$in>;
+        close $in;
+    }
+
+    unlink "$base.pir", "$base.pbc";
+    return $pbc;
+}
+
+=item C<pirc_check($code, @opts)>
+
+Check C<$code> with pirc and the options in C<@opts>, and return what pirc
+printed. The file has the same name every time, so that the messages can be
+compared.
+
+=cut
+
+sub pirc_check {
+    my ($code, @opts) = @_;
+    my $base   = write_source($code, $prefix . '_check');
+    my $output = pirc(@opts, '-n', "$base.pir");
+
+    unlink "$base.pir";
+    return $output;
+}
+
+=back
+
+=cut
+
+1;
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
@@ -5,7 +5,7 @@ use strict;
 use warnings;
 
 use lib qw(lib);
-use Parrot::Test tests => 1;
+use Parrot::Test tests => 5;
 
 pirc_2_pasm_is(<<'CODE', <<'OUTPUT', "a single const declaration");
 .sub main
@@ -15,6 +15,79 @@ CODE
 ok
 OUTPUT
 
+# a body larger than the default initial macro buffer of 4096 bytes
+my $body = "    inc \$I0\n" x 500;
+
+pirc_2_pasm_is(<<"CODE", <<'OUTPUT', "a macro body that must grow its buffer");
+.macro add_500()
+$body.endm
+
+.sub main
+    \$I0 = 0
+    .add_500()
+    say \$I0
+.end
+CODE
+500
+OUTPUT
+
+# enough macro constants to share hash buckets
+my $consts = join '', map { ".macro_const C$_ $_\n" } 1 .. 300;
+
+pirc_2_pasm_is(<<"CODE", <<'OUTPUT', "many macro constants");
+$consts
+.sub main
+    say .C1
+    say .C150
+    say .C300
+.end
+CODE
+1
+150
+300
+OUTPUT
+
+pirc_2_pasm_is(<<'CODE', <<'OUTPUT', "a macro parameter hides a macro constant");
+.macro_const x 1
+
+.macro show(x)
+    say .x
+.endm
+
+.sub main
+    say .x
+    .show(2)
+    say .x
+.end
+CODE
+1
+2
+1
+OUTPUT
+
+# the arguments of each expansion are freed when it ends
+pirc_2_pasm_is(<<'CODE', <<'OUTPUT', "a macro with arguments expanded several times");
+.macro add_to(reg, value)
+    .reg += .value
+.endm
+
+.sub main
+    $I0 = 0
+    $I1 = 0
+    .add_to($I0, 1)
+    .add_to($I0, 2)
+    .add_to($I0, 3)
+    say $I0
+    .add_to($I0, 10)
+    .add_to($I1, 10)
+    .add_to($I0, 100)
+    say $I0
+.end
+CODE
+6
+116
+OUTPUT
+
 # Local Variables:
 #   mode: cperl
 #   cperl-indent-level: 4
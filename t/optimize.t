@@ -0,0 +1,125 @@
+#!perl
+# Copyright (C) 2009, Parrot Foundation.
+
+use strict;
+use warnings;
+
+use lib qw(lib compilers/pirc/t/lib);
+use Test::More tests => 7;
+use Pirc::Test;
+
+# -t: subs that can only be found by :nsentry, :subid or :outer are kept
+
+is( pirc_run(<<'CODE', '-t'), "called\nstored\n",
+.sub main :main
+    $P0 = get_global 'stored'
+    $P0()
+.end
+
+.sub 'called'
+    say "called"
+.end
+
+.sub 'other' :nsentry('stored')
+    'called'()
+    say "stored"
+.end
+CODE
+    "-t keeps a sub stored by its :nsentry, and what it calls" );
+
+is( pirc_run(<<'CODE', '-t'), "outer\n", "-t keeps an :outer sub named by its :subid" );
+.sub main :main
+    'inner'()
+.end
+
+.sub 'outer' :subid('outer_id')
+    .lex '$a', $P0
+.end
+
+.sub 'inner' :outer('outer_id')
+    say "outer"
+.end
+CODE
+
+like( pirc_run(<<'CODE', '-t', '-v'), qr/removing unreachable sub 'dead'.*^main$/ms,
+.sub main :main
+    say "main"
+.end
+
+.sub 'dead'
+    say "dead"
+.end
+CODE
+    "-t removes a sub that is never referenced" );
+
+is( pirc_run(<<'CODE', '-t', '--keep=api,other'), "api\n",
+.sub main :main
+    $S0 = 'ap'
+    $S0 .= 'i'
+    $P0 = get_global $S0
+    $P0()
+.end
+
+.sub 'api'
+    say "api"
+.end
+CODE
+    "-t keeps the subs passed to --keep, which it can't see being called" );
+
+# -c: keys are unpacked after the strings they refer to, however often used
+
+is( pirc_run(<<'CODE', '-c'), "42\n42\n42\n", "-c keeps a rarely used string before its key" );
+.sub main :main
+    $P0 = new 'Hash'
+    $P0['rare'] = 42
+    $I0 = $P0['rare']
+    say $I0
+    $I0 = $P0['rare']
+    say $I0
+    $I0 = $P0['rare']
+    say $I0
+.end
+CODE
+
+# unreferenced constants are removed; the others are renumbered
+
+is( pirc_run(<<'CODE'), "3.5\nkey\nargs 2 b\n", "renumbered constants are still found" );
+.sub main :main
+    $N0 = 3.5
+    say $N0
+    $P0 = new 'Hash'
+    $P0['key'] = 'key'
+    $S0 = $P0['key']
+    say $S0
+    'args'(2, 'b')
+.end
+
+.sub 'args'
+    .param int a
+    .param string b
+    print "args "
+    print a
+    print " "
+    say b
+.end
+CODE
+
+like( pirc_run(<<'CODE', '-t', '-v'), qr/^removed [1-9]\d* unused constants$.*^live$/ms,
+.sub main :main
+    say "live"
+.end
+
+.sub 'dead'
+    say "only used by a dead sub"
+    $N0 = 2.25
+    say $N0
+.end
+CODE
+    "the constants of a removed sub are removed too" );
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
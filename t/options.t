@@ -0,0 +1,307 @@
+#!perl
+# Copyright (C) 2009, Parrot Foundation.
+
+use strict;
+use warnings;
+
+use lib qw(lib compilers/pirc/t/lib);
+use Test::More tests => 22;
+use File::Spec::Functions qw(catfile);
+use File::Path qw(mkpath rmtree);
+use Pirc::Test;
+
+my $hello = <<'CODE';
+.sub main :main
+    say "hello"
+.end
+CODE
+
+# -C: the bytecode is stored in the cache, and copied from it the next time
+
+{
+    my $cache = catfile(qw(compilers pirc t), 'options_cache');
+    mkpath($cache);
+
+    # the name of the input file is part of the hash
+    is( pirc_run_as('options_cached', $hello, '-C', $cache), "hello\n",
+        "-C stores the bytecode in the cache" );
+    is( pirc_run_as('options_cached', $hello, '-C', $cache), "hello\n",
+        "-C copies the bytecode from the cache" );
+
+    opendir my $dir, $cache or die "Can't read $cache: $!";
+    my @files = grep { !/^\./ } readdir $dir;
+    closedir $dir;
+
+    is( scalar @files, 1, "-C leaves no temporary files behind" );
+
+    rmtree($cache);
+}
+
+# -P writes a snapshot of the macros and constants; -L loads them again
+
+{
+    my $prelude = catfile(qw(compilers pirc t), 'options_prelude.pir');
+    my $snap    = catfile(qw(compilers pirc t), 'options.snap');
+
+    write_file($prelude, <<'CODE');
+.macro_const ANSWER 42
+.macro greet(who)
+    print "hello, "
+    say .who
+.endm
+.sub prelude
+.end
+CODE
+
+    my $output = `$pirc -n -P $snap $prelude 2>&1`;
+    is( $output, "ok\n", "-P writes a snapshot" );
+
+    is( pirc_run(<<'CODE', '-L', $snap), "42\nhello, world\n",
+.sub main :main
+    say .ANSWER
+    .greet("world")
+.end
+CODE
+        "-L defines the macros and constants of the snapshot" );
+
+    # a large prelude, to catch loading times that grow faster than the snapshot
+    write_file($prelude, join('', map { ".macro_const VALUE_$_ \"value $_\"\n" } 1 .. 20000)
+                         . ".sub prelude\n.end\n");
+
+    `$pirc -n -P $snap $prelude 2>&1`;
+
+    is( pirc_run(<<'CODE', '-L', $snap), "value 1\nvalue 20000\n",
+.sub main :main
+    say .VALUE_1
+    say .VALUE_20000
+.end
+CODE
+        "-L loads a snapshot of 20000 definitions" );
+
+    unlink $prelude, $snap;
+}
+
+# -z: the input is scanned in place; macro bodies must survive that
+
+is( pirc_run(<<'CODE', '-z'), "hello\nhello\n3\nhere\n",
+.macro greet()
+    say "hello"
+.endm
+
+.sub main :main
+    .greet()
+    .greet()
+    $P0 = new 'Hash'
+    $P0['a:b'] = 3
+    $I0 = $P0['a:b']
+    say $I0
+    $S0 = <<'DOC'
+here
+DOC
+    print $S0
+.end
+CODE
+    "-z scans macros, keys and heredocs in place" );
+
+# --stats and --trace report on the phases of the compiler
+
+my $two_subs = <<'CODE';
+.macro greet()
+    'hello'()
+.endm
+
+.sub main :main
+    .greet()
+    .greet()
+.end
+
+.sub 'hello'
+    say "hello"
+.end
+CODE
+
+like( pirc_run($two_subs, '--stats'), qr/^subs\s+2$.*^macro expansions\s+2$/ms,
+    "--stats counts the subs and macro expansions" );
+
+like( pirc_run($two_subs, '--stats=json'), qr/"subs": 2,.*"macro_expansions": 2,/s,
+    "--stats=json prints the same counts as JSON" );
+
+{
+    my $trace = catfile(qw(compilers pirc t), 'options_trace.json');
+
+    pirc_run($two_subs, "--trace=$trace");
+
+    my $events = '';
+    if (open my $fh, '<', $trace) {
+        local $/;
+        $events = <$fh>;
+        close $fh;
+    }
+
+    my $sub_event = qr/"cat":"sub"[^}]*"name":"'?hello'?"/;
+
+    like( $events, qr/\A\{"traceEvents":\[.*$sub_event.*\],"displayTimeUnit":"ms"\}\n\z/s,
+        "--trace writes the subs as trace events" );
+
+    unlink $trace;
+}
+
+# --mem-stats accounts the memory by kind of allocation
+
+like( pirc_run($two_subs, '--mem-stats'),
+    qr/^subroutines\s+2\s+[1-9]\d*$.*^high-water mark\s+[1-9]\d*$/ms,
+    "--mem-stats counts the memory of each kind, and the high-water mark" );
+
+like( pirc_run($two_subs, '--mem-stats=json'),
+    qr/"sub": \{ "count": 2, "bytes": [1-9]\d* \}.*"peak_bytes": [1-9]\d*,/s,
+    "--mem-stats=json prints the same as JSON" );
+
+# -j: registers are allocated on several threads, with the same result
+
+{
+    my $subs = join '', map { <<"CODE" } 1 .. 12;
+.sub 'sub_$_'
+    .param int n
+    .local int i, j
+    .local num x
+    .local string s
+    i = n + $_
+    j = i * 2
+    x = j / 3.0
+    s = 'sub_$_'
+    print s
+    print ' '
+    say x
+    .return (i)
+.end
+
+CODE
+
+    my $one  = pirc_pbc($subs, '-r', '-j', 1);
+    my $four = pirc_pbc($subs, '-r', '-j', 4);
+
+    ok( length $one > 0 && $one eq $four, "-j 4 generates the same bytecode as -j 1" );
+}
+
+# --split checks the subs in chunks, with the same result as a whole
+
+{
+    # a file of 8 subs, of which sub $bad uses an undeclared variable
+    my $split_file = sub {
+        my ($bad) = @_;
+        my $code  = <<'CODE';
+.macro_const BASE 10
+.macro twice(x)
+    .x *= 2
+.endm
+
+CODE
+
+        for my $n (1 .. 8) {
+            my $var = $n == $bad ? 'j' : 'i';
+
+            $code .= <<"CODE";
+.namespace ['Split'; 'N$n']
+
+=head2 sub_$n
+
+Documentation, which is not part of any chunk.
+
+=cut
+
+.sub 'sub_$n'
+    .local int i
+    i = .BASE + $n
+    .twice(i)
+    say $var
+.end
+
+CODE
+        }
+
+        return $code;
+    };
+
+    my $good = $split_file->(0);
+    is( pirc_check($good, '--split=4'), "ok\n", "--split=4 -n accepts what -n accepts" );
+
+    my $bad = $split_file->(6);
+    is( pirc_check($bad, '--split=4'), pirc_check($bad),
+        "--split=4 -n reports the same error as -n" );
+
+    # each chunk sees the text outside the subs, but only one reports on it
+    my $outside = $good . "say 'outside'\n";
+    is( pirc_check($outside, '--split=4'), pirc_check($outside),
+        "--split=4 -n reports an error outside the subs once" );
+}
+
+# --project compiles the files of a project, each to a .pbc file next to it
+
+{
+    my $dir     = catfile(qw(compilers pirc t), 'options_project');
+    my $shared  = catfile($dir, 'shared.inc');
+    my $listing = catfile($dir, 'files');
+    mkpath($dir);
+
+    write_file($shared, <<'CODE');
+.macro_const GREETING "hello from "
+CODE
+
+    my @names = qw(one two three);
+    for my $name (@names) {
+        write_file(catfile($dir, "$name.pir"), <<"CODE");
+.sub main :main
+    .include "$shared"
+    print .GREETING
+    say "$name"
+.end
+CODE
+    }
+
+    write_file($listing, join '', "# the files of the project\n",
+                                  map { catfile($dir, "$_.pir") . "\n" } @names);
+
+    my $output = `$pirc -b -j 2 --project=$listing 2>&1`;
+    is( $?, 0, "--project compiles all files of a project" ) or diag($output);
+
+    my $ran = join '', map { `$parrot @{[ catfile($dir, "$_.pbc") ]} 2>&1` } @names;
+    is( $ran, "hello from one\nhello from two\nhello from three\n",
+        "--project writes the bytecode of each file next to it" );
+
+    my @scratch = (glob('hdoctemp_*_*'), glob('output_thr_*_*'));
+    is( scalar @scratch, 0, "--project leaves no scratch files behind" );
+
+    like( `$pirc -n --stats --project=$listing 2>&1`, qr/can't be used with '--stats'/,
+        "--project rejects --stats" );
+
+    # a file that is missing, or includes a missing file, only fails itself
+    my $missing  = catfile($dir, 'missing.pir');
+    my $includer = catfile($dir, 'includer.pir');
+
+    write_file($includer, <<"CODE");
+.sub main :main
+    .include "@{[ catfile($dir, 'missing.inc') ]}"
+.end
+CODE
+
+    write_file($listing, join '', map { "$_\n" } $missing, $includer, catfile($dir, 'one.pir'));
+
+    unlink catfile($dir, 'one.pbc');
+
+    $output = `$pirc -b -j 2 --project=$listing 2>&1`;
+    ok( $? != 0 && $output =~ /Failed to compile '\Q$missing\E'/
+               && $output =~ /Failed to compile '\Q$includer\E'/,
+        "--project reports the files that can't be read, and fails" ) or diag($output);
+
+    is( `$parrot @{[ catfile($dir, 'one.pbc') ]} 2>&1`, "hello from one\n",
+        "--project still compiles the other files" );
+
+    rmtree($dir);
+}
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
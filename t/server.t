@@ -0,0 +1,106 @@
+#!perl
+# Copyright (C) 2009, Parrot Foundation.
+
+use strict;
+use warnings;
+
+use lib qw(lib compilers/pirc/t/lib);
+use Test::More;
+use File::Spec::Functions qw(catfile);
+use Cwd qw(abs_path);
+use Pirc::Test;
+
+plan skip_all => 'the compile server needs Unix domain sockets' if $^O eq 'MSWin32';
+plan tests => 8;
+
+my $socket = abs_path(catfile(qw(compilers pirc t))) . "/server_$$.sock";
+
+my $hello = <<'CODE';
+.sub main :main
+    say "hello"
+.end
+CODE
+
+my $server = fork;
+die "Can't fork: $!" unless defined $server;
+
+if ($server == 0) {
+    exec $pirc, "--server=$socket", '-j', 2 or die "Can't start $pirc: $!";
+}
+
+END { kill 'TERM', $server if $server; unlink $socket if defined $socket; }
+
+for (1 .. 100) {
+    last if -S $socket;
+    select undef, undef, undef, 0.1;
+}
+
+ok( -S $socket, "--server listens on the socket, with -j after it" );
+is( (stat $socket)[2] & 0777, 0600, "only the server's user can use the socket" );
+
+{
+    local $ENV{PIRC_SERVER} = $socket;
+    my $base   = write_source($hello);
+    my $output = pirc('-b', '-o', "$base.pbc", "$base.pir");
+
+    is( $output . `$parrot $base.pbc 2>&1`, "hello\n", "the server compiles a request" );
+
+    unlink "$base.pir", "$base.pbc";
+}
+
+{
+    my $base = write_source(<<'CODE');
+.sub main :main
+    say undeclared
+.end
+CODE
+
+    local $ENV{PIRC_SERVER} = $socket;
+    my ($output, $status) = pirc('-n', "$base.pir");
+
+    ok( $status != 0 && $output =~ /symbol 'undeclared' not declared/,
+        "the client gets the errors and exit status of the compilation" );
+
+    unlink "$base.pir";
+}
+
+{
+    # the empty argument is the input file; it isn't the end of the request
+    local $ENV{PIRC_SERVER} = $socket;
+    my $output = pirc('-n', "''");
+
+    like( $output, qr/error opening file ''/, "an empty argument is passed on to the server" );
+}
+
+{
+    local $ENV{PIRC_SERVER} = catfile(qw(compilers pirc t), 'no_server.sock');
+    my $base   = write_source($hello);
+    my $output = pirc('-n', "$base.pir");
+
+    is( $output, "ok\n", "without a server, the client compiles the file itself" );
+
+    unlink "$base.pir";
+}
+
+{
+    # requests in the same directory at the same time
+    my @bases = map { write_source($hello) } 1 .. 4;
+
+    local $ENV{PIRC_SERVER} = $socket;
+    system(join(' ', map { "$pirc -b -o $_.pbc $_.pir &" } @bases) . ' wait');
+
+    my $ran = join '', map { `$parrot $_.pbc 2>&1` } @bases;
+    is( $ran, "hello\n" x 4, "the server compiles requests in the same directory at once" );
+
+    unlink map { ("$_.pir", "$_.pbc") } @bases;
+}
+
+like( `$pirc --server=$socket.2 -b 2>&1`, qr/can only be used with option '-j'/,
+    "--server rejects the other options" );
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4:
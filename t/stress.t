@@ -0,0 +1,52 @@
+#!perl
+# Copyright (C) 2009, Parrot Foundation.
+
+use strict;
+use warnings;
+
+use lib qw(lib);
+use Test::More;
+use Parrot::Config;
+use File::Spec::Functions qw(catfile);
+
+my $pirstress = catfile('.', "pirstress$PConfig{exe}");
+
+plan skip_all => 'pirstress is not built; run make pirstress' unless -x $pirstress;
+plan skip_all => 'Parrot was built without threads' unless $PConfig{HAS_THREADS};
+plan tests => 2;
+
+my $source = catfile(qw(compilers pirc t), 'stress.pir');
+
+open my $fh, '>', $source or die "Can't write $source: $!";
+print {$fh} <<'CODE';
+.sub main :main
+    $I0 = 'twice'(21)
+    say $I0
+.end
+
+.sub 'twice'
+    .param int n
+    n *= 2
+    .return (n)
+.end
+CODE
+close $fh;
+
+my $output = `$pirstress $source 2 3 2>&1`;
+
+unlink $source;
+
+like( $output, qr/^2 threads, 3 rounds each: 0 failed$/m,
+    "threads compiling the same file get the same bytecode" );
+
+# each thread misses once and then hits; a new interpreter misses as well,
+# even if it's created at the address of one that was destroyed.
+like( $output, qr/^eval cache: 4 hits, 3 misses$/m,
+    "evals are cached per interpreter, and forgotten when it's destroyed" );
+
+# Local Variables:
+#   mode: cperl
+#   cperl-indent-level: 4
+#   fill-column: 100
+# End:
+# vim: expandtab shiftwidth=4: